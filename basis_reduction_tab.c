@@ -43,10 +43,37 @@ struct tab_lp {
 #define GBR_is_zero(a)			    (mpq_sgn(a) == 0)
 #define GBR_numref(a)			    mpq_numref(a)
 #define GBR_denref(a)			    mpq_denref(a)
+#ifdef USE_SMALL_INT_OPT
+#define GBR_floor(a, b)                                    \
+	do {                                               \
+		mpz_fdiv_q(isl_siogmp_reinit_big(a),       \
+		    GBR_numref(b), GBR_denref(b));         \
+		isl_siogmp_try_demote(a);                  \
+	} while (0)
+#define GBR_ceil(a, b)                                     \
+	do {                                               \
+		mpz_cdiv_q(isl_siogmp_reinit_big(a),       \
+		    GBR_numref(b), GBR_denref(b));         \
+		isl_siogmp_try_demote(a);                  \
+	} while (0)
+#define GBR_set_num_neg(a, b)                              \
+	do {                                               \
+		isl_siogmp_scratchspace_t scratch;         \
+		mpz_neg(GBR_numref(*a),                    \
+		    isl_siogmp_bigarg_src(*b, &scratch));  \
+	} while (0)
+#define GBR_set_den(a, b)                                  \
+	do {                                               \
+		isl_siogmp_scratchspace_t scratch;         \
+		mpz_set(GBR_denref(*a),                    \
+		    isl_siogmp_bigarg_src(*b, &scratch));  \
+	} while (0)
+#else /* USE_SMALL_INT_OPT */
 #define GBR_floor(a,b)			    mpz_fdiv_q(a,GBR_numref(b),GBR_denref(b))
 #define GBR_ceil(a,b)			    mpz_cdiv_q(a,GBR_numref(b),GBR_denref(b))
 #define GBR_set_num_neg(a, b)		    mpz_neg(GBR_numref(*a), b);
 #define GBR_set_den(a, b)		    mpz_set(GBR_denref(*a), b);
+#endif /* USE_SMALL_INT_OPT */
 #endif /* USE_GMP_FOR_MP */
 
 #ifdef USE_IMATH_FOR_MP
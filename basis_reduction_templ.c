@@ -15,8 +15,20 @@
 #include <isl_map_private.h>
 #include <isl_vec_private.h>
 #include <isl_options_private.h>
+#include <isl_profile_private.h>
 #include "isl_basis_reduction.h"
 
+/* Record that an LP is about to be solved.
+ * Solving the LP is charged to the budgets of the current thread,
+ * such that the computation is aborted if any of them is exhausted.
+ */
+static isl_stat count_lp(isl_ctx *ctx)
+{
+	isl_atomic_inc(&ctx->stats->gbr_solved_lps);
+	isl_profile_count(ctx, isl_profile_gbr_lps);
+	return isl_ctx_charge_budget(ctx) < 0 ? isl_stat_error : isl_stat_ok;
+}
+
 static void save_alpha(GBR_LP *lp, int first, int n, GBR_type *alpha)
 {
 	int i;
@@ -42,11 +54,12 @@ static void save_alpha(GBR_LP *lp, int first, int n, GBR_type *alpha)
  *  for Integer Programming" of Cook el al. to compute a reduced basis.
  * We use \epsilon = 1/4.
  *
- * If ctx->opt->gbr_only_first is set, the user is only interested
+ * If "only_first" is set, the user is only interested
  * in the first direction.  In this case we stop the basis reduction when
  * the width in the first direction becomes smaller than 2.
  */
-struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
+struct isl_tab *isl_tab_compute_reduced_basis_only_first(struct isl_tab *tab,
+	int only_first)
 {
 	unsigned dim;
 	struct isl_ctx *ctx;
@@ -71,7 +84,6 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 	int fixed_saved = 0;
 	int mu_fixed[2];
 	int n_bounded;
-	int gbr_only_first;
 
 	if (!tab)
 		return NULL;
@@ -80,7 +92,6 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 		return tab;
 
 	ctx = tab->mat->ctx;
-	gbr_only_first = ctx->opt->gbr_only_first;
 	dim = tab->n_var;
 	B = tab->basis;
 	if (!B)
@@ -131,8 +142,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 	i = tab->n_zero;
 
 	GBR_lp_set_obj(lp, B->row[1+i]+1, dim);
-	ctx->stats->gbr_solved_lps++;
-	if (GBR_lp_solve(lp) < 0)
+	if (count_lp(ctx) < 0 || GBR_lp_solve(lp) < 0)
 		goto error;
 	GBR_lp_get_obj_val(lp, &F[i]);
 
@@ -149,8 +159,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 	do {
 		if (i+1 == tab->n_zero) {
 			GBR_lp_set_obj(lp, B->row[1+i+1]+1, dim);
-			ctx->stats->gbr_solved_lps++;
-			if (GBR_lp_solve(lp) < 0)
+			if (count_lp(ctx) < 0 || GBR_lp_solve(lp) < 0)
 				goto error;
 			GBR_lp_get_obj_val(lp, &F_new);
 			fixed = GBR_lp_is_fixed(lp);
@@ -164,8 +173,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 		} else {
 			row = GBR_lp_add_row(lp, B->row[1+i]+1, dim);
 			GBR_lp_set_obj(lp, B->row[1+i+1]+1, dim);
-			ctx->stats->gbr_solved_lps++;
-			if (GBR_lp_solve(lp) < 0)
+			if (count_lp(ctx) < 0 || GBR_lp_solve(lp) < 0)
 				goto error;
 			GBR_lp_get_obj_val(lp, &F_new);
 			fixed = GBR_lp_is_fixed(lp);
@@ -194,8 +202,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 						ctx->one, B->row[1+i+1]+1,
 						tmp, B->row[1+i]+1, dim);
 				GBR_lp_set_obj(lp, b_tmp->el, dim);
-				ctx->stats->gbr_solved_lps++;
-				if (GBR_lp_solve(lp) < 0)
+				if (count_lp(ctx) < 0 || GBR_lp_solve(lp) < 0)
 					goto error;
 				GBR_lp_get_obj_val(lp, &mu_F[j]);
 				mu_fixed[j] = GBR_lp_is_fixed(lp);
@@ -245,7 +252,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 				--i;
 			} else {
 				GBR_set(F[tab->n_zero], F_new);
-				if (gbr_only_first && GBR_lt(F[tab->n_zero], two))
+				if (only_first && GBR_lt(F[tab->n_zero], two))
 					break;
 
 				if (fixed) {
@@ -305,6 +312,18 @@ error:
 	return tab;
 }
 
+/* Compute a reduced basis for the set represented by the tableau "tab",
+ * only interested in the first direction if
+ * the gbr_only_first option is set.
+ */
+struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
+{
+	if (!tab)
+		return NULL;
+	return isl_tab_compute_reduced_basis_only_first(tab,
+					tab->mat->ctx->opt->gbr_only_first);
+}
+
 /* Compute an affine form of a reduced basis of the given basic
  * non-parametric set, which is assumed to be bounded and not
  * include any integer divisions.
@@ -377,6 +377,10 @@ __isl_give isl_map *isl_pw_aff_gt_map(__isl_take isl_pw_aff *pa1,
 __isl_constructor
 __isl_give isl_pw_aff *isl_pw_aff_read_from_str(isl_ctx *ctx, const char *str);
 __isl_give char *isl_pw_aff_to_str(__isl_keep isl_pw_aff *pa);
+__isl_give isl_pw_aff *isl_pw_aff_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
+__isl_give void *isl_pw_aff_to_binary(__isl_keep isl_pw_aff *pa,
+	size_t *size);
 __isl_give isl_printer *isl_printer_print_pw_aff(__isl_take isl_printer *p,
 	__isl_keep isl_pw_aff *pwaff);
 void isl_pw_aff_dump(__isl_keep isl_pw_aff *pwaff);
@@ -626,6 +630,10 @@ __isl_give isl_pw_multi_aff *isl_pw_multi_aff_from_map(__isl_take isl_map *map);
 __isl_constructor
 __isl_give isl_pw_multi_aff *isl_pw_multi_aff_read_from_str(isl_ctx *ctx,
 	const char *str);
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_read_from_binary(
+	isl_ctx *ctx, const void *data, size_t size);
+__isl_give void *isl_pw_multi_aff_to_binary(
+	__isl_keep isl_pw_multi_aff *pma, size_t *size);
 void isl_pw_multi_aff_dump(__isl_keep isl_pw_multi_aff *pma);
 
 
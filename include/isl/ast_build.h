@@ -34,6 +34,10 @@ int isl_options_get_ast_build_group_coscheduled(isl_ctx *ctx);
 isl_stat isl_options_set_ast_build_separation_bounds(isl_ctx *ctx, int val);
 int isl_options_get_ast_build_separation_bounds(isl_ctx *ctx);
 
+isl_stat isl_options_set_ast_build_separation_max_pieces(isl_ctx *ctx,
+	int val);
+int isl_options_get_ast_build_separation_max_pieces(isl_ctx *ctx);
+
 isl_stat isl_options_set_ast_build_scale_strides(isl_ctx *ctx, int val);
 int isl_options_get_ast_build_scale_strides(isl_ctx *ctx);
 
@@ -43,6 +47,15 @@ int isl_options_get_ast_build_allow_else(isl_ctx *ctx);
 isl_stat isl_options_set_ast_build_allow_or(isl_ctx *ctx, int val);
 int isl_options_get_ast_build_allow_or(isl_ctx *ctx);
 
+isl_stat isl_options_set_ast_build_parallel(isl_ctx *ctx, int val);
+int isl_options_get_ast_build_parallel(isl_ctx *ctx);
+
+isl_stat isl_options_set_ast_build_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_ast_build_cache_size(isl_ctx *ctx);
+
+isl_stat isl_options_set_ast_build_expr_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_ast_build_expr_cache_size(isl_ctx *ctx);
+
 isl_ctx *isl_ast_build_get_ctx(__isl_keep isl_ast_build *build);
 
 __isl_constructor
@@ -115,6 +128,9 @@ __isl_give isl_ast_expr *isl_ast_build_call_from_multi_pw_aff(
 
 __isl_give isl_ast_node *isl_ast_build_node_from_schedule(
 	__isl_keep isl_ast_build *build, __isl_take isl_schedule *schedule);
+__isl_give isl_printer *isl_ast_build_print_from_schedule(
+	__isl_keep isl_ast_build *build, __isl_take isl_schedule *schedule,
+	__isl_take isl_printer *p, __isl_take isl_ast_print_options *options);
 __isl_export
 __isl_give isl_ast_node *isl_ast_build_node_from_schedule_map(
 	__isl_keep isl_ast_build *build, __isl_take isl_union_map *schedule);
@@ -52,10 +52,9 @@ extern "C" {
  * another ctx.  Functions for moving objects from one ctx to another
  * will be added as the need arises.
  *
- * A given context should only be used inside a single thread.
- * A global context for synchronization between different threads
- * as well as functions for moving a context to a different thread
- * will be added as the need arises.
+ * A given context should only be used inside a single thread,
+ * unless it has been made concurrent using isl_ctx_enable_concurrency,
+ * which requires isl to have been built with thread support.
  *
  * If anything goes wrong (out of memory, failed assertion), then
  * the library will currently simply abort.  This will be made
@@ -163,6 +162,9 @@ void isl_ctx_ref(struct isl_ctx *ctx);
 void isl_ctx_deref(struct isl_ctx *ctx);
 void isl_ctx_free(isl_ctx *ctx);
 
+isl_stat isl_ctx_enable_concurrency(isl_ctx *ctx);
+isl_bool isl_ctx_is_concurrent(isl_ctx *ctx);
+
 void isl_ctx_abort(isl_ctx *ctx);
 void isl_ctx_resume(isl_ctx *ctx);
 int isl_ctx_aborted(isl_ctx *ctx);
@@ -171,6 +173,29 @@ void isl_ctx_set_max_operations(isl_ctx *ctx, unsigned long max_operations);
 unsigned long isl_ctx_get_max_operations(isl_ctx *ctx);
 void isl_ctx_reset_operations(isl_ctx *ctx);
 
+isl_stat isl_ctx_push_budget(isl_ctx *ctx, unsigned long max_operations,
+	double max_seconds);
+isl_bool isl_ctx_pop_budget(isl_ctx *ctx);
+
+isl_stat isl_ctx_push_arena(isl_ctx *ctx);
+isl_stat isl_ctx_pop_arena(isl_ctx *ctx);
+size_t isl_ctx_get_arena_retained(isl_ctx *ctx);
+
+unsigned long isl_ctx_get_memo_hits(isl_ctx *ctx);
+unsigned long isl_ctx_get_memo_misses(isl_ctx *ctx);
+void isl_ctx_reset_memo(isl_ctx *ctx);
+
+unsigned long isl_ctx_get_ast_cache_hits(isl_ctx *ctx);
+unsigned long isl_ctx_get_ast_cache_misses(isl_ctx *ctx);
+void isl_ctx_reset_ast_cache(isl_ctx *ctx);
+
+unsigned long isl_ctx_get_blk_cache_hits(isl_ctx *ctx);
+unsigned long isl_ctx_get_blk_cache_misses(isl_ctx *ctx);
+
+__isl_give char *isl_ctx_stats_to_str(isl_ctx *ctx);
+__isl_give char *isl_ctx_stats_to_json(isl_ctx *ctx);
+void isl_ctx_reset_profile(isl_ctx *ctx);
+
 #define ISL_ARG_CTX_DECL(prefix,st,args)				\
 st *isl_ctx_peek_ ## prefix(isl_ctx *ctx);
 
@@ -114,6 +114,9 @@ __isl_export
 __isl_give isl_union_flow *isl_union_access_info_compute_flow(
 	__isl_take isl_union_access_info *access);
 
+isl_stat isl_options_set_flow_parallel(isl_ctx *ctx, int val);
+int isl_options_get_flow_parallel(isl_ctx *ctx);
+
 isl_ctx *isl_union_flow_get_ctx(__isl_keep isl_union_flow *flow);
 __isl_give isl_union_flow *isl_union_flow_copy(
 	__isl_keep isl_union_flow *flow);
@@ -194,6 +194,10 @@ __isl_give isl_basic_map *isl_basic_map_read_from_str(isl_ctx *ctx,
 __isl_give isl_map *isl_map_read_from_file(isl_ctx *ctx, FILE *input);
 __isl_constructor
 __isl_give isl_map *isl_map_read_from_str(isl_ctx *ctx, const char *str);
+__isl_give isl_basic_map *isl_basic_map_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
+__isl_give isl_map *isl_map_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
 void isl_basic_map_dump(__isl_keep isl_basic_map *bmap);
 void isl_map_dump(__isl_keep isl_map *map);
 __isl_give char *isl_basic_map_to_str(__isl_keep isl_basic_map *bmap);
@@ -202,6 +206,9 @@ __isl_give isl_printer *isl_printer_print_basic_map(
 __isl_give char *isl_map_to_str(__isl_keep isl_map *map);
 __isl_give isl_printer *isl_printer_print_map(__isl_take isl_printer *printer,
 	__isl_keep isl_map *map);
+__isl_give void *isl_basic_map_to_binary(__isl_keep isl_basic_map *bmap,
+	size_t *size);
+__isl_give void *isl_map_to_binary(__isl_keep isl_map *map, size_t *size);
 __isl_give isl_basic_map *isl_basic_map_fix_si(__isl_take isl_basic_map *bmap,
 		enum isl_dim_type type, unsigned pos, int value);
 __isl_give isl_basic_map *isl_basic_map_fix_val(__isl_take isl_basic_map *bmap,
@@ -46,6 +46,40 @@ int isl_options_get_pip_symmetry(isl_ctx *ctx);
 isl_stat isl_options_set_coalesce_bounded_wrapping(isl_ctx *ctx, int val);
 int isl_options_get_coalesce_bounded_wrapping(isl_ctx *ctx);
 
+isl_stat isl_options_set_lp_float_presolve(isl_ctx *ctx, int val);
+int isl_options_get_lp_float_presolve(isl_ctx *ctx);
+
+isl_stat isl_options_set_union_map_parallel(isl_ctx *ctx, int val);
+int isl_options_get_union_map_parallel(isl_ctx *ctx);
+
+isl_stat isl_options_set_n_threads(isl_ctx *ctx, int val);
+int isl_options_get_n_threads(isl_ctx *ctx);
+
+isl_stat isl_options_set_memo_size(isl_ctx *ctx, int val);
+int isl_options_get_memo_size(isl_ctx *ctx);
+
+#define			ISL_MEMO_COALESCE	(1 << 0)
+#define			ISL_MEMO_IS_SUBSET	(1 << 1)
+#define			ISL_MEMO_IS_EMPTY	(1 << 2)
+#define			ISL_MEMO_GIST		(1 << 3)
+#define			ISL_MEMO_ALL		(ISL_MEMO_COALESCE | \
+						 ISL_MEMO_IS_SUBSET | \
+						 ISL_MEMO_IS_EMPTY | \
+						 ISL_MEMO_GIST)
+isl_stat isl_options_set_memo_operations(isl_ctx *ctx, int val);
+int isl_options_get_memo_operations(isl_ctx *ctx);
+
+isl_stat isl_options_set_blk_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_blk_cache_size(isl_ctx *ctx);
+
+isl_stat isl_options_set_print_stats(isl_ctx *ctx, int val);
+int isl_options_get_print_stats(isl_ctx *ctx);
+
+#define			ISL_PRINT_STATS_TEXT	0
+#define			ISL_PRINT_STATS_JSON	1
+isl_stat isl_options_set_print_stats_format(isl_ctx *ctx, int val);
+int isl_options_get_print_stats_format(isl_ctx *ctx);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -44,6 +44,12 @@ int isl_options_get_schedule_separate_components(isl_ctx *ctx);
 isl_stat isl_options_set_schedule_serialize_sccs(isl_ctx *ctx, int val);
 int isl_options_get_schedule_serialize_sccs(isl_ctx *ctx);
 
+isl_stat isl_options_set_schedule_parallel_components(isl_ctx *ctx, int val);
+int isl_options_get_schedule_parallel_components(isl_ctx *ctx);
+
+isl_stat isl_options_set_schedule_reuse_lp(isl_ctx *ctx, int val);
+int isl_options_get_schedule_reuse_lp(isl_ctx *ctx);
+
 isl_stat isl_options_set_schedule_whole_component(isl_ctx *ctx, int val);
 int isl_options_get_schedule_whole_component(isl_ctx *ctx);
 
@@ -191,6 +197,10 @@ __isl_give isl_printer *isl_printer_print_schedule(__isl_take isl_printer *p,
 	__isl_keep isl_schedule *schedule);
 void isl_schedule_dump(__isl_keep isl_schedule *schedule);
 __isl_give char *isl_schedule_to_str(__isl_keep isl_schedule *schedule);
+__isl_give isl_schedule *isl_schedule_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
+__isl_give void *isl_schedule_to_binary(__isl_keep isl_schedule *schedule,
+	size_t *size);
 
 #if defined(__cplusplus)
 }
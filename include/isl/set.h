@@ -138,6 +138,10 @@ __isl_give isl_basic_set *isl_basic_set_read_from_str(isl_ctx *ctx,
 __isl_give isl_set *isl_set_read_from_file(isl_ctx *ctx, FILE *input);
 __isl_constructor
 __isl_give isl_set *isl_set_read_from_str(isl_ctx *ctx, const char *str);
+__isl_give isl_basic_set *isl_basic_set_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
+__isl_give isl_set *isl_set_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
 void isl_basic_set_dump(__isl_keep isl_basic_set *bset);
 void isl_set_dump(__isl_keep isl_set *set);
 __isl_give isl_printer *isl_printer_print_basic_set(
@@ -515,6 +519,9 @@ __isl_give isl_pw_aff *isl_set_dim_min(__isl_take isl_set *set, int pos);
 
 __isl_give char *isl_basic_set_to_str(__isl_keep isl_basic_set *bset);
 __isl_give char *isl_set_to_str(__isl_keep isl_set *set);
+__isl_give void *isl_basic_set_to_binary(__isl_keep isl_basic_set *bset,
+	size_t *size);
+__isl_give void *isl_set_to_binary(__isl_keep isl_set *set, size_t *size);
 
 #if defined(__cplusplus)
 }
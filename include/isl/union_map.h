@@ -281,6 +281,10 @@ __isl_constructor
 __isl_give isl_union_map *isl_union_map_read_from_str(isl_ctx *ctx,
 	const char *str);
 __isl_give char *isl_union_map_to_str(__isl_keep isl_union_map *umap);
+__isl_give isl_union_map *isl_union_map_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size);
+__isl_give void *isl_union_map_to_binary(__isl_keep isl_union_map *umap,
+	size_t *size);
 __isl_give isl_printer *isl_printer_print_union_map(__isl_take isl_printer *p,
 	__isl_keep isl_union_map *umap);
 void isl_union_map_dump(__isl_keep isl_union_map *umap);
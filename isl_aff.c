@@ -253,7 +253,7 @@ __isl_give isl_aff *isl_aff_copy(__isl_keep isl_aff *aff)
 	if (!aff)
 		return NULL;
 
-	aff->ref++;
+	isl_atomic_inc(&aff->ref);
 	return aff;
 }
 
@@ -268,13 +268,16 @@ __isl_give isl_aff *isl_aff_dup(__isl_keep isl_aff *aff)
 
 __isl_give isl_aff *isl_aff_cow(__isl_take isl_aff *aff)
 {
+	isl_aff *dup;
+
 	if (!aff)
 		return NULL;
 
-	if (aff->ref == 1)
+	if (isl_atomic_get(&aff->ref) == 1)
 		return aff;
-	aff->ref--;
-	return isl_aff_dup(aff);
+	dup = isl_aff_dup(aff);
+	isl_aff_free(aff);
+	return dup;
 }
 
 __isl_null isl_aff *isl_aff_free(__isl_take isl_aff *aff)
@@ -282,7 +285,7 @@ __isl_null isl_aff *isl_aff_free(__isl_take isl_aff *aff)
 	if (!aff)
 		return NULL;
 
-	if (--aff->ref > 0)
+	if (isl_atomic_dec(&aff->ref) > 0)
 		return NULL;
 
 	isl_local_space_free(aff->ls);
@@ -395,7 +398,7 @@ __isl_give isl_local_space *isl_aff_take_domain_local_space(
 
 	if (!aff)
 		return NULL;
-	if (aff->ref != 1)
+	if (isl_atomic_get(&aff->ref) != 1)
 		return isl_aff_get_domain_local_space(aff);
 	ls = aff->ls;
 	aff->ls = NULL;
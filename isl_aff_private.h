@@ -87,6 +87,8 @@ __isl_give isl_aff *isl_aff_expand_divs( __isl_take isl_aff *aff,
 
 __isl_give isl_pw_aff *isl_pw_aff_alloc_size(__isl_take isl_space *space,
 	int n);
+__isl_give isl_pw_aff *isl_pw_aff_add_piece(__isl_take isl_pw_aff *pwaff,
+	__isl_take isl_set *set, __isl_take isl_aff *aff);
 __isl_give isl_pw_aff *isl_pw_aff_reset_space(__isl_take isl_pw_aff *pwaff,
 	__isl_take isl_space *dim);
 __isl_give isl_pw_aff *isl_pw_aff_reset_domain_space(
@@ -128,6 +130,11 @@ __isl_give isl_multi_aff *isl_multi_aff_from_basic_set_equalities(
 __isl_give isl_multi_aff *isl_multi_aff_from_aff_mat(
 	__isl_take isl_space *space, __isl_take isl_mat *mat);
 
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_alloc_size(
+	__isl_take isl_space *space, int n);
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_add_piece(
+	__isl_take isl_pw_multi_aff *pw, __isl_take isl_set *set,
+	__isl_take isl_multi_aff *maff);
 __isl_give isl_pw_multi_aff *isl_pw_multi_aff_reset_domain_space(
 	__isl_take isl_pw_multi_aff *pwmaff, __isl_take isl_space *space);
 __isl_give isl_pw_multi_aff *isl_pw_multi_aff_reset_space(
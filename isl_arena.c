@@ -0,0 +1,554 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <isl_arena_private.h>
+#include <isl_blk.h>
+
+/* The size of a chunk of arena memory, including its header.
+ * Larger chunks are allocated for blocks that do not fit
+ * in a chunk of this size.
+ */
+#define ISL_ARENA_CHUNK_SIZE	(64 * 1024)
+
+/* The alignment of the blocks handed out by the arena.
+ */
+#define ISL_ARENA_ALIGN		16
+
+/* The header that precedes every block of memory allocated
+ * from an arena chunk.
+ * Blocks allocated on the heap do not have a header.
+ * Whether a block was allocated from an arena chunk is determined
+ * by looking up its address in the chunks of the arena instead.
+ *
+ * "size" is the (usable) size of the block.
+ *
+ * The "align" member ensures that the memory following the header
+ * is suitably aligned.
+ */
+union isl_arena_header {
+	size_t size;
+	char align[ISL_ARENA_ALIGN];
+};
+
+/* A chunk of arena memory.
+ *
+ * "arena" is the arena to which the chunk belongs.
+ * "prev" and "next" link the chunk into the list of active chunks
+ * of the arena or, if "retired" is set, into the list of retired chunks.
+ * "size" is the number of bytes available for blocks,
+ * "used" is the number of bytes that have already been handed out and
+ * "live" is the number of blocks in the chunk that have not been freed yet.
+ * The blocks start at offset CHUNK_HEADER_SIZE from the start of the chunk.
+ */
+struct isl_arena_chunk {
+	struct isl_arena *arena;
+	struct isl_arena_chunk *prev;
+	struct isl_arena_chunk *next;
+	size_t size;
+	size_t used;
+	size_t live;
+	int retired;
+};
+
+#define CHUNK_HEADER_SIZE						\
+	((sizeof(struct isl_arena_chunk) + ISL_ARENA_ALIGN - 1) &	\
+	 ~(size_t) (ISL_ARENA_ALIGN - 1))
+
+/* The arena of an isl_ctx.
+ *
+ * "chunks" contains the "n_chunk" chunks of the arena (both active and
+ * retired) sorted by address.  It has room for "size_chunk" chunks.
+ * It is used to determine whether a block of memory was allocated
+ * from the arena and, if so, from which chunk.
+ * "depth" is the number of arena scopes that are currently active.
+ * "active" is the list of chunks that were allocated in the current
+ * outermost arena scope.  New blocks are taken from the first chunk
+ * in the list.
+ * "retired" is the list of chunks allocated in earlier scopes
+ * that still contain some live blocks.
+ * A retired chunk is released as soon as its last live block is freed.
+ * "retained" is the total size of the retired chunks.
+ */
+struct isl_arena {
+	int n_chunk;
+	int size_chunk;
+	struct isl_arena_chunk **chunks;
+
+	int depth;
+	struct isl_arena_chunk *active;
+	struct isl_arena_chunk *retired;
+	size_t retained;
+};
+
+/* Round "size" up to a multiple of ISL_ARENA_ALIGN.
+ */
+static size_t align_size(size_t size)
+{
+	return (size + ISL_ARENA_ALIGN - 1) & ~(size_t) (ISL_ARENA_ALIGN - 1);
+}
+
+/* Return a pointer to the start of the blocks in "chunk".
+ */
+static char *chunk_data(struct isl_arena_chunk *chunk)
+{
+	return (char *) chunk + CHUNK_HEADER_SIZE;
+}
+
+/* Return the header of the block "ptr".
+ */
+static union isl_arena_header *get_header(void *ptr)
+{
+	return (union isl_arena_header *) ptr - 1;
+}
+
+/* Return the position in arena->chunks of the first chunk
+ * that starts after "ptr" or arena->n_chunk if there is no such chunk.
+ */
+static int chunk_pos(struct isl_arena *arena, const void *ptr)
+{
+	int lo = 0, hi = arena->n_chunk;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if ((uintptr_t) arena->chunks[mid] <= (uintptr_t) ptr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Return the chunk of the arena of "ctx" that contains "ptr" or
+ * NULL if "ptr" was not allocated from the arena.
+ *
+ * Outside of arena scopes, the arena usually does not contain
+ * any chunks, such that freeing heap memory incurs no lookup.
+ */
+static struct isl_arena_chunk *find_chunk(isl_ctx *ctx, const void *ptr)
+{
+	struct isl_arena *arena;
+	struct isl_arena_chunk *chunk;
+	int pos;
+
+	arena = ctx ? ctx->arena : NULL;
+	if (!arena || arena->n_chunk == 0)
+		return NULL;
+	pos = chunk_pos(arena, ptr);
+	if (pos == 0)
+		return NULL;
+	chunk = arena->chunks[pos - 1];
+	if ((uintptr_t) ptr >= (uintptr_t) (chunk_data(chunk) + chunk->size))
+		return NULL;
+	return chunk;
+}
+
+/* Add "chunk" to the chunks of "arena" sorted by address.
+ */
+static isl_stat chunk_register(isl_ctx *ctx, struct isl_arena *arena,
+	struct isl_arena_chunk *chunk)
+{
+	int pos;
+
+	if (arena->n_chunk >= arena->size_chunk) {
+		int size = arena->size_chunk ? 2 * arena->size_chunk : 16;
+		struct isl_arena_chunk **chunks;
+
+		chunks = realloc(arena->chunks, size * sizeof(*chunks));
+		if (!chunks)
+			isl_die(ctx, isl_error_alloc, "allocation failure",
+				return isl_stat_error);
+		arena->chunks = chunks;
+		arena->size_chunk = size;
+	}
+	pos = chunk_pos(arena, chunk);
+	memmove(arena->chunks + pos + 1, arena->chunks + pos,
+		(arena->n_chunk - pos) * sizeof(*arena->chunks));
+	arena->chunks[pos] = chunk;
+	arena->n_chunk++;
+
+	return isl_stat_ok;
+}
+
+/* Remove "chunk" from the chunks of "arena" sorted by address.
+ */
+static void chunk_unregister(struct isl_arena *arena,
+	struct isl_arena_chunk *chunk)
+{
+	int pos;
+
+	pos = chunk_pos(arena, chunk) - 1;
+	arena->n_chunk--;
+	memmove(arena->chunks + pos, arena->chunks + pos + 1,
+		(arena->n_chunk - pos) * sizeof(*arena->chunks));
+}
+
+/* Return the list of chunks of "arena" to which "chunk" belongs.
+ */
+static struct isl_arena_chunk **chunk_list(struct isl_arena *arena,
+	struct isl_arena_chunk *chunk)
+{
+	return chunk->retired ? &arena->retired : &arena->active;
+}
+
+/* Add "chunk" to the front of "list".
+ */
+static void chunk_link(struct isl_arena_chunk **list,
+	struct isl_arena_chunk *chunk)
+{
+	chunk->prev = NULL;
+	chunk->next = *list;
+	if (*list)
+		(*list)->prev = chunk;
+	*list = chunk;
+}
+
+/* Remove "chunk" from the list of chunks of "arena" to which it belongs.
+ */
+static void chunk_unlink(struct isl_arena *arena,
+	struct isl_arena_chunk *chunk)
+{
+	if (chunk->prev)
+		chunk->prev->next = chunk->next;
+	else
+		*chunk_list(arena, chunk) = chunk->next;
+	if (chunk->next)
+		chunk->next->prev = chunk->prev;
+}
+
+/* Remove "chunk" from its arena and free it.
+ */
+static void chunk_free(struct isl_arena_chunk *chunk)
+{
+	struct isl_arena *arena = chunk->arena;
+
+	chunk_unregister(arena, chunk);
+	chunk_unlink(arena, chunk);
+	if (chunk->retired)
+		arena->retained -= CHUNK_HEADER_SIZE + chunk->size;
+	free(chunk);
+}
+
+/* Allocate a new chunk in the arena of "ctx" that has room for
+ * at least "need" bytes and make it the first active chunk.
+ * The previous first active chunk is freed if it no longer
+ * contains any live blocks.
+ */
+static struct isl_arena_chunk *chunk_alloc(isl_ctx *ctx, size_t need)
+{
+	struct isl_arena *arena = ctx->arena;
+	struct isl_arena_chunk *chunk;
+	size_t size;
+
+	size = ISL_ARENA_CHUNK_SIZE - CHUNK_HEADER_SIZE;
+	if (need > size)
+		size = need;
+	chunk = malloc(CHUNK_HEADER_SIZE + size);
+	if (!chunk)
+		isl_die(ctx, isl_error_alloc, "allocation failure",
+			return NULL);
+	if (chunk_register(ctx, arena, chunk) < 0) {
+		free(chunk);
+		return NULL;
+	}
+	chunk->arena = arena;
+	chunk->size = size;
+	chunk->used = 0;
+	chunk->live = 0;
+	chunk->retired = 0;
+	if (arena->active && arena->active->live == 0)
+		chunk_free(arena->active);
+	chunk_link(&arena->active, chunk);
+
+	return chunk;
+}
+
+/* Allocate a block of "size" bytes from the arena of "ctx".
+ */
+static void *arena_alloc(isl_ctx *ctx, size_t size)
+{
+	struct isl_arena_chunk *chunk;
+	union isl_arena_header *header;
+	size_t need;
+
+	need = sizeof(union isl_arena_header) + align_size(size);
+	chunk = ctx->arena->active;
+	if (!chunk || chunk->size - chunk->used < need)
+		chunk = chunk_alloc(ctx, need);
+	if (!chunk)
+		return NULL;
+
+	header = (union isl_arena_header *) (chunk_data(chunk) + chunk->used);
+	chunk->used += need;
+	chunk->live++;
+	header->size = size;
+
+	return header + 1;
+}
+
+/* Allocate a block of "size" bytes from the heap.
+ * As in isl_malloc_or_die, a NULL result is only considered
+ * to be an error if "size" is not zero.
+ */
+static void *heap_alloc(isl_ctx *ctx, size_t size)
+{
+	void *ptr;
+
+	ptr = malloc(size);
+	if (!ptr && size)
+		isl_die(ctx, isl_error_alloc, "allocation failure",
+			return NULL);
+
+	return ptr;
+}
+
+/* Is there an active arena scope on "ctx"?
+ */
+static int in_arena_scope(isl_ctx *ctx)
+{
+	return ctx->arena && ctx->arena->depth > 0;
+}
+
+/* Allocate a block of "size" bytes, taken from the arena of "ctx"
+ * if there is an active arena scope and from the heap otherwise.
+ * Like isl_malloc_or_die, this counts as an operation of "ctx".
+ */
+void *isl_arena_malloc(isl_ctx *ctx, size_t size)
+{
+	if (isl_ctx_next_operation(ctx) < 0)
+		return NULL;
+	if (in_arena_scope(ctx))
+		return arena_alloc(ctx, size);
+	return heap_alloc(ctx, size);
+}
+
+/* Allocate a zero-initialized block of "nmemb" elements
+ * of "size" bytes each.  See isl_arena_malloc.
+ */
+void *isl_arena_calloc(isl_ctx *ctx, size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if (size && nmemb > SIZE_MAX / size)
+		isl_die(ctx, isl_error_alloc, "allocation too large",
+			return NULL);
+	ptr = isl_arena_malloc(ctx, nmemb * size);
+	if (!ptr)
+		return NULL;
+	memset(ptr, 0, nmemb * size);
+
+	return ptr;
+}
+
+/* Free the block "ptr" allocated through isl_arena_malloc,
+ * isl_arena_calloc or isl_arena_realloc on "ctx".
+ *
+ * A block that does not belong to any arena chunk of "ctx"
+ * was allocated on the heap and is simply freed.
+ * A block in an arena chunk is not freed individually.
+ * Instead, the number of live blocks in the chunk is decremented.
+ * If this number drops to zero, then the chunk is freed,
+ * except if it is the chunk from which new blocks are being allocated.
+ * In the latter case, the chunk is reset such that
+ * its memory can be reused.
+ */
+void isl_arena_free(isl_ctx *ctx, void *ptr)
+{
+	struct isl_arena_chunk *chunk;
+
+	if (!ptr)
+		return;
+	chunk = find_chunk(ctx, ptr);
+	if (!chunk) {
+		free(ptr);
+		return;
+	}
+	if (--chunk->live > 0)
+		return;
+	if (!chunk->retired && chunk == chunk->arena->active)
+		chunk->used = 0;
+	else
+		chunk_free(chunk);
+}
+
+/* Does the block "ptr" allocated on "ctx" belong to a chunk
+ * that has been retired, i.e., a chunk that is released
+ * as soon as its last block is freed?
+ */
+int isl_arena_is_retired(isl_ctx *ctx, void *ptr)
+{
+	struct isl_arena_chunk *chunk;
+
+	if (!ptr)
+		return 0;
+	chunk = find_chunk(ctx, ptr);
+	return chunk && chunk->retired;
+}
+
+/* Change the size of the block "ptr" to "size" bytes.
+ * Return NULL, without freeing "ptr", if anything goes wrong.
+ *
+ * A block on the heap is simply resized on the heap, even inside
+ * an arena scope, since its size is not known.
+ * A block that was the last block to be allocated
+ * in the arena is resized in place if there is room in its chunk.
+ * Arena blocks are never shrunk.
+ * In all other cases, a new block is allocated and
+ * the contents of the old block are copied over.
+ */
+void *isl_arena_realloc(isl_ctx *ctx, void *ptr, size_t size)
+{
+	union isl_arena_header *header;
+	struct isl_arena_chunk *chunk;
+	void *res;
+	size_t old_size;
+
+	if (!ptr)
+		return isl_arena_malloc(ctx, size);
+
+	chunk = find_chunk(ctx, ptr);
+	if (!chunk)
+		return isl_realloc_or_die(ctx, ptr, size);
+
+	header = get_header(ptr);
+	old_size = header->size;
+	if (size <= old_size)
+		return ptr;
+	if (chunk == ctx->arena->active &&
+	    (char *) ptr + align_size(old_size) ==
+					chunk_data(chunk) + chunk->used &&
+	    chunk->size - chunk->used >=
+				align_size(size) - align_size(old_size)) {
+		if (isl_ctx_next_operation(ctx) < 0)
+			return NULL;
+		chunk->used += align_size(size) - align_size(old_size);
+		header->size = size;
+		return ptr;
+	}
+
+	res = isl_arena_malloc(ctx, size);
+	if (!res)
+		return NULL;
+	memcpy(res, ptr, old_size);
+	isl_arena_free(ctx, ptr);
+
+	return res;
+}
+
+/* Does "ctx" have an active arena scope or any memory
+ * that was allocated in an arena scope and that has not been freed yet?
+ */
+isl_bool isl_arena_in_use(isl_ctx *ctx)
+{
+	struct isl_arena *arena;
+
+	if (!ctx)
+		return isl_bool_error;
+	arena = ctx->arena;
+	if (!arena)
+		return isl_bool_false;
+	return arena->depth > 0 || arena->active || arena->retired;
+}
+
+/* Free "arena" along with all its chunks.
+ * This is only called when the isl_ctx to which it belongs is freed.
+ */
+void isl_arena_release(struct isl_arena *arena)
+{
+	if (!arena)
+		return;
+	while (arena->active)
+		chunk_free(arena->active);
+	while (arena->retired)
+		chunk_free(arena->retired);
+	free(arena->chunks);
+	free(arena);
+}
+
+/* Enter a new arena scope on "ctx".
+ *
+ * Inside an arena scope, the memory for the short-lived objects
+ * that are created by many operations (integer blocks, vectors,
+ * matrices, basic maps and tableaus) is taken from a bump allocator
+ * rather than from the heap.  Freeing such an object only decrements
+ * the number of live objects in the arena chunk to which it belongs.
+ * When the outermost arena scope is left, all chunks that no longer
+ * contain any live objects are released at once.
+ *
+ * Arena scopes are not supported on concurrent isl_ctx objects.
+ */
+isl_stat isl_ctx_push_arena(isl_ctx *ctx)
+{
+	if (!ctx)
+		return isl_stat_error;
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		isl_die(ctx, isl_error_unsupported,
+			"arenas not supported on concurrent isl_ctx",
+			return isl_stat_error);
+#endif
+	if (!ctx->arena) {
+		ctx->arena = isl_calloc_type(ctx, struct isl_arena);
+		if (!ctx->arena)
+			return isl_stat_error;
+	}
+	ctx->arena->depth++;
+
+	return isl_stat_ok;
+}
+
+/* Leave the innermost arena scope on "ctx".
+ *
+ * If this is the outermost arena scope, then the chunks that were
+ * allocated during the scope are released, except for those
+ * that still contain live objects, i.e., objects that escape the scope.
+ * The latter are retired and are only released when the last
+ * of their objects is freed.
+ * Since the integer blocks that are cached by the current thread
+ * may reside in these chunks, the cache is cleared first.
+ */
+isl_stat isl_ctx_pop_arena(isl_ctx *ctx)
+{
+	struct isl_arena *arena;
+	struct isl_arena_chunk *chunk, *next;
+
+	if (!ctx)
+		return isl_stat_error;
+	arena = ctx->arena;
+	if (!arena || arena->depth == 0)
+		isl_die(ctx, isl_error_invalid, "no arena to pop",
+			return isl_stat_error);
+	if (--arena->depth > 0)
+		return isl_stat_ok;
+
+	isl_blk_clear_cache(&ctx->local);
+	for (chunk = arena->active; chunk; chunk = next) {
+		next = chunk->next;
+		if (chunk->live == 0) {
+			chunk_free(chunk);
+			continue;
+		}
+		chunk_unlink(arena, chunk);
+		chunk->retired = 1;
+		chunk_link(&arena->retired, chunk);
+		arena->retained += CHUNK_HEADER_SIZE + chunk->size;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Return the number of bytes of arena memory of "ctx" that are
+ * retained because they contain objects that escaped
+ * from an arena scope and that have not been freed yet.
+ */
+size_t isl_ctx_get_arena_retained(isl_ctx *ctx)
+{
+	if (!ctx || !ctx->arena)
+		return 0;
+	return ctx->arena->retained;
+}
@@ -0,0 +1,33 @@
+#ifndef ISL_ARENA_PRIVATE_H
+#define ISL_ARENA_PRIVATE_H
+
+#include <isl_ctx_private.h>
+
+/* Memory allocated through the functions below needs to be freed
+ * using isl_arena_free and resized using isl_arena_realloc.
+ * Inside an arena scope (see isl_ctx_push_arena), the memory is taken
+ * from the arena of the isl_ctx.  Otherwise, it is taken from the heap.
+ * The isl_ctx passed to isl_arena_free and isl_arena_is_retired
+ * needs to be the one on which the memory was allocated.
+ */
+void *isl_arena_malloc(isl_ctx *ctx, size_t size);
+void *isl_arena_calloc(isl_ctx *ctx, size_t nmemb, size_t size);
+void *isl_arena_realloc(isl_ctx *ctx, void *ptr, size_t size);
+void isl_arena_free(isl_ctx *ctx, void *ptr);
+int isl_arena_is_retired(isl_ctx *ctx, void *ptr);
+
+#define isl_arena_alloc_type(ctx,type)					\
+	((type *)isl_arena_malloc(ctx, sizeof(type)))
+#define isl_arena_calloc_type(ctx,type)					\
+	((type *)isl_arena_calloc(ctx, 1, sizeof(type)))
+#define isl_arena_alloc_array(ctx,type,n)				\
+	((type *)isl_arena_malloc(ctx, (n)*sizeof(type)))
+#define isl_arena_calloc_array(ctx,type,n)				\
+	((type *)isl_arena_calloc(ctx, n, sizeof(type)))
+#define isl_arena_realloc_array(ctx,ptr,type,n)				\
+	((type *)isl_arena_realloc(ctx, ptr, (n)*sizeof(type)))
+
+isl_bool isl_arena_in_use(isl_ctx *ctx);
+void isl_arena_release(struct isl_arena *arena);
+
+#endif
@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include <isl/val.h>
+#include <isl_ctx_private.h>
 #include <isl_ast_private.h>
 
 #undef BASE
@@ -68,13 +69,16 @@ __isl_give isl_ast_print_options *isl_ast_print_options_dup(
 __isl_give isl_ast_print_options *isl_ast_print_options_cow(
 	__isl_take isl_ast_print_options *options)
 {
+	isl_ast_print_options *dup;
+
 	if (!options)
 		return NULL;
 
-	if (options->ref == 1)
+	if (isl_atomic_get(&options->ref) == 1)
 		return options;
-	options->ref--;
-	return isl_ast_print_options_dup(options);
+	dup = isl_ast_print_options_dup(options);
+	isl_ast_print_options_free(options);
+	return dup;
 }
 
 __isl_give isl_ast_print_options *isl_ast_print_options_copy(
@@ -83,7 +87,7 @@ __isl_give isl_ast_print_options *isl_ast_print_options_copy(
 	if (!options)
 		return NULL;
 
-	options->ref++;
+	isl_atomic_inc(&options->ref);
 	return options;
 }
 
@@ -93,7 +97,7 @@ __isl_null isl_ast_print_options *isl_ast_print_options_free(
 	if (!options)
 		return NULL;
 
-	if (--options->ref > 0)
+	if (isl_atomic_dec(&options->ref) > 0)
 		return NULL;
 
 	isl_ctx_deref(options->ctx);
@@ -150,7 +154,7 @@ __isl_give isl_ast_expr *isl_ast_expr_copy(__isl_keep isl_ast_expr *expr)
 	if (!expr)
 		return NULL;
 
-	expr->ref++;
+	isl_atomic_inc(&expr->ref);
 	return expr;
 }
 
@@ -192,13 +196,16 @@ __isl_give isl_ast_expr *isl_ast_expr_dup(__isl_keep isl_ast_expr *expr)
 
 __isl_give isl_ast_expr *isl_ast_expr_cow(__isl_take isl_ast_expr *expr)
 {
+	isl_ast_expr *dup;
+
 	if (!expr)
 		return NULL;
 
-	if (expr->ref == 1)
+	if (isl_atomic_get(&expr->ref) == 1)
 		return expr;
-	expr->ref--;
-	return isl_ast_expr_dup(expr);
+	dup = isl_ast_expr_dup(expr);
+	isl_ast_expr_free(expr);
+	return dup;
 }
 
 __isl_null isl_ast_expr *isl_ast_expr_free(__isl_take isl_ast_expr *expr)
@@ -208,7 +215,7 @@ __isl_null isl_ast_expr *isl_ast_expr_free(__isl_take isl_ast_expr *expr)
 	if (!expr)
 		return NULL;
 
-	if (--expr->ref > 0)
+	if (isl_atomic_dec(&expr->ref) > 0)
 		return NULL;
 
 	isl_ctx_deref(expr->ctx);
@@ -957,7 +964,7 @@ __isl_give isl_ast_node *isl_ast_node_copy(__isl_keep isl_ast_node *node)
 	if (!node)
 		return NULL;
 
-	node->ref++;
+	isl_atomic_inc(&node->ref);
 	return node;
 }
 
@@ -1016,13 +1023,16 @@ __isl_give isl_ast_node *isl_ast_node_dup(__isl_keep isl_ast_node *node)
 
 __isl_give isl_ast_node *isl_ast_node_cow(__isl_take isl_ast_node *node)
 {
+	isl_ast_node *dup;
+
 	if (!node)
 		return NULL;
 
-	if (node->ref == 1)
+	if (isl_atomic_get(&node->ref) == 1)
 		return node;
-	node->ref--;
-	return isl_ast_node_dup(node);
+	dup = isl_ast_node_dup(node);
+	isl_ast_node_free(node);
+	return dup;
 }
 
 __isl_null isl_ast_node *isl_ast_node_free(__isl_take isl_ast_node *node)
@@ -1030,7 +1040,7 @@ __isl_null isl_ast_node *isl_ast_node_free(__isl_take isl_ast_node *node)
 	if (!node)
 		return NULL;
 
-	if (--node->ref > 0)
+	if (isl_atomic_dec(&node->ref) > 0)
 		return NULL;
 
 	switch (node->type) {
@@ -2489,6 +2499,40 @@ __isl_give isl_printer *isl_ast_node_list_print(
 	return p;
 }
 
+/* Print the nodes in "list" to "p" as part of the printing
+ * of a sequence of nodes that is produced piece by piece,
+ * where "*n_printed" is the number of nodes in the sequence
+ * that have already been printed and "last" is set if "list"
+ * contains the final nodes of the sequence.
+ * The output is the same as that of printing the block node
+ * formed by the entire sequence or, if the sequence consists
+ * of a single node, that of printing this single node.
+ *
+ * If "list" is not the final part of the sequence, then the sequence
+ * contains at least one more node, so that printing the first nodes
+ * can start the block.
+ */
+__isl_give isl_printer *isl_ast_node_list_print_partial(
+	__isl_keep isl_ast_node_list *list, __isl_take isl_printer *p,
+	__isl_keep isl_ast_print_options *options, int *n_printed, int last)
+{
+	if (!p || !list || !options)
+		return isl_printer_free(p);
+
+	if (*n_printed == 0 && last && list->n == 1) {
+		*n_printed = 1;
+		return print_ast_node_c(p, list->p[0], options, 0, 0);
+	}
+	if (*n_printed == 0 && (last || list->n > 0))
+		p = start_block(p);
+	p = isl_ast_node_list_print(list, p, options);
+	*n_printed += list->n;
+	if (last)
+		p = end_block(p);
+
+	return p;
+}
+
 #define ISL_AST_MACRO_FLOORD	(1 << 0)
 #define ISL_AST_MACRO_MIN	(1 << 1)
 #define ISL_AST_MACRO_MAX	(1 << 2)
@@ -18,8 +18,10 @@
 #include <isl/map.h>
 #include <isl/union_set.h>
 #include <isl/union_map.h>
+#include <isl_ctx_private.h>
 #include <isl_ast_build_private.h>
 #include <isl_ast_private.h>
+#include <isl_ast_expr_cache_private.h>
 #include <isl_config.h>
 
 /* Construct a map that isolates the current dimension.
@@ -172,7 +174,7 @@ __isl_give isl_ast_build *isl_ast_build_copy(__isl_keep isl_ast_build *build)
 	if (!build)
 		return NULL;
 
-	build->ref++;
+	isl_atomic_inc(&build->ref);
 	return build;
 }
 
@@ -228,6 +230,7 @@ __isl_give isl_ast_build *isl_ast_build_dup(__isl_keep isl_ast_build *build)
 		for (i = 0; i < dup->n; ++i)
 			dup->loop_type[i] = build->loop_type[i];
 	}
+	dup->expr_cache = isl_ast_expr_cache_copy(build->expr_cache);
 
 	if (!dup->iterators || !dup->domain || !dup->generated ||
 	    !dup->pending || !dup->values ||
@@ -285,13 +288,16 @@ error:
 
 __isl_give isl_ast_build *isl_ast_build_cow(__isl_take isl_ast_build *build)
 {
+	isl_ast_build *dup;
+
 	if (!build)
 		return NULL;
 
-	if (build->ref == 1)
+	if (isl_atomic_get(&build->ref) == 1)
 		return build;
-	build->ref--;
-	return isl_ast_build_dup(build);
+	dup = isl_ast_build_dup(build);
+	isl_ast_build_free(build);
+	return dup;
 }
 
 __isl_null isl_ast_build *isl_ast_build_free(
@@ -300,7 +306,7 @@ __isl_null isl_ast_build *isl_ast_build_free(
 	if (!build)
 		return NULL;
 
-	if (--build->ref > 0)
+	if (isl_atomic_dec(&build->ref) > 0)
 		return NULL;
 
 	isl_id_list_free(build->iterators);
@@ -318,6 +324,7 @@ __isl_null isl_ast_build *isl_ast_build_free(
 	isl_schedule_node_free(build->node);
 	free(build->loop_type);
 	isl_set_free(build->isolated);
+	isl_ast_expr_cache_free(build->expr_cache);
 
 	free(build);
 
@@ -1031,6 +1038,175 @@ int isl_ast_build_has_schedule_node(__isl_keep isl_ast_build *build)
 	return build->node != NULL;
 }
 
+/* Has any user callback been set on "build"?
+ */
+isl_bool isl_ast_build_has_callback(__isl_keep isl_ast_build *build)
+{
+	if (!build)
+		return isl_bool_error;
+	return build->at_each_domain || build->before_each_for ||
+		build->after_each_for || build->before_each_mark ||
+		build->after_each_mark || build->create_leaf;
+}
+
+/* Attach a fresh AST expression cache to "build" if
+ * the ast_build_expr_cache_size option is set and
+ * remove any cache that may have been attached before.
+ * The cache is shared by all isl_ast_builds derived from
+ * the result, but not by "build" itself if it has any other references.
+ */
+__isl_give isl_ast_build *isl_ast_build_init_expr_cache(
+	__isl_take isl_ast_build *build)
+{
+	isl_ctx *ctx;
+	int size;
+
+	if (!build)
+		return NULL;
+
+	ctx = isl_ast_build_get_ctx(build);
+	size = isl_options_get_ast_build_expr_cache_size(ctx);
+	if (size <= 0 && !build->expr_cache)
+		return build;
+
+	build = isl_ast_build_cow(build);
+	if (!build)
+		return NULL;
+	build->expr_cache = isl_ast_expr_cache_free(build->expr_cache);
+	if (size <= 0)
+		return build;
+	build->expr_cache = isl_ast_expr_cache_alloc(ctx, size);
+	if (!build->expr_cache)
+		return isl_ast_build_free(build);
+
+	return build;
+}
+
+/* Are "pa1" and "pa2", either of which may be NULL, obviously equal?
+ */
+static isl_bool pw_aff_plain_is_equal_or_null(__isl_keep isl_pw_aff *pa1,
+	__isl_keep isl_pw_aff *pa2)
+{
+	if (!pa1 || !pa2)
+		return pa1 == pa2;
+	return isl_pw_aff_plain_is_equal(pa1, pa2);
+}
+
+/* Are "ma1" and "ma2", either of which may be NULL, obviously equal?
+ */
+static isl_bool multi_aff_plain_is_equal_or_null(__isl_keep isl_multi_aff *ma1,
+	__isl_keep isl_multi_aff *ma2)
+{
+	if (!ma1 || !ma2)
+		return ma1 == ma2;
+	return isl_multi_aff_plain_is_equal(ma1, ma2);
+}
+
+/* Are "set1" and "set2", either of which may be NULL, obviously equal?
+ */
+static isl_bool set_plain_is_equal_or_null(__isl_keep isl_set *set1,
+	__isl_keep isl_set *set2)
+{
+	if (!set1 || !set2)
+		return set1 == set2;
+	return isl_set_plain_is_equal(set1, set2);
+}
+
+/* Are "build1" and "build2" obviously equal in the sense that
+ * generating an AST from the same schedule tree in either of them
+ * produces the same result?
+ *
+ * The AST build options in "options" are ignored since they are
+ * not used when generating an AST from a schedule tree.
+ * Neither are "executed" and "schedule_map" compared
+ * since the former is only used from within callbacks,
+ * while the latter is derived from the other fields.
+ * The iterators are compared on their identifiers, which are
+ * shared by builds that generate the same iterators.
+ * Since a band node can only be compared with
+ * another band node at the same position in the same schedule tree,
+ * the band nodes are required to be the same objects.
+ */
+isl_bool isl_ast_build_plain_is_equal(__isl_keep isl_ast_build *build1,
+	__isl_keep isl_ast_build *build2)
+{
+	int i, n;
+	isl_bool equal;
+
+	if (!build1 || !build2)
+		return isl_bool_error;
+	if (build1 == build2)
+		return isl_bool_true;
+
+	if (build1->outer_pos != build2->outer_pos ||
+	    build1->depth != build2->depth ||
+	    build1->single_valued != build2->single_valued)
+		return isl_bool_false;
+	if (build1->at_each_domain != build2->at_each_domain ||
+	    build1->at_each_domain_user != build2->at_each_domain_user ||
+	    build1->before_each_for != build2->before_each_for ||
+	    build1->before_each_for_user != build2->before_each_for_user ||
+	    build1->after_each_for != build2->after_each_for ||
+	    build1->after_each_for_user != build2->after_each_for_user ||
+	    build1->before_each_mark != build2->before_each_mark ||
+	    build1->before_each_mark_user != build2->before_each_mark_user ||
+	    build1->after_each_mark != build2->after_each_mark ||
+	    build1->after_each_mark_user != build2->after_each_mark_user ||
+	    build1->create_leaf != build2->create_leaf ||
+	    build1->create_leaf_user != build2->create_leaf_user)
+		return isl_bool_false;
+	if (build1->node != build2->node || build1->n != build2->n)
+		return isl_bool_false;
+	for (i = 0; build1->loop_type && i < build1->n; ++i)
+		if (build1->loop_type[i] != build2->loop_type[i])
+			return isl_bool_false;
+
+	n = isl_id_list_n_id(build1->iterators);
+	if (n < 0)
+		return isl_bool_error;
+	if (n != isl_id_list_n_id(build2->iterators))
+		return isl_bool_false;
+	for (i = 0; i < n; ++i) {
+		isl_id *id1, *id2;
+
+		id1 = isl_id_list_get_id(build1->iterators, i);
+		id2 = isl_id_list_get_id(build2->iterators, i);
+		isl_id_free(id1);
+		isl_id_free(id2);
+		if (!id1 || !id2)
+			return isl_bool_error;
+		if (id1 != id2)
+			return isl_bool_false;
+	}
+
+	equal = isl_set_plain_is_equal(build1->domain, build2->domain);
+	if (equal >= 0 && equal)
+		equal = isl_set_plain_is_equal(build1->generated,
+						build2->generated);
+	if (equal >= 0 && equal)
+		equal = isl_set_plain_is_equal(build1->pending,
+						build2->pending);
+	if (equal >= 0 && equal)
+		equal = isl_vec_is_equal(build1->strides, build2->strides);
+	if (equal >= 0 && equal)
+		equal = isl_multi_aff_plain_is_equal(build1->offsets,
+						build2->offsets);
+	if (equal >= 0 && equal)
+		equal = isl_multi_aff_plain_is_equal(build1->values,
+						build2->values);
+	if (equal >= 0 && equal)
+		equal = pw_aff_plain_is_equal_or_null(build1->value,
+						build2->value);
+	if (equal >= 0 && equal)
+		equal = multi_aff_plain_is_equal_or_null(build1->internal2input,
+						build2->internal2input);
+	if (equal >= 0 && equal)
+		equal = set_plain_is_equal_or_null(build1->isolated,
+						build2->isolated);
+
+	return equal;
+}
+
 /* Return a copy of the band node that "build" refers to.
  */
 __isl_give isl_schedule_node *isl_ast_build_get_schedule_node(
@@ -17,6 +17,7 @@
 #include <isl_ast_build_expr.h>
 #include <isl_ast_private.h>
 #include <isl_ast_build_private.h>
+#include <isl_ast_expr_cache_private.h>
 #include <isl_sort.h>
 
 /* Compute the "opposite" of the (numerator of the) argument of a div
@@ -1506,7 +1507,7 @@ __isl_give isl_ast_expr *isl_ast_build_expr_from_basic_set(
  *
  * "set" lives in the internal schedule space.
  */
-__isl_give isl_ast_expr *isl_ast_build_expr_from_set_internal(
+static __isl_give isl_ast_expr *ast_expr_from_set(
 	__isl_keep isl_ast_build *build, __isl_take isl_set *set)
 {
 	int i, n;
@@ -1554,6 +1555,32 @@ __isl_give isl_ast_expr *isl_ast_build_expr_from_set_internal(
 	return res;
 }
 
+/* Construct an isl_ast_expr that evaluates the conditions defining "set",
+ * taking the result from the AST expression cache of "build", if any,
+ * or storing it in that cache.
+ *
+ * "set" lives in the internal schedule space.
+ */
+__isl_give isl_ast_expr *isl_ast_build_expr_from_set_internal(
+	__isl_keep isl_ast_build *build, __isl_take isl_set *set)
+{
+	isl_ast_expr *expr;
+
+	if (!build || !build->expr_cache)
+		return ast_expr_from_set(build, set);
+
+	expr = isl_ast_expr_cache_find_set(build, set);
+	if (expr) {
+		isl_set_free(set);
+		return expr;
+	}
+	expr = ast_expr_from_set(build, isl_set_copy(set));
+	isl_ast_expr_cache_add_set(build, set, expr);
+	isl_set_free(set);
+
+	return expr;
+}
+
 /* Construct an isl_ast_expr that evaluates the conditions defining "set".
  * The result is simplified in terms of build->domain.
  *
@@ -2169,7 +2196,7 @@ error:
  *
  * The domain of "pa" lives in the internal schedule space.
  */
-__isl_give isl_ast_expr *isl_ast_build_expr_from_pw_aff_internal(
+static __isl_give isl_ast_expr *ast_expr_from_pw_aff_internal(
 	__isl_keep isl_ast_build *build, __isl_take isl_pw_aff *pa)
 {
 	struct isl_from_pw_aff_data data = { NULL };
@@ -2196,6 +2223,34 @@ error:
 	return NULL;
 }
 
+/* Construct an isl_ast_expr that evaluates "pa",
+ * taking the result from the AST expression cache of "build", if any,
+ * or storing it in that cache.
+ * The cache is consulted before "pa" is simplified
+ * such that a hit also avoids the simplification.
+ *
+ * The domain of "pa" lives in the internal schedule space.
+ */
+__isl_give isl_ast_expr *isl_ast_build_expr_from_pw_aff_internal(
+	__isl_keep isl_ast_build *build, __isl_take isl_pw_aff *pa)
+{
+	isl_ast_expr *expr;
+
+	if (!build || !build->expr_cache)
+		return ast_expr_from_pw_aff_internal(build, pa);
+
+	expr = isl_ast_expr_cache_find_pw_aff(build, pa);
+	if (expr) {
+		isl_pw_aff_free(pa);
+		return expr;
+	}
+	expr = ast_expr_from_pw_aff_internal(build, isl_pw_aff_copy(pa));
+	isl_ast_expr_cache_add_pw_aff(build, pa, expr);
+	isl_pw_aff_free(pa);
+
+	return expr;
+}
+
 /* Construct an isl_ast_expr that evaluates "pa".
  * The result is simplified in terms of build->domain.
  *
@@ -141,6 +141,11 @@
  * "isolated" is the piece of the schedule domain isolated by the isolate
  * option on the current band.  This set may be NULL if we have not checked
  * for the isolate option yet.
+ *
+ * "expr_cache" caches the AST expressions constructed from piecewise
+ * affine expressions and sets.  It is shared by all isl_ast_builds
+ * derived from the isl_ast_build at the start of an AST generation
+ * and it is NULL if the ast_build_expr_cache_size option is not set.
  */
 struct isl_ast_build {
 	int ref;
@@ -197,6 +202,8 @@ struct isl_ast_build {
 	int n;
 	enum isl_ast_loop_type *loop_type;
 	isl_set *isolated;
+
+	struct isl_ast_expr_cache *expr_cache;
 };
 
 __isl_give isl_ast_build *isl_ast_build_clear_local_info(
@@ -257,6 +264,11 @@ __isl_give isl_id *isl_ast_build_get_iterator_id(
 	__isl_keep isl_ast_build *build, int pos);
 
 int isl_ast_build_has_schedule_node(__isl_keep isl_ast_build *build);
+isl_bool isl_ast_build_has_callback(__isl_keep isl_ast_build *build);
+__isl_give isl_ast_build *isl_ast_build_init_expr_cache(
+	__isl_take isl_ast_build *build);
+isl_bool isl_ast_build_plain_is_equal(__isl_keep isl_ast_build *build1,
+	__isl_keep isl_ast_build *build2);
 __isl_give isl_schedule_node *isl_ast_build_get_schedule_node(
 	__isl_keep isl_ast_build *build);
 __isl_give isl_ast_build *isl_ast_build_set_schedule_node(
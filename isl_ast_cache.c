@@ -0,0 +1,565 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl/hash.h>
+#include <isl/map.h>
+#include <isl/union_set.h>
+#include <isl_schedule_node_private.h>
+#include <isl_ast_cache_private.h>
+
+/* An entry in the AST cache.
+ *
+ * "key" describes the schedule subtree and the context in which
+ * the AST in "list" was generated.
+ * The tree, the build and the inverse schedule in "key" as well as
+ * "list" are owned by the entry.
+ * The grafts in "list" are not shared with any graft list
+ * outside of the cache.
+ * "prev" and "next" link the entries in order of most recent use.
+ */
+struct isl_ast_cache_entry {
+	struct isl_ast_cache_key key;
+	isl_ast_graft_list *list;
+
+	struct isl_ast_cache_entry *prev;
+	struct isl_ast_cache_entry *next;
+};
+
+/* The AST cache of an isl_ctx.
+ *
+ * "table" contains "n" entries, each of which also appears
+ * in the list starting at "head" (the most recently used entry)
+ * and ending at "tail" (the least recently used entry).
+ * "hits" and "misses" keep track of the number of successful and
+ * unsuccessful lookups.
+ *
+ * Unlike the memo table, the AST cache is not protected by the lock
+ * on the isl_ctx since comparing keys may itself require that lock.
+ * In builds with thread support, it is protected by "lock" instead.
+ */
+struct isl_ast_cache {
+	int n;
+	struct isl_hash_table table;
+	struct isl_ast_cache_entry *head;
+	struct isl_ast_cache_entry *tail;
+
+	unsigned long hits;
+	unsigned long misses;
+
+#ifdef USE_THREADS
+	pthread_mutex_t lock;
+#endif
+};
+
+/* Acquire the lock on "cache", if any.
+ */
+static void cache_lock(struct isl_ast_cache *cache)
+{
+#ifdef USE_THREADS
+	pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+/* Release the lock on "cache", if any.
+ */
+static void cache_unlock(struct isl_ast_cache *cache)
+{
+#ifdef USE_THREADS
+	pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+/* Encode the values of the boolean and choice options
+ * that affect AST generation of "ctx" in a single integer.
+ */
+static unsigned encode_options(isl_ctx *ctx)
+{
+	unsigned options = 0;
+	struct isl_options *opt = ctx->opt;
+
+	options = (options << 1) | !!opt->ast_build_atomic_upper_bound;
+	options = (options << 1) | !!opt->ast_build_prefer_pdiv;
+	options = (options << 1) | !!opt->ast_build_detect_min_max;
+	options = (options << 1) | !!opt->ast_build_exploit_nested_bounds;
+	options = (options << 1) | !!opt->ast_build_group_coscheduled;
+	options = (options << 1) | !!opt->ast_build_scale_strides;
+	options = (options << 1) | !!opt->ast_build_allow_else;
+	options = (options << 1) | !!opt->ast_build_allow_or;
+	options = (options << 2) | (opt->ast_build_separation_bounds & 3);
+
+	return options;
+}
+
+/* Combine "hash" with a hash of the shape of "tree", i.e.,
+ * the types of its nodes and the number of members
+ * and the loop AST generation types of its band nodes.
+ * The sets and functions that appear in the nodes are not hashed
+ * since computing such a hash would be relatively expensive.
+ */
+static uint32_t tree_shape_hash(uint32_t hash,
+	__isl_keep isl_schedule_tree *tree)
+{
+	int i, n;
+	enum isl_schedule_node_type type;
+
+	type = isl_schedule_tree_get_type(tree);
+	isl_hash_byte(hash, type & 0xFF);
+	if (type == isl_schedule_node_band) {
+		n = isl_schedule_tree_band_n_member(tree);
+		isl_hash_byte(hash, n & 0xFF);
+		for (i = 0; i < n; ++i) {
+			enum isl_ast_loop_type loop_type;
+
+			loop_type = isl_schedule_tree_band_member_get_ast_loop_type(
+								tree, i);
+			isl_hash_byte(hash, loop_type & 0xFF);
+		}
+	}
+
+	n = isl_schedule_tree_n_children(tree);
+	isl_hash_byte(hash, n & 0xFF);
+	for (i = 0; i < n; ++i) {
+		isl_schedule_tree *child;
+
+		child = isl_schedule_tree_get_child(tree, i);
+		hash = tree_shape_hash(hash, child);
+		isl_schedule_tree_free(child);
+	}
+
+	return hash;
+}
+
+/* Initialize "key" for looking up or storing the AST generated
+ * from the schedule subtree rooted at "node" in "build",
+ * with "executed" the inverse schedule at "node".
+ *
+ * Return isl_bool_true if the AST cache should be used,
+ * i.e., if the cache is enabled, if no callbacks have been set
+ * on "build" (since those may have side effects and may
+ * produce different results for the same input) and
+ * if the subtree does not depend on its position in the schedule tree.
+ * The key is only initialized in this case and then needs to be cleared
+ * using isl_ast_cache_key_clear.
+ *
+ * Besides the options and the shape of the subtree,
+ * the hash only takes into account the depth of "build",
+ * the number of maps in "executed" and, if "node" is a filter node,
+ * its filter.
+ */
+isl_bool isl_ast_cache_key_init(struct isl_ast_cache_key *key,
+	__isl_keep isl_ast_build *build, __isl_keep isl_schedule_node *node,
+	__isl_keep isl_union_map *executed)
+{
+	isl_ctx *ctx;
+	isl_bool use;
+	uint32_t hash;
+
+	if (!build || !node || !executed)
+		return isl_bool_error;
+	ctx = isl_ast_build_get_ctx(build);
+	if (ctx->opt->ast_build_cache_size <= 0)
+		return isl_bool_false;
+	use = isl_ast_build_has_callback(build);
+	if (use >= 0 && !use)
+		use = isl_schedule_node_is_subtree_anchored(node);
+	if (use < 0 || use)
+		return isl_bool_not(use);
+
+	key->tree = isl_schedule_node_get_tree(node);
+	if (!key->tree)
+		return isl_bool_error;
+	key->build = build;
+	key->executed = executed;
+	key->options = encode_options(ctx);
+	key->max_pieces = ctx->opt->ast_build_separation_max_pieces;
+
+	hash = isl_hash_init();
+	isl_hash_hash(hash, key->options);
+	isl_hash_hash(hash, key->max_pieces);
+	isl_hash_byte(hash, isl_ast_build_get_depth(build) & 0xFF);
+	isl_hash_byte(hash, isl_union_map_n_map(executed) & 0xFF);
+	hash = tree_shape_hash(hash, key->tree);
+	if (isl_schedule_tree_get_type(key->tree) == isl_schedule_node_filter) {
+		isl_union_set *filter;
+
+		filter = isl_schedule_tree_filter_get_filter(key->tree);
+		isl_hash_hash(hash, isl_union_set_get_hash(filter));
+		isl_union_set_free(filter);
+	}
+	key->hash = hash;
+
+	return isl_bool_true;
+}
+
+/* Release the resources held by "key".
+ */
+void isl_ast_cache_key_clear(struct isl_ast_cache_key *key)
+{
+	key->tree = isl_schedule_tree_free(key->tree);
+}
+
+/* Internal data structure for union_map_plain_is_equal.
+ *
+ * "umap" is the union map against which the maps are compared.
+ * "equal" is the result of the comparison.
+ */
+struct isl_ast_cache_umap_data {
+	isl_union_map *umap;
+	isl_bool equal;
+};
+
+/* Is "map" obviously equal to the map in the same space in data->umap?
+ * Interrupt the traversal as soon as this is not the case.
+ */
+static isl_stat map_plain_is_equal_in(__isl_take isl_map *map, void *user)
+{
+	struct isl_ast_cache_umap_data *data = user;
+	isl_map *map2;
+
+	map2 = isl_union_map_extract_map(data->umap, isl_map_get_space(map));
+	data->equal = isl_map_plain_is_equal(map, map2);
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	if (data->equal < 0 || !data->equal)
+		return isl_stat_error;
+	return isl_stat_ok;
+}
+
+/* Are "umap1" and "umap2" obviously equal?
+ * That is, do they consist of maps in the same spaces that
+ * are obviously equal to each other?
+ */
+static isl_bool union_map_plain_is_equal(__isl_keep isl_union_map *umap1,
+	__isl_keep isl_union_map *umap2)
+{
+	struct isl_ast_cache_umap_data data = { umap2, isl_bool_true };
+
+	if (!umap1 || !umap2)
+		return isl_bool_error;
+	if (umap1 == umap2)
+		return isl_bool_true;
+	if (isl_union_map_n_map(umap1) != isl_union_map_n_map(umap2))
+		return isl_bool_false;
+	if (isl_union_map_foreach_map(umap1, &map_plain_is_equal_in,
+					&data) < 0 &&
+	    data.equal == isl_bool_true)
+		return isl_bool_error;
+
+	return data.equal;
+}
+
+/* Does the AST cache entry "entry" correspond to the key "val"?
+ * The schedule trees are compared before the builds and
+ * the inverse schedules since schedule trees that have not been
+ * modified are typically shared between lookups,
+ * making their comparison cheap.
+ * Errors are treated as mismatches.
+ */
+static int has_key(const void *entry, const void *val)
+{
+	const struct isl_ast_cache_entry *e = entry;
+	const struct isl_ast_cache_key *key = val;
+	isl_bool equal;
+
+	if (e->key.options != key->options ||
+	    e->key.max_pieces != key->max_pieces)
+		return 0;
+	equal = isl_schedule_tree_plain_is_equal(e->key.tree, key->tree);
+	if (equal >= 0 && equal)
+		equal = isl_ast_build_plain_is_equal(e->key.build, key->build);
+	if (equal >= 0 && equal)
+		equal = union_map_plain_is_equal(e->key.executed,
+						key->executed);
+
+	return equal == isl_bool_true;
+}
+
+/* Is "entry" equal to "val"?
+ */
+static int is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Return the AST cache of "ctx", allocating it if needed.
+ */
+static struct isl_ast_cache *get_cache(isl_ctx *ctx)
+{
+	struct isl_ast_cache *cache;
+
+	isl_ctx_lock(ctx);
+	cache = ctx->ast_cache;
+	if (cache)
+		goto done;
+
+	cache = isl_calloc_type(ctx, struct isl_ast_cache);
+	if (!cache)
+		goto done;
+	if (isl_hash_table_init(ctx, &cache->table, 16) < 0) {
+		free(cache);
+		cache = NULL;
+		goto done;
+	}
+#ifdef USE_THREADS
+	if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+		isl_hash_table_clear(&cache->table);
+		free(cache);
+		cache = NULL;
+		goto done;
+	}
+#endif
+	ctx->ast_cache = cache;
+done:
+	isl_ctx_unlock(ctx);
+
+	return cache;
+}
+
+/* Remove "entry" from the list of entries of "cache".
+ */
+static void unlink_entry(struct isl_ast_cache *cache,
+	struct isl_ast_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		cache->head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		cache->tail = entry->prev;
+}
+
+/* Add "entry" to the front of the list of entries of "cache".
+ */
+static void link_entry(struct isl_ast_cache *cache,
+	struct isl_ast_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head)
+		cache->head->prev = entry;
+	else
+		cache->tail = entry;
+	cache->head = entry;
+}
+
+/* Free "entry" along with the objects it owns.
+ */
+static void free_entry(struct isl_ast_cache_entry *entry)
+{
+	isl_schedule_tree_free(entry->key.tree);
+	isl_ast_build_free(entry->key.build);
+	isl_union_map_free(entry->key.executed);
+	isl_ast_graft_list_free(entry->list);
+	free(entry);
+}
+
+/* Remove "entry" from "cache".
+ * The caller is responsible for freeing the entry.
+ */
+static void remove_entry(isl_ctx *ctx, struct isl_ast_cache *cache,
+	struct isl_ast_cache_entry *entry)
+{
+	struct isl_hash_table_entry *t;
+
+	t = isl_hash_table_find(ctx, &cache->table, entry->key.hash,
+				&is_entry, entry, 0);
+	if (t)
+		isl_hash_table_remove(ctx, &cache->table, t);
+	unlink_entry(cache, entry);
+	cache->n--;
+}
+
+/* Return the AST stored for "key" in the AST cache of its isl_ctx
+ * or NULL if there is no such AST.
+ * If it is found, then mark the entry as the most recently used one.
+ * The grafts in the result are fresh copies of those in the cache
+ * such that they can be modified by the caller.
+ */
+__isl_give isl_ast_graft_list *isl_ast_cache_find(
+	struct isl_ast_cache_key *key)
+{
+	isl_ctx *ctx;
+	struct isl_ast_cache *cache;
+	struct isl_hash_table_entry *t;
+	struct isl_ast_cache_entry *entry;
+	isl_ast_graft_list *list = NULL;
+
+	ctx = isl_ast_build_get_ctx(key->build);
+	cache = get_cache(ctx);
+	if (!cache)
+		return NULL;
+
+	cache_lock(cache);
+	t = isl_hash_table_find(ctx, &cache->table, key->hash,
+				&has_key, key, 0);
+	if (!t) {
+		cache->misses++;
+	} else {
+		cache->hits++;
+		entry = t->data;
+		unlink_entry(cache, entry);
+		link_entry(cache, entry);
+		list = isl_ast_graft_list_dup_grafts(entry->list);
+	}
+	cache_unlock(cache);
+
+	return list;
+}
+
+/* Store "list" as the AST generated for "key" in the AST cache,
+ * evicting the least recently used entries if the cache would
+ * otherwise exceed the size specified by the ast_build_cache_size option.
+ * If some other thread has added an entry for the same key
+ * in the mean time, then the existing entry is kept.
+ * The cache keeps its own copies of the grafts in "list"
+ * such that they are not affected by any in-place modifications
+ * performed by the caller.
+ * The evicted entries are only freed after releasing the lock
+ * on the cache.
+ *
+ * Failures are not reported since the AST cache
+ * only serves to speed up AST generation.
+ */
+void isl_ast_cache_add(struct isl_ast_cache_key *key,
+	__isl_keep isl_ast_graft_list *list)
+{
+	isl_ctx *ctx;
+	struct isl_ast_cache *cache;
+	struct isl_ast_cache_entry *entry, *evicted = NULL;
+	struct isl_hash_table_entry *t;
+
+	if (!list)
+		return;
+
+	ctx = isl_ast_build_get_ctx(key->build);
+	cache = get_cache(ctx);
+	if (!cache)
+		return;
+	entry = isl_calloc_type(ctx, struct isl_ast_cache_entry);
+	if (!entry)
+		return;
+	entry->key = *key;
+	entry->key.tree = isl_schedule_tree_copy(key->tree);
+	entry->key.build = isl_ast_build_copy(key->build);
+	entry->key.executed = isl_union_map_copy(key->executed);
+	entry->list = isl_ast_graft_list_dup_grafts(list);
+	if (!entry->key.tree || !entry->key.build || !entry->key.executed ||
+	    !entry->list) {
+		free_entry(entry);
+		return;
+	}
+
+	cache_lock(cache);
+	t = isl_hash_table_find(ctx, &cache->table, key->hash,
+				&has_key, key, 1);
+	if (!t || t->data)
+		goto error;
+	t->data = entry;
+	link_entry(cache, entry);
+	cache->n++;
+	while (cache->n > ctx->opt->ast_build_cache_size && cache->tail) {
+		struct isl_ast_cache_entry *tail = cache->tail;
+
+		remove_entry(ctx, cache, tail);
+		tail->next = evicted;
+		evicted = tail;
+	}
+	cache_unlock(cache);
+
+	while (evicted) {
+		entry = evicted;
+		evicted = entry->next;
+		free_entry(entry);
+	}
+
+	return;
+error:
+	cache_unlock(cache);
+	free_entry(entry);
+}
+
+/* Free "cache" along with all its entries.
+ */
+void isl_ast_cache_free(isl_ctx *ctx, struct isl_ast_cache *cache)
+{
+	struct isl_ast_cache_entry *entry, *next;
+
+	if (!cache)
+		return;
+
+	for (entry = cache->head; entry; entry = next) {
+		next = entry->next;
+		free_entry(entry);
+	}
+	isl_hash_table_clear(&cache->table);
+#ifdef USE_THREADS
+	pthread_mutex_destroy(&cache->lock);
+#endif
+	free(cache);
+}
+
+/* Return the number of successful lookups in the AST cache of "ctx".
+ */
+unsigned long isl_ctx_get_ast_cache_hits(isl_ctx *ctx)
+{
+	unsigned long hits = 0;
+	struct isl_ast_cache *cache;
+
+	if (!ctx)
+		return 0;
+	isl_ctx_lock(ctx);
+	cache = ctx->ast_cache;
+	isl_ctx_unlock(ctx);
+	if (cache) {
+		cache_lock(cache);
+		hits = cache->hits;
+		cache_unlock(cache);
+	}
+
+	return hits;
+}
+
+/* Return the number of unsuccessful lookups in the AST cache of "ctx".
+ */
+unsigned long isl_ctx_get_ast_cache_misses(isl_ctx *ctx)
+{
+	unsigned long misses = 0;
+	struct isl_ast_cache *cache;
+
+	if (!ctx)
+		return 0;
+	isl_ctx_lock(ctx);
+	cache = ctx->ast_cache;
+	isl_ctx_unlock(ctx);
+	if (cache) {
+		cache_lock(cache);
+		misses = cache->misses;
+		cache_unlock(cache);
+	}
+
+	return misses;
+}
+
+/* Remove all entries from the AST cache of "ctx" and
+ * reset the hit and miss counters.
+ * This function should not be called while an AST is being generated
+ * in another thread.
+ */
+void isl_ctx_reset_ast_cache(isl_ctx *ctx)
+{
+	struct isl_ast_cache *cache;
+
+	if (!ctx)
+		return;
+	isl_ctx_lock(ctx);
+	cache = ctx->ast_cache;
+	ctx->ast_cache = NULL;
+	isl_ctx_unlock(ctx);
+	isl_ast_cache_free(ctx, cache);
+}
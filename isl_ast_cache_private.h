@@ -0,0 +1,45 @@
+#ifndef ISL_AST_CACHE_PRIVATE_H
+#define ISL_AST_CACHE_PRIVATE_H
+
+#include <isl/union_map.h>
+#include <isl/schedule_node.h>
+#include <isl_ast_build_private.h>
+#include <isl_ast_graft_private.h>
+#include <isl_schedule_tree.h>
+
+struct isl_ast_cache;
+
+/* A key into the AST cache of an isl_ctx.
+ *
+ * "tree" is the schedule subtree from which an AST is generated,
+ * "build" is the AST build in which it is generated and
+ * "executed" is the inverse schedule at the root of "tree".
+ * "options" encodes the values of the boolean and choice
+ * AST generation options, while "max_pieces" is the value
+ * of the ast_build_separation_max_pieces option.
+ * "hash" is a hash of the above.
+ *
+ * "tree" is owned by the key, while "build" and "executed" are not.
+ */
+struct isl_ast_cache_key {
+	isl_schedule_tree *tree;
+	isl_ast_build *build;
+	isl_union_map *executed;
+	unsigned options;
+	int max_pieces;
+	uint32_t hash;
+};
+
+isl_bool isl_ast_cache_key_init(struct isl_ast_cache_key *key,
+	__isl_keep isl_ast_build *build, __isl_keep isl_schedule_node *node,
+	__isl_keep isl_union_map *executed);
+void isl_ast_cache_key_clear(struct isl_ast_cache_key *key);
+
+__isl_give isl_ast_graft_list *isl_ast_cache_find(
+	struct isl_ast_cache_key *key);
+void isl_ast_cache_add(struct isl_ast_cache_key *key,
+	__isl_keep isl_ast_graft_list *list);
+
+void isl_ast_cache_free(isl_ctx *ctx, struct isl_ast_cache *cache);
+
+#endif
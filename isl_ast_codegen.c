@@ -25,7 +25,11 @@
 #include <isl_ast_private.h>
 #include <isl_ast_build_expr.h>
 #include <isl_ast_build_private.h>
+#include <isl_ast_cache_private.h>
 #include <isl_ast_graft_private.h>
+#include <isl_options_private.h>
+#include <isl_parallel.h>
+#include <isl_profile_private.h>
 
 /* Data used in generate_domain.
  *
@@ -2174,12 +2178,17 @@ static __isl_give isl_ast_graft_list *generate_parallel_domains(
 /* Internal data for separate_domain.
  *
  * "explicit" is set if we only want to use explicit bounds.
+ * "max_pieces" is the maximal number of separated domains,
+ * with 0 meaning that there is no limit.
+ * "exceeded" is set if this limit has been exceeded.
  *
  * "domain" collects the separated domains.
  */
 struct isl_separate_domain_data {
 	isl_ast_build *build;
 	int explicit;
+	int max_pieces;
+	int exceeded;
 	isl_set *domain;
 };
 
@@ -2233,6 +2242,9 @@ static __isl_give isl_set *explicit_bounds(__isl_take isl_map *map,
  * and pieces that do not intersect with the range of "map"
  * and then add that part of the range of "map" that does not intersect
  * with data->domain.
+ *
+ * If this results in more pieces than allowed by data->max_pieces,
+ * then interrupt the separation.
  */
 static isl_stat separate_domain(__isl_take isl_map *map, void *user)
 {
@@ -2253,9 +2265,35 @@ static isl_stat separate_domain(__isl_take isl_map *map, void *user)
 	data->domain = isl_set_union(data->domain, d1);
 	data->domain = isl_set_union(data->domain, d2);
 
+	if (data->max_pieces > 0 &&
+	    isl_set_n_basic_set(data->domain) > data->max_pieces) {
+		data->exceeded = 1;
+		return isl_stat_error;
+	}
+
 	return isl_stat_ok;
 }
 
+/* Construct a single basic set that includes the domain of "executed",
+ * with inner dimensions projected out, in the same way as
+ * generate_shifted_component_tree_base does for the atomic option.
+ */
+static __isl_give isl_set *atomic_schedule_domain(
+	__isl_keep isl_union_map *executed, __isl_keep isl_ast_build *build)
+{
+	isl_union_set *schedule_domain;
+	isl_set *domain;
+	isl_basic_set *hull;
+
+	schedule_domain = isl_union_map_domain(isl_union_map_copy(executed));
+	domain = isl_set_from_union_set(schedule_domain);
+	domain = isl_ast_build_eliminate(build, domain);
+	domain = isl_set_coalesce(domain);
+	hull = isl_set_unshifted_simple_hull(domain);
+
+	return isl_set_from_basic_set(hull);
+}
+
 /* Separate the schedule domains of "executed".
  *
  * That is, break up the domain of "executed" into basic sets,
@@ -2263,6 +2301,13 @@ static isl_stat separate_domain(__isl_take isl_map *map, void *user)
  * the same domain spaces.
  *
  * "space" is the (single) domain space of "executed".
+ *
+ * The number of pieces may grow exponentially in the number
+ * of maps in "executed".  If it exceeds the limit set by
+ * the ast_build_separation_max_pieces option, then separation
+ * is abandoned and the domain of "executed" is combined
+ * into a single basic set instead, as if the atomic option
+ * had been specified.
  */
 static __isl_give isl_set *separate_schedule_domains(
 	__isl_take isl_space *space, __isl_take isl_union_map *executed,
@@ -2274,9 +2319,13 @@ static __isl_give isl_set *separate_schedule_domains(
 	ctx = isl_ast_build_get_ctx(build);
 	data.explicit = isl_options_get_ast_build_separation_bounds(ctx) ==
 				    ISL_AST_BUILD_SEPARATION_BOUNDS_EXPLICIT;
+	data.max_pieces =
+		isl_options_get_ast_build_separation_max_pieces(ctx);
 	data.domain = isl_set_empty(space);
 	if (isl_union_map_foreach_map(executed, &separate_domain, &data) < 0)
 		data.domain = isl_set_free(data.domain);
+	if (data.exceeded)
+		data.domain = atomic_schedule_domain(executed, build);
 
 	isl_union_map_free(executed);
 	return data.domain;
@@ -5037,6 +5086,8 @@ error:
  * The main computation is performed on an inverse schedule (with
  * the schedule domain in the domain and the elements to be executed
  * in the range) called "executed".
+ * Any AST expression cache is only shared by the builds
+ * derived during this computation.
  */
 __isl_give isl_ast_node *isl_ast_build_node_from_schedule_map(
 	__isl_keep isl_ast_build *build, __isl_take isl_union_map *schedule)
@@ -5047,6 +5098,7 @@ __isl_give isl_ast_node *isl_ast_build_node_from_schedule_map(
 
 	build = isl_ast_build_copy(build);
 	build = isl_ast_build_set_single_valued(build, 0);
+	build = isl_ast_build_init_expr_cache(build);
 	schedule = isl_union_map_coalesce(schedule);
 	schedule = isl_union_map_remove_redundancies(schedule);
 	executed = isl_union_map_reverse(schedule);
@@ -5541,6 +5593,114 @@ static __isl_give isl_ast_graft_list *build_ast_from_schedule_node(
 	__isl_take isl_ast_build *build, __isl_take isl_schedule_node *node,
 	__isl_take isl_union_map *executed);
 
+/* Generate an AST for child "pos" of the sequence (or set) node "node",
+ * with "executed" the inverse schedule at "node".
+ *
+ * If the AST cache is enabled, then first check if an AST
+ * has already been generated for the same child in the same context.
+ * If not, the generated AST is added to the cache.
+ */
+static __isl_give isl_ast_graft_list *build_ast_from_sequence_child(
+	__isl_keep isl_ast_build *build, __isl_keep isl_schedule_node *node,
+	int pos, __isl_keep isl_union_map *executed)
+{
+	isl_bool use_cache;
+	isl_schedule_node *child;
+	isl_ast_graft_list *list;
+	struct isl_ast_cache_key key;
+
+	child = isl_schedule_node_get_child(node, pos);
+	use_cache = isl_ast_cache_key_init(&key, build, child, executed);
+	if (use_cache < 0)
+		goto error;
+	if (use_cache) {
+		list = isl_ast_cache_find(&key);
+		if (list) {
+			isl_ast_cache_key_clear(&key);
+			isl_schedule_node_free(child);
+			return list;
+		}
+	}
+
+	list = build_ast_from_schedule_node(isl_ast_build_copy(build), child,
+					isl_union_map_copy(executed));
+
+	if (use_cache) {
+		isl_ast_cache_add(&key, list);
+		isl_ast_cache_key_clear(&key);
+	}
+
+	return list;
+error:
+	isl_schedule_node_free(child);
+	return NULL;
+}
+
+/* Internal data structure for build_ast_from_sequence_parallel.
+ * "build", "node" and "executed" are the arguments
+ * of build_ast_from_sequence, while "list" collects
+ * the AST generated for each child of "node".
+ */
+struct isl_ast_sequence_data {
+	isl_ast_build *build;
+	isl_schedule_node *node;
+	isl_union_map *executed;
+	isl_ast_graft_list **list;
+};
+
+/* isl_parallel_for callback for build_ast_from_sequence_parallel.
+ * Generate an AST for child "i" of data->node and
+ * store the result in data->list[i].
+ */
+static isl_stat build_ast_from_child_task(int i, void *user)
+{
+	struct isl_ast_sequence_data *data = user;
+
+	data->list[i] = build_ast_from_sequence_child(data->build,
+					data->node, i, data->executed);
+
+	return data->list[i] ? isl_stat_ok : isl_stat_error;
+}
+
+/* Generate an AST for each of the "n" children of the sequence (or set)
+ * node "node" in parallel and concatenate the results.
+ *
+ * The ASTs of the children are only concatenated once all of them
+ * have been generated, in the order of the children, such that
+ * the result is exactly the same as when the ASTs are generated
+ * one by one in build_ast_from_sequence.
+ */
+static __isl_give isl_ast_graft_list *build_ast_from_sequence_parallel(
+	__isl_take isl_ast_build *build, __isl_take isl_schedule_node *node,
+	__isl_take isl_union_map *executed, int n)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_stat r;
+	isl_ast_graft_list *list;
+	struct isl_ast_sequence_data data = { build, node, executed };
+
+	ctx = isl_ast_build_get_ctx(build);
+	data.list = isl_calloc_array(ctx, isl_ast_graft_list *, n);
+	r = data.list ? isl_stat_ok : isl_stat_error;
+	if (r >= 0)
+		r = isl_parallel_for(ctx, n, &build_ast_from_child_task, &data);
+
+	list = r < 0 ? NULL : isl_ast_graft_list_alloc(ctx, n);
+	for (i = 0; data.list && i < n; ++i) {
+		if (list)
+			list = isl_ast_graft_list_concat(list, data.list[i]);
+		else
+			isl_ast_graft_list_free(data.list[i]);
+	}
+	free(data.list);
+	isl_ast_build_free(build);
+	isl_schedule_node_free(node);
+	isl_union_map_free(executed);
+
+	return list;
+}
+
 /* Generate an AST that visits the elements in the domain of "executed"
  * in the relative order specified by the sequence (or set) node "node" and
  * its descendants.
@@ -5549,7 +5709,12 @@ static __isl_give isl_ast_graft_list *build_ast_from_schedule_node(
  * to the domain elements executed by those iterations.
  *
  * We simply generate an AST for each of the children and concatenate
- * the results.
+ * the results.  The ASTs of the children may be taken from the AST cache
+ * (see build_ast_from_sequence_child).
+ * If the ast_build_parallel option is set, if no user callbacks
+ * have been set on "build" and if the children can be handled
+ * by several threads, then this is done in
+ * build_ast_from_sequence_parallel.
  */
 static __isl_give isl_ast_graft_list *build_ast_from_sequence(
 	__isl_take isl_ast_build *build, __isl_take isl_schedule_node *node,
@@ -5557,19 +5722,25 @@ static __isl_give isl_ast_graft_list *build_ast_from_sequence(
 {
 	int i, n;
 	isl_ctx *ctx;
+	isl_bool callback;
 	isl_ast_graft_list *list;
 
 	ctx = isl_ast_build_get_ctx(build);
-	list = isl_ast_graft_list_alloc(ctx, 0);
-
 	n = isl_schedule_node_n_children(node);
+	callback = isl_ast_build_has_callback(build);
+	if (callback < 0 || n < 0)
+		goto error;
+	if (ctx->opt->ast_build_parallel && !callback &&
+	    isl_parallel_n_threads(ctx, n) > 1)
+		return build_ast_from_sequence_parallel(build, node,
+							executed, n);
+
+	list = isl_ast_graft_list_alloc(ctx, 0);
 	for (i = 0; i < n; ++i) {
-		isl_schedule_node *child;
 		isl_ast_graft_list *list_i;
 
-		child = isl_schedule_node_get_child(node, i);
-		list_i = build_ast_from_schedule_node(isl_ast_build_copy(build),
-					child, isl_union_map_copy(executed));
+		list_i = build_ast_from_sequence_child(build, node, i,
+							executed);
 		list = isl_ast_graft_list_concat(list, list_i);
 	}
 	isl_ast_build_free(build);
@@ -5577,6 +5748,11 @@ static __isl_give isl_ast_graft_list *build_ast_from_sequence(
 	isl_union_map_free(executed);
 
 	return list;
+error:
+	isl_ast_build_free(build);
+	isl_schedule_node_free(node);
+	isl_union_map_free(executed);
+	return NULL;
 }
 
 /* Generate an AST that visits the elements in the domain of "executed"
@@ -5659,12 +5835,12 @@ static __isl_give isl_ast_graft_list *build_ast_from_child(
 	return build_ast_from_schedule_node(build, node, executed);
 }
 
-/* Generate an AST that visits the elements in the domain of the domain
- * node "node" in the relative order specified by its descendants.
+/* Construct the initial inverse schedule for generating an AST
+ * from the domain node "node".
  *
- * An initial inverse schedule is created that maps a zero-dimensional
+ * The initial inverse schedule maps a zero-dimensional
  * schedule space to the node domain.
- * The input "build" is assumed to have a parametric domain and
+ * The input "*build" is assumed to have a parametric domain and
  * is replaced by the same zero-dimensional schedule space.
  *
  * We also add some of the parameter constraints in the build domain
@@ -5673,44 +5849,62 @@ static __isl_give isl_ast_graft_list *build_ast_from_child(
  * However, we do not want to divide the executed relation into
  * more disjuncts than necessary.  We therefore approximate
  * the constraints on the parameters by a single disjunct set.
+ *
+ * If anything goes wrong, then NULL is returned and
+ * "*build" still needs to be freed by the caller.
  */
-static __isl_give isl_ast_node *build_ast_from_domain(
-	__isl_take isl_ast_build *build, __isl_take isl_schedule_node *node)
+static __isl_give isl_union_map *init_domain_executed(
+	isl_ast_build **build, __isl_keep isl_schedule_node *node)
 {
 	isl_ctx *ctx;
 	isl_union_set *domain, *schedule_domain;
-	isl_union_map *executed;
 	isl_space *space;
 	isl_set *set;
-	isl_ast_graft_list *list;
-	isl_ast_node *ast;
 	int is_params;
 
-	if (!build)
-		goto error;
+	if (!*build)
+		return NULL;
 
-	ctx = isl_ast_build_get_ctx(build);
-	space = isl_ast_build_get_space(build, 1);
+	ctx = isl_ast_build_get_ctx(*build);
+	space = isl_ast_build_get_space(*build, 1);
 	is_params = isl_space_is_params(space);
 	isl_space_free(space);
 	if (is_params < 0)
-		goto error;
+		return NULL;
 	if (!is_params)
 		isl_die(ctx, isl_error_unsupported,
-			"expecting parametric initial context", goto error);
+			"expecting parametric initial context", return NULL);
 
 	domain = isl_schedule_node_domain_get_domain(node);
 	domain = isl_union_set_coalesce(domain);
 
 	space = isl_union_set_get_space(domain);
 	space = isl_space_set_from_params(space);
-	build = isl_ast_build_product(build, space);
+	*build = isl_ast_build_product(*build, space);
 
-	set = isl_ast_build_get_domain(build);
+	set = isl_ast_build_get_domain(*build);
 	set = isl_set_from_basic_set(isl_set_simple_hull(set));
 	schedule_domain = isl_union_set_from_set(set);
 
-	executed = isl_union_map_from_domain_and_range(schedule_domain, domain);
+	return isl_union_map_from_domain_and_range(schedule_domain, domain);
+}
+
+/* Generate an AST that visits the elements in the domain of the domain
+ * node "node" in the relative order specified by its descendants.
+ * The initial inverse schedule and build are constructed
+ * by init_domain_executed.
+ */
+static __isl_give isl_ast_node *build_ast_from_domain(
+	__isl_take isl_ast_build *build, __isl_take isl_schedule_node *node)
+{
+	isl_union_map *executed;
+	isl_ast_graft_list *list;
+	isl_ast_node *ast;
+
+	executed = init_domain_executed(&build, node);
+	if (!executed)
+		goto error;
+
 	list = build_ast_from_child(isl_ast_build_copy(build), node, executed);
 	ast = isl_ast_node_from_graft_list(list, build);
 	isl_ast_build_free(build);
@@ -5731,8 +5925,10 @@ error:
  *
  * The construction starts at the root node of the schedule,
  * which is assumed to be a domain node.
+ * Any AST expression cache is only shared by the builds
+ * derived during this construction.
  */
-__isl_give isl_ast_node *isl_ast_build_node_from_schedule(
+static __isl_give isl_ast_node *ast_build_node_from_schedule(
 	__isl_keep isl_ast_build *build, __isl_take isl_schedule *schedule)
 {
 	isl_ctx *ctx;
@@ -5750,6 +5946,7 @@ __isl_give isl_ast_node *isl_ast_build_node_from_schedule(
 
 	build = isl_ast_build_copy(build);
 	build = isl_ast_build_set_single_valued(build, 0);
+	build = isl_ast_build_init_expr_cache(build);
 	if (isl_schedule_node_get_type(node) != isl_schedule_node_domain)
 		isl_die(ctx, isl_error_unsupported,
 			"expecting root domain node",
@@ -5759,3 +5956,146 @@ error:
 	isl_schedule_free(schedule);
 	return NULL;
 }
+
+/* Generate an AST that visits the elements in the domain of "schedule"
+ * in the relative order specified by the schedule tree,
+ * profiling the operation if requested.
+ */
+__isl_give isl_ast_node *isl_ast_build_node_from_schedule(
+	__isl_keep isl_ast_build *build, __isl_take isl_schedule *schedule)
+{
+	isl_ctx *ctx;
+	isl_ast_node *node;
+	struct isl_profile_scope scope;
+
+	if (!build) {
+		isl_schedule_free(schedule);
+		return NULL;
+	}
+
+	ctx = isl_ast_build_get_ctx(build);
+	isl_profile_enter(ctx, "isl_ast_build_node_from_schedule", &scope);
+	node = ast_build_node_from_schedule(build, schedule);
+	isl_profile_leave(ctx, &scope);
+
+	return node;
+}
+
+/* Print the AST that visits the elements in the domain of the domain
+ * node "node" in the relative order specified by its descendants
+ * to "p", while it is being generated.
+ *
+ * If the child of "node" is a sequence (or set) node, then
+ * the ASTs of its children are generated one by one and
+ * each top-level AST node is printed as soon as it is known
+ * that it will no longer be modified.
+ * Since the if nodes for the guards of a graft may still be extended
+ * by the next graft, the last graft is always kept back.
+ * The AST nodes that have been printed are not kept in memory.
+ * Otherwise, the entire AST is generated and then printed.
+ * In both cases, the result is the same as that of printing the AST
+ * constructed by build_ast_from_domain.
+ */
+static __isl_give isl_printer *print_from_domain(
+	__isl_take isl_ast_build *build, __isl_take isl_schedule_node *node,
+	__isl_take isl_printer *p, __isl_keep isl_ast_print_options *options)
+{
+	int i, n = 1, n_printed = 0;
+	int is_sequence;
+	isl_union_map *executed;
+	isl_ast_node_list *node_list;
+	struct isl_ast_graft_stream *stream;
+	enum isl_schedule_node_type type;
+
+	executed = init_domain_executed(&build, node);
+	node = isl_schedule_node_child(node, 0);
+	stream = isl_ast_graft_stream_alloc(build);
+	if (!executed || !node || !stream)
+		p = isl_printer_free(p);
+
+	type = isl_schedule_node_get_type(node);
+	is_sequence = type == isl_schedule_node_sequence ||
+			type == isl_schedule_node_set;
+	if (is_sequence)
+		n = isl_schedule_node_n_children(node);
+	if (n < 0)
+		p = isl_printer_free(p);
+	for (i = 0; p && i < n; ++i) {
+		isl_ast_graft_list *list;
+
+		if (is_sequence)
+			list = build_ast_from_sequence_child(build, node, i,
+								executed);
+		else
+			list = build_ast_from_schedule_node(
+					isl_ast_build_copy(build),
+					isl_schedule_node_copy(node),
+					isl_union_map_copy(executed));
+		node_list = isl_ast_graft_stream_add(stream, list);
+		if (!node_list)
+			p = isl_printer_free(p);
+		p = isl_ast_node_list_print_partial(node_list, p, options,
+							&n_printed, 0);
+		isl_ast_node_list_free(node_list);
+	}
+
+	node_list = isl_ast_graft_stream_finish(stream);
+	p = isl_ast_node_list_print_partial(node_list, p, options,
+						&n_printed, 1);
+	isl_ast_node_list_free(node_list);
+
+	isl_union_map_free(executed);
+	isl_schedule_node_free(node);
+	isl_ast_build_free(build);
+
+	return p;
+}
+
+/* Generate an AST that visits the elements in the domain of "schedule"
+ * in the relative order specified by the schedule tree and
+ * print it to "p" in C format while it is being generated,
+ * profiling the operation if requested.
+ *
+ * The output is the same as that of isl_ast_node_print applied
+ * to the result of isl_ast_build_node_from_schedule,
+ * but the entire AST is not kept in memory if the root domain node
+ * of "schedule" has a sequence (or set) node as child.
+ * See print_from_domain.
+ */
+__isl_give isl_printer *isl_ast_build_print_from_schedule(
+	__isl_keep isl_ast_build *build, __isl_take isl_schedule *schedule,
+	__isl_take isl_printer *p, __isl_take isl_ast_print_options *options)
+{
+	isl_ctx *ctx;
+	isl_schedule_node *node = NULL;
+	struct isl_profile_scope scope;
+
+	if (!build || !schedule || !options)
+		goto error;
+
+	ctx = isl_ast_build_get_ctx(build);
+	node = isl_schedule_get_root(schedule);
+	isl_schedule_free(schedule);
+	if (!node)
+		goto error_node;
+	if (isl_schedule_node_get_type(node) != isl_schedule_node_domain)
+		isl_die(ctx, isl_error_unsupported,
+			"expecting root domain node", goto error_node);
+
+	isl_profile_enter(ctx, "isl_ast_build_print_from_schedule", &scope);
+	build = isl_ast_build_copy(build);
+	build = isl_ast_build_set_single_valued(build, 0);
+	build = isl_ast_build_init_expr_cache(build);
+	p = print_from_domain(build, node, p, options);
+	isl_profile_leave(ctx, &scope);
+
+	isl_ast_print_options_free(options);
+	return p;
+error:
+	isl_schedule_free(schedule);
+error_node:
+	isl_schedule_node_free(node);
+	isl_ast_print_options_free(options);
+	isl_printer_free(p);
+	return NULL;
+}
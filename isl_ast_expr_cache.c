@@ -0,0 +1,559 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_map_private.h>
+#include <isl_aff_private.h>
+#include <isl_seq.h>
+#include <isl/hash.h>
+#include <isl/id.h>
+#include <isl_ast_expr_cache_private.h>
+
+/* A key into an AST expression cache.
+ *
+ * Exactly one of "pa" and "set" is set.  It is the piecewise
+ * affine expression or the set from which an AST expression
+ * is constructed.
+ * "domain", "values" and "iterators" are the corresponding fields
+ * of the isl_ast_build in which the expression is constructed.
+ * These are the only fields of the isl_ast_build
+ * that affect the construction.
+ * "options" encodes the values of the options that affect
+ * the construction of AST expressions.
+ * "hash" is a hash of the above.
+ */
+struct isl_ast_expr_cache_key {
+	isl_pw_aff *pa;
+	isl_set *set;
+	isl_set *domain;
+	isl_multi_aff *values;
+	isl_id_list *iterators;
+	unsigned options;
+	uint32_t hash;
+};
+
+/* An entry in an AST expression cache.
+ *
+ * "expr" is the AST expression constructed for "key".
+ * The objects in "key" as well as "expr" are owned by the entry.
+ * "prev" and "next" link the entries in order of most recent use.
+ */
+struct isl_ast_expr_cache_entry {
+	struct isl_ast_expr_cache_key key;
+	isl_ast_expr *expr;
+
+	struct isl_ast_expr_cache_entry *prev;
+	struct isl_ast_expr_cache_entry *next;
+};
+
+/* A cache of AST expressions, shared by an isl_ast_build and
+ * all the isl_ast_builds derived from it.
+ *
+ * "size" is the maximal number of entries.
+ * "table" contains "n" entries, each of which also appears
+ * in the list starting at "head" (the most recently used entry)
+ * and ending at "tail" (the least recently used entry).
+ *
+ * Since the isl_ast_builds that share the cache may be used
+ * from different threads, the cache is protected by "lock"
+ * in builds with thread support.
+ */
+struct isl_ast_expr_cache {
+	int ref;
+
+	isl_ctx *ctx;
+	int size;
+	int n;
+	struct isl_hash_table table;
+	struct isl_ast_expr_cache_entry *head;
+	struct isl_ast_expr_cache_entry *tail;
+
+#ifdef USE_THREADS
+	pthread_mutex_t lock;
+#endif
+};
+
+/* Acquire the lock on "cache", if any.
+ */
+static void cache_lock(struct isl_ast_expr_cache *cache)
+{
+#ifdef USE_THREADS
+	pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+/* Release the lock on "cache", if any.
+ */
+static void cache_unlock(struct isl_ast_expr_cache *cache)
+{
+#ifdef USE_THREADS
+	pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+/* Create an AST expression cache that keeps at most "size" expressions.
+ */
+struct isl_ast_expr_cache *isl_ast_expr_cache_alloc(isl_ctx *ctx, int size)
+{
+	struct isl_ast_expr_cache *cache;
+
+	cache = isl_calloc_type(ctx, struct isl_ast_expr_cache);
+	if (!cache)
+		return NULL;
+	cache->ref = 1;
+	cache->ctx = ctx;
+	cache->size = size;
+	if (isl_hash_table_init(ctx, &cache->table, 16) < 0) {
+		free(cache);
+		return NULL;
+	}
+#ifdef USE_THREADS
+	if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+		isl_hash_table_clear(&cache->table);
+		free(cache);
+		return NULL;
+	}
+#endif
+
+	return cache;
+}
+
+struct isl_ast_expr_cache *isl_ast_expr_cache_copy(
+	struct isl_ast_expr_cache *cache)
+{
+	if (!cache)
+		return NULL;
+
+	isl_atomic_inc(&cache->ref);
+	return cache;
+}
+
+/* Release the objects held by "key".
+ */
+static void key_clear(struct isl_ast_expr_cache_key *key)
+{
+	isl_pw_aff_free(key->pa);
+	isl_set_free(key->set);
+	isl_set_free(key->domain);
+	isl_multi_aff_free(key->values);
+	isl_id_list_free(key->iterators);
+}
+
+/* Free "entry" along with the objects it owns.
+ */
+static void free_entry(struct isl_ast_expr_cache_entry *entry)
+{
+	key_clear(&entry->key);
+	isl_ast_expr_free(entry->expr);
+	free(entry);
+}
+
+struct isl_ast_expr_cache *isl_ast_expr_cache_free(
+	struct isl_ast_expr_cache *cache)
+{
+	struct isl_ast_expr_cache_entry *entry, *next;
+
+	if (!cache)
+		return NULL;
+
+	if (isl_atomic_dec(&cache->ref) > 0)
+		return NULL;
+
+	for (entry = cache->head; entry; entry = next) {
+		next = entry->next;
+		free_entry(entry);
+	}
+	isl_hash_table_clear(&cache->table);
+#ifdef USE_THREADS
+	pthread_mutex_destroy(&cache->lock);
+#endif
+	free(cache);
+
+	return NULL;
+}
+
+/* Combine "hash" with a hash of the representation of "set".
+ * Unlike isl_set_get_hash, this function does not normalize "set"
+ * since doing so would modify the representation of "set" and
+ * could therefore affect the AST that is being generated.
+ * Sets that are equal but that are represented differently
+ * therefore typically have a different hash.
+ */
+static uint32_t set_repr_hash(uint32_t hash, __isl_keep isl_set *set)
+{
+	int i, j;
+
+	isl_hash_byte(hash, set->n & 0xFF);
+	for (i = 0; i < set->n; ++i) {
+		isl_basic_set *bset = set->p[i];
+		unsigned total = isl_basic_set_total_dim(bset);
+
+		isl_hash_byte(hash, bset->n_eq & 0xFF);
+		isl_hash_byte(hash, bset->n_ineq & 0xFF);
+		isl_hash_byte(hash, bset->n_div & 0xFF);
+		for (j = 0; j < bset->n_eq; ++j)
+			isl_hash_hash(hash,
+				    isl_seq_get_hash(bset->eq[j], 1 + total));
+		for (j = 0; j < bset->n_ineq; ++j)
+			isl_hash_hash(hash,
+				    isl_seq_get_hash(bset->ineq[j], 1 + total));
+	}
+
+	return hash;
+}
+
+/* Combine "hash" with a hash of the representation of "pa".
+ */
+static uint32_t pw_aff_repr_hash(uint32_t hash, __isl_keep isl_pw_aff *pa)
+{
+	int i;
+
+	isl_hash_byte(hash, pa->n & 0xFF);
+	for (i = 0; i < pa->n; ++i) {
+		hash = set_repr_hash(hash, pa->p[i].set);
+		isl_hash_hash(hash, isl_aff_get_hash(pa->p[i].aff));
+	}
+
+	return hash;
+}
+
+/* Do "set1" and "set2" have the same representation?
+ */
+static isl_bool set_is_identical(__isl_keep isl_set *set1,
+	__isl_keep isl_set *set2)
+{
+	int i;
+	isl_bool equal;
+
+	if (!set1 || !set2)
+		return isl_bool_error;
+	if (set1 == set2)
+		return isl_bool_true;
+	if (set1->n != set2->n)
+		return isl_bool_false;
+	equal = isl_space_is_equal(set1->dim, set2->dim);
+	for (i = 0; equal == isl_bool_true && i < set1->n; ++i)
+		equal = isl_basic_set_plain_is_equal(set1->p[i], set2->p[i]);
+
+	return equal;
+}
+
+/* Do "pa1" and "pa2" have the same representation?
+ */
+static isl_bool pw_aff_is_identical(__isl_keep isl_pw_aff *pa1,
+	__isl_keep isl_pw_aff *pa2)
+{
+	int i;
+	isl_bool equal;
+
+	if (!pa1 || !pa2)
+		return isl_bool_error;
+	if (pa1 == pa2)
+		return isl_bool_true;
+	if (pa1->n != pa2->n)
+		return isl_bool_false;
+	equal = isl_space_is_equal(pa1->dim, pa2->dim);
+	for (i = 0; equal == isl_bool_true && i < pa1->n; ++i) {
+		equal = set_is_identical(pa1->p[i].set, pa2->p[i].set);
+		if (equal == isl_bool_true)
+			equal = isl_aff_plain_is_equal(pa1->p[i].aff,
+							pa2->p[i].aff);
+	}
+
+	return equal;
+}
+
+/* Do "list1" and "list2" consist of the same identifiers?
+ */
+static isl_bool id_list_is_equal(__isl_keep isl_id_list *list1,
+	__isl_keep isl_id_list *list2)
+{
+	int i, n;
+
+	if (!list1 || !list2)
+		return isl_bool_error;
+	if (list1 == list2)
+		return isl_bool_true;
+	n = isl_id_list_n_id(list1);
+	if (n != isl_id_list_n_id(list2))
+		return isl_bool_false;
+	for (i = 0; i < n; ++i) {
+		isl_id *id1, *id2;
+
+		id1 = isl_id_list_get_id(list1, i);
+		id2 = isl_id_list_get_id(list2, i);
+		isl_id_free(id1);
+		isl_id_free(id2);
+		if (!id1 || !id2)
+			return isl_bool_error;
+		if (id1 != id2)
+			return isl_bool_false;
+	}
+
+	return isl_bool_true;
+}
+
+/* Initialize "key" for looking up or storing the AST expression
+ * constructed from "pa" or "set" in "build".
+ * The objects in "key" are not owned by "key".
+ *
+ * The hash only takes into account the representation of "pa" or "set",
+ * that of the domain of "build" and the options.
+ * Note that the domain of "build" is typically shared by
+ * many lookups, while "values" and "iterators" rarely change
+ * without the domain changing as well.
+ */
+static isl_stat key_init(struct isl_ast_expr_cache_key *key,
+	__isl_keep isl_ast_build *build, __isl_keep isl_pw_aff *pa,
+	__isl_keep isl_set *set)
+{
+	isl_ctx *ctx;
+	uint32_t hash;
+
+	if (!build || !build->domain || (!pa && !set))
+		return isl_stat_error;
+
+	ctx = isl_ast_build_get_ctx(build);
+	key->pa = pa;
+	key->set = set;
+	key->domain = build->domain;
+	key->values = build->values;
+	key->iterators = build->iterators;
+	key->options = !!ctx->opt->ast_build_prefer_pdiv;
+	key->options = (key->options << 1) |
+			!!ctx->opt->ast_build_detect_min_max;
+
+	hash = isl_hash_init();
+	isl_hash_byte(hash, pa ? 1 : 0);
+	isl_hash_byte(hash, key->options & 0xFF);
+	if (pa)
+		hash = pw_aff_repr_hash(hash, pa);
+	else
+		hash = set_repr_hash(hash, set);
+	hash = set_repr_hash(hash, key->domain);
+	key->hash = hash;
+
+	return isl_stat_ok;
+}
+
+/* Does the cache entry "entry" correspond to the key "val"?
+ * Errors are treated as mismatches.
+ */
+static int has_key(const void *entry, const void *val)
+{
+	const struct isl_ast_expr_cache_entry *e = entry;
+	const struct isl_ast_expr_cache_key *key = val;
+	isl_bool equal;
+
+	if (e->key.options != key->options)
+		return 0;
+	if (!e->key.pa != !key->pa)
+		return 0;
+	if (key->pa)
+		equal = pw_aff_is_identical(e->key.pa, key->pa);
+	else
+		equal = set_is_identical(e->key.set, key->set);
+	if (equal == isl_bool_true)
+		equal = set_is_identical(e->key.domain, key->domain);
+	if (equal == isl_bool_true && e->key.values != key->values)
+		equal = isl_multi_aff_plain_is_equal(e->key.values,
+							key->values);
+	if (equal == isl_bool_true)
+		equal = id_list_is_equal(e->key.iterators, key->iterators);
+
+	return equal == isl_bool_true;
+}
+
+/* Is "entry" equal to "val"?
+ */
+static int is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Remove "entry" from the list of entries of "cache".
+ */
+static void unlink_entry(struct isl_ast_expr_cache *cache,
+	struct isl_ast_expr_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		cache->head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		cache->tail = entry->prev;
+}
+
+/* Add "entry" to the front of the list of entries of "cache".
+ */
+static void link_entry(struct isl_ast_expr_cache *cache,
+	struct isl_ast_expr_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head)
+		cache->head->prev = entry;
+	else
+		cache->tail = entry;
+	cache->head = entry;
+}
+
+/* Remove "entry" from "cache".
+ * The caller is responsible for freeing the entry.
+ */
+static void remove_entry(struct isl_ast_expr_cache *cache,
+	struct isl_ast_expr_cache_entry *entry)
+{
+	struct isl_hash_table_entry *t;
+
+	t = isl_hash_table_find(cache->ctx, &cache->table, entry->key.hash,
+				&is_entry, entry, 0);
+	if (t)
+		isl_hash_table_remove(cache->ctx, &cache->table, t);
+	unlink_entry(cache, entry);
+	cache->n--;
+}
+
+/* Return the AST expression stored for "pa" or "set" in the expression
+ * cache of "build" or NULL if there is no such expression.
+ * If it is found, then mark the entry as the most recently used one.
+ */
+static __isl_give isl_ast_expr *find(__isl_keep isl_ast_build *build,
+	__isl_keep isl_pw_aff *pa, __isl_keep isl_set *set)
+{
+	struct isl_ast_expr_cache *cache;
+	struct isl_ast_expr_cache_key key;
+	struct isl_hash_table_entry *t;
+	struct isl_ast_expr_cache_entry *entry;
+	isl_ast_expr *expr = NULL;
+
+	if (!build || !build->expr_cache)
+		return NULL;
+	if (key_init(&key, build, pa, set) < 0)
+		return NULL;
+
+	cache = build->expr_cache;
+	cache_lock(cache);
+	t = isl_hash_table_find(cache->ctx, &cache->table, key.hash,
+				&has_key, &key, 0);
+	if (t) {
+		entry = t->data;
+		unlink_entry(cache, entry);
+		link_entry(cache, entry);
+		expr = isl_ast_expr_copy(entry->expr);
+	}
+	cache_unlock(cache);
+
+	return expr;
+}
+
+/* Store "expr" as the AST expression constructed from "pa" or "set"
+ * in the expression cache of "build", evicting the least recently
+ * used entries if the cache would otherwise exceed its size.
+ * If some other thread has added an entry for the same key
+ * in the mean time, then the existing entry is kept.
+ * The evicted entries are only freed after releasing the lock
+ * on the cache.
+ *
+ * Failures are not reported since the cache
+ * only serves to speed up AST generation.
+ */
+static void add(__isl_keep isl_ast_build *build, __isl_keep isl_pw_aff *pa,
+	__isl_keep isl_set *set, __isl_keep isl_ast_expr *expr)
+{
+	struct isl_ast_expr_cache *cache;
+	struct isl_ast_expr_cache_entry *entry, *evicted = NULL;
+	struct isl_hash_table_entry *t;
+
+	if (!build || !build->expr_cache || !expr)
+		return;
+
+	cache = build->expr_cache;
+	entry = isl_calloc_type(cache->ctx, struct isl_ast_expr_cache_entry);
+	if (!entry)
+		return;
+	if (key_init(&entry->key, build, pa, set) < 0) {
+		free(entry);
+		return;
+	}
+	entry->key.pa = isl_pw_aff_copy(pa);
+	entry->key.set = isl_set_copy(set);
+	entry->key.domain = isl_set_copy(entry->key.domain);
+	entry->key.values = isl_multi_aff_copy(entry->key.values);
+	entry->key.iterators = isl_id_list_copy(entry->key.iterators);
+	entry->expr = isl_ast_expr_copy(expr);
+	if ((pa && !entry->key.pa) || (set && !entry->key.set) ||
+	    !entry->key.domain || !entry->key.values ||
+	    !entry->key.iterators || !entry->expr) {
+		free_entry(entry);
+		return;
+	}
+
+	cache_lock(cache);
+	t = isl_hash_table_find(cache->ctx, &cache->table, entry->key.hash,
+				&has_key, &entry->key, 1);
+	if (!t || t->data)
+		goto error;
+	t->data = entry;
+	link_entry(cache, entry);
+	cache->n++;
+	while (cache->n > cache->size && cache->tail) {
+		struct isl_ast_expr_cache_entry *tail = cache->tail;
+
+		remove_entry(cache, tail);
+		tail->next = evicted;
+		evicted = tail;
+	}
+	cache_unlock(cache);
+
+	while (evicted) {
+		entry = evicted;
+		evicted = entry->next;
+		free_entry(entry);
+	}
+
+	return;
+error:
+	cache_unlock(cache);
+	free_entry(entry);
+}
+
+/* Return the AST expression stored for "pa" in the expression cache
+ * of "build" or NULL if there is no such expression.
+ */
+__isl_give isl_ast_expr *isl_ast_expr_cache_find_pw_aff(
+	__isl_keep isl_ast_build *build, __isl_keep isl_pw_aff *pa)
+{
+	return find(build, pa, NULL);
+}
+
+/* Store "expr" as the AST expression constructed from "pa"
+ * in the expression cache of "build".
+ */
+void isl_ast_expr_cache_add_pw_aff(__isl_keep isl_ast_build *build,
+	__isl_keep isl_pw_aff *pa, __isl_keep isl_ast_expr *expr)
+{
+	add(build, pa, NULL, expr);
+}
+
+/* Return the AST expression stored for "set" in the expression cache
+ * of "build" or NULL if there is no such expression.
+ */
+__isl_give isl_ast_expr *isl_ast_expr_cache_find_set(
+	__isl_keep isl_ast_build *build, __isl_keep isl_set *set)
+{
+	return find(build, NULL, set);
+}
+
+/* Store "expr" as the AST expression constructed from "set"
+ * in the expression cache of "build".
+ */
+void isl_ast_expr_cache_add_set(__isl_keep isl_ast_build *build,
+	__isl_keep isl_set *set, __isl_keep isl_ast_expr *expr)
+{
+	add(build, NULL, set, expr);
+}
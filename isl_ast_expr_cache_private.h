@@ -0,0 +1,26 @@
+#ifndef ISL_AST_EXPR_CACHE_PRIVATE_H
+#define ISL_AST_EXPR_CACHE_PRIVATE_H
+
+#include <isl/aff.h>
+#include <isl/ast.h>
+#include <isl/set.h>
+#include <isl_ast_build_private.h>
+
+struct isl_ast_expr_cache;
+
+struct isl_ast_expr_cache *isl_ast_expr_cache_alloc(isl_ctx *ctx, int size);
+struct isl_ast_expr_cache *isl_ast_expr_cache_copy(
+	struct isl_ast_expr_cache *cache);
+struct isl_ast_expr_cache *isl_ast_expr_cache_free(
+	struct isl_ast_expr_cache *cache);
+
+__isl_give isl_ast_expr *isl_ast_expr_cache_find_pw_aff(
+	__isl_keep isl_ast_build *build, __isl_keep isl_pw_aff *pa);
+void isl_ast_expr_cache_add_pw_aff(__isl_keep isl_ast_build *build,
+	__isl_keep isl_pw_aff *pa, __isl_keep isl_ast_expr *expr);
+__isl_give isl_ast_expr *isl_ast_expr_cache_find_set(
+	__isl_keep isl_ast_build *build, __isl_keep isl_set *set);
+void isl_ast_expr_cache_add_set(__isl_keep isl_ast_build *build,
+	__isl_keep isl_set *set, __isl_keep isl_ast_expr *expr);
+
+#endif
@@ -11,6 +11,7 @@
  */
 
 #include <isl/space.h>
+#include <isl_ctx_private.h>
 #include <isl_ast_private.h>
 #include <isl_ast_build_expr.h>
 #include <isl_ast_build_private.h>
@@ -94,10 +95,67 @@ static __isl_give isl_ast_graft *isl_ast_graft_copy(
 	if (!graft)
 		return NULL;
 
-	graft->ref++;
+	isl_atomic_inc(&graft->ref);
 	return graft;
 }
 
+/* Return a fresh copy of "graft" that shares its node, guard and
+ * enforced set with "graft".
+ */
+static __isl_give isl_ast_graft *isl_ast_graft_dup(
+	__isl_keep isl_ast_graft *graft)
+{
+	isl_ctx *ctx;
+	isl_ast_graft *dup;
+
+	if (!graft)
+		return NULL;
+
+	ctx = isl_ast_graft_get_ctx(graft);
+	dup = isl_calloc_type(ctx, isl_ast_graft);
+	if (!dup)
+		return NULL;
+
+	dup->ref = 1;
+	dup->node = isl_ast_node_copy(graft->node);
+	dup->guard = isl_set_copy(graft->guard);
+	dup->enforced = isl_basic_set_copy(graft->enforced);
+
+	if (!dup->node || !dup->guard || !dup->enforced)
+		return isl_ast_graft_free(dup);
+
+	return dup;
+}
+
+/* Return a copy of "list" in which each graft is a fresh copy
+ * of the corresponding graft in "list".
+ * Since grafts are modified in place, this allows "list" to be kept
+ * while the result is being modified.
+ */
+__isl_give isl_ast_graft_list *isl_ast_graft_list_dup_grafts(
+	__isl_keep isl_ast_graft_list *list)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_ast_graft_list *dup;
+
+	if (!list)
+		return NULL;
+
+	ctx = isl_ast_graft_list_get_ctx(list);
+	n = isl_ast_graft_list_n_ast_graft(list);
+	dup = isl_ast_graft_list_alloc(ctx, n);
+	for (i = 0; i < n; ++i) {
+		isl_ast_graft *graft;
+
+		graft = isl_ast_graft_list_get_ast_graft(list, i);
+		dup = isl_ast_graft_list_add(dup, isl_ast_graft_dup(graft));
+		isl_ast_graft_free(graft);
+	}
+
+	return dup;
+}
+
 /* Do all the grafts in "list" have the same guard and is this guard
  * independent of the current depth?
  */
@@ -522,135 +580,206 @@ static int clear_if_nodes(struct isl_if_node *if_node, int first, int n)
 	return first;
 }
 
-/* For each graft in "list",
- * insert an if node around graft->node testing the condition encoded
- * in graft->guard, assuming graft->guard involves any conditions.
+/* Internal data structure for inserting if nodes for the guards
+ * of a sequence of grafts.
  *
- * We keep track of a list of generated if nodes that can be extended
- * without changing the order of the elements in "list".
- * If the guard of a graft is a subset of either the guard or its complement
- * of one of those if nodes, then the node
- * of the new graft is inserted into the then or else branch of the last graft
- * and the current graft is discarded.
+ * "build" is the build in which the guards are evaluated.
+ * "allow_else" is set if else branches may be constructed.
+ * "if_node" is an array of size "size" containing
+ * the "n_if" generated if nodes that can be extended
+ * without changing the order of the grafts.
+ * All of these if nodes appear in the last element of "res".
+ * "res" collects the resulting grafts.
+ */
+struct isl_insert_guard_data {
+	isl_ast_build *build;
+	int allow_else;
+	int size;
+	int n_if;
+	struct isl_if_node *if_node;
+	isl_ast_graft_list *res;
+};
+
+/* Initialize "data" for inserting if nodes in "build",
+ * keeping track of at most "size" if nodes.
+ */
+static isl_stat isl_insert_guard_data_init(struct isl_insert_guard_data *data,
+	__isl_keep isl_ast_build *build, int size)
+{
+	isl_ctx *ctx;
+
+	if (!build)
+		return isl_stat_error;
+
+	ctx = isl_ast_build_get_ctx(build);
+	data->build = build;
+	data->allow_else = isl_options_get_ast_build_allow_else(ctx);
+	data->size = size;
+	data->n_if = 0;
+	data->if_node = NULL;
+	if (size > 0) {
+		data->if_node = isl_alloc_array(ctx, struct isl_if_node, size);
+		if (!data->if_node)
+			return isl_stat_error;
+	}
+	data->res = isl_ast_graft_list_alloc(ctx, size + 1);
+	if (!data->res)
+		return isl_stat_error;
+
+	return isl_stat_ok;
+}
+
+/* Free all memory allocated for "data", except "build".
+ */
+static void isl_insert_guard_data_clear(struct isl_insert_guard_data *data)
+{
+	clear_if_nodes(data->if_node, 0, data->n_if);
+	free(data->if_node);
+	isl_ast_graft_list_free(data->res);
+}
+
+/* Insert an if node around graft->node testing the condition encoded
+ * in graft->guard, assuming graft->guard involves any conditions, and
+ * add the result to data->res.
+ * "last" is set if "graft" is known to be the last graft, in which case
+ * the generated if node does not need to be kept track of.
+ *
+ * If the guard of the graft is a subset of either the guard or
+ * its complement of one of the if nodes in "data", then the node
+ * of the graft is inserted into the then or else branch
+ * of the last graft in data->res and the graft itself is discarded.
  * The guard of the node is then simplified based on the conditions
  * enforced at that then or else branch.
- * Otherwise, the current graft is appended to the list.
+ * Otherwise, the graft is appended to data->res.
  *
  * We only construct else branches if allowed by the user.
  */
+static isl_stat insert_pending_guard(struct isl_insert_guard_data *data,
+	__isl_take isl_ast_graft *graft, int last)
+{
+	int j;
+	int subset, found_then, found_else;
+	isl_set *guard;
+	isl_ast_node *node;
+	isl_ast_build *build = data->build;
+	struct isl_if_node *if_node = data->if_node;
+
+	if (!graft)
+		return isl_stat_error;
+
+	subset = 0;
+	found_then = found_else = -1;
+	if (data->n_if > 0) {
+		isl_set *test;
+		test = isl_set_copy(graft->guard);
+		test = isl_set_intersect(test, isl_set_copy(build->domain));
+		for (j = data->n_if - 1; j >= 0; --j) {
+			subset = isl_set_is_subset(test, if_node[j].guard);
+			if (subset < 0 || subset) {
+				found_then = j;
+				break;
+			}
+			if (!data->allow_else)
+				continue;
+			subset = isl_set_is_subset(test, if_node[j].complement);
+			if (subset < 0 || subset) {
+				found_else = j;
+				break;
+			}
+		}
+		data->n_if = clear_if_nodes(if_node, j + 1, data->n_if);
+		isl_set_free(test);
+	}
+	if (subset < 0) {
+		isl_ast_graft_free(graft);
+		return isl_stat_error;
+	}
+
+	guard = isl_set_copy(graft->guard);
+	if (found_then >= 0)
+		graft->guard = isl_set_gist(graft->guard,
+			isl_set_copy(if_node[found_then].guard));
+	else if (found_else >= 0)
+		graft->guard = isl_set_gist(graft->guard,
+			isl_set_copy(if_node[found_else].complement));
+
+	node = graft->node;
+	if (!graft->guard)
+		graft = isl_ast_graft_free(graft);
+	graft = insert_pending_guard_node(graft, build);
+	if (graft && graft->node != node && !last) {
+		isl_set *set;
+		if_node[data->n_if].node = graft->node;
+		if_node[data->n_if].guard = guard;
+		if (found_then >= 0)
+			set = if_node[found_then].guard;
+		else if (found_else >= 0)
+			set = if_node[found_else].complement;
+		else
+			set = build->domain;
+		set = isl_set_copy(set);
+		set = isl_set_subtract(set, isl_set_copy(guard));
+		if_node[data->n_if].complement = set;
+		data->n_if++;
+	} else
+		isl_set_free(guard);
+	if (!graft)
+		return isl_stat_error;
+
+	if (found_then >= 0)
+		data->res = extend_then(data->res, if_node[found_then].node,
+					graft, build);
+	else if (found_else >= 0)
+		data->res = extend_else(data->res, if_node[found_else].node,
+					graft, build);
+	else
+		data->res = isl_ast_graft_list_add(data->res, graft);
+	if (!data->res)
+		return isl_stat_error;
+
+	return isl_stat_ok;
+}
+
+/* For each graft in "list",
+ * insert an if node around graft->node testing the condition encoded
+ * in graft->guard, assuming graft->guard involves any conditions.
+ * Grafts may get merged into the if nodes generated
+ * for earlier grafts (see insert_pending_guard).
+ * Since the if node of the last graft cannot get extended,
+ * at most n - 1 if nodes need to be kept track of.
+ */
 static __isl_give isl_ast_graft_list *insert_pending_guard_nodes(
 	__isl_take isl_ast_graft_list *list,
 	__isl_keep isl_ast_build *build)
 {
-	int i, j, n, n_if;
-	int allow_else;
-	isl_ctx *ctx;
+	int i, n;
 	isl_ast_graft_list *res;
-	struct isl_if_node *if_node = NULL;
+	struct isl_insert_guard_data data = { NULL };
 
 	if (!build || !list)
 		return isl_ast_graft_list_free(list);
 
-	ctx = isl_ast_build_get_ctx(build);
 	n = isl_ast_graft_list_n_ast_graft(list);
-
-	allow_else = isl_options_get_ast_build_allow_else(ctx);
-
-	n_if = 0;
-	if (n > 1) {
-		if_node = isl_alloc_array(ctx, struct isl_if_node, n - 1);
-		if (!if_node)
-			return isl_ast_graft_list_free(list);
+	if (isl_insert_guard_data_init(&data, build, n > 1 ? n - 1 : 0) < 0) {
+		isl_insert_guard_data_clear(&data);
+		return isl_ast_graft_list_free(list);
 	}
 
-	res = isl_ast_graft_list_alloc(ctx, n);
-
 	for (i = 0; i < n; ++i) {
-		isl_set *guard;
 		isl_ast_graft *graft;
-		int subset, found_then, found_else;
-		isl_ast_node *node;
 
 		graft = isl_ast_graft_list_get_ast_graft(list, i);
-		if (!graft)
+		if (insert_pending_guard(&data, graft, i == n - 1) < 0)
 			break;
-		subset = 0;
-		found_then = found_else = -1;
-		if (n_if > 0) {
-			isl_set *test;
-			test = isl_set_copy(graft->guard);
-			test = isl_set_intersect(test,
-						isl_set_copy(build->domain));
-			for (j = n_if - 1; j >= 0; --j) {
-				subset = isl_set_is_subset(test,
-							if_node[j].guard);
-				if (subset < 0 || subset) {
-					found_then = j;
-					break;
-				}
-				if (!allow_else)
-					continue;
-				subset = isl_set_is_subset(test,
-							if_node[j].complement);
-				if (subset < 0 || subset) {
-					found_else = j;
-					break;
-				}
-			}
-			n_if = clear_if_nodes(if_node, j + 1, n_if);
-			isl_set_free(test);
-		}
-		if (subset < 0) {
-			graft = isl_ast_graft_free(graft);
-			break;
-		}
-
-		guard = isl_set_copy(graft->guard);
-		if (found_then >= 0)
-			graft->guard = isl_set_gist(graft->guard,
-				isl_set_copy(if_node[found_then].guard));
-		else if (found_else >= 0)
-			graft->guard = isl_set_gist(graft->guard,
-				isl_set_copy(if_node[found_else].complement));
-
-		node = graft->node;
-		if (!graft->guard)
-			graft = isl_ast_graft_free(graft);
-		graft = insert_pending_guard_node(graft, build);
-		if (graft && graft->node != node && i != n - 1) {
-			isl_set *set;
-			if_node[n_if].node = graft->node;
-			if_node[n_if].guard = guard;
-			if (found_then >= 0)
-				set = if_node[found_then].guard;
-			else if (found_else >= 0)
-				set = if_node[found_else].complement;
-			else
-				set = build->domain;
-			set = isl_set_copy(set);
-			set = isl_set_subtract(set, isl_set_copy(guard));
-			if_node[n_if].complement = set;
-			n_if++;
-		} else
-			isl_set_free(guard);
-		if (!graft)
-			break;
-
-		if (found_then >= 0)
-			res = extend_then(res, if_node[found_then].node,
-						graft, build);
-		else if (found_else >= 0)
-			res = extend_else(res, if_node[found_else].node,
-						graft, build);
-		else
-			res = isl_ast_graft_list_add(res, graft);
 	}
+
+	res = data.res;
+	data.res = NULL;
 	if (i < n)
 		res = isl_ast_graft_list_free(res);
 
 	isl_ast_graft_list_free(list);
-	clear_if_nodes(if_node, 0, n_if);
-	free(if_node);
+	isl_insert_guard_data_clear(&data);
 	return res;
 }
 
@@ -717,6 +846,122 @@ static __isl_give isl_ast_node_list *extract_node_list(
 	return node_list;
 }
 
+/* A stream of grafts at the outer level of an AST generation.
+ *
+ * "build" is the build in which the grafts were generated.
+ * "data" keeps track of the if nodes generated for the guards
+ * of the grafts that have been added to the stream.
+ * All elements of data.res, except the last, have been handed out
+ * by isl_ast_graft_stream_add.
+ */
+struct isl_ast_graft_stream {
+	isl_ast_build *build;
+	struct isl_insert_guard_data data;
+};
+
+/* Create a stream of grafts generated in "build".
+ */
+struct isl_ast_graft_stream *isl_ast_graft_stream_alloc(
+	__isl_keep isl_ast_build *build)
+{
+	isl_ctx *ctx;
+	struct isl_ast_graft_stream *stream;
+
+	if (!build)
+		return NULL;
+
+	ctx = isl_ast_build_get_ctx(build);
+	stream = isl_calloc_type(ctx, struct isl_ast_graft_stream);
+	if (!stream)
+		return NULL;
+	stream->build = isl_ast_build_copy(build);
+	if (isl_insert_guard_data_init(&stream->data, stream->build, 0) < 0) {
+		isl_ast_node_list_free(isl_ast_graft_stream_finish(stream));
+		return NULL;
+	}
+
+	return stream;
+}
+
+/* Add the grafts in "list" to "stream", inserting if nodes
+ * for their guards in the same way as isl_ast_node_from_graft_list and
+ * return the nodes of those grafts that can no longer be modified
+ * by adding further grafts.
+ * Since only the last graft in the stream can still get extended,
+ * all other grafts are returned, in order.
+ * The returned nodes are not necessarily those of the grafts in "list".
+ */
+__isl_give isl_ast_node_list *isl_ast_graft_stream_add(
+	struct isl_ast_graft_stream *stream, __isl_take isl_ast_graft_list *list)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_ast_graft_list *done;
+	isl_ast_node_list *node_list;
+	struct isl_insert_guard_data *data;
+
+	if (!stream || !list)
+		goto error;
+
+	ctx = isl_ast_build_get_ctx(stream->build);
+	data = &stream->data;
+	n = isl_ast_graft_list_n_ast_graft(list);
+	for (i = 0; i < n; ++i) {
+		isl_ast_graft *graft;
+
+		if (data->n_if >= data->size) {
+			int size = 3 * data->size / 2 + 4;
+			struct isl_if_node *if_node;
+
+			if_node = isl_realloc_array(ctx, data->if_node,
+						    struct isl_if_node, size);
+			if (!if_node)
+				goto error;
+			data->if_node = if_node;
+			data->size = size;
+		}
+		graft = isl_ast_graft_list_get_ast_graft(list, i);
+		if (insert_pending_guard(data, graft, 0) < 0)
+			goto error;
+	}
+	isl_ast_graft_list_free(list);
+
+	n = isl_ast_graft_list_n_ast_graft(data->res);
+	if (n <= 1)
+		return isl_ast_node_list_alloc(ctx, 0);
+	done = isl_ast_graft_list_drop(isl_ast_graft_list_copy(data->res),
+					n - 1, 1);
+	data->res = isl_ast_graft_list_drop(data->res, 0, n - 1);
+	node_list = extract_node_list(done);
+	isl_ast_graft_list_free(done);
+	if (!data->res)
+		return isl_ast_node_list_free(node_list);
+
+	return node_list;
+error:
+	isl_ast_graft_list_free(list);
+	return NULL;
+}
+
+/* Return the nodes of the grafts that are still left in "stream"
+ * and free "stream".
+ */
+__isl_give isl_ast_node_list *isl_ast_graft_stream_finish(
+	struct isl_ast_graft_stream *stream)
+{
+	isl_ast_node_list *node_list;
+
+	if (!stream)
+		return NULL;
+
+	node_list = extract_node_list(stream->data.res);
+	isl_insert_guard_data_clear(&stream->data);
+	isl_ast_build_free(stream->build);
+	free(stream);
+
+	return node_list;
+}
+
 /* Look for shared enforced constraints by all the elements in "list"
  * on outer loops (with respect to the current depth) and return the result.
  *
@@ -997,7 +1242,7 @@ void *isl_ast_graft_free(__isl_take isl_ast_graft *graft)
 	if (!graft)
 		return NULL;
 
-	if (--graft->ref > 0)
+	if (isl_atomic_dec(&graft->ref) > 0)
 		return NULL;
 
 	isl_ast_node_free(graft->node);
@@ -56,6 +56,18 @@ __isl_give isl_ast_graft *isl_ast_graft_alloc_domain(
 void *isl_ast_graft_free(__isl_take isl_ast_graft *graft);
 __isl_give isl_ast_graft_list *isl_ast_graft_list_sort_guard(
 	__isl_take isl_ast_graft_list *list);
+__isl_give isl_ast_graft_list *isl_ast_graft_list_dup_grafts(
+	__isl_keep isl_ast_graft_list *list);
+
+struct isl_ast_graft_stream;
+
+struct isl_ast_graft_stream *isl_ast_graft_stream_alloc(
+	__isl_keep isl_ast_build *build);
+__isl_give isl_ast_node_list *isl_ast_graft_stream_add(
+	struct isl_ast_graft_stream *stream,
+	__isl_take isl_ast_graft_list *list);
+__isl_give isl_ast_node_list *isl_ast_graft_stream_finish(
+	struct isl_ast_graft_stream *stream);
 
 __isl_give isl_ast_graft_list *isl_ast_graft_list_merge(
 	__isl_take isl_ast_graft_list *list1,
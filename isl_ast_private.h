@@ -117,5 +117,8 @@ struct isl_ast_print_options {
 __isl_give isl_printer *isl_ast_node_list_print(
 	__isl_keep isl_ast_node_list *list, __isl_take isl_printer *p,
 	__isl_keep isl_ast_print_options *options);
+__isl_give isl_printer *isl_ast_node_list_print_partial(
+	__isl_keep isl_ast_node_list *list, __isl_take isl_printer *p,
+	__isl_keep isl_ast_print_options *options, int *n_printed, int last);
 
 #endif
@@ -18,6 +18,8 @@
 extern "C" {
 #endif
 
+struct isl_tab *isl_tab_compute_reduced_basis_only_first(struct isl_tab *tab,
+	int only_first);
 struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab);
 
 #if defined(__cplusplus)
@@ -0,0 +1,1908 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl_union_map_private.h>
+#include <isl_space_private.h>
+#include <isl_id_private.h>
+#include <isl_local_space_private.h>
+#include <isl_aff_private.h>
+#include <isl_mat_private.h>
+#include <isl_vec_private.h>
+#include <isl_val_private.h>
+#include <isl_schedule_private.h>
+#include <isl_schedule_tree.h>
+#include <isl_schedule_band.h>
+#include <isl/hash.h>
+#include <isl/union_set.h>
+#include <isl/union_map.h>
+#include <isl/schedule.h>
+
+/* The binary format starts with the four characters "ISLB",
+ * followed by the version of the format and the kind of object
+ * that is stored (one of the isl_binary_kind values below).
+ * Next is a table of the names of all identifiers that appear
+ * in the object, followed by the object itself.
+ *
+ * Counts and other unsigned integers are stored as variable-length
+ * integers, with seven bits per byte, least significant bits first and
+ * the most significant bit of each byte set if more bytes follow.
+ * A coefficient is stored as a variable-length integer "h".
+ * If the least significant bit of "h" is zero, then h >> 1 is
+ * the zigzag encoding of the coefficient.  Otherwise, h >> 2 is
+ * the number of bytes in the absolute value of the coefficient,
+ * bit 1 of "h" is set if the coefficient is negative and
+ * the bytes of the absolute value follow, least significant byte first.
+ * An identifier is stored as its position in the table of names,
+ * plus one, such that zero represents the absence of an identifier.
+ *
+ * The constraints of basic maps are stored along with their flags,
+ * such that properties such as the absence of redundant constraints
+ * do not need to be recomputed when the basic maps are read back in.
+ */
+#define ISL_BINARY_MAGIC	"ISLB"
+#define ISL_BINARY_VERSION	1
+
+enum isl_binary_kind {
+	isl_binary_basic_set = 1,
+	isl_binary_basic_map,
+	isl_binary_set,
+	isl_binary_map,
+	isl_binary_union_set,
+	isl_binary_union_map,
+	isl_binary_pw_aff,
+	isl_binary_pw_multi_aff,
+	isl_binary_schedule
+};
+
+#define ISL_BINARY_BASIC_MAP_FLAGS					\
+	(ISL_BASIC_MAP_FINAL | ISL_BASIC_MAP_EMPTY |			\
+	 ISL_BASIC_MAP_NO_IMPLICIT | ISL_BASIC_MAP_NO_REDUNDANT |	\
+	 ISL_BASIC_MAP_RATIONAL | ISL_BASIC_MAP_NORMALIZED |		\
+	 ISL_BASIC_MAP_NORMALIZED_DIVS | ISL_BASIC_MAP_ALL_EQUALITIES |	\
+	 ISL_BASIC_MAP_REDUCED_COEFFICIENTS)
+#define ISL_BINARY_MAP_FLAGS	(ISL_MAP_DISJOINT | ISL_MAP_NORMALIZED)
+
+/* A name in the table of identifier names, along with
+ * its position in the table.
+ * The name is copied since the identifier it was taken from
+ * may be freed before the table is written out.
+ */
+struct isl_binary_name {
+	char *name;
+	int pos;
+};
+
+/* Data used during the construction of a binary representation.
+ *
+ * "buf" contains the "len" bytes that have been written so far and
+ * has room for "size" bytes.
+ * "names" is the table of identifier names.  It contains "n_name" elements
+ * and has room for "size_name" elements.
+ * "name_table" maps names to their elements in "names".
+ */
+struct isl_binary_writer {
+	isl_ctx *ctx;
+
+	unsigned char *buf;
+	size_t len;
+	size_t size;
+
+	int n_name;
+	int size_name;
+	struct isl_binary_name **names;
+	struct isl_hash_table name_table;
+};
+
+/* Data used during the reconstruction of an object
+ * from its binary representation.
+ *
+ * "p" points to the next byte that needs to be read and
+ * "end" points right after the last byte.
+ * "ids" contains the "n_id" identifiers corresponding to
+ * the names in the table of identifier names.
+ * "depth" is the number of nested spaces or schedule tree nodes
+ * that are currently being read.
+ */
+struct isl_binary_reader {
+	isl_ctx *ctx;
+
+	const unsigned char *p;
+	const unsigned char *end;
+
+	int n_id;
+	isl_id **ids;
+
+	int depth;
+};
+
+/* The maximal nesting depth of spaces and of schedule trees
+ * that is accepted while reading.
+ * Since nested objects are read recursively, this protects against
+ * running out of stack space on corrupted or malicious input.
+ */
+#define ISL_BINARY_MAX_DEPTH	1000
+
+static isl_stat writer_init(struct isl_binary_writer *w, isl_ctx *ctx)
+{
+	w->ctx = ctx;
+	w->buf = NULL;
+	w->len = 0;
+	w->size = 0;
+	w->n_name = 0;
+	w->size_name = 0;
+	w->names = NULL;
+	return isl_hash_table_init(ctx, &w->name_table, 0);
+}
+
+static void writer_clear(struct isl_binary_writer *w)
+{
+	int i;
+
+	for (i = 0; i < w->n_name; ++i) {
+		free(w->names[i]->name);
+		free(w->names[i]);
+	}
+	free(w->names);
+	free(w->buf);
+	isl_hash_table_clear(&w->name_table);
+}
+
+/* Append the "n" bytes starting at "data" to "w".
+ */
+static isl_stat write_bytes(struct isl_binary_writer *w, const void *data,
+	size_t n)
+{
+	if (w->len + n > w->size) {
+		size_t size = 2 * w->size + n + 64;
+		unsigned char *buf;
+
+		buf = isl_realloc_array(w->ctx, w->buf, unsigned char, size);
+		if (!buf)
+			return isl_stat_error;
+		w->buf = buf;
+		w->size = size;
+	}
+	memcpy(w->buf + w->len, data, n);
+	w->len += n;
+	return isl_stat_ok;
+}
+
+/* Append the variable-length encoding of "v" to "w".
+ */
+static isl_stat write_uint(struct isl_binary_writer *w, uint64_t v)
+{
+	unsigned char buf[10];
+	size_t n = 0;
+
+	while (v >= 0x80) {
+		buf[n++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	buf[n++] = v;
+	return write_bytes(w, buf, n);
+}
+
+/* Append the encoding of the coefficient "v" to "w".
+ * Coefficients that fit in 62 bits are stored in zigzag encoding.
+ * Other coefficients are stored as a sequence of bytes,
+ * extracted from an isl_val.
+ */
+static isl_stat write_int(struct isl_binary_writer *w, isl_int v)
+{
+	isl_val *val;
+	size_t n;
+	unsigned char *chunks;
+	isl_stat r;
+
+	if (isl_int_fits_slong(v)) {
+		long l = isl_int_get_si(v);
+		uint64_t z;
+
+		if (l < 0)
+			z = ((uint64_t) -(l + 1) << 1) | 1;
+		else
+			z = (uint64_t) l << 1;
+		if ((z >> 62) == 0)
+			return write_uint(w, z << 1);
+	}
+
+	val = isl_val_int_from_isl_int(w->ctx, v);
+	if (!val)
+		return isl_stat_error;
+	n = isl_val_n_abs_num_chunks(val, 1);
+	chunks = isl_alloc_array(w->ctx, unsigned char, n);
+	r = chunks ? isl_stat_ok : isl_stat_error;
+	if (r >= 0 && isl_val_get_abs_num_chunks(val, 1, chunks) < 0)
+		r = isl_stat_error;
+	if (r >= 0)
+		r = write_uint(w, ((uint64_t) n << 2) |
+				(isl_int_is_neg(v) ? 2 : 0) | 1);
+	if (r >= 0)
+		r = write_bytes(w, chunks, n);
+	free(chunks);
+	isl_val_free(val);
+	return r;
+}
+
+/* Append the "n" coefficients starting at "row" to "w".
+ */
+static isl_stat write_row(struct isl_binary_writer *w, isl_int *row,
+	unsigned n)
+{
+	unsigned i;
+
+	for (i = 0; i < n; ++i)
+		if (write_int(w, row[i]) < 0)
+			return isl_stat_error;
+	return isl_stat_ok;
+}
+
+static int has_name(const void *entry, const void *val)
+{
+	const struct isl_binary_name *name = entry;
+
+	return !strcmp(name->name, val);
+}
+
+/* Append the identifier "id" (which may be NULL) to "w",
+ * adding its name to the table of identifier names if needed.
+ * Only the name of the identifier is stored.
+ * Anonymous identifiers can therefore not be stored.
+ */
+static isl_stat write_id(struct isl_binary_writer *w, __isl_keep isl_id *id)
+{
+	const char *s;
+	uint32_t hash;
+	struct isl_hash_table_entry *entry;
+	struct isl_binary_name *name;
+
+	if (!id)
+		return write_uint(w, 0);
+	s = isl_id_get_name(id);
+	if (!s)
+		isl_die(w->ctx, isl_error_unsupported,
+			"cannot store anonymous identifiers",
+			return isl_stat_error);
+
+	hash = isl_hash_string(isl_hash_init(), s);
+	entry = isl_hash_table_find(w->ctx, &w->name_table, hash,
+					&has_name, s, 1);
+	if (!entry)
+		return isl_stat_error;
+	if (entry->data) {
+		name = entry->data;
+		return write_uint(w, 1 + name->pos);
+	}
+
+	if (w->n_name >= w->size_name) {
+		struct isl_binary_name **names;
+		int size = 2 * w->size_name + 8;
+
+		names = isl_realloc_array(w->ctx, w->names,
+					struct isl_binary_name *, size);
+		if (!names)
+			return isl_stat_error;
+		w->names = names;
+		w->size_name = size;
+	}
+	name = isl_alloc_type(w->ctx, struct isl_binary_name);
+	if (!name)
+		return isl_stat_error;
+	name->name = strdup(s);
+	if (!name->name) {
+		free(name);
+		return isl_stat_error;
+	}
+	name->pos = w->n_name;
+	w->names[w->n_name++] = name;
+	entry->data = name;
+
+	return write_uint(w, 1 + name->pos);
+}
+
+static isl_stat write_space(struct isl_binary_writer *w,
+	__isl_keep isl_space *space);
+
+/* Append tuple "i" of "space" to "w".
+ * The tuple identifier is stored as 0 if there is no identifier,
+ * 1 if it is isl_id_none (marking a set or parameter space) and
+ * 2 followed by the identifier otherwise.
+ * This is followed by a flag indicating whether the tuple
+ * has a nested space and the nested space itself, if any.
+ */
+static isl_stat write_tuple(struct isl_binary_writer *w,
+	__isl_keep isl_space *space, int i)
+{
+	isl_id *id = space->tuple_id[i];
+	isl_stat r;
+
+	if (!id)
+		r = write_uint(w, 0);
+	else if (id == &isl_id_none)
+		r = write_uint(w, 1);
+	else if (write_uint(w, 2) < 0)
+		r = isl_stat_error;
+	else
+		r = write_id(w, id);
+	if (r < 0)
+		return isl_stat_error;
+
+	if (write_uint(w, space->nested[i] ? 1 : 0) < 0)
+		return isl_stat_error;
+	if (space->nested[i])
+		return write_space(w, space->nested[i]);
+	return isl_stat_ok;
+}
+
+/* Append "space" to "w", in the form of the number of parameters,
+ * input and output dimensions, the two tuples and
+ * the identifiers of all dimensions.
+ */
+static isl_stat write_space(struct isl_binary_writer *w,
+	__isl_keep isl_space *space)
+{
+	unsigned i, total;
+
+	if (!space)
+		return isl_stat_error;
+
+	if (write_uint(w, space->nparam) < 0 ||
+	    write_uint(w, space->n_in) < 0 ||
+	    write_uint(w, space->n_out) < 0)
+		return isl_stat_error;
+	for (i = 0; i < 2; ++i)
+		if (write_tuple(w, space, i) < 0)
+			return isl_stat_error;
+	total = space->nparam + space->n_in + space->n_out;
+	for (i = 0; i < total; ++i) {
+		isl_id *id = i < space->n_id ? space->ids[i] : NULL;
+		if (write_id(w, id) < 0)
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Append "bmap" to "w", without its space.
+ * That is, append its flags, the number of integer divisions,
+ * equality and inequality constraints, followed by
+ * the integer divisions and the constraints themselves.
+ */
+static isl_stat write_basic_map_body(struct isl_binary_writer *w,
+	__isl_keep isl_basic_map *bmap)
+{
+	int i;
+	unsigned total;
+
+	if (!bmap)
+		return isl_stat_error;
+
+	total = isl_basic_map_total_dim(bmap);
+	if (write_uint(w, bmap->flags & ISL_BINARY_BASIC_MAP_FLAGS) < 0 ||
+	    write_uint(w, bmap->n_div) < 0 ||
+	    write_uint(w, bmap->n_eq) < 0 ||
+	    write_uint(w, bmap->n_ineq) < 0)
+		return isl_stat_error;
+	for (i = 0; i < bmap->n_div; ++i)
+		if (write_row(w, bmap->div[i], 2 + total) < 0)
+			return isl_stat_error;
+	for (i = 0; i < bmap->n_eq; ++i)
+		if (write_row(w, bmap->eq[i], 1 + total) < 0)
+			return isl_stat_error;
+	for (i = 0; i < bmap->n_ineq; ++i)
+		if (write_row(w, bmap->ineq[i], 1 + total) < 0)
+			return isl_stat_error;
+
+	return isl_stat_ok;
+}
+
+static isl_stat write_basic_map(struct isl_binary_writer *w,
+	__isl_keep isl_basic_map *bmap)
+{
+	if (!bmap || write_space(w, bmap->dim) < 0)
+		return isl_stat_error;
+	return write_basic_map_body(w, bmap);
+}
+
+/* Append "map" to "w", without its space.
+ * The basic maps share the space of "map" and are therefore
+ * also stored without their spaces.
+ */
+static isl_stat write_map_body(struct isl_binary_writer *w,
+	__isl_keep isl_map *map)
+{
+	int i;
+
+	if (!map)
+		return isl_stat_error;
+
+	if (write_uint(w, map->flags & ISL_BINARY_MAP_FLAGS) < 0 ||
+	    write_uint(w, map->n) < 0)
+		return isl_stat_error;
+	for (i = 0; i < map->n; ++i)
+		if (write_basic_map_body(w, map->p[i]) < 0)
+			return isl_stat_error;
+
+	return isl_stat_ok;
+}
+
+static isl_stat write_map(struct isl_binary_writer *w, __isl_keep isl_map *map)
+{
+	if (!map || write_space(w, map->dim) < 0)
+		return isl_stat_error;
+	return write_map_body(w, map);
+}
+
+static isl_stat write_map_entry(__isl_take isl_map *map, void *user)
+{
+	isl_stat r;
+
+	r = write_map(user, map);
+	isl_map_free(map);
+	return r;
+}
+
+/* Append "umap" to "w", in the form of its (parameter) space,
+ * followed by the number of maps in "umap" and the maps themselves.
+ */
+static isl_stat write_union_map(struct isl_binary_writer *w,
+	__isl_keep isl_union_map *umap)
+{
+	isl_space *space;
+	isl_stat r;
+
+	space = isl_union_map_get_space(umap);
+	r = write_space(w, space);
+	isl_space_free(space);
+	if (r < 0 || write_uint(w, isl_union_map_n_map(umap)) < 0)
+		return isl_stat_error;
+	return isl_union_map_foreach_map(umap, &write_map_entry, w);
+}
+
+/* Append "aff" to "w", without its domain space.
+ * That is, append the integer divisions of its local space,
+ * followed by its denominator, constant term and coefficients.
+ */
+static isl_stat write_aff_body(struct isl_binary_writer *w,
+	__isl_keep isl_aff *aff)
+{
+	int i;
+	isl_mat *div;
+
+	if (!aff)
+		return isl_stat_error;
+
+	div = aff->ls->div;
+	if (write_uint(w, div->n_row) < 0)
+		return isl_stat_error;
+	for (i = 0; i < div->n_row; ++i)
+		if (write_row(w, div->row[i], div->n_col) < 0)
+			return isl_stat_error;
+	return write_row(w, aff->v->el, aff->v->size);
+}
+
+/* Append "pa" to "w", in the form of its space, followed by
+ * the number of pieces and the pieces themselves.
+ * The sets and affine expressions of the pieces share the domain of "pa"
+ * and are stored without their spaces.
+ */
+static isl_stat write_pw_aff(struct isl_binary_writer *w,
+	__isl_keep isl_pw_aff *pa)
+{
+	int i;
+
+	if (!pa || write_space(w, pa->dim) < 0 || write_uint(w, pa->n) < 0)
+		return isl_stat_error;
+	for (i = 0; i < pa->n; ++i) {
+		if (write_map_body(w, pa->p[i].set) < 0 ||
+		    write_aff_body(w, pa->p[i].aff) < 0)
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Append the affine expressions of "ma" to "w".
+ * Their number is determined by the space of "ma".
+ */
+static isl_stat write_multi_aff_body(struct isl_binary_writer *w,
+	__isl_keep isl_multi_aff *ma)
+{
+	int i, n;
+
+	n = isl_multi_aff_dim(ma, isl_dim_out);
+	for (i = 0; i < n; ++i) {
+		isl_aff *aff;
+		isl_stat r;
+
+		aff = isl_multi_aff_get_aff(ma, i);
+		r = write_aff_body(w, aff);
+		isl_aff_free(aff);
+		if (r < 0)
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Append "pma" to "w".
+ * This is similar to write_pw_aff.
+ */
+static isl_stat write_pw_multi_aff(struct isl_binary_writer *w,
+	__isl_keep isl_pw_multi_aff *pma)
+{
+	int i;
+
+	if (!pma || write_space(w, pma->dim) < 0 ||
+	    write_uint(w, pma->n) < 0)
+		return isl_stat_error;
+	for (i = 0; i < pma->n; ++i) {
+		if (write_map_body(w, pma->p[i].set) < 0 ||
+		    write_multi_aff_body(w, pma->p[i].maff) < 0)
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+static isl_stat write_pw_aff_entry(__isl_take isl_pw_aff *pa, void *user)
+{
+	isl_stat r;
+
+	r = write_pw_aff(user, pa);
+	isl_pw_aff_free(pa);
+	return r;
+}
+
+/* Append "upa" to "w".
+ * This is similar to write_union_map.
+ */
+static isl_stat write_union_pw_aff(struct isl_binary_writer *w,
+	__isl_keep isl_union_pw_aff *upa)
+{
+	isl_space *space;
+	isl_stat r;
+
+	space = isl_union_pw_aff_get_space(upa);
+	r = write_space(w, space);
+	isl_space_free(space);
+	if (r < 0 || write_uint(w, isl_union_pw_aff_n_pw_aff(upa)) < 0)
+		return isl_stat_error;
+	return isl_union_pw_aff_foreach_pw_aff(upa, &write_pw_aff_entry, w);
+}
+
+static isl_stat write_pw_multi_aff_entry(__isl_take isl_pw_multi_aff *pma,
+	void *user)
+{
+	isl_stat r;
+
+	r = write_pw_multi_aff(user, pma);
+	isl_pw_multi_aff_free(pma);
+	return r;
+}
+
+/* Append "upma" to "w".
+ * This is similar to write_union_map.
+ */
+static isl_stat write_union_pw_multi_aff(struct isl_binary_writer *w,
+	__isl_keep isl_union_pw_multi_aff *upma)
+{
+	isl_space *space;
+	isl_stat r;
+	int n;
+
+	space = isl_union_pw_multi_aff_get_space(upma);
+	r = write_space(w, space);
+	isl_space_free(space);
+	n = isl_union_pw_multi_aff_n_pw_multi_aff(upma);
+	if (r < 0 || write_uint(w, n) < 0)
+		return isl_stat_error;
+	return isl_union_pw_multi_aff_foreach_pw_multi_aff(upma,
+					&write_pw_multi_aff_entry, w);
+}
+
+/* Append "mupa" to "w", in the form of its space, followed by
+ * its elements.  The number of elements is determined by the space.
+ */
+static isl_stat write_multi_union_pw_aff(struct isl_binary_writer *w,
+	__isl_keep isl_multi_union_pw_aff *mupa)
+{
+	int i, n;
+	isl_space *space;
+	isl_stat r;
+
+	space = isl_multi_union_pw_aff_get_space(mupa);
+	r = write_space(w, space);
+	isl_space_free(space);
+	if (r < 0)
+		return isl_stat_error;
+
+	n = isl_multi_union_pw_aff_dim(mupa, isl_dim_set);
+	for (i = 0; i < n; ++i) {
+		isl_union_pw_aff *upa;
+
+		upa = isl_multi_union_pw_aff_get_union_pw_aff(mupa, i);
+		r = write_union_pw_aff(w, upa);
+		isl_union_pw_aff_free(upa);
+		if (r < 0)
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Append "band" to "w", in the form of its partial schedule,
+ * its permutable flag, the coincident flags of its members and
+ * its AST build options, including the loop AST generation types.
+ */
+static isl_stat write_band(struct isl_binary_writer *w,
+	__isl_keep isl_schedule_band *band)
+{
+	int i;
+	isl_union_set *options;
+	isl_stat r;
+
+	if (!band || write_multi_union_pw_aff(w, band->mupa) < 0 ||
+	    write_uint(w, band->permutable) < 0)
+		return isl_stat_error;
+	for (i = 0; i < band->n; ++i)
+		if (write_uint(w, band->coincident[i]) < 0)
+			return isl_stat_error;
+
+	options = isl_schedule_band_get_ast_build_options(band);
+	r = options ? write_union_map(w, options) : isl_stat_error;
+	isl_union_set_free(options);
+	return r;
+}
+
+/* Append the schedule tree "tree" to "w", in the form
+ * of the type of its root, the information specific to that type,
+ * the number of children and the children themselves.
+ */
+static isl_stat write_schedule_tree(struct isl_binary_writer *w,
+	__isl_keep isl_schedule_tree *tree)
+{
+	int i, n;
+	isl_stat r = isl_stat_ok;
+
+	if (!tree || write_uint(w, tree->type) < 0)
+		return isl_stat_error;
+
+	switch (tree->type) {
+	case isl_schedule_node_band:
+		r = write_band(w, tree->band);
+		break;
+	case isl_schedule_node_context:
+		r = write_map(w, tree->context);
+		break;
+	case isl_schedule_node_domain:
+		r = write_union_map(w, tree->domain);
+		break;
+	case isl_schedule_node_expansion:
+		r = write_union_pw_multi_aff(w, tree->contraction);
+		if (r >= 0)
+			r = write_union_map(w, tree->expansion);
+		break;
+	case isl_schedule_node_extension:
+		r = write_union_map(w, tree->extension);
+		break;
+	case isl_schedule_node_filter:
+		r = write_union_map(w, tree->filter);
+		break;
+	case isl_schedule_node_guard:
+		r = write_map(w, tree->guard);
+		break;
+	case isl_schedule_node_mark:
+		r = write_id(w, tree->mark);
+		break;
+	case isl_schedule_node_leaf:
+	case isl_schedule_node_sequence:
+	case isl_schedule_node_set:
+		break;
+	case isl_schedule_node_error:
+		return isl_stat_error;
+	}
+	if (r < 0)
+		return isl_stat_error;
+
+	n = isl_schedule_tree_n_children(tree);
+	if (n < 0 || write_uint(w, n) < 0)
+		return isl_stat_error;
+	for (i = 0; i < n; ++i) {
+		isl_schedule_tree *child;
+
+		child = isl_schedule_tree_get_child(tree, i);
+		r = write_schedule_tree(w, child);
+		isl_schedule_tree_free(child);
+		if (r < 0)
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Finish the construction of the binary representation
+ * of an object of kind "kind" that has been written to "w" and
+ * return this binary representation, storing its size in "size".
+ * "r" is the result of writing the object.
+ *
+ * The header and the table of identifier names are only constructed
+ * at this point since the names are only known after
+ * the object has been written.
+ */
+static void *writer_finish(struct isl_binary_writer *w,
+	enum isl_binary_kind kind, isl_stat r, size_t *size)
+{
+	int i;
+	unsigned char *body;
+	size_t len;
+	void *res;
+
+	if (r >= 0 && !size)
+		isl_die(w->ctx, isl_error_invalid, "no size specified",
+			r = isl_stat_error);
+	if (r < 0) {
+		writer_clear(w);
+		return NULL;
+	}
+
+	body = w->buf;
+	len = w->len;
+	w->buf = NULL;
+	w->len = w->size = 0;
+
+	r = write_bytes(w, ISL_BINARY_MAGIC, 4);
+	if (r >= 0)
+		r = write_uint(w, ISL_BINARY_VERSION);
+	if (r >= 0)
+		r = write_uint(w, kind);
+	if (r >= 0)
+		r = write_uint(w, w->n_name);
+	for (i = 0; r >= 0 && i < w->n_name; ++i) {
+		const char *name = w->names[i]->name;
+		size_t n = strlen(name);
+
+		r = write_uint(w, n);
+		if (r >= 0)
+			r = write_bytes(w, name, n);
+	}
+	if (r >= 0 && len > 0)
+		r = write_bytes(w, body, len);
+	free(body);
+
+	res = r < 0 ? NULL : w->buf;
+	if (res) {
+		*size = w->len;
+		w->buf = NULL;
+	}
+	writer_clear(w);
+	return res;
+}
+
+static isl_stat truncated(struct isl_binary_reader *r)
+{
+	isl_die(r->ctx, isl_error_invalid, "truncated binary data",
+		return isl_stat_error);
+}
+
+static isl_stat invalid(struct isl_binary_reader *r)
+{
+	isl_die(r->ctx, isl_error_invalid, "invalid binary data",
+		return isl_stat_error);
+}
+
+/* Read a variable-length unsigned integer from "r" and store it in "v".
+ */
+static isl_stat read_uint(struct isl_binary_reader *r, uint64_t *v)
+{
+	int shift;
+
+	*v = 0;
+	for (shift = 0; shift < 64; shift += 7) {
+		unsigned char c;
+
+		if (r->p >= r->end)
+			return truncated(r);
+		c = *r->p++;
+		*v |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return isl_stat_ok;
+	}
+
+	return invalid(r);
+}
+
+/* Read a count from "r" and store it in "n".
+ * Each of the counted elements takes up at least one byte,
+ * so the count cannot be larger than the number of remaining bytes.
+ * Checking this protects against excessive memory allocation
+ * on invalid input.
+ */
+static isl_stat read_count(struct isl_binary_reader *r, int *n)
+{
+	uint64_t v;
+
+	if (read_uint(r, &v) < 0)
+		return isl_stat_error;
+	if (v > INT_MAX || v > (uint64_t) (r->end - r->p))
+		return invalid(r);
+	*n = v;
+	return isl_stat_ok;
+}
+
+/* Check that "r" has enough bytes left to contain
+ * "n_row" rows of "n_col" coefficients each.
+ */
+static isl_stat check_rows(struct isl_binary_reader *r, unsigned n_row,
+	unsigned n_col)
+{
+	if (n_col > 0 && n_row > (size_t) (r->end - r->p) / n_col)
+		return truncated(r);
+	return isl_stat_ok;
+}
+
+/* Is every magnitude of at most 62 bits representable as a long?
+ */
+#define ISL_BINARY_LONG_62	((LONG_MAX >> 31 >> 31) != 0)
+
+/* Check that "r" has enough bytes left to contain the rows
+ * of a basic map with "n_div" integer divisions, "n_con" constraints and
+ * "total" variables (including the integer divisions).
+ * An integer division row has 2 + total coefficients,
+ * while a constraint row has 1 + total coefficients.
+ * Each coefficient takes up at least one byte.
+ */
+static isl_stat check_basic_map_rows(struct isl_binary_reader *r,
+	uint64_t n_div, uint64_t n_con, unsigned total)
+{
+	uint64_t left = r->end - r->p;
+
+	if (n_div > left / (2 + (uint64_t) total))
+		return truncated(r);
+	left -= n_div * (2 + (uint64_t) total);
+	if (n_con > left / (1 + (uint64_t) total))
+		return truncated(r);
+	return isl_stat_ok;
+}
+
+/* Read a coefficient from "r" and store it in "v".
+ * See write_int for a description of the encoding.
+ *
+ * The magnitude of a coefficient in zigzag encoding
+ * has at most 62 bits.  If long is wide enough to hold it,
+ * then it is set directly.  Otherwise, the coefficient may have been
+ * written on a platform with a wider long and it is constructed
+ * from its bytes instead.
+ */
+static isl_stat read_int(struct isl_binary_reader *r, isl_int v)
+{
+	uint64_t h;
+	isl_val *val;
+	int neg;
+
+	if (read_uint(r, &h) < 0)
+		return isl_stat_error;
+	if (!(h & 1)) {
+		uint64_t mag = h >> 2;
+
+		neg = (h >> 1) & 1;
+#if ISL_BINARY_LONG_62
+		isl_int_set_si(v, neg ? -(long) mag - 1 : (long) mag);
+		return isl_stat_ok;
+#else
+		if (mag <= LONG_MAX) {
+			isl_int_set_si(v, neg ? -(long) mag - 1 : (long) mag);
+			return isl_stat_ok;
+		}
+		val = isl_val_int_from_chunks(r->ctx, 1, sizeof(mag), &mag);
+		if (neg)
+			val = isl_val_sub_ui(isl_val_neg(val), 1);
+#endif
+	} else {
+		uint64_t n = h >> 2;
+
+		neg = (h >> 1) & 1;
+		if (n > (uint64_t) (r->end - r->p))
+			return truncated(r);
+		val = isl_val_int_from_chunks(r->ctx, n, 1, r->p);
+		r->p += n;
+		if (neg)
+			val = isl_val_neg(val);
+	}
+	if (!val)
+		return isl_stat_error;
+	isl_int_set(v, val->n);
+	isl_val_free(val);
+	return isl_stat_ok;
+}
+
+/* Read "n" coefficients from "r" and store them in "row".
+ */
+static isl_stat read_row(struct isl_binary_reader *r, isl_int *row,
+	unsigned n)
+{
+	unsigned i;
+
+	for (i = 0; i < n; ++i)
+		if (read_int(r, row[i]) < 0)
+			return isl_stat_error;
+	return isl_stat_ok;
+}
+
+/* Read an identifier from "r" and store it in "id".
+ * "id" is set to NULL if no identifier was stored.
+ */
+static isl_stat read_id(struct isl_binary_reader *r, isl_id **id)
+{
+	uint64_t v;
+
+	*id = NULL;
+	if (read_uint(r, &v) < 0)
+		return isl_stat_error;
+	if (v > r->n_id)
+		return invalid(r);
+	if (v > 0)
+		*id = isl_id_copy(r->ids[v - 1]);
+	return isl_stat_ok;
+}
+
+/* Initialize "r" for reading the "size" bytes at "data",
+ * which are expected to contain an object of kind "kind".
+ * In particular, check the header and read the table of identifier names.
+ */
+static isl_stat reader_init(struct isl_binary_reader *r, isl_ctx *ctx,
+	const void *data, size_t size, enum isl_binary_kind kind)
+{
+	int i;
+	uint64_t version, stored_kind;
+
+	r->ctx = ctx;
+	r->n_id = 0;
+	r->ids = NULL;
+	r->depth = 0;
+	if (!ctx)
+		return isl_stat_error;
+	if (!data)
+		isl_die(ctx, isl_error_invalid, "no data specified",
+			return isl_stat_error);
+	r->p = data;
+	r->end = r->p + size;
+
+	if (size < 4 || memcmp(r->p, ISL_BINARY_MAGIC, 4))
+		isl_die(ctx, isl_error_invalid, "not in isl binary format",
+			return isl_stat_error);
+	r->p += 4;
+	if (read_uint(r, &version) < 0)
+		return isl_stat_error;
+	if (version != ISL_BINARY_VERSION)
+		isl_die(ctx, isl_error_unsupported,
+			"unsupported binary format version",
+			return isl_stat_error);
+	if (read_uint(r, &stored_kind) < 0)
+		return isl_stat_error;
+	if (stored_kind != kind)
+		isl_die(ctx, isl_error_invalid,
+			"binary data represents different kind of object",
+			return isl_stat_error);
+
+	if (read_count(r, &r->n_id) < 0)
+		return isl_stat_error;
+	r->ids = isl_calloc_array(ctx, isl_id *, r->n_id);
+	if (r->n_id && !r->ids)
+		return isl_stat_error;
+	for (i = 0; i < r->n_id; ++i) {
+		int len;
+		char *name;
+
+		if (read_count(r, &len) < 0)
+			return isl_stat_error;
+		name = isl_alloc_array(ctx, char, len + 1);
+		if (!name)
+			return isl_stat_error;
+		memcpy(name, r->p, len);
+		name[len] = '\0';
+		r->p += len;
+		r->ids[i] = isl_id_alloc(ctx, name, NULL);
+		free(name);
+		if (!r->ids[i])
+			return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Free the data allocated by reader_init and
+ * check that all data has been read if "complete" is set.
+ */
+static isl_stat reader_finish(struct isl_binary_reader *r, int complete)
+{
+	int i;
+
+	for (i = 0; i < r->n_id; ++i)
+		isl_id_free(r->ids[i]);
+	free(r->ids);
+
+	if (complete && r->p != r->end)
+		return invalid(r);
+	return isl_stat_ok;
+}
+
+static __isl_give isl_space *read_space(struct isl_binary_reader *r);
+
+/* Record that a nested object is about to be read from "r".
+ * Return isl_stat_error if this exceeds the maximal nesting depth.
+ * The caller is responsible for decrementing r->depth again
+ * after reading the nested object.
+ */
+static isl_stat enter_nested(struct isl_binary_reader *r)
+{
+	if (r->depth >= ISL_BINARY_MAX_DEPTH)
+		isl_die(r->ctx, isl_error_invalid,
+			"binary data nested too deeply", return isl_stat_error);
+	r->depth++;
+	return isl_stat_ok;
+}
+
+/* Read tuple "i" of "space" from "r".
+ * See write_tuple for a description of the encoding.
+ * A nested space needs to have the same parameters as "space" and
+ * as many dimensions as the tuple.
+ */
+static __isl_give isl_space *read_tuple(struct isl_binary_reader *r,
+	__isl_take isl_space *space, int i)
+{
+	enum isl_dim_type type = i == 0 ? isl_dim_in : isl_dim_out;
+	uint64_t tag, has_nested;
+	isl_id *id;
+	isl_space *nested;
+
+	if (read_uint(r, &tag) < 0)
+		return isl_space_free(space);
+	if (tag == 1) {
+		space = isl_space_set_tuple_id(space, type, &isl_id_none);
+	} else if (tag == 2) {
+		if (read_id(r, &id) < 0)
+			return isl_space_free(space);
+		if (!id) {
+			invalid(r);
+			return isl_space_free(space);
+		}
+		space = isl_space_set_tuple_id(space, type, id);
+	} else if (tag != 0) {
+		invalid(r);
+		return isl_space_free(space);
+	}
+
+	if (read_uint(r, &has_nested) < 0)
+		return isl_space_free(space);
+	if (has_nested > 1) {
+		invalid(r);
+		return isl_space_free(space);
+	}
+	if (!has_nested)
+		return space;
+
+	if (enter_nested(r) < 0)
+		return isl_space_free(space);
+	nested = read_space(r);
+	r->depth--;
+	space = isl_space_cow(space);
+	if (!space || !nested)
+		goto error;
+	if (nested->nparam != space->nparam ||
+	    nested->n_in + nested->n_out != isl_space_dim(space, type)) {
+		invalid(r);
+		goto error;
+	}
+	space->nested[i] = nested;
+	return space;
+error:
+	isl_space_free(nested);
+	return isl_space_free(space);
+}
+
+/* Read a space from "r".
+ * See write_space for a description of the encoding.
+ */
+static __isl_give isl_space *read_space(struct isl_binary_reader *r)
+{
+	int i, nparam, n_in, n_out;
+	isl_space *space;
+
+	if (read_count(r, &nparam) < 0 || read_count(r, &n_in) < 0 ||
+	    read_count(r, &n_out) < 0)
+		return NULL;
+	if (check_rows(r, nparam + n_in + n_out, 1) < 0)
+		return NULL;
+
+	space = isl_space_alloc(r->ctx, nparam, n_in, n_out);
+	for (i = 0; i < 2; ++i)
+		space = read_tuple(r, space, i);
+	for (i = 0; i < nparam + n_in + n_out; ++i) {
+		isl_id *id;
+		enum isl_dim_type type = isl_dim_param;
+		int pos = i;
+
+		if (!space || read_id(r, &id) < 0)
+			return isl_space_free(space);
+		if (!id)
+			continue;
+		if (pos >= nparam) {
+			type = isl_dim_in;
+			pos -= nparam;
+		}
+		if (type == isl_dim_in && pos >= n_in) {
+			type = isl_dim_out;
+			pos -= n_in;
+		}
+		space = isl_space_set_dim_id(space, type, pos, id);
+	}
+
+	return space;
+}
+
+/* Read a basic map with space "space" from "r".
+ * See write_basic_map_body for a description of the encoding.
+ *
+ * The flags are only set at the very end since
+ * adding integer divisions and constraints may clear some of them.
+ */
+static __isl_give isl_basic_map *read_basic_map_body(
+	struct isl_binary_reader *r, __isl_take isl_space *space)
+{
+	int i, k;
+	uint64_t flags;
+	int n_div, n_eq, n_ineq;
+	unsigned total;
+	isl_basic_map *bmap;
+
+	if (!space)
+		return NULL;
+	if (read_uint(r, &flags) < 0 || read_count(r, &n_div) < 0 ||
+	    read_count(r, &n_eq) < 0 || read_count(r, &n_ineq) < 0)
+		goto error;
+	if (flags & ~(uint64_t) ISL_BINARY_BASIC_MAP_FLAGS) {
+		invalid(r);
+		goto error;
+	}
+	total = isl_space_dim(space, isl_dim_all) + n_div;
+	if (check_basic_map_rows(r, n_div, (uint64_t) n_eq + n_ineq,
+				total) < 0)
+		goto error;
+
+	bmap = isl_basic_map_alloc_space(space, n_div, n_eq, n_ineq);
+	if (!bmap)
+		return NULL;
+	for (i = 0; i < n_div; ++i) {
+		k = isl_basic_map_alloc_div(bmap);
+		if (k < 0 || read_row(r, bmap->div[k], 2 + total) < 0)
+			return isl_basic_map_free(bmap);
+	}
+	for (i = 0; i < n_eq; ++i) {
+		k = isl_basic_map_alloc_equality(bmap);
+		if (k < 0 || read_row(r, bmap->eq[k], 1 + total) < 0)
+			return isl_basic_map_free(bmap);
+	}
+	for (i = 0; i < n_ineq; ++i) {
+		k = isl_basic_map_alloc_inequality(bmap);
+		if (k < 0 || read_row(r, bmap->ineq[k], 1 + total) < 0)
+			return isl_basic_map_free(bmap);
+	}
+	bmap->flags = flags;
+
+	return bmap;
+error:
+	isl_space_free(space);
+	return NULL;
+}
+
+/* Check that "space" is a set space if "set" is set.
+ */
+static __isl_give isl_space *check_set_space(struct isl_binary_reader *r,
+	__isl_take isl_space *space, int set)
+{
+	if (!space || !set || isl_space_is_set(space))
+		return space;
+	invalid(r);
+	return isl_space_free(space);
+}
+
+/* Read a basic map from "r", which is required to be
+ * a basic set if "set" is set.
+ */
+static __isl_give isl_basic_map *read_basic_map(struct isl_binary_reader *r,
+	int set)
+{
+	isl_space *space;
+
+	space = check_set_space(r, read_space(r), set);
+	return read_basic_map_body(r, space);
+}
+
+/* Read a map with space "space" from "r".
+ * See write_map_body for a description of the encoding.
+ */
+static __isl_give isl_map *read_map_body(struct isl_binary_reader *r,
+	__isl_take isl_space *space)
+{
+	int i, n;
+	uint64_t flags;
+	isl_map *map;
+
+	if (!space)
+		return NULL;
+	if (read_uint(r, &flags) < 0 || read_count(r, &n) < 0)
+		goto error;
+	if (flags & ~(uint64_t) ISL_BINARY_MAP_FLAGS) {
+		invalid(r);
+		goto error;
+	}
+
+	map = isl_map_alloc_space(isl_space_copy(space), n, 0);
+	for (i = 0; map && i < n; ++i) {
+		isl_basic_map *bmap;
+
+		bmap = read_basic_map_body(r, isl_space_copy(space));
+		if (!bmap)
+			map = isl_map_free(map);
+		else
+			map->p[map->n++] = bmap;
+	}
+	if (map)
+		map->flags = flags;
+	isl_space_free(space);
+
+	return map;
+error:
+	isl_space_free(space);
+	return NULL;
+}
+
+/* Read a map from "r", which is required to be a set if "set" is set.
+ */
+static __isl_give isl_map *read_map(struct isl_binary_reader *r, int set)
+{
+	isl_space *space;
+
+	space = check_set_space(r, read_space(r), set);
+	return read_map_body(r, space);
+}
+
+/* Read a union map from "r", which is required to be
+ * a union set if "set" is set.
+ * See write_union_map for a description of the encoding.
+ */
+static __isl_give isl_union_map *read_union_map(struct isl_binary_reader *r,
+	int set)
+{
+	int i, n;
+	isl_space *space;
+	isl_union_map *umap;
+
+	space = read_space(r);
+	if (space && !isl_space_is_params(space)) {
+		invalid(r);
+		space = isl_space_free(space);
+	}
+	if (!space || read_count(r, &n) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	umap = isl_union_map_empty(space);
+	for (i = 0; umap && i < n; ++i)
+		umap = isl_union_map_add_map(umap, read_map(r, set));
+
+	return umap;
+}
+
+/* Read an affine expression with domain space "space" from "r".
+ * See write_aff_body for a description of the encoding.
+ */
+static __isl_give isl_aff *read_aff_body(struct isl_binary_reader *r,
+	__isl_take isl_space *space)
+{
+	int i, n_div;
+	unsigned n_col;
+	isl_mat *div;
+	isl_vec *v;
+	isl_local_space *ls;
+
+	if (!space || read_count(r, &n_div) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+	n_col = 2 + isl_space_dim(space, isl_dim_all) + n_div;
+	if (check_rows(r, n_div + 1, n_col) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	div = isl_mat_alloc(r->ctx, n_div, n_col);
+	for (i = 0; div && i < n_div; ++i)
+		if (read_row(r, div->row[i], n_col) < 0)
+			div = isl_mat_free(div);
+	ls = isl_local_space_alloc_div(space, div);
+	v = isl_vec_alloc(r->ctx, n_col);
+	if (v && read_row(r, v->el, n_col) < 0)
+		v = isl_vec_free(v);
+
+	return isl_aff_alloc_vec(ls, v);
+}
+
+/* Read a piecewise affine expression from "r".
+ * See write_pw_aff for a description of the encoding.
+ */
+static __isl_give isl_pw_aff *read_pw_aff(struct isl_binary_reader *r)
+{
+	int i, n;
+	isl_space *space, *domain;
+	isl_pw_aff *pa;
+
+	space = read_space(r);
+	if (space && isl_space_dim(space, isl_dim_out) != 1) {
+		invalid(r);
+		space = isl_space_free(space);
+	}
+	if (!space || read_count(r, &n) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	domain = isl_space_domain(isl_space_copy(space));
+	pa = isl_pw_aff_alloc_size(space, n);
+	for (i = 0; pa && i < n; ++i) {
+		isl_set *set;
+		isl_aff *aff;
+
+		set = read_map_body(r, isl_space_copy(domain));
+		aff = set ? read_aff_body(r, isl_space_copy(domain)) : NULL;
+		pa = isl_pw_aff_add_piece(pa, set, aff);
+	}
+	isl_space_free(domain);
+
+	return pa;
+}
+
+/* Read a multi-affine expression with space "space" from "r".
+ * See write_multi_aff_body for a description of the encoding.
+ */
+static __isl_give isl_multi_aff *read_multi_aff_body(
+	struct isl_binary_reader *r, __isl_take isl_space *space)
+{
+	int i, n;
+	isl_space *domain;
+	isl_aff_list *list;
+
+	if (!space)
+		return NULL;
+
+	n = isl_space_dim(space, isl_dim_out);
+	domain = isl_space_domain(isl_space_copy(space));
+	list = isl_aff_list_alloc(r->ctx, n);
+	for (i = 0; list && i < n; ++i) {
+		isl_aff *aff;
+
+		aff = read_aff_body(r, isl_space_copy(domain));
+		list = isl_aff_list_add(list, aff);
+	}
+	isl_space_free(domain);
+
+	return isl_multi_aff_from_aff_list(space, list);
+}
+
+/* Read a piecewise multi-affine expression from "r".
+ * See write_pw_multi_aff for a description of the encoding.
+ */
+static __isl_give isl_pw_multi_aff *read_pw_multi_aff(
+	struct isl_binary_reader *r)
+{
+	int i, n;
+	isl_space *space, *domain;
+	isl_pw_multi_aff *pma;
+
+	space = read_space(r);
+	if (!space || read_count(r, &n) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	domain = isl_space_domain(isl_space_copy(space));
+	pma = isl_pw_multi_aff_alloc_size(isl_space_copy(space), n);
+	for (i = 0; pma && i < n; ++i) {
+		isl_set *set;
+		isl_multi_aff *ma;
+
+		set = read_map_body(r, isl_space_copy(domain));
+		ma = NULL;
+		if (set)
+			ma = read_multi_aff_body(r, isl_space_copy(space));
+		pma = isl_pw_multi_aff_add_piece(pma, set, ma);
+	}
+	isl_space_free(domain);
+	isl_space_free(space);
+
+	return pma;
+}
+
+/* Read the (parameter) space of a union of piecewise expressions
+ * from "r", along with the number of piecewise expressions.
+ */
+static __isl_give isl_space *read_union_space(struct isl_binary_reader *r,
+	int *n)
+{
+	isl_space *space;
+
+	space = read_space(r);
+	if (space && !isl_space_is_params(space)) {
+		invalid(r);
+		space = isl_space_free(space);
+	}
+	if (!space || read_count(r, n) < 0)
+		return isl_space_free(space);
+	return space;
+}
+
+/* Read a union of piecewise affine expressions from "r".
+ * See write_union_pw_aff for a description of the encoding.
+ */
+static __isl_give isl_union_pw_aff *read_union_pw_aff(
+	struct isl_binary_reader *r)
+{
+	int i, n;
+	isl_space *space;
+	isl_union_pw_aff *upa;
+
+	space = read_union_space(r, &n);
+	if (!space)
+		return NULL;
+
+	upa = isl_union_pw_aff_empty(space);
+	for (i = 0; upa && i < n; ++i)
+		upa = isl_union_pw_aff_add_pw_aff(upa, read_pw_aff(r));
+
+	return upa;
+}
+
+/* Read a union of piecewise multi-affine expressions from "r".
+ * See write_union_pw_multi_aff for a description of the encoding.
+ */
+static __isl_give isl_union_pw_multi_aff *read_union_pw_multi_aff(
+	struct isl_binary_reader *r)
+{
+	int i, n;
+	isl_space *space;
+	isl_union_pw_multi_aff *upma;
+
+	space = read_union_space(r, &n);
+	if (!space)
+		return NULL;
+
+	upma = isl_union_pw_multi_aff_empty(space);
+	for (i = 0; upma && i < n; ++i)
+		upma = isl_union_pw_multi_aff_add_pw_multi_aff(upma,
+							read_pw_multi_aff(r));
+
+	return upma;
+}
+
+/* Read a multi union piecewise affine expression from "r".
+ * See write_multi_union_pw_aff for a description of the encoding.
+ */
+static __isl_give isl_multi_union_pw_aff *read_multi_union_pw_aff(
+	struct isl_binary_reader *r)
+{
+	int i, n;
+	isl_space *space;
+	isl_union_pw_aff_list *list;
+
+	space = check_set_space(r, read_space(r), 1);
+	if (!space)
+		return NULL;
+
+	n = isl_space_dim(space, isl_dim_set);
+	list = isl_union_pw_aff_list_alloc(r->ctx, n);
+	for (i = 0; list && i < n; ++i)
+		list = isl_union_pw_aff_list_add(list, read_union_pw_aff(r));
+
+	return isl_multi_union_pw_aff_from_union_pw_aff_list(space, list);
+}
+
+/* Read a band from "r".
+ * See write_band for a description of the encoding.
+ */
+static __isl_give isl_schedule_band *read_band(struct isl_binary_reader *r)
+{
+	int i, n;
+	uint64_t v;
+	isl_multi_union_pw_aff *mupa;
+	isl_schedule_band *band;
+	isl_union_set *options;
+
+	mupa = read_multi_union_pw_aff(r);
+	band = isl_schedule_band_from_multi_union_pw_aff(mupa);
+	if (!band || read_uint(r, &v) < 0)
+		return isl_schedule_band_free(band);
+	band = isl_schedule_band_set_permutable(band, v != 0);
+	n = isl_schedule_band_n_member(band);
+	for (i = 0; band && i < n; ++i) {
+		if (read_uint(r, &v) < 0)
+			return isl_schedule_band_free(band);
+		band = isl_schedule_band_member_set_coincident(band, i, v != 0);
+	}
+	options = read_union_map(r, 1);
+	if (!options)
+		return isl_schedule_band_free(band);
+	return isl_schedule_band_set_ast_build_options(band, options);
+}
+
+static __isl_give isl_schedule_tree *read_schedule_tree(
+	struct isl_binary_reader *r);
+
+/* Read a schedule tree that is nested inside another schedule tree
+ * from "r", provided the maximal nesting depth is not exceeded.
+ */
+static __isl_give isl_schedule_tree *read_nested_schedule_tree(
+	struct isl_binary_reader *r)
+{
+	isl_schedule_tree *tree;
+
+	if (enter_nested(r) < 0)
+		return NULL;
+	tree = read_schedule_tree(r);
+	r->depth--;
+	return tree;
+}
+
+/* Read the children of a sequence or set node of type "type" from "r" and
+ * construct the node.  The number of children is "n".
+ */
+static __isl_give isl_schedule_tree *read_children(
+	struct isl_binary_reader *r, enum isl_schedule_node_type type, int n)
+{
+	int i;
+	isl_schedule_tree_list *list;
+
+	list = isl_schedule_tree_list_alloc(r->ctx, n);
+	for (i = 0; list && i < n; ++i)
+		list = isl_schedule_tree_list_add(list,
+					read_nested_schedule_tree(r));
+
+	return isl_schedule_tree_from_children(type, list);
+}
+
+/* Read a schedule tree from "r".
+ * See write_schedule_tree for a description of the encoding.
+ *
+ * Except for sequence and set nodes, a node has at most one child.
+ * The information specific to the type of the node is read first, but
+ * the node is only constructed after its child, by inserting it
+ * on top of this child.  A missing child is represented by a leaf.
+ */
+static __isl_give isl_schedule_tree *read_schedule_tree(
+	struct isl_binary_reader *r)
+{
+	uint64_t type;
+	int n;
+	isl_schedule_band *band = NULL;
+	isl_set *set = NULL;
+	isl_union_set *uset = NULL;
+	isl_union_map *umap = NULL;
+	isl_union_pw_multi_aff *upma = NULL;
+	isl_id *mark = NULL;
+	isl_schedule_tree *child;
+	isl_stat ok = isl_stat_ok;
+
+	if (read_uint(r, &type) < 0)
+		return NULL;
+
+	switch (type) {
+	case isl_schedule_node_band:
+		band = read_band(r);
+		ok = band ? isl_stat_ok : isl_stat_error;
+		break;
+	case isl_schedule_node_context:
+	case isl_schedule_node_guard:
+		set = read_map(r, 1);
+		ok = set ? isl_stat_ok : isl_stat_error;
+		break;
+	case isl_schedule_node_domain:
+	case isl_schedule_node_filter:
+		uset = read_union_map(r, 1);
+		ok = uset ? isl_stat_ok : isl_stat_error;
+		break;
+	case isl_schedule_node_expansion:
+		upma = read_union_pw_multi_aff(r);
+		if (upma)
+			umap = read_union_map(r, 0);
+		ok = umap ? isl_stat_ok : isl_stat_error;
+		break;
+	case isl_schedule_node_extension:
+		umap = read_union_map(r, 0);
+		ok = umap ? isl_stat_ok : isl_stat_error;
+		break;
+	case isl_schedule_node_mark:
+		ok = read_id(r, &mark);
+		if (ok >= 0 && !mark)
+			ok = invalid(r);
+		break;
+	case isl_schedule_node_leaf:
+	case isl_schedule_node_sequence:
+	case isl_schedule_node_set:
+		break;
+	default:
+		ok = invalid(r);
+	}
+	if (ok >= 0)
+		ok = read_count(r, &n);
+	if (ok >= 0 && type != isl_schedule_node_sequence &&
+	    type != isl_schedule_node_set &&
+	    n > (type == isl_schedule_node_leaf ? 0 : 1))
+		ok = invalid(r);
+	if (ok < 0)
+		goto error;
+
+	if (type == isl_schedule_node_sequence || type == isl_schedule_node_set)
+		return read_children(r, type, n);
+	if (n == 0)
+		child = isl_schedule_tree_leaf(r->ctx);
+	else
+		child = read_nested_schedule_tree(r);
+
+	switch (type) {
+	case isl_schedule_node_band:
+		return isl_schedule_tree_insert_band(child, band);
+	case isl_schedule_node_context:
+		return isl_schedule_tree_insert_context(child, set);
+	case isl_schedule_node_guard:
+		return isl_schedule_tree_insert_guard(child, set);
+	case isl_schedule_node_domain:
+		return isl_schedule_tree_insert_domain(child, uset);
+	case isl_schedule_node_filter:
+		return isl_schedule_tree_insert_filter(child, uset);
+	case isl_schedule_node_expansion:
+		return isl_schedule_tree_insert_expansion(child, upma, umap);
+	case isl_schedule_node_extension:
+		return isl_schedule_tree_insert_extension(child, umap);
+	case isl_schedule_node_mark:
+		return isl_schedule_tree_insert_mark(child, mark);
+	default:
+		return child;
+	}
+error:
+	isl_schedule_band_free(band);
+	isl_set_free(set);
+	isl_union_set_free(uset);
+	isl_union_map_free(umap);
+	isl_union_pw_multi_aff_free(upma);
+	isl_id_free(mark);
+	return NULL;
+}
+
+static __isl_give isl_schedule *read_schedule(struct isl_binary_reader *r)
+{
+	return isl_schedule_from_schedule_tree(r->ctx, read_schedule_tree(r));
+}
+
+/* Return a binary representation of "bset" and
+ * store its size in "size".
+ * The result needs to be freed by the caller using free().
+ */
+__isl_give void *isl_basic_set_to_binary(__isl_keep isl_basic_set *bset,
+	size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!bset || writer_init(&w, isl_basic_set_get_ctx(bset)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_basic_set,
+				write_basic_map(&w, bset), size);
+}
+
+__isl_give void *isl_basic_map_to_binary(__isl_keep isl_basic_map *bmap,
+	size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!bmap || writer_init(&w, isl_basic_map_get_ctx(bmap)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_basic_map,
+				write_basic_map(&w, bmap), size);
+}
+
+__isl_give void *isl_set_to_binary(__isl_keep isl_set *set, size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!set || writer_init(&w, isl_set_get_ctx(set)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_set, write_map(&w, set), size);
+}
+
+__isl_give void *isl_map_to_binary(__isl_keep isl_map *map, size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!map || writer_init(&w, isl_map_get_ctx(map)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_map, write_map(&w, map), size);
+}
+
+__isl_give void *isl_union_set_to_binary(__isl_keep isl_union_set *uset,
+	size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!uset || writer_init(&w, isl_union_set_get_ctx(uset)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_union_set,
+				write_union_map(&w, uset), size);
+}
+
+__isl_give void *isl_union_map_to_binary(__isl_keep isl_union_map *umap,
+	size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!umap || writer_init(&w, isl_union_map_get_ctx(umap)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_union_map,
+				write_union_map(&w, umap), size);
+}
+
+__isl_give void *isl_pw_aff_to_binary(__isl_keep isl_pw_aff *pa, size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!pa || writer_init(&w, isl_pw_aff_get_ctx(pa)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_pw_aff,
+				write_pw_aff(&w, pa), size);
+}
+
+__isl_give void *isl_pw_multi_aff_to_binary(__isl_keep isl_pw_multi_aff *pma,
+	size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!pma || writer_init(&w, isl_pw_multi_aff_get_ctx(pma)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_pw_multi_aff,
+				write_pw_multi_aff(&w, pma), size);
+}
+
+__isl_give void *isl_schedule_to_binary(__isl_keep isl_schedule *schedule,
+	size_t *size)
+{
+	struct isl_binary_writer w;
+
+	if (!schedule || writer_init(&w, isl_schedule_get_ctx(schedule)) < 0)
+		return NULL;
+	return writer_finish(&w, isl_binary_schedule,
+				write_schedule_tree(&w, schedule->root), size);
+}
+
+/* Read a basic set from the binary representation
+ * of "size" bytes at "data".
+ */
+__isl_give isl_basic_set *isl_basic_set_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_basic_set *bset = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_basic_set) >= 0)
+		bset = read_basic_map(&r, 1);
+	if (reader_finish(&r, bset != NULL) < 0)
+		return isl_basic_set_free(bset);
+	return bset;
+}
+
+__isl_give isl_basic_map *isl_basic_map_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_basic_map *bmap = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_basic_map) >= 0)
+		bmap = read_basic_map(&r, 0);
+	if (reader_finish(&r, bmap != NULL) < 0)
+		return isl_basic_map_free(bmap);
+	return bmap;
+}
+
+__isl_give isl_set *isl_set_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_set *set = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_set) >= 0)
+		set = read_map(&r, 1);
+	if (reader_finish(&r, set != NULL) < 0)
+		return isl_set_free(set);
+	return set;
+}
+
+__isl_give isl_map *isl_map_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_map *map = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_map) >= 0)
+		map = read_map(&r, 0);
+	if (reader_finish(&r, map != NULL) < 0)
+		return isl_map_free(map);
+	return map;
+}
+
+__isl_give isl_union_set *isl_union_set_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_union_set *uset = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_union_set) >= 0)
+		uset = read_union_map(&r, 1);
+	if (reader_finish(&r, uset != NULL) < 0)
+		return isl_union_set_free(uset);
+	return uset;
+}
+
+__isl_give isl_union_map *isl_union_map_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_union_map *umap = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_union_map) >= 0)
+		umap = read_union_map(&r, 0);
+	if (reader_finish(&r, umap != NULL) < 0)
+		return isl_union_map_free(umap);
+	return umap;
+}
+
+__isl_give isl_pw_aff *isl_pw_aff_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_pw_aff *pa = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_pw_aff) >= 0)
+		pa = read_pw_aff(&r);
+	if (reader_finish(&r, pa != NULL) < 0)
+		return isl_pw_aff_free(pa);
+	return pa;
+}
+
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_pw_multi_aff *pma = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_pw_multi_aff) >= 0)
+		pma = read_pw_multi_aff(&r);
+	if (reader_finish(&r, pma != NULL) < 0)
+		return isl_pw_multi_aff_free(pma);
+	return pma;
+}
+
+__isl_give isl_schedule *isl_schedule_read_from_binary(isl_ctx *ctx,
+	const void *data, size_t size)
+{
+	struct isl_binary_reader r;
+	isl_schedule *schedule = NULL;
+
+	if (reader_init(&r, ctx, data, size, isl_binary_schedule) >= 0)
+		schedule = read_schedule(&r);
+	if (reader_finish(&r, schedule != NULL) < 0)
+		return isl_schedule_free(schedule);
+	return schedule;
+}
@@ -7,11 +7,12 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <stdlib.h>
 #include <isl_blk.h>
 #include <isl_ctx_private.h>
-
-/* The maximal number of cache misses before first element is evicted */
-#define ISL_BLK_MAX_MISS	100
+#include <isl_options_private.h>
+#include <isl_arena_private.h>
+#include <isl_profile_private.h>
 
 struct isl_blk isl_blk_empty()
 {
@@ -45,19 +46,42 @@ static void isl_blk_free_force(struct isl_ctx *ctx, struct isl_blk block)
 
 	for (i = 0; i < block.size; ++i)
 		isl_int_clear(block.data[i]);
-	free(block.data);
+	isl_arena_free(ctx, block.data);
 }
 
+/* Return the size class of blocks of at least "n" elements,
+ * i.e., the smallest "c" such that 2^c >= n, or
+ * ISL_BLK_N_CLASS if blocks of "n" elements are too large to be cached.
+ */
+static int size_class(size_t n)
+{
+	int c;
+
+	for (c = 0; c < ISL_BLK_N_CLASS; ++c)
+		if (((size_t) 1 << c) >= n)
+			return c;
+	return ISL_BLK_N_CLASS;
+}
+
+/* Extend "block" to hold at least "new_n" elements.
+ * Unless the block is too large to be cached, its size is rounded up
+ * to the size of its size class such that it can be reused
+ * for any request in that class once it is freed.
+ */
 static struct isl_blk extend(struct isl_ctx *ctx, struct isl_blk block,
 				size_t new_n)
 {
-	int i;
+	int i, c;
 	isl_int *p;
 
 	if (block.size >= new_n)
 		return block;
 
-	p = isl_realloc_array(ctx, block.data, isl_int, new_n);
+	c = size_class(new_n);
+	if (c < ISL_BLK_N_CLASS)
+		new_n = (size_t) 1 << c;
+
+	p = isl_arena_realloc_array(ctx, block.data, isl_int, new_n);
 	if (!p) {
 		isl_blk_free_force(ctx, block);
 		return isl_blk_error();
@@ -71,34 +95,40 @@ static struct isl_blk extend(struct isl_ctx *ctx, struct isl_blk block,
 	return block;
 }
 
+/* Take a block of size class "c" from the cache in "local", if any.
+ */
+static struct isl_blk take_cached(struct isl_ctx_local *local, int c)
+{
+	struct isl_blk_pool *pool;
+	struct isl_blk block;
+
+	if (c >= ISL_BLK_N_CLASS || local->blk_pool[c].n == 0)
+		return isl_blk_empty();
+
+	pool = &local->blk_pool[c];
+	block = pool->block[--pool->n];
+	local->blk_cached -= block.size * sizeof(isl_int);
+	return block;
+}
+
+/* Allocate a block of "n" integers, reusing a cached block
+ * of the current thread from the corresponding size class if possible.
+ * The integers in a cached block have already been initialized.
+ */
 struct isl_blk isl_blk_alloc(struct isl_ctx *ctx, size_t n)
 {
-	int i;
 	struct isl_blk block;
+	struct isl_ctx_local *local;
 
+	isl_profile_count(ctx, isl_profile_allocations);
 	block = isl_blk_empty();
-	if (n && ctx->n_cached) {
-		int best = 0;
-		for (i = 1; ctx->cache[best].size != n && i < ctx->n_cached; ++i) {
-			if (ctx->cache[best].size < n) {
-				if (ctx->cache[i].size > ctx->cache[best].size)
-					best = i;
-			} else if (ctx->cache[i].size >= n &&
-				   ctx->cache[i].size < ctx->cache[best].size)
-					best = i;
-		}
-		if (ctx->cache[best].size < 2 * n + 100) {
-			block = ctx->cache[best];
-			if (--ctx->n_cached != best)
-				ctx->cache[best] = ctx->cache[ctx->n_cached];
-			if (best == 0)
-				ctx->n_miss = 0;
-		} else if (ctx->n_miss++ >= ISL_BLK_MAX_MISS) {
-			isl_blk_free_force(ctx, ctx->cache[0]);
-			if (--ctx->n_cached != 0)
-				ctx->cache[0] = ctx->cache[ctx->n_cached];
-			ctx->n_miss = 0;
-		}
+	local = isl_ctx_local(ctx);
+	if (n && local) {
+		block = take_cached(local, size_class(n));
+		if (isl_blk_is_empty(block))
+			local->blk_misses++;
+		else
+			local->blk_hits++;
 	}
 
 	return extend(ctx, block, n);
@@ -113,22 +143,121 @@ struct isl_blk isl_blk_extend(struct isl_ctx *ctx, struct isl_blk block,
 	return extend(ctx, block, new_n);
 }
 
+/* Try and add "block" to the cache in "local".
+ * Return 1 if the block was added and 0 if it needs to be freed instead.
+ *
+ * Only blocks with a size that exactly matches their size class are cached.
+ * The pool of the size class grows as needed,
+ * as long as the total size of the cached blocks
+ * does not exceed the blk_cache_size option.
+ * A block that escaped from an arena scope is never cached
+ * since that would keep its arena chunk alive.
+ */
+static int add_cached(struct isl_ctx *ctx, struct isl_ctx_local *local,
+	struct isl_blk block)
+{
+	struct isl_blk_pool *pool;
+	size_t bytes;
+	int c;
+
+	c = size_class(block.size);
+	if (c >= ISL_BLK_N_CLASS || ((size_t) 1 << c) != block.size)
+		return 0;
+	bytes = block.size * sizeof(isl_int);
+	if (ctx->opt->blk_cache_size < 0 ||
+	    local->blk_cached + bytes > (size_t) ctx->opt->blk_cache_size)
+		return 0;
+	if (isl_arena_is_retired(ctx, block.data))
+		return 0;
+
+	pool = &local->blk_pool[c];
+	if (pool->n >= pool->size) {
+		int size = pool->size ? 2 * pool->size : 4;
+		struct isl_blk *p;
+
+		p = realloc(pool->block, size * sizeof(struct isl_blk));
+		if (!p)
+			return 0;
+		pool->block = p;
+		pool->size = size;
+	}
+	pool->block[pool->n++] = block;
+	local->blk_cached += bytes;
+
+	return 1;
+}
+
+/* Free "block", keeping it in the cache of the current thread
+ * if possible.
+ */
 void isl_blk_free(struct isl_ctx *ctx, struct isl_blk block)
 {
+	struct isl_ctx_local *local;
+
 	if (isl_blk_is_empty(block) || isl_blk_is_error(block))
 		return;
 
-	if (ctx->n_cached < ISL_BLK_CACHE_SIZE)
-		ctx->cache[ctx->n_cached++] = block;
-	else
+	local = isl_ctx_local(ctx);
+	if (!local || !add_cached(ctx, local, block))
 		isl_blk_free_force(ctx, block);
 }
 
-void isl_blk_clear_cache(struct isl_ctx *ctx)
+/* Free all blocks in the cache of the per-thread state "local".
+ */
+void isl_blk_clear_cache(struct isl_ctx_local *local)
 {
-	int i;
+	int c, i;
+
+	for (c = 0; c < ISL_BLK_N_CLASS; ++c) {
+		struct isl_blk_pool *pool = &local->blk_pool[c];
+
+		for (i = 0; i < pool->n; ++i)
+			isl_blk_free_force(local->ctx, pool->block[i]);
+		free(pool->block);
+		pool->n = 0;
+		pool->size = 0;
+		pool->block = NULL;
+	}
+	local->blk_cached = 0;
+}
 
-	for (i = 0; i < ctx->n_cached; ++i)
-		isl_blk_free_force(ctx, ctx->cache[i]);
-	ctx->n_cached = 0;
+/* Return the total number of block allocations by all threads of "ctx"
+ * that could ("hits" is set) or could not ("hits" is not set)
+ * be served from the cache.
+ */
+static unsigned long blk_cache_count(isl_ctx *ctx, int hits)
+{
+	struct isl_ctx_local *local;
+	unsigned long n = 0;
+
+	if (!ctx)
+		return 0;
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		pthread_mutex_lock(&ctx->local_lock);
+#endif
+	for (local = &ctx->local; local; local = local->next)
+		n += hits ? local->blk_hits : local->blk_misses;
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		pthread_mutex_unlock(&ctx->local_lock);
+#endif
+
+	return n;
+}
+
+/* Return the number of block allocations on "ctx"
+ * that were served from the cache.
+ */
+unsigned long isl_ctx_get_blk_cache_hits(isl_ctx *ctx)
+{
+	return blk_cache_count(ctx, 1);
+}
+
+/* Return the number of block allocations on "ctx"
+ * that could not be served from the cache.
+ */
+unsigned long isl_ctx_get_blk_cache_misses(isl_ctx *ctx)
+{
+	return blk_cache_count(ctx, 0);
 }
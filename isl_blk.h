@@ -21,9 +21,24 @@ struct isl_blk {
 	isl_int *data;
 };
 
-#define ISL_BLK_CACHE_SIZE	20
+/* The number of size classes of cached blocks.
+ * Size class "c" holds blocks of exactly 2^c elements.
+ * Larger blocks are never cached.
+ */
+#define ISL_BLK_N_CLASS		24
+
+/* A pool of cached blocks of the same size class.
+ * "n" is the number of cached blocks in "block", while
+ * "size" is the number of elements allocated for "block".
+ */
+struct isl_blk_pool {
+	int n;
+	int size;
+	struct isl_blk *block;
+};
 
 struct isl_ctx;
+struct isl_ctx_local;
 
 struct isl_blk isl_blk_alloc(struct isl_ctx *ctx, size_t n);
 struct isl_blk isl_blk_empty(void);
@@ -31,7 +46,7 @@ int isl_blk_is_error(struct isl_blk block);
 struct isl_blk isl_blk_extend(struct isl_ctx *ctx, struct isl_blk block,
 				size_t new_n);
 void isl_blk_free(struct isl_ctx *ctx, struct isl_blk block);
-void isl_blk_clear_cache(struct isl_ctx *ctx);
+void isl_blk_clear_cache(struct isl_ctx_local *local);
 
 #if defined(__cplusplus)
 }
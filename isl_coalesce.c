@@ -30,6 +30,8 @@
 #include <isl_aff_private.h>
 #include <isl_equalities.h>
 #include <isl_constraint_private.h>
+#include <isl_memo.h>
+#include <isl_profile_private.h>
 
 #include <set_to_map.c>
 #include <set_from_map.c>
@@ -185,6 +187,13 @@ static int all(int *con, unsigned len, int status)
  * the other basic map.  The number of elements in the "eq" array
  * is twice the number of equalities in the "bmap", corresponding
  * to the two inequalities that make up each equality.
+ *
+ * "box" is either NULL or a bounding box of the rational relaxation
+ * of "bmap", computed on demand by coalesce_info_set_box.
+ * The first half of "box" contains lower bounds on the variables and
+ * the second half contains upper bounds.
+ * "bounded" specifies for each of these elements whether the variable
+ * is actually bounded in that direction.
  */
 struct isl_coalesce_info {
 	isl_basic_map *bmap;
@@ -194,6 +203,8 @@ struct isl_coalesce_info {
 	int simplify;
 	int *eq;
 	int *ineq;
+	isl_vec *box;
+	int *bounded;
 };
 
 /* Is there any (half of an) equality constraint in the description
@@ -335,11 +346,23 @@ static void clear_coalesce_info(int n, struct isl_coalesce_info *info)
 	for (i = 0; i < n; ++i) {
 		isl_basic_map_free(info[i].bmap);
 		isl_tab_free(info[i].tab);
+		isl_vec_free(info[i].box);
+		free(info[i].bounded);
 	}
 
 	free(info);
 }
 
+/* Drop the bounding box of the basic map represented by "info",
+ * if any.  This needs to be called whenever the basic map changes.
+ */
+static void coalesce_info_clear_box(struct isl_coalesce_info *info)
+{
+	info->box = isl_vec_free(info->box);
+	free(info->bounded);
+	info->bounded = NULL;
+}
+
 /* Drop the basic map represented by "info".
  * That is, clear the memory associated to the entry and
  * mark it as having been removed.
@@ -349,6 +372,7 @@ static void drop(struct isl_coalesce_info *info)
 	info->bmap = isl_basic_map_free(info->bmap);
 	isl_tab_free(info->tab);
 	info->tab = NULL;
+	coalesce_info_clear_box(info);
 	info->removed = 1;
 }
 
@@ -906,16 +930,18 @@ static isl_bool is_affected(__isl_keep isl_basic_map *bmap, int ineq,
 static __isl_give isl_vec *try_tightening(struct isl_coalesce_info *info,
 	int ineq, __isl_take isl_vec *v)
 {
-	isl_ctx *ctx;
+	struct isl_ctx_local *local;
 	isl_stat r;
 
 	if (!v)
 		return NULL;
 
-	ctx = isl_vec_get_ctx(v);
-	isl_seq_gcd(v->el + 1, v->size - 1, &ctx->normalize_gcd);
-	if (isl_int_is_zero(ctx->normalize_gcd) ||
-	    isl_int_is_one(ctx->normalize_gcd)) {
+	local = isl_ctx_local(isl_vec_get_ctx(v));
+	if (!local)
+		return isl_vec_free(v);
+	isl_seq_gcd(v->el + 1, v->size - 1, &local->normalize_gcd);
+	if (isl_int_is_zero(local->normalize_gcd) ||
+	    isl_int_is_one(local->normalize_gcd)) {
 		return v;
 	}
 
@@ -923,7 +949,7 @@ static __isl_give isl_vec *try_tightening(struct isl_coalesce_info *info,
 	if (!v)
 		return NULL;
 
-	isl_int_fdiv_r(v->el[0], v->el[0], ctx->normalize_gcd);
+	isl_int_fdiv_r(v->el[0], v->el[0], local->normalize_gcd);
 	if (isl_int_is_zero(v->el[0]))
 		return v;
 
@@ -3705,6 +3731,175 @@ static enum isl_change coalesce_pair(int i, int j,
 	return check_coalesce_eq(i, j, info);
 }
 
+/* Compute a bounding box of the rational relaxation of the basic map
+ * represented by "info" and store it in info->box,
+ * unless this has already been done.
+ * The basic map is assumed not to have any integer divisions.
+ *
+ * The bounds are computed on a copy of info->tab since computing
+ * the bounds may change the basis of the tableau and
+ * the outcome of the other coalescing steps may depend on this basis.
+ * The rational bounds are rounded outward.
+ */
+static isl_stat coalesce_info_set_box(struct isl_coalesce_info *info)
+{
+	int k, d;
+	isl_ctx *ctx;
+	struct isl_tab *tab;
+	isl_vec *f;
+	isl_int opt, opt_denom;
+	isl_stat r = isl_stat_ok;
+
+	if (info->box)
+		return isl_stat_ok;
+
+	ctx = isl_basic_map_get_ctx(info->bmap);
+	d = isl_basic_map_total_dim(info->bmap);
+	tab = isl_tab_dup(info->tab);
+	f = isl_vec_alloc(ctx, 1 + d);
+	info->box = isl_vec_alloc(ctx, 2 * d);
+	info->bounded = isl_calloc_array(ctx, int, 2 * d);
+	if (!tab || !f || !info->box || (d && !info->bounded) ||
+	    isl_tab_extend_cons(tab, 1) < 0)
+		r = isl_stat_error;
+
+	isl_int_init(opt);
+	isl_int_init(opt_denom);
+	for (k = 0; r >= 0 && k < 2 * d; ++k) {
+		enum isl_lp_result res;
+		int upper = k >= d;
+
+		isl_seq_clr(f->el, 1 + d);
+		isl_int_set_si(f->el[1 + k % d], upper ? -1 : 1);
+		res = isl_tab_min(tab, f->el, ctx->one, &opt, &opt_denom, 0);
+		if (res == isl_lp_error || res == isl_lp_empty) {
+			r = isl_stat_error;
+			break;
+		}
+		if (res == isl_lp_unbounded)
+			continue;
+		isl_int_fdiv_q(info->box->el[k], opt, opt_denom);
+		if (upper)
+			isl_int_neg(info->box->el[k], info->box->el[k]);
+		info->bounded[k] = 1;
+	}
+	isl_int_clear(opt_denom);
+	isl_int_clear(opt);
+
+	isl_vec_free(f);
+	isl_tab_free(tab);
+	if (r < 0)
+		coalesce_info_clear_box(info);
+	return r;
+}
+
+/* Is the inequality constraint "ineq" of some basic map
+ * known to separate this basic map from the basic map
+ * with bounding box "box" (of which the variables are
+ * bounded as specified by "bounded") in the sense of
+ * isl_tab_ineq_type returning isl_ineq_separate?
+ * "d" is the number of variables.
+ *
+ * Let g be the gcd of the coefficients of the variables in "ineq".
+ * If the maximal value of "ineq" over the box is smaller than -g,
+ * then "ineq" is violated by all elements of the other basic map and
+ * can only be considered adjacent to an equality or an inequality
+ * of the other basic map if it is equal to -c (1 + r) on that basic map,
+ * with c a positive constant and r a non-negative variable or
+ * constraint of the other basic map that is zero in the sample value
+ * of its tableau.  If this tableau has no dead columns, then
+ * this equality also holds outside the basic map so that c divides g.
+ * However, the value of "ineq" in the sample value would then
+ * be -c >= -g, which is impossible.
+ * The caller is responsible for checking that there are
+ * no dead columns.
+ * "tmp" is used as scratch space.
+ */
+static int separated_by_box(isl_int *ineq, int d, __isl_keep isl_vec *box,
+	int *bounded, isl_int *tmp)
+{
+	int k;
+
+	isl_seq_gcd(ineq + 1, d, tmp);
+	if (isl_int_is_zero(*tmp))
+		return 0;
+	isl_int_add(*tmp, *tmp, ineq[0]);
+	for (k = 0; k < d; ++k) {
+		int pos;
+
+		if (isl_int_is_zero(ineq[1 + k]))
+			continue;
+		pos = isl_int_is_pos(ineq[1 + k]) ? d + k : k;
+		if (!bounded[pos])
+			return 0;
+		isl_int_addmul(*tmp, ineq[1 + k], box->el[pos]);
+	}
+
+	return isl_int_is_neg(*tmp);
+}
+
+/* Does any of the non-redundant inequality constraints of the basic map
+ * represented by "info1" separate it from the basic map
+ * represented by "info2", where info2->box has already been computed?
+ */
+static int any_separating_ineq(struct isl_coalesce_info *info1,
+	struct isl_coalesce_info *info2, isl_int *tmp)
+{
+	int k;
+	int d;
+	unsigned n_eq = info1->bmap->n_eq;
+
+	d = isl_basic_map_total_dim(info1->bmap);
+	for (k = 0; k < info1->bmap->n_ineq; ++k) {
+		if (isl_tab_is_redundant(info1->tab, n_eq + k))
+			continue;
+		if (separated_by_box(info1->bmap->ineq[k], d,
+				    info2->box, info2->bounded, tmp))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Can the basic maps represented by "info1" and "info2" be skipped
+ * by coalesce_range without changing the outcome?
+ * That is, is coalesce_pair known to return isl_change_none
+ * without this requiring any tableau operation?
+ *
+ * This is the case if neither basic map has any integer divisions,
+ * such that coalesce_pair only calls coalesce_local_pair,
+ * and if some non-redundant inequality constraint of either basic map
+ * is found to be separating by comparing it
+ * to a bounding box of the other basic map, which is computed on demand.
+ * coalesce_local_pair then returns isl_change_none
+ * as soon as it has detected this separating constraint.
+ * See separated_by_box for why the other basic map is required
+ * not to have any dead columns (or equality constraints) in its tableau.
+ */
+static isl_bool coalesce_pair_separated(struct isl_coalesce_info *info1,
+	struct isl_coalesce_info *info2)
+{
+	int separated;
+	isl_int tmp;
+
+	if (info1->bmap->n_div != 0 || info2->bmap->n_div != 0)
+		return isl_bool_false;
+	if (info1->bmap->n_eq != 0 || info1->tab->n_dead != 0)
+		return isl_bool_false;
+	if (info2->bmap->n_eq != 0 || info2->tab->n_dead != 0)
+		return isl_bool_false;
+	if (coalesce_info_set_box(info1) < 0 ||
+	    coalesce_info_set_box(info2) < 0)
+		return isl_bool_error;
+
+	isl_int_init(tmp);
+	separated = any_separating_ineq(info1, info2, &tmp) ||
+		    any_separating_ineq(info2, info1, &tmp);
+	isl_int_clear(tmp);
+
+	return separated ? isl_bool_true : isl_bool_false;
+}
+
 /* Return the maximum of "a" and "b".
  */
 static int isl_max(int a, int b)
@@ -3725,6 +3920,14 @@ static int isl_max(int a, int b)
  * If the two basic maps got fused, then we recheck the fused basic map
  * against the previously considered basic maps, starting at i + 1
  * (even if start2 is greater than i + 1).
+ *
+ * Pairs of basic maps that are obviously separated by one of their
+ * constraints are skipped (see coalesce_pair_separated).
+ * Every other pair is charged to the budgets of the current thread
+ * such that coalescing is aborted when any of them is exhausted.
+ * Since the bounding boxes used in this test are only valid
+ * as long as the basic maps do not change, they are dropped
+ * from both basic maps whenever a pair is coalesced.
  */
 static int coalesce_range(isl_ctx *ctx, struct isl_coalesce_info *info,
 	int start1, int end1, int start2, int end2)
@@ -3736,6 +3939,7 @@ static int coalesce_range(isl_ctx *ctx, struct isl_coalesce_info *info,
 			continue;
 		for (j = isl_max(i + 1, start2); j < end2; ++j) {
 			enum isl_change changed;
+			isl_bool separated;
 
 			if (info[j].removed)
 				continue;
@@ -3743,7 +3947,18 @@ static int coalesce_range(isl_ctx *ctx, struct isl_coalesce_info *info,
 				isl_die(ctx, isl_error_internal,
 					"basic map unexpectedly removed",
 					return -1);
+			separated = coalesce_pair_separated(&info[i], &info[j]);
+			if (separated < 0)
+				return -1;
+			if (separated)
+				continue;
+			if (isl_ctx_charge_budget(ctx) < 0)
+				return -1;
 			changed = coalesce_pair(i, j, info);
+			if (changed != isl_change_none) {
+				coalesce_info_clear_box(&info[i]);
+				coalesce_info_clear_box(&info[j]);
+			}
 			switch (changed) {
 			case isl_change_error:
 				return -1;
@@ -3851,7 +4066,7 @@ static __isl_give isl_map *update_basic_maps(__isl_take isl_map *map,
  * For each basic map, we also compute the hash of the apparent affine hull
  * for use in coalesce.
  */
-__isl_give isl_map *isl_map_coalesce(__isl_take isl_map *map)
+static __isl_give isl_map *map_coalesce(__isl_take isl_map *map)
 {
 	int i;
 	unsigned n;
@@ -3917,6 +4132,57 @@ error:
 	return NULL;
 }
 
+/* Coalesce the basic maps in "map", which is assumed to be non-NULL.
+ *
+ * If the memo table is enabled for coalescing, then first check
+ * whether an identical map has been coalesced before and, if so,
+ * return the earlier result.  Otherwise, store the result
+ * in the memo table.
+ * Since map_coalesce may modify its input in place
+ * (without changing its meaning), it is applied to a duplicate
+ * such that "map" can still serve as the key.
+ * Maps with at most one basic map are not worth memoizing.
+ */
+static __isl_give isl_map *map_coalesce_memo(__isl_take isl_map *map)
+{
+	struct isl_memo_key key;
+	isl_bool memo;
+	isl_map *res;
+
+	if (map->n <= 1)
+		return map_coalesce(map);
+
+	memo = isl_memo_key_init(&key, ISL_MEMO_COALESCE, map, NULL);
+	if (!memo)
+		return map_coalesce(map);
+	res = isl_memo_find_map(&key);
+	if (!res) {
+		res = map_coalesce(isl_map_dup(map));
+		isl_memo_add_map(&key, res);
+	}
+	isl_map_free(map);
+	return res;
+}
+
+/* Coalesce the basic maps in "map", profiling the operation
+ * if requested.
+ */
+__isl_give isl_map *isl_map_coalesce(__isl_take isl_map *map)
+{
+	isl_ctx *ctx;
+	struct isl_profile_scope scope;
+
+	if (!map)
+		return NULL;
+
+	ctx = isl_map_get_ctx(map);
+	isl_profile_enter(ctx, "isl_map_coalesce", &scope);
+	map = map_coalesce_memo(map);
+	isl_profile_leave(ctx, &scope);
+
+	return map;
+}
+
 /* For each pair of basic sets in the set, check if the union of the two
  * can be represented by a single basic set.
  * If so, replace the pair by the single basic set and start over.
@@ -10,6 +10,7 @@
  * ZAC des vignes, 4 rue Jacques Monod, 91893 Orsay, France 
  */
 
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_constraint_private.h>
 #include <isl_space_private.h>
@@ -101,17 +102,21 @@ __isl_give isl_constraint *isl_constraint_alloc(int eq,
 	return isl_constraint_alloc_vec(eq, ls, v);
 }
 
-struct isl_constraint *isl_basic_map_constraint(struct isl_basic_map *bmap,
-	isl_int **line)
+/* Return the constraint of "bmap" that is stored at "line".
+ * "line" needs to point inside the constraints of "bmap" itself
+ * and not inside those of a copy, since the type of the constraint
+ * is derived from its position.
+ */
+__isl_give isl_constraint *isl_basic_map_constraint(
+	__isl_keep isl_basic_map *bmap, isl_int **line)
 {
 	int eq;
 	isl_ctx *ctx;
 	isl_vec *v;
 	isl_local_space *ls = NULL;
-	isl_constraint *constraint;
 
 	if (!bmap || !line)
-		goto error;
+		return NULL;
 
 	eq = line >= bmap->eq;
 
@@ -121,18 +126,14 @@ struct isl_constraint *isl_basic_map_constraint(struct isl_basic_map *bmap,
 	if (!v)
 		goto error;
 	isl_seq_cpy(v->el, line[0], v->size);
-	constraint = isl_constraint_alloc_vec(eq, ls, v);
-
-	isl_basic_map_free(bmap);
-	return constraint;
+	return isl_constraint_alloc_vec(eq, ls, v);
 error:
 	isl_local_space_free(ls);
-	isl_basic_map_free(bmap);
 	return NULL;
 }
 
-struct isl_constraint *isl_basic_set_constraint(struct isl_basic_set *bset,
-	isl_int **line)
+__isl_give isl_constraint *isl_basic_set_constraint(
+	__isl_keep isl_basic_set *bset, isl_int **line)
 {
 	return isl_basic_map_constraint(bset_to_bmap(bset), line);
 }
@@ -160,13 +161,16 @@ struct isl_constraint *isl_constraint_dup(struct isl_constraint *c)
 
 struct isl_constraint *isl_constraint_cow(struct isl_constraint *c)
 {
+	struct isl_constraint *dup;
+
 	if (!c)
 		return NULL;
 
-	if (c->ref == 1)
+	if (isl_atomic_get(&c->ref) == 1)
 		return c;
-	c->ref--;
-	return isl_constraint_dup(c);
+	dup = isl_constraint_dup(c);
+	isl_constraint_free(c);
+	return dup;
 }
 
 struct isl_constraint *isl_constraint_copy(struct isl_constraint *constraint)
@@ -174,7 +178,7 @@ struct isl_constraint *isl_constraint_copy(struct isl_constraint *constraint)
 	if (!constraint)
 		return NULL;
 
-	constraint->ref++;
+	isl_atomic_inc(&constraint->ref);
 	return constraint;
 }
 
@@ -183,7 +187,7 @@ __isl_null isl_constraint *isl_constraint_free(__isl_take isl_constraint *c)
 	if (!c)
 		return NULL;
 
-	if (--c->ref > 0)
+	if (isl_atomic_dec(&c->ref) > 0)
 		return NULL;
 
 	isl_local_space_free(c->ls);
@@ -227,8 +231,7 @@ isl_stat isl_basic_map_foreach_constraint(__isl_keep isl_basic_map *bmap,
 			return isl_stat_error);
 
 	for (i = 0; i < bmap->n_eq; ++i) {
-		c = isl_basic_map_constraint(isl_basic_map_copy(bmap),
-						&bmap->eq[i]);
+		c = isl_basic_map_constraint(bmap, &bmap->eq[i]);
 		if (!c)
 			return isl_stat_error;
 		if (fn(c, user) < 0)
@@ -236,8 +239,7 @@ isl_stat isl_basic_map_foreach_constraint(__isl_keep isl_basic_map *bmap,
 	}
 
 	for (i = 0; i < bmap->n_ineq; ++i) {
-		c = isl_basic_map_constraint(isl_basic_map_copy(bmap),
-						&bmap->ineq[i]);
+		c = isl_basic_map_constraint(bmap, &bmap->ineq[i]);
 		if (!c)
 			return isl_stat_error;
 		if (fn(c, user) < 0)
@@ -802,8 +804,7 @@ isl_bool isl_basic_map_has_defining_equality(
 					   1+total-offset-pos-1) != -1)
 			continue;
 		if (c)
-			*c = isl_basic_map_constraint(isl_basic_map_copy(bmap),
-								&bmap->eq[i]);
+			*c = isl_basic_map_constraint(bmap, &bmap->eq[i]);
 		return isl_bool_true;
 	}
 	return isl_bool_false;
@@ -866,10 +867,8 @@ isl_bool isl_basic_set_has_defining_inequalities(
 				lower_line = &bset->ineq[j];
 				upper_line = &bset->ineq[i];
 			}
-			*lower = isl_basic_set_constraint(
-					isl_basic_set_copy(bset), lower_line);
-			*upper = isl_basic_set_constraint(
-					isl_basic_set_copy(bset), upper_line);
+			*lower = isl_basic_set_constraint(bset, lower_line);
+			*upper = isl_basic_set_constraint(bset, upper_line);
 			isl_int_clear(m);
 			return isl_bool_true;
 		}
@@ -1003,8 +1002,7 @@ static isl_stat foreach_upper_bound(__isl_keep isl_basic_set *bset,
 			isl_basic_set_free(context_i);
 			continue;
 		}
-		upper = isl_basic_set_constraint(isl_basic_set_copy(bset),
-						&bset->ineq[i]);
+		upper = isl_basic_set_constraint(bset, &bset->ineq[i]);
 		if (!upper || !context_i)
 			goto error;
 		if (fn(NULL, upper, context_i, user) < 0)
@@ -1045,8 +1043,7 @@ static isl_stat foreach_lower_bound(__isl_keep isl_basic_set *bset,
 			isl_basic_set_free(context_i);
 			continue;
 		}
-		lower = isl_basic_set_constraint(isl_basic_set_copy(bset),
-						&bset->ineq[i]);
+		lower = isl_basic_set_constraint(bset, &bset->ineq[i]);
 		if (!lower || !context_i)
 			goto error;
 		if (fn(lower, NULL, context_i, user) < 0)
@@ -1105,10 +1102,8 @@ static isl_stat foreach_bound_pair(__isl_keep isl_basic_set *bset,
 				isl_basic_set_free(context_j);
 				continue;
 			}
-			lower = isl_basic_set_constraint(isl_basic_set_copy(bset),
-							&bset->ineq[i]);
-			upper = isl_basic_set_constraint(isl_basic_set_copy(bset),
-							&bset->ineq[j]);
+			lower = isl_basic_set_constraint(bset, &bset->ineq[i]);
+			upper = isl_basic_set_constraint(bset, &bset->ineq[j]);
 			if (!lower || !upper || !context_j)
 				goto error;
 			if (fn(lower, upper, context_j, user) < 0)
@@ -1180,8 +1175,7 @@ isl_stat isl_basic_set_foreach_bound_pair(__isl_keep isl_basic_set *bset,
 		if (isl_int_is_zero(bset->eq[i][1 + abs_pos]))
 			continue;
 
-		lower = isl_basic_set_constraint(isl_basic_set_copy(bset),
-						&bset->eq[i]);
+		lower = isl_basic_set_constraint(bset, &bset->eq[i]);
 		upper = isl_constraint_copy(lower);
 		context = isl_basic_set_remove_dims(isl_basic_set_copy(bset),
 					type, pos, 1);
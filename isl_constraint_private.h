@@ -18,8 +18,8 @@ struct isl_constraint {
 
 #include <isl_list_templ.h>
 
-struct isl_constraint *isl_basic_set_constraint(struct isl_basic_set *bset,
-	isl_int **line);
+__isl_give isl_constraint *isl_basic_set_constraint(
+	__isl_keep isl_basic_set *bset, isl_int **line);
 
 void isl_constraint_get_constant(__isl_keep isl_constraint *constraint,
 	isl_int *v);
@@ -2355,7 +2355,8 @@ static __isl_give isl_basic_map *cached_simple_hull(__isl_take isl_map *map,
  * isl_basic_map_remove_redundancies.
  *
  * The result of the computation is stored in map->cached_simple_hull[shift]
- * such that it can be reused in subsequent calls.  The cache is cleared
+ * such that it can be reused in subsequent calls, unless the map
+ * may be accessed by other threads.  The cache is cleared
  * whenever the map is modified (in isl_map_cow).
  * Note that the results need to be stored in the input map for there
  * to be any chance that they may get reused.  In particular, they
@@ -2401,7 +2402,7 @@ static __isl_give isl_basic_map *map_simple_hull(__isl_take isl_map *map,
 	}
 
 	hull = isl_basic_map_finalize(hull);
-	if (input)
+	if (input && isl_ctx_may_update_shared(input->ctx, &input->ref))
 		input->cached_simple_hull[shift] = isl_basic_map_copy(hull);
 	isl_map_free(input);
 
@@ -7,9 +7,14 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <string.h>
+#include <time.h>
 #include <isl_ctx_private.h>
+#include <isl_arena_private.h>
 #include <isl/vec.h>
 #include <isl_options_private.h>
+#include <isl_parallel.h>
+#include <isl_profile_private.h>
 
 #define __isl_calloc(type,size)		((type *)calloc(1, size))
 #define __isl_calloc_type(type)		__isl_calloc(type,sizeof(type))
@@ -22,6 +27,143 @@ isl_bool isl_bool_not(isl_bool b)
 	return b < 0 ? isl_bool_error : !b;
 }
 
+/* Return the current time in nanoseconds.
+ * Only differences between two such times are meaningful.
+ */
+uint64_t isl_time_ns(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return (uint64_t) clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
+}
+
+/* The number of operations charged to a budget with a time limit
+ * between two consecutive checks of the current time.
+ */
+#define ISL_BUDGET_TIME_INTERVAL	64
+
+/* A budget pushed by isl_ctx_push_budget.
+ *
+ * "max_operations" is the maximal number of operations that may
+ * be performed within the budget, or zero if there is no such limit,
+ * while "operations" is the number of operations performed so far.
+ * "deadline" is the time (as returned by isl_time_ns) after which
+ * no further operations may be performed, or zero if there is no time limit.
+ * "exhausted" is set to the kind of limit that has been exceeded
+ * as soon as any of the limits has been exceeded
+ * and is isl_budget_none otherwise.
+ * "outer" is the budget that was the innermost budget of the thread
+ * when this budget was pushed.
+ * "depth" is the position of the budget on the stack,
+ * starting from 1 for the outermost budget.
+ *
+ * A budget is shared with the threads that perform tasks
+ * on behalf of isl_parallel_for for the thread that pushed it.
+ * "operations" and "exhausted" are therefore accessed atomically.
+ */
+struct isl_budget {
+	unsigned long max_operations;
+	unsigned long operations;
+	uint64_t deadline;
+	int exhausted;
+	int depth;
+
+	struct isl_budget *outer;
+};
+
+/* The kinds of limits of a budget.
+ */
+enum isl_budget_kind {
+	isl_budget_none = 0,
+	isl_budget_operations,
+	isl_budget_time
+};
+
+/* Mark "budget" as having exceeded its limit of kind "kind",
+ * unless it has already been marked as exhausted before,
+ * possibly by another thread sharing the budget.
+ * Return 1 if "budget" was marked by this call and 0 otherwise.
+ */
+static int set_exhausted(struct isl_budget *budget, enum isl_budget_kind kind)
+{
+#ifdef USE_THREADS
+	int none = isl_budget_none;
+
+	return __atomic_compare_exchange_n(&budget->exhausted, &none, kind,
+				0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+	if (budget->exhausted != isl_budget_none)
+		return 0;
+	budget->exhausted = kind;
+	return 1;
+#endif
+}
+
+/* Construct an error message describing exhausted budget "budget"
+ * in the per-thread state "local" and return a pointer to it.
+ * The message is kept in "local" such that it remains valid
+ * as long as it may be referred to by the error state of the thread.
+ */
+static const char *budget_msg(struct isl_ctx_local *local,
+	struct isl_budget *budget)
+{
+	int kind = isl_atomic_get(&budget->exhausted);
+
+	snprintf(local->budget_msg, sizeof(local->budget_msg),
+		"%s budget of budget scope %d exceeded",
+		kind == isl_budget_time ? "time" : "operation", budget->depth);
+	return local->budget_msg;
+}
+
+/* Charge an operation to "budget" and all its outer budgets
+ * on behalf of the thread with per-thread state "local".
+ * Return isl_stat_error if any of them has been exhausted.
+ * An error is only reported by the operation that exhausts a budget.
+ * The error message identifies the budget by its depth on the stack,
+ * with budget scope 1 referring to the outermost budget,
+ * and by the kind of limit that was exceeded.
+ * Any subsequent operation performed within the exhausted budget
+ * fails silently with the same error type and message,
+ * until the budget is popped.
+ */
+static isl_stat charge_budget(isl_ctx *ctx, struct isl_ctx_local *local,
+	struct isl_budget *budget)
+{
+	unsigned long operations;
+	enum isl_budget_kind kind;
+
+	for (; budget; budget = budget->outer) {
+		if (isl_atomic_get(&budget->exhausted) != isl_budget_none)
+			goto exhausted;
+		operations = isl_atomic_inc(&budget->operations);
+		kind = isl_budget_none;
+		if (budget->max_operations &&
+		    operations > budget->max_operations)
+			kind = isl_budget_operations;
+		else if (budget->deadline &&
+		    operations % ISL_BUDGET_TIME_INTERVAL == 0 &&
+		    isl_time_ns() >= budget->deadline)
+			kind = isl_budget_time;
+		if (kind == isl_budget_none)
+			continue;
+		if (!set_exhausted(budget, kind))
+			goto exhausted;
+		isl_die(ctx, isl_error_quota, budget_msg(local, budget),
+			return isl_stat_error);
+	}
+
+	return isl_stat_ok;
+exhausted:
+	isl_ctx_set_full_error(ctx, isl_error_quota,
+				budget_msg(local, budget), NULL, -1);
+	return isl_stat_error;
+}
+
 /* Check that the result of an allocation ("p") is not NULL and
  * complain if it is.
  * The only exception is when allocation size ("size") is equal to zero.
@@ -42,6 +184,8 @@ static void *check_non_null(isl_ctx *ctx, void *p, size_t size)
  */
 int isl_ctx_next_operation(isl_ctx *ctx)
 {
+	struct isl_ctx_local *local;
+
 	if (!ctx)
 		return -1;
 	if (ctx->abort) {
@@ -51,7 +195,38 @@ int isl_ctx_next_operation(isl_ctx *ctx)
 	if (ctx->max_operations && ctx->operations >= ctx->max_operations)
 		isl_die(ctx, isl_error_quota,
 			"maximal number of operations exceeded", return -1);
-	ctx->operations++;
+	local = isl_ctx_local(ctx);
+	if (local && local->budget &&
+	    charge_budget(ctx, local, local->budget) < 0)
+		return -1;
+	isl_atomic_inc(&ctx->operations);
+	isl_profile_count(ctx, isl_profile_operations);
+	return 0;
+}
+
+/* Charge a unit of work that is not counted as an operation
+ * to the budgets of the current thread, if any.
+ * Return 0 if the work may be performed and
+ * return -1 if the computation should be aborted.
+ *
+ * Unlike isl_ctx_next_operation, this function does not increment
+ * the number of operations of "ctx" and is therefore not affected by
+ * (and does not affect) the bound set by isl_ctx_set_max_operations.
+ */
+int isl_ctx_charge_budget(isl_ctx *ctx)
+{
+	struct isl_ctx_local *local;
+
+	if (!ctx)
+		return -1;
+	if (ctx->abort) {
+		isl_ctx_set_error(ctx, isl_error_abort);
+		return -1;
+	}
+	local = isl_ctx_local(ctx);
+	if (local && local->budget &&
+	    charge_budget(ctx, local, local->budget) < 0)
+		return -1;
 	return 0;
 }
 
@@ -91,12 +266,17 @@ void *isl_realloc_or_die(isl_ctx *ctx, void *ptr, size_t size)
 void isl_ctx_set_full_error(isl_ctx *ctx, enum isl_error error, const char *msg,
 	const char *file, int line)
 {
+	struct isl_ctx_local *local;
+
 	if (!ctx)
 		return;
-	ctx->error = error;
-	ctx->error_msg = msg;
-	ctx->error_file = file;
-	ctx->error_line = line;
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return;
+	local->error = error;
+	local->error_msg = msg;
+	local->error_file = file;
+	local->error_line = line;
 }
 
 void isl_handle_error(isl_ctx *ctx, enum isl_error error, const char *msg,
@@ -120,6 +300,138 @@ void isl_handle_error(isl_ctx *ctx, enum isl_error error, const char *msg,
 	}
 }
 
+/* Reset the error information in the per-thread state "local".
+ */
+static void local_reset_error(struct isl_ctx_local *local)
+{
+	local->error = isl_error_none;
+	local->error_msg = NULL;
+	local->error_file = NULL;
+	local->error_line = -1;
+}
+
+/* Initialize the per-thread state "local".
+ */
+static void local_init(struct isl_ctx_local *local)
+{
+	isl_int_init(local->normalize_gcd);
+	memset(local->blk_pool, 0, sizeof(local->blk_pool));
+	local->blk_cached = 0;
+	local->blk_hits = 0;
+	local->blk_misses = 0;
+	local->in_parallel = 0;
+	local->profile = NULL;
+	local->n_promotion = isl_int_n_promotion();
+	local->budget = NULL;
+	local->next = NULL;
+	local_reset_error(local);
+}
+
+/* Free all memory held by the per-thread state "local",
+ * but not "local" itself.
+ */
+static void local_clear(struct isl_ctx_local *local)
+{
+	struct isl_budget *budget, *outer;
+
+	for (budget = local->budget; budget; budget = outer) {
+		outer = budget->outer;
+		free(budget);
+	}
+	isl_blk_clear_cache(local);
+	isl_int_clear(local->normalize_gcd);
+}
+
+#ifdef USE_THREADS
+/* Mark the per-thread state "local" as no longer being used
+ * by any thread.
+ * This is called when a thread that used a concurrent isl_ctx exits.
+ */
+static void release_local(void *user)
+{
+	struct isl_ctx_local *local = user;
+
+	pthread_mutex_lock(&local->ctx->local_lock);
+	local->in_use = 0;
+	pthread_mutex_unlock(&local->ctx->local_lock);
+}
+#endif
+
+#ifdef USE_THREADS
+/* Look for a per-thread state of "ctx" that is not currently
+ * assigned to any thread and assign it to the current thread.
+ * Return NULL if there is no such state.
+ * The conversions of integers from small to big representation
+ * are counted separately for each thread, so the number
+ * that have already been attributed is reset to that of the current thread.
+ */
+static struct isl_ctx_local *reuse_local(isl_ctx *ctx)
+{
+	struct isl_ctx_local *local;
+
+	pthread_mutex_lock(&ctx->local_lock);
+	for (local = ctx->local.next; local; local = local->next)
+		if (!local->in_use)
+			break;
+	if (local) {
+		local->in_use = 1;
+		local->n_promotion = isl_int_n_promotion();
+	}
+	pthread_mutex_unlock(&ctx->local_lock);
+
+	return local;
+}
+
+/* Return the per-thread state of the concurrent "ctx"
+ * for the current thread, assigning it one if this is the first time
+ * the current thread uses "ctx".
+ * Return NULL if the state could not be allocated.
+ *
+ * The state of a thread that has exited is reused if possible
+ * such that the number of states does not keep on growing
+ * when short-lived threads use "ctx".
+ * Otherwise, a new state is allocated.
+ * The state is not allocated through isl_alloc_type since
+ * an allocation failure would then be reported
+ * through the very state that is being allocated.
+ */
+struct isl_ctx_local *isl_ctx_thread_local(isl_ctx *ctx)
+{
+	struct isl_ctx_local *local;
+
+	local = pthread_getspecific(ctx->local_key);
+	if (local)
+		return local;
+
+	local = reuse_local(ctx);
+	if (local) {
+		if (pthread_setspecific(ctx->local_key, local) == 0)
+			return local;
+		release_local(local);
+		return NULL;
+	}
+
+	local = __isl_calloc_type(struct isl_ctx_local);
+	if (!local)
+		return NULL;
+	local_init(local);
+	local->ctx = ctx;
+	local->in_use = 1;
+	if (pthread_setspecific(ctx->local_key, local) != 0) {
+		local_clear(local);
+		free(local);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&ctx->local_lock);
+	local->next = ctx->local.next;
+	ctx->local.next = local;
+	pthread_mutex_unlock(&ctx->local_lock);
+
+	return local;
+}
+#endif
+
 static struct isl_options *find_nested_options(struct isl_args *args,
 	void *opt, struct isl_args *wanted)
 {
@@ -211,12 +523,14 @@ isl_ctx *isl_ctx_alloc_with_options(struct isl_args *args, void *user_opt)
 	isl_int_init(ctx->negone);
 	isl_int_set_si(ctx->negone, -1);
 
-	isl_int_init(ctx->normalize_gcd);
+	local_init(&ctx->local);
+	ctx->local.ctx = ctx;
+	ctx->local.in_use = 1;
 
-	ctx->n_cached = 0;
-	ctx->n_miss = 0;
-
-	isl_ctx_reset_error(ctx);
+	ctx->memo = NULL;
+	ctx->ast_cache = NULL;
+	ctx->profile = NULL;
+	ctx->arena = NULL;
 
 	ctx->operations = 0;
 	isl_ctx_set_max_operations(ctx, ctx->opt->max_operations);
@@ -241,44 +555,127 @@ struct isl_ctx *isl_ctx_alloc()
 
 void isl_ctx_ref(struct isl_ctx *ctx)
 {
-	ctx->ref++;
+	isl_atomic_inc(&ctx->ref);
 }
 
 void isl_ctx_deref(struct isl_ctx *ctx)
 {
-	isl_assert(ctx, ctx->ref > 0, return);
-	ctx->ref--;
+	isl_assert(ctx, isl_atomic_get(&ctx->ref) > 0, return);
+	isl_atomic_dec(&ctx->ref);
+}
+
+/* Allow "ctx" to be used by several threads at the same time.
+ * This is only possible in builds with thread support and
+ * should be done before "ctx" is used by any other thread.
+ * The calling thread keeps using the per-thread state
+ * that has been used by "ctx" so far.
+ */
+isl_stat isl_ctx_enable_concurrency(isl_ctx *ctx)
+{
+	if (!ctx)
+		return isl_stat_error;
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		return isl_stat_ok;
+	if (isl_arena_in_use(ctx))
+		isl_die(ctx, isl_error_invalid,
+			"cannot enable concurrency while arena is in use",
+			return isl_stat_error);
+	if (pthread_key_create(&ctx->local_key, &release_local) != 0)
+		isl_die(ctx, isl_error_unknown,
+			"unable to create thread-specific key",
+			return isl_stat_error);
+	if (pthread_setspecific(ctx->local_key, &ctx->local) != 0)
+		goto error;
+	if (pthread_mutex_init(&ctx->local_lock, NULL) != 0)
+		goto error;
+	if (pthread_mutex_init(&ctx->lock, NULL) != 0) {
+		pthread_mutex_destroy(&ctx->local_lock);
+		goto error;
+	}
+	ctx->concurrent = 1;
+	return isl_stat_ok;
+error:
+	pthread_key_delete(ctx->local_key);
+	isl_die(ctx, isl_error_unknown,
+		"unable to initialize concurrent isl_ctx",
+		return isl_stat_error);
+#else
+	isl_die(ctx, isl_error_unsupported,
+		"isl was built without thread support", return isl_stat_error);
+#endif
+}
+
+/* Can "ctx" be used by several threads at the same time?
+ */
+isl_bool isl_ctx_is_concurrent(isl_ctx *ctx)
+{
+	if (!ctx)
+		return isl_bool_error;
+#ifdef USE_THREADS
+	return ctx->concurrent;
+#else
+	return isl_bool_false;
+#endif
 }
 
-/* Print statistics on usage.
+#ifdef USE_THREADS
+/* Stop the threads in the worker pool of the concurrent "ctx", if any, and
+ * free the per-thread states of threads other than
+ * the one that allocated "ctx", along with
+ * the synchronization primitives.
+ * The threads in the pool need to be stopped first since
+ * they release their per-thread states when they exit.
  */
-static void print_stats(isl_ctx *ctx)
+static void clear_concurrent(isl_ctx *ctx)
 {
-	fprintf(stderr, "operations: %lu\n", ctx->operations);
+	struct isl_ctx_local *local, *next;
+
+	if (!ctx->concurrent)
+		return;
+
+	isl_parallel_pool_free(ctx->parallel_pool);
+	ctx->parallel_pool = NULL;
+	for (local = ctx->local.next; local; local = next) {
+		next = local->next;
+		local_clear(local);
+		free(local);
+	}
+	ctx->local.next = NULL;
+	pthread_key_delete(ctx->local_key);
+	pthread_mutex_destroy(&ctx->local_lock);
+	pthread_mutex_destroy(&ctx->lock);
+	ctx->concurrent = 0;
 }
+#endif
 
 void isl_ctx_free(struct isl_ctx *ctx)
 {
 	if (!ctx)
 		return;
+	if (ctx->opt->print_stats)
+		isl_profile_print_stats(ctx, stderr);
+	isl_ctx_reset_memo(ctx);
+	isl_ctx_reset_ast_cache(ctx);
 	if (ctx->ref != 0)
 		isl_die(ctx, isl_error_invalid,
 			"isl_ctx freed, but some objects still reference it",
 			return);
 
-	if (ctx->opt->print_stats)
-		print_stats(ctx);
-
 	isl_hash_table_clear(&ctx->id_table);
-	isl_blk_clear_cache(ctx);
+#ifdef USE_THREADS
+	clear_concurrent(ctx);
+#endif
+	local_clear(&ctx->local);
+	isl_arena_release(ctx->arena);
 	isl_int_clear(ctx->zero);
 	isl_int_clear(ctx->one);
 	isl_int_clear(ctx->two);
 	isl_int_clear(ctx->negone);
-	isl_int_clear(ctx->normalize_gcd);
 	isl_args_free(ctx->user_args, ctx->user_opt);
 	if (ctx->opt_allocated)
 		isl_options_free(ctx->opt);
+	isl_profile_free(ctx->profile);
 	free(ctx->stats);
 	free(ctx);
 }
@@ -290,40 +687,59 @@ struct isl_options *isl_ctx_options(isl_ctx *ctx)
 	return ctx->opt;
 }
 
+/* Return the last error in "ctx" that occurred in the current thread.
+ * If the per-thread state could not even be allocated,
+ * then report an allocation failure.
+ */
 enum isl_error isl_ctx_last_error(isl_ctx *ctx)
 {
-	return ctx ? ctx->error : isl_error_invalid;
+	struct isl_ctx_local *local;
+
+	if (!ctx)
+		return isl_error_invalid;
+	local = isl_ctx_local(ctx);
+	return local ? local->error : isl_error_alloc;
 }
 
 /* Return the error message of the last error in "ctx".
  */
 const char *isl_ctx_last_error_msg(isl_ctx *ctx)
 {
-	return ctx ? ctx->error_msg : NULL;
+	struct isl_ctx_local *local;
+
+	local = ctx ? isl_ctx_local(ctx) : NULL;
+	return local ? local->error_msg : NULL;
 }
 
 /* Return the file name where the last error in "ctx" occurred.
  */
 const char *isl_ctx_last_error_file(isl_ctx *ctx)
 {
-	return ctx ? ctx->error_file : NULL;
+	struct isl_ctx_local *local;
+
+	local = ctx ? isl_ctx_local(ctx) : NULL;
+	return local ? local->error_file : NULL;
 }
 
 /* Return the line number where the last error in "ctx" occurred.
  */
 int isl_ctx_last_error_line(isl_ctx *ctx)
 {
-	return ctx ? ctx->error_line : -1;
+	struct isl_ctx_local *local;
+
+	local = ctx ? isl_ctx_local(ctx) : NULL;
+	return local ? local->error_line : -1;
 }
 
 void isl_ctx_reset_error(isl_ctx *ctx)
 {
+	struct isl_ctx_local *local;
+
 	if (!ctx)
 		return;
-	ctx->error = isl_error_none;
-	ctx->error_msg = NULL;
-	ctx->error_file = NULL;
-	ctx->error_line = -1;
+	local = isl_ctx_local(ctx);
+	if (local)
+		local_reset_error(local);
 }
 
 void isl_ctx_set_error(isl_ctx *ctx, enum isl_error error)
@@ -379,3 +795,73 @@ void isl_ctx_reset_operations(isl_ctx *ctx)
 		return;
 	ctx->operations = 0;
 }
+
+/* Push a budget of at most "max_operations" operations and
+ * at most "max_seconds" seconds of wall clock time onto the stack
+ * of budgets of the current thread.
+ * A value of zero means that the corresponding quantity is not limited.
+ *
+ * While the budget is on the stack, every operation performed
+ * by the current thread (and by any threads performing tasks
+ * on its behalf) is charged to the budget as well as
+ * to all budgets that were pushed earlier.
+ * As soon as any of these budgets is exhausted, the operation fails
+ * with an isl_error_quota error and so does every subsequent operation
+ * until the exhausted budget has been popped.
+ */
+isl_stat isl_ctx_push_budget(isl_ctx *ctx, unsigned long max_operations,
+	double max_seconds)
+{
+	struct isl_ctx_local *local;
+	struct isl_budget *budget;
+
+	if (!ctx)
+		return isl_stat_error;
+	if (max_seconds < 0)
+		isl_die(ctx, isl_error_invalid, "negative time budget",
+			return isl_stat_error);
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return isl_stat_error;
+	budget = isl_calloc_type(ctx, struct isl_budget);
+	if (!budget)
+		return isl_stat_error;
+
+	budget->max_operations = max_operations;
+	if (max_seconds > 0)
+		budget->deadline = isl_time_ns() +
+					(uint64_t) (max_seconds * 1e9);
+	budget->outer = local->budget;
+	budget->depth = budget->outer ? budget->outer->depth + 1 : 1;
+	local->budget = budget;
+
+	return isl_stat_ok;
+}
+
+/* Pop the innermost budget from the stack of budgets of the current thread,
+ * which should have been pushed by the same thread.
+ * Return isl_bool_true if this budget has been exhausted.
+ * The error state of "ctx" is not affected.
+ */
+isl_bool isl_ctx_pop_budget(isl_ctx *ctx)
+{
+	struct isl_ctx_local *local;
+	struct isl_budget *budget;
+	int exhausted;
+
+	if (!ctx)
+		return isl_bool_error;
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return isl_bool_error;
+	budget = local->budget;
+	if (!budget)
+		isl_die(ctx, isl_error_invalid, "no budget to pop",
+			return isl_bool_error);
+
+	local->budget = budget->outer;
+	exhausted = isl_atomic_get(&budget->exhausted) != isl_budget_none;
+	free(budget);
+
+	return exhausted ? isl_bool_true : isl_bool_false;
+}
@@ -1,12 +1,104 @@
+#ifndef ISL_CTX_PRIVATE_H
+#define ISL_CTX_PRIVATE_H
+
 #include <isl/ctx.h>
 #include <isl_blk.h>
 
-/* "error" stores the last error that has occurred.
+#include <stdint.h>
+
+#ifdef USE_THREADS
+#include <pthread.h>
+#endif
+
+struct isl_profile_node;
+struct isl_budget;
+struct isl_arena;
+struct isl_parallel_pool;
+
+/* The part of the state of an isl_ctx that is modified
+ * by nearly every operation and that is therefore kept
+ * separately for each thread in a concurrent isl_ctx.
+ *
+ * "normalize_gcd" is scratch space for computing gcds.
+ * "blk_pool" contains the cached isl_blk blocks, one pool per size class,
+ * while "blk_cached" is the total size (in bytes) of the cached blocks.
+ * "blk_hits" and "blk_misses" count the number of block allocations
+ * that could and could not be served from the cache.
+ * "error" stores the last error that has occurred.
  * It is reset to isl_error_none by isl_ctx_reset_error.
  * "error_msg" stores the error message of the last error,
  * while "error_file" and "error_line" specify where the last error occurred.
  * "error_msg" and "error_file" always point to statically allocated
- * strings (if not NULL).
+ * strings or to "budget_msg" (if not NULL).
+ * "budget_msg" holds the error message describing an exhausted budget.
+ * "in_parallel" is set while the thread is performing tasks
+ * on behalf of isl_parallel_for.
+ * "profile" is the innermost profiled operation of the thread, if any.
+ * "n_promotion" is the number of conversions of integers
+ * from small to big representation performed by the thread
+ * that have already been attributed to a profiled operation,
+ * see isl_profile_sync.
+ * "budget" is the innermost budget that applies to the thread, if any.
+ * "next" links together the per-thread states of a concurrent isl_ctx.
+ * "ctx" is the isl_ctx to which the state belongs, while "in_use"
+ * is set if the state is currently assigned to some thread.
+ * The state of a thread that exits is kept around for use
+ * by the next thread that starts using the isl_ctx.
+ */
+struct isl_ctx_local {
+	isl_int			normalize_gcd;
+
+	struct isl_blk_pool	blk_pool[ISL_BLK_N_CLASS];
+	size_t			blk_cached;
+	unsigned long		blk_hits;
+	unsigned long		blk_misses;
+
+	enum isl_error		error;
+	const char		*error_msg;
+	const char		*error_file;
+	int			error_line;
+	char			budget_msg[64];
+
+	int			in_parallel;
+
+	struct isl_profile_node	*profile;
+	unsigned long		n_promotion;
+	struct isl_budget	*budget;
+
+	struct isl_ctx_local	*next;
+	struct isl_ctx		*ctx;
+	int			in_use;
+};
+
+/* "local" is the per-thread state of the thread that allocated the isl_ctx
+ * and the only such state if the isl_ctx is not concurrent.
+ *
+ * If "concurrent" is set, then the isl_ctx may be used by several
+ * threads at the same time.  Each thread then has its own copy
+ * of the per-thread state, which can be retrieved through "local_key".
+ * The states of threads other than the one that allocated the isl_ctx
+ * are kept in the list starting at "local.next", which is protected
+ * by "local_lock".
+ * "lock" protects the shared state of the isl_ctx, in particular "id_table"
+ * and "memo".
+ * "parallel_pool" contains the threads used by isl_parallel_for.
+ * It is only allocated when it is first used.
+ *
+ * "memo" is the memo table with the results of selected operations.
+ * It is only allocated when it is first used.
+ *
+ * "ast_cache" caches ASTs generated for schedule subtrees.
+ * It is only allocated when it is first used and
+ * it is protected by its own lock rather than by "lock".
+ *
+ * "profile" is the root of the tree of profiled operations.
+ * It is only allocated when the first profiled operation is performed
+ * while the print_stats option is set.
+ * The innermost profiled operation of a thread is kept
+ * in the "profile" field of its per-thread state.
+ *
+ * "arena" keeps track of the memory allocated inside arena scopes.
+ * It is only allocated when the first arena scope is entered.
  */
 struct isl_ctx {
 	int			ref;
@@ -23,22 +115,132 @@ struct isl_ctx {
 	isl_int			two;
 	isl_int			negone;
 
-	isl_int			normalize_gcd;
-
-	int			n_cached;
-	int			n_miss;
-	struct isl_blk		cache[ISL_BLK_CACHE_SIZE];
+	struct isl_ctx_local	local;
 	struct isl_hash_table	id_table;
 
-	enum isl_error		error;
-	const char		*error_msg;
-	const char		*error_file;
-	int			error_line;
+#ifdef USE_THREADS
+	int			concurrent;
+	pthread_key_t		local_key;
+	pthread_mutex_t		local_lock;
+	pthread_mutex_t		lock;
+	struct isl_parallel_pool	*parallel_pool;
+#endif
 
 	int			abort;
 
+	struct isl_memo		*memo;
+	struct isl_ast_cache	*ast_cache;
+
+	struct isl_profile_node	*profile;
+
+	struct isl_arena	*arena;
+
 	unsigned long		operations;
 	unsigned long		max_operations;
 };
 
+/* Atomically increment or decrement the integer pointed to by "p"
+ * or add "v" to it and return the new value.
+ * In builds with thread support, this is used for updating
+ * reference counts and statistics such that they remain accurate
+ * when objects are shared between threads.
+ * isl_atomic_get reads the integer pointed to by "p", such that
+ * a reference count that is found to be one also guarantees
+ * that all accesses through references that have been dropped
+ * by other threads have been completed.
+ */
+#ifdef USE_THREADS
+#define isl_atomic_inc(p)	__atomic_add_fetch(p, 1, __ATOMIC_RELAXED)
+#define isl_atomic_dec(p)	__atomic_sub_fetch(p, 1, __ATOMIC_ACQ_REL)
+#define isl_atomic_add(p, v)	__atomic_add_fetch(p, v, __ATOMIC_RELAXED)
+#define isl_atomic_get(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#else
+#define isl_atomic_inc(p)	(++*(p))
+#define isl_atomic_dec(p)	(--*(p))
+#define isl_atomic_add(p, v)	(*(p) += (v))
+#define isl_atomic_get(p)	(*(p))
+#endif
+
+#ifdef USE_THREADS
+struct isl_ctx_local *isl_ctx_thread_local(isl_ctx *ctx);
+#endif
+
+/* Return the per-thread state of "ctx" for the current thread,
+ * or NULL if it could not be allocated.
+ */
+static inline struct isl_ctx_local *isl_ctx_local(isl_ctx *ctx)
+{
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		return isl_ctx_thread_local(ctx);
+#endif
+	return &ctx->local;
+}
+
+/* Acquire the lock on the shared state of "ctx",
+ * if "ctx" may be used by several threads at the same time.
+ */
+static inline void isl_ctx_lock(isl_ctx *ctx)
+{
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		pthread_mutex_lock(&ctx->lock);
+#endif
+}
+
+/* Release the lock acquired by isl_ctx_lock.
+ */
+static inline void isl_ctx_unlock(isl_ctx *ctx)
+{
+#ifdef USE_THREADS
+	if (ctx->concurrent)
+		pthread_mutex_unlock(&ctx->lock);
+#endif
+}
+
+/* Can "ctx" be used by several threads at the same time?
+ */
+static inline int isl_ctx_concurrent(isl_ctx *ctx)
+{
+#ifdef USE_THREADS
+	return ctx->concurrent;
+#else
+	return 0;
+#endif
+}
+
+/* Is it safe to update information that is cached inside an object
+ * of "ctx" with reference count "*ref" without changing the meaning
+ * of the object, given that the caller owns one of the references
+ * (i.e., the object was passed as __isl_take)?
+ * In a concurrent isl_ctx, an object that is referenced more than once
+ * may be accessed by other threads at the same time.
+ */
+static inline int isl_ctx_may_update_shared(isl_ctx *ctx, int *ref)
+{
+	if (isl_ctx_concurrent(ctx))
+		return isl_atomic_get(ref) == 1;
+	return 1;
+}
+
+/* Is it safe to update information that is cached inside an object
+ * of "ctx" that the caller does not own (i.e., the object
+ * was passed as __isl_keep)?
+ * In a concurrent isl_ctx, such an object may be reachable
+ * from an object that is shared with other threads,
+ * even if it is only referenced once, so no information
+ * is ever stored inside it.
+ */
+static inline int isl_ctx_may_update_kept(isl_ctx *ctx)
+{
+	return !isl_ctx_concurrent(ctx);
+}
+
+void isl_ctx_set_full_error(isl_ctx *ctx, enum isl_error error, const char *msg,
+	const char *file, int line);
 int isl_ctx_next_operation(isl_ctx *ctx);
+int isl_ctx_charge_budget(isl_ctx *ctx);
+
+uint64_t isl_time_ns(void);
+
+#endif
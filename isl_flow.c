@@ -25,6 +25,9 @@
 #include <isl/flow.h>
 #include <isl/schedule_node.h>
 #include <isl_sort.h>
+#include <isl_options_private.h>
+#include <isl_parallel.h>
+#include <isl_profile_private.h>
 #include <isl/stream.h>
 
 enum isl_restriction_type {
@@ -2235,6 +2238,36 @@ error:
 	return NULL;
 }
 
+/* Add the dependences and the sink subsets without source in "part"
+ * to those in "flow".
+ */
+static __isl_give isl_union_flow *isl_union_flow_add(
+	__isl_take isl_union_flow *flow, __isl_take isl_union_flow *part)
+{
+	if (!flow || !part)
+		goto error;
+
+	flow->must_dep = isl_union_map_union(flow->must_dep,
+					isl_union_map_copy(part->must_dep));
+	flow->may_dep = isl_union_map_union(flow->may_dep,
+					isl_union_map_copy(part->may_dep));
+	flow->must_no_source = isl_union_map_union(flow->must_no_source,
+				isl_union_map_copy(part->must_no_source));
+	flow->may_no_source = isl_union_map_union(flow->may_no_source,
+				isl_union_map_copy(part->may_no_source));
+	isl_union_flow_free(part);
+
+	if (!flow->must_dep || !flow->may_dep ||
+	    !flow->must_no_source || !flow->may_no_source)
+		return isl_union_flow_free(flow);
+
+	return flow;
+error:
+	isl_union_flow_free(flow);
+	isl_union_flow_free(part);
+	return NULL;
+}
+
 /* Copy this isl_union_flow object.
  */
 __isl_give isl_union_flow *isl_union_flow_copy(__isl_keep isl_union_flow *flow)
@@ -2638,6 +2671,103 @@ static __isl_give isl_union_access_info *isl_union_access_info_normalize(
 	return access;
 }
 
+/* Internal data structure for compute_flow_union_map_parallel.
+ * "data" contains the sources that are shared by all sinks.
+ * "space" is the parameter space of the result,
+ * "sink" contains the "n" sink accesses and
+ * "flow" collects the dependences computed for each of them.
+ */
+struct isl_compute_flow_parallel_data {
+	struct isl_compute_flow_data *data;
+	isl_space *space;
+	int n;
+	isl_map **sink;
+	isl_union_flow **flow;
+};
+
+/* isl_union_map_foreach_map callback for compute_flow_union_map_parallel
+ * that appends "map" to data->sink.
+ */
+static isl_stat collect_sink(__isl_take isl_map *map, void *user)
+{
+	struct isl_compute_flow_parallel_data *data = user;
+
+	data->sink[data->n++] = map;
+
+	return isl_stat_ok;
+}
+
+/* isl_parallel_for callback for compute_flow_union_map_parallel.
+ * Compute the dependences of the sink at position "i"
+ * in a separate isl_union_flow, using a private copy
+ * of the shared isl_compute_flow_data.
+ */
+static isl_stat compute_flow_task(int i, void *user)
+{
+	struct isl_compute_flow_parallel_data *data = user;
+	struct isl_compute_flow_data task = *data->data;
+	isl_stat r;
+
+	task.flow = isl_union_flow_alloc(isl_space_copy(data->space));
+	if (!task.flow)
+		return isl_stat_error;
+	r = compute_flow(isl_map_copy(data->sink[i]), &task);
+	data->flow[i] = task.flow;
+
+	return r;
+}
+
+/* Compute the dependences for each sink access in "sink"
+ * in parallel and add them to data->flow.
+ *
+ * The dependences of each sink are first computed separately and
+ * are only added to data->flow once all of them have been computed,
+ * in the order in which isl_union_map_foreach_map visits the sinks.
+ * The result therefore does not depend on the order in which
+ * the sinks happen to be handled by the different threads.
+ */
+static isl_stat compute_flow_union_map_parallel(__isl_keep isl_union_map *sink,
+	struct isl_compute_flow_data *data)
+{
+	isl_ctx *ctx = isl_union_map_get_ctx(sink);
+	int i, n;
+	isl_stat r = isl_stat_ok;
+	struct isl_compute_flow_parallel_data par = { data };
+
+	if (!data->flow)
+		return isl_stat_error;
+	n = isl_union_map_n_map(sink);
+	if (n < 0)
+		return isl_stat_error;
+	par.space = isl_union_map_get_space(data->flow->must_dep);
+	par.sink = isl_calloc_array(ctx, isl_map *, n);
+	par.flow = isl_calloc_array(ctx, isl_union_flow *, n);
+	if (!par.space || (n && (!par.sink || !par.flow)))
+		r = isl_stat_error;
+	if (r >= 0)
+		r = isl_union_map_foreach_map(sink, &collect_sink, &par);
+	if (r >= 0)
+		r = isl_parallel_for(ctx, n, &compute_flow_task, &par);
+	for (i = 0; r >= 0 && i < n; ++i) {
+		data->flow = isl_union_flow_add(data->flow, par.flow[i]);
+		par.flow[i] = NULL;
+		if (!data->flow)
+			r = isl_stat_error;
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (par.sink)
+			isl_map_free(par.sink[i]);
+		if (par.flow)
+			isl_union_flow_free(par.flow[i]);
+	}
+	free(par.sink);
+	free(par.flow);
+	isl_space_free(par.space);
+
+	return r;
+}
+
 /* Given a description of the "sink" accesses, the "source" accesses and
  * a schedule, compute for each instance of a sink access
  * and for each element accessed by that instance,
@@ -2656,12 +2786,17 @@ static __isl_give isl_union_access_info *isl_union_access_info_normalize(
  * We first prepend the schedule dimensions to the domain
  * of the accesses so that we can easily compare their relative order.
  * Then we consider each sink access individually in compute_flow.
+ * If the flow_parallel option is set and if the sinks can be handled
+ * by several threads, then this is done in
+ * compute_flow_union_map_parallel.
  */
 static __isl_give isl_union_flow *compute_flow_union_map(
 	__isl_take isl_union_access_info *access)
 {
+	isl_ctx *ctx;
 	struct isl_compute_flow_data data;
 	isl_union_map *sink;
+	isl_stat r;
 
 	access = isl_union_access_info_align_params(access);
 	access = isl_union_access_info_introduce_schedule(access);
@@ -2674,7 +2809,13 @@ static __isl_give isl_union_flow *compute_flow_union_map(
 	sink = access->access[isl_access_sink];
 	data.flow = isl_union_flow_alloc(isl_union_map_get_space(sink));
 
-	if (isl_union_map_foreach_map(sink, &compute_flow, &data) < 0)
+	ctx = isl_union_access_info_get_ctx(access);
+	if (ctx->opt->flow_parallel &&
+	    isl_parallel_n_threads(ctx, isl_union_map_n_map(sink)) > 1)
+		r = compute_flow_union_map_parallel(sink, &data);
+	else
+		r = isl_union_map_foreach_map(sink, &compute_flow, &data);
+	if (r < 0)
 		goto error;
 
 	data.flow = isl_union_flow_drop_schedule(data.flow);
@@ -3079,6 +3220,76 @@ static __isl_give isl_union_flow *compute_single_flow(
 	return uf;
 }
 
+/* Internal data structure for compute_flow_schedule_parallel.
+ * "data" contains the scheduled sinks and sources,
+ * "space" is the parameter space of the result and
+ * "flow" collects the dependences computed for each sink.
+ */
+struct isl_compute_flow_schedule_parallel_data {
+	struct isl_compute_flow_schedule_data *data;
+	isl_space *space;
+	isl_union_flow **flow;
+};
+
+/* isl_parallel_for callback for compute_flow_schedule_parallel.
+ * Compute the dependences of the sink at position "i"
+ * in a separate isl_union_flow.
+ */
+static isl_stat compute_single_flow_task(int i, void *user)
+{
+	struct isl_compute_flow_schedule_parallel_data *data = user;
+	isl_union_flow *flow;
+
+	flow = isl_union_flow_alloc(isl_space_copy(data->space));
+	data->flow[i] = compute_single_flow(flow, &data->data->sink[i],
+					    data->data);
+
+	return data->flow[i] ? isl_stat_ok : isl_stat_error;
+}
+
+/* Compute the dependences for each of the scheduled sinks in "data"
+ * in parallel and add them to "flow".
+ *
+ * The dependences of each sink are first computed separately and
+ * are only added to "flow" once all of them have been computed,
+ * in the order of the sinks in "data".
+ * The result therefore does not depend on the order in which
+ * the sinks happen to be handled by the different threads.
+ */
+static __isl_give isl_union_flow *compute_flow_schedule_parallel(
+	__isl_take isl_union_flow *flow,
+	struct isl_compute_flow_schedule_data *data)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_stat r;
+	struct isl_compute_flow_schedule_parallel_data par = { data };
+
+	if (!flow)
+		return NULL;
+
+	ctx = isl_union_flow_get_ctx(flow);
+	par.space = isl_union_map_get_space(flow->must_dep);
+	par.flow = isl_calloc_array(ctx, isl_union_flow *, data->n_sink);
+	r = par.space && par.flow ? isl_stat_ok : isl_stat_error;
+	if (r >= 0)
+		r = isl_parallel_for(ctx, data->n_sink,
+				    &compute_single_flow_task, &par);
+	if (r < 0)
+		flow = isl_union_flow_free(flow);
+	for (i = 0; flow && i < data->n_sink; ++i) {
+		flow = isl_union_flow_add(flow, par.flow[i]);
+		par.flow[i] = NULL;
+	}
+
+	for (i = 0; par.flow && i < data->n_sink; ++i)
+		isl_union_flow_free(par.flow[i]);
+	free(par.flow);
+	isl_space_free(par.space);
+
+	return flow;
+}
+
 /* Given a description of the "sink" accesses, the "source" accesses and
  * a schedule, compute for each instance of a sink access
  * and for each element accessed by that instance,
@@ -3099,6 +3310,8 @@ static __isl_give isl_union_flow *compute_single_flow(
  * We extract the individual scheduled source and sink access relations
  * (taking into account the domain of the schedule) and
  * then compute dependences for each scheduled sink individually.
+ * If the flow_parallel option is set and if the sinks can be handled
+ * by several threads, then this is done in compute_flow_schedule_parallel.
  */
 static __isl_give isl_union_flow *compute_flow_schedule(
 	__isl_take isl_union_access_info *access)
@@ -3134,8 +3347,12 @@ static __isl_give isl_union_flow *compute_flow_schedule(
 
 	isl_compute_flow_schedule_data_align_params(&data);
 
-	for (i = 0; i < data.n_sink; ++i)
-		flow = compute_single_flow(flow, &data.sink[i], &data);
+	if (ctx->opt->flow_parallel &&
+	    isl_parallel_n_threads(ctx, data.n_sink) > 1)
+		flow = compute_flow_schedule_parallel(flow, &data);
+	else
+		for (i = 0; i < data.n_sink; ++i)
+			flow = compute_single_flow(flow, &data.sink[i], &data);
 
 	isl_compute_flow_schedule_data_clear(&data);
 
@@ -3167,7 +3384,7 @@ error:
  * or a schedule map and call the corresponding function to perform
  * the analysis.
  */
-__isl_give isl_union_flow *isl_union_access_info_compute_flow(
+static __isl_give isl_union_flow *union_access_info_compute_flow(
 	__isl_take isl_union_access_info *access)
 {
 	isl_bool has_kill;
@@ -3199,6 +3416,27 @@ error:
 	return NULL;
 }
 
+/* Compute the dependences described by "access",
+ * profiling the operation if requested.
+ */
+__isl_give isl_union_flow *isl_union_access_info_compute_flow(
+	__isl_take isl_union_access_info *access)
+{
+	isl_ctx *ctx;
+	isl_union_flow *flow;
+	struct isl_profile_scope scope;
+
+	if (!access)
+		return NULL;
+
+	ctx = isl_union_access_info_get_ctx(access);
+	isl_profile_enter(ctx, "isl_union_access_info_compute_flow", &scope);
+	flow = union_access_info_compute_flow(access);
+	isl_profile_leave(ctx, &scope);
+
+	return flow;
+}
+
 /* Print the information contained in "flow" to "p".
  * The information is printed as a YAML document.
  */
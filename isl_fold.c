@@ -9,6 +9,7 @@
  */
 
 #define ISL_DIM_H
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_union_map_private.h>
 #include <isl_polynomial_private.h>
@@ -732,7 +733,7 @@ __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_copy(
 	if (!fold)
 		return NULL;
 
-	fold->ref++;
+	isl_atomic_inc(&fold->ref);
 	return fold;
 }
 
@@ -765,13 +766,16 @@ error:
 __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_cow(
 	__isl_take isl_qpolynomial_fold *fold)
 {
+	isl_qpolynomial_fold *dup;
+
 	if (!fold)
 		return NULL;
 
-	if (fold->ref == 1)
+	if (isl_atomic_get(&fold->ref) == 1)
 		return fold;
-	fold->ref--;
-	return isl_qpolynomial_fold_dup(fold);
+	dup = isl_qpolynomial_fold_dup(fold);
+	isl_qpolynomial_fold_free(fold);
+	return dup;
 }
 
 void isl_qpolynomial_fold_free(__isl_take isl_qpolynomial_fold *fold)
@@ -780,7 +784,7 @@ void isl_qpolynomial_fold_free(__isl_take isl_qpolynomial_fold *fold)
 
 	if (!fold)
 		return;
-	if (--fold->ref > 0)
+	if (isl_atomic_dec(&fold->ref) > 0)
 		return;
 
 	for (i = 0; i < fold->n; ++i)
@@ -96,11 +96,19 @@ static int isl_id_has_name_and_user(const void *entry, const void *val)
 	return !strcmp(id->name, nu->name);
 }
 
+/* Return an isl_id with the given name and user pointer,
+ * reusing an existing isl_id if there is one.
+ *
+ * In a concurrent isl_ctx, the lookup is performed while holding
+ * the lock on the shared state of "ctx" to prevent other threads
+ * from inserting or removing isl_ids at the same time.
+ */
 __isl_give isl_id *isl_id_alloc(isl_ctx *ctx, const char *name, void *user)
 {
 	struct isl_hash_table_entry *entry;
 	uint32_t id_hash;
 	struct isl_name_and_user nu = { name, user };
+	isl_id *id;
 
 	if (!ctx)
 		return NULL;
@@ -110,16 +118,21 @@ __isl_give isl_id *isl_id_alloc(isl_ctx *ctx, const char *name, void *user)
 		id_hash = isl_hash_string(id_hash, name);
 	else
 		id_hash = isl_hash_builtin(id_hash, user);
+	isl_ctx_lock(ctx);
 	entry = isl_hash_table_find(ctx, &ctx->id_table, id_hash,
 					isl_id_has_name_and_user, &nu, 1);
-	if (!entry)
-		return NULL;
-	if (entry->data)
-		return isl_id_copy(entry->data);
-	entry->data = id_alloc(ctx, name, user);
-	if (!entry->data)
-		ctx->id_table.n--;
-	return entry->data;
+	if (!entry) {
+		id = NULL;
+	} else if (entry->data) {
+		id = isl_id_copy(entry->data);
+	} else {
+		entry->data = id_alloc(ctx, name, user);
+		if (!entry->data)
+			ctx->id_table.n--;
+		id = entry->data;
+	}
+	isl_ctx_unlock(ctx);
+	return id;
 }
 
 /* If the id has a negative refcount, then it is a static isl_id
@@ -130,10 +143,10 @@ __isl_give isl_id *isl_id_copy(isl_id *id)
 	if (!id)
 		return NULL;
 
-	if (id->ref < 0)
+	if (isl_atomic_get(&id->ref) < 0)
 		return id;
 
-	id->ref++;
+	isl_atomic_inc(&id->ref);
 	return id;
 }
 
@@ -192,33 +205,45 @@ __isl_give isl_id *isl_id_set_free_user(__isl_take isl_id *id,
 
 /* If the id has a negative refcount, then it is a static isl_id
  * and should not be freed.
+ *
+ * The reference count is decremented while holding the lock
+ * on the shared state of the isl_ctx such that no other thread
+ * can obtain a new reference through isl_id_alloc
+ * between the moment the reference count drops to zero and
+ * the moment the isl_id is removed from the table.
  */
 __isl_null isl_id *isl_id_free(__isl_take isl_id *id)
 {
 	struct isl_hash_table_entry *entry;
+	isl_ctx *ctx;
 
 	if (!id)
 		return NULL;
 
-	if (id->ref < 0)
+	if (isl_atomic_get(&id->ref) < 0)
 		return NULL;
 
-	if (--id->ref > 0)
+	ctx = id->ctx;
+	isl_ctx_lock(ctx);
+	if (isl_atomic_dec(&id->ref) > 0) {
+		isl_ctx_unlock(ctx);
 		return NULL;
+	}
 
-	entry = isl_hash_table_find(id->ctx, &id->ctx->id_table, id->hash,
+	entry = isl_hash_table_find(ctx, &ctx->id_table, id->hash,
 					isl_id_eq, id, 0);
 	if (!entry)
-		isl_die(id->ctx, isl_error_unknown,
+		isl_die(ctx, isl_error_unknown,
 			"unable to find id", (void)0);
 	else
-		isl_hash_table_remove(id->ctx, &id->ctx->id_table, entry);
+		isl_hash_table_remove(ctx, &ctx->id_table, entry);
+	isl_ctx_unlock(ctx);
 
 	if (id->free_user)
 		id->free_user(id->user);
 
 	free((char *)id->name);
-	isl_ctx_deref(id->ctx);
+	isl_ctx_deref(ctx);
 	free(id);
 
 	return NULL;
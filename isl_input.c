@@ -542,18 +542,6 @@ error2:
 	return NULL;
 }
 
-static __isl_give isl_pw_aff *add_cst(__isl_take isl_pw_aff *pwaff, isl_int v)
-{
-	isl_aff *aff;
-	isl_space *space;
-
-	space = isl_pw_aff_get_domain_space(pwaff);
-	aff = isl_aff_zero_on_domain(isl_local_space_from_space(space));
-	aff = isl_aff_add_constant(aff, v);
-
-	return isl_pw_aff_add(pwaff, isl_pw_aff_from_aff(aff));
-}
-
 /* Return a piecewise affine expression defined on the specified domain
  * that represents NaN.
  */
@@ -565,17 +553,70 @@ static __isl_give isl_pw_aff *nan_on_domain(__isl_keep isl_space *space)
 	return isl_pw_aff_nan_on_domain(ls);
 }
 
+/* Is "tok" an identifier that refers to a variable in "v" and
+ * that appears as a plain term in an affine expression, i.e.,
+ * one that is not the first argument of a "%", "mod", "*" or "/"
+ * operation?
+ * If so, return the position of the variable.  Otherwise, return -1.
+ * In the latter case, the token may still be parsed
+ * by accept_affine_factor, which will then produce
+ * an appropriate error message if needed.
+ */
+static int plain_var_pos(__isl_keep isl_stream *s, struct isl_token *tok,
+	struct vars *v)
+{
+	int n = v->n;
+	int pos;
+
+	if (!tok || tok->type != ISL_TOKEN_IDENT)
+		return -1;
+	if (isl_stream_next_token_is(s, '%') ||
+	    isl_stream_next_token_is(s, ISL_TOKEN_MOD) ||
+	    isl_stream_next_token_is(s, '*') ||
+	    isl_stream_next_token_is(s, '/'))
+		return -1;
+	pos = vars_pos(v, tok->u.s, -1);
+	if (pos < 0 || pos >= n) {
+		vars_drop(v, v->n - n);
+		return -1;
+	}
+	return pos;
+}
+
+/* Add "term" to "res", where a NULL "res" represents
+ * the (not yet constructed) zero expression.
+ */
+static __isl_give isl_pw_aff *add_term(__isl_take isl_pw_aff *res,
+	__isl_take isl_pw_aff *term)
+{
+	if (!res)
+		return term;
+	return isl_pw_aff_add(res, term);
+}
+
+/* Read an affine expression from "s".
+ *
+ * Plain terms, i.e., constants, variables and
+ * constant multiples of variables, are accumulated directly
+ * in the coefficients of the affine expression "acc".
+ * Only the other terms are constructed as separate
+ * piecewise affine expressions and added to "res".
+ * This avoids constructing and adding a piecewise affine expression
+ * for every term in the common case of a plain affine expression.
+ */
 static __isl_give isl_pw_aff *accept_affine(__isl_keep isl_stream *s,
 	__isl_take isl_space *space, struct vars *v)
 {
 	struct isl_token *tok = NULL;
 	isl_local_space *ls;
-	isl_pw_aff *res;
+	isl_aff *acc;
+	isl_pw_aff *res = NULL;
 	int sign = 1;
+	int pos;
 
 	ls = isl_local_space_from_space(isl_space_copy(space));
-	res = isl_pw_aff_from_aff(isl_aff_zero_on_domain(ls));
-	if (!res)
+	acc = isl_aff_zero_on_domain(ls);
+	if (!acc)
 		goto error;
 
 	for (;;) {
@@ -589,7 +630,15 @@ static __isl_give isl_pw_aff *accept_affine(__isl_keep isl_stream *s,
 			isl_token_free(tok);
 			continue;
 		}
-		if (tok->type == '(' || is_start_of_div(tok) ||
+		if ((pos = plain_var_pos(s, tok, v)) >= 0) {
+			if (sign < 0)
+				isl_int_sub_ui(acc->v->el[2 + pos],
+						acc->v->el[2 + pos], 1);
+			else
+				isl_int_add_ui(acc->v->el[2 + pos],
+						acc->v->el[2 + pos], 1);
+			sign = 1;
+		} else if (tok->type == '(' || is_start_of_div(tok) ||
 		    tok->type == ISL_TOKEN_MIN || tok->type == ISL_TOKEN_MAX ||
 		    tok->type == ISL_TOKEN_IDENT ||
 		    tok->type == ISL_TOKEN_AFF) {
@@ -599,9 +648,8 @@ static __isl_give isl_pw_aff *accept_affine(__isl_keep isl_stream *s,
 			term = accept_affine_factor(s,
 						    isl_space_copy(space), v);
 			if (sign < 0)
-				res = isl_pw_aff_sub(res, term);
-			else
-				res = isl_pw_aff_add(res, term);
+				term = isl_pw_aff_neg(term);
+			res = add_term(res, term);
 			if (!res)
 				goto error;
 			sign = 1;
@@ -611,21 +659,37 @@ static __isl_give isl_pw_aff *accept_affine(__isl_keep isl_stream *s,
 			if (isl_stream_eat_if_available(s, '*') ||
 			    isl_stream_next_token_is(s, ISL_TOKEN_IDENT)) {
 				isl_pw_aff *term;
-				term = accept_affine_factor(s,
+				struct isl_token *tok2;
+
+				tok2 = isl_stream_next_token(s);
+				pos = plain_var_pos(s, tok2, v);
+				if (pos >= 0) {
+					isl_token_free(tok2);
+					isl_int_add(acc->v->el[2 + pos],
+						acc->v->el[2 + pos], tok->u.v);
+				} else {
+					if (tok2)
+						isl_stream_push_token(s, tok2);
+					term = accept_affine_factor(s,
 						    isl_space_copy(space), v);
-				term = isl_pw_aff_scale(term, tok->u.v);
-				res = isl_pw_aff_add(res, term);
-				if (!res)
-					goto error;
+					term = isl_pw_aff_scale(term, tok->u.v);
+					res = add_term(res, term);
+					if (!res)
+						goto error;
+				}
 			} else {
-				res = add_cst(res, tok->u.v);
+				isl_int_add(acc->v->el[1], acc->v->el[1],
+						tok->u.v);
 			}
 			sign = 1;
 		} else if (tok->type == ISL_TOKEN_NAN) {
-			res = isl_pw_aff_add(res, nan_on_domain(space));
+			res = add_term(res, nan_on_domain(space));
+			if (!res)
+				goto error;
 		} else {
 			isl_stream_error(s, tok, "unexpected isl_token");
 			isl_stream_push_token(s, tok);
+			isl_aff_free(acc);
 			isl_pw_aff_free(res);
 			isl_space_free(space);
 			return NULL;
@@ -650,10 +714,11 @@ static __isl_give isl_pw_aff *accept_affine(__isl_keep isl_stream *s,
 	}
 
 	isl_space_free(space);
-	return res;
+	return add_term(res, isl_pw_aff_from_aff(acc));
 error:
 	isl_space_free(space);
 	isl_token_free(tok);
+	isl_aff_free(acc);
 	isl_pw_aff_free(res);
 	return NULL;
 }
@@ -1505,6 +1570,74 @@ error:
 	return NULL;
 }
 
+/* If "pa" is a piecewise affine expression with a single piece
+ * defined over a universe domain and if this piece is not NaN,
+ * then return (a copy of) the affine expression of that piece.
+ * Otherwise, return NULL.
+ */
+static __isl_give isl_aff *plain_aff(__isl_keep isl_pw_aff *pa)
+{
+	isl_bool ok;
+
+	if (!pa || pa->n != 1)
+		return NULL;
+	ok = isl_set_plain_is_universe(pa->p[0].set);
+	if (ok == isl_bool_true)
+		ok = isl_bool_not(isl_aff_is_nan(pa->p[0].aff));
+	if (ok != isl_bool_true)
+		return NULL;
+	return isl_aff_copy(pa->p[0].aff);
+}
+
+/* Construct the constraint
+ *
+ *	a op b
+ *
+ * of type "type" where "left" and "right" each consist of
+ * a single element and where these elements are
+ * plain affine expressions, i.e., affine expressions
+ * without any case distinction.
+ * Return NULL if the constraint is not of this form.
+ *
+ * This is the common case in a textual representation and
+ * the constraint can then be constructed directly as a basic set,
+ * without passing through the piecewise affine expression machinery.
+ */
+static __isl_give isl_basic_set *plain_constraint(int type,
+	__isl_keep isl_pw_aff_list *left, __isl_keep isl_pw_aff_list *right)
+{
+	isl_pw_aff *pa;
+	isl_aff *a, *b;
+
+	if (type != ISL_TOKEN_LE && type != ISL_TOKEN_GE &&
+	    type != ISL_TOKEN_LT && type != ISL_TOKEN_GT && type != '=')
+		return NULL;
+	if (isl_pw_aff_list_n_pw_aff(left) != 1 ||
+	    isl_pw_aff_list_n_pw_aff(right) != 1)
+		return NULL;
+	pa = isl_pw_aff_list_get_pw_aff(left, 0);
+	a = plain_aff(pa);
+	isl_pw_aff_free(pa);
+	pa = isl_pw_aff_list_get_pw_aff(right, 0);
+	b = plain_aff(pa);
+	isl_pw_aff_free(pa);
+	if (!a || !b) {
+		isl_aff_free(a);
+		isl_aff_free(b);
+		return NULL;
+	}
+
+	if (type == ISL_TOKEN_LE)
+		return isl_aff_le_basic_set(a, b);
+	if (type == ISL_TOKEN_GE)
+		return isl_aff_ge_basic_set(a, b);
+	if (type == ISL_TOKEN_LT)
+		return isl_aff_lt_basic_set(a, b);
+	if (type == ISL_TOKEN_GT)
+		return isl_aff_gt_basic_set(a, b);
+	return isl_aff_eq_basic_set(a, b);
+}
+
 /* Construct constraints of the form
  *
  *	a op b
@@ -1518,6 +1651,9 @@ error:
  * If "type" is the type of a comparison operator between lists
  * of affine expressions, then a single (compound) constraint
  * is constructed by list_cmp instead.
+ * If the constraint is a single comparison between
+ * plain affine expressions, then it is constructed
+ * by plain_constraint instead.
  */
 static __isl_give isl_set *construct_constraints(
 	__isl_take isl_set *set, int type,
@@ -1526,6 +1662,15 @@ static __isl_give isl_set *construct_constraints(
 {
 	isl_set *cond;
 
+	if (!rational) {
+		isl_basic_set *bset;
+
+		bset = plain_constraint(type, left, right);
+		if (bset)
+			return isl_set_intersect(set,
+						isl_set_from_basic_set(bset));
+	}
+
 	left = isl_pw_aff_list_copy(left);
 	right = isl_pw_aff_list_copy(right);
 	if (rational) {
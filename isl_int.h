@@ -16,9 +16,21 @@
 #include <string.h>
 #include <isl_config.h>
 
+/* Storage class of variables that are kept separately for each thread.
+ */
+#ifdef USE_THREADS
+#define ISL_THREAD_LOCAL	__thread
+#else
+#define ISL_THREAD_LOCAL
+#endif
+
 #ifdef USE_GMP_FOR_MP
+#ifdef USE_SMALL_INT_OPT
+#include <isl_int_siogmp.h>
+#else /* USE_SMALL_INT_OPT */
 #include <isl_int_gmp.h>
-#endif
+#endif /* USE_SMALL_INT_OPT */
+#endif /* USE_GMP_FOR_MP */
 
 #ifdef USE_IMATH_FOR_MP
 #ifdef USE_SMALL_INT_OPT
@@ -36,6 +48,14 @@
 #define isl_int_is_nonpos(i)	(isl_int_sgn(i) <= 0)
 #define isl_int_is_nonneg(i)	(isl_int_sgn(i) >= 0)
 
+/* Return the number of times the current thread has converted
+ * an integer from small to big representation.
+ * Without small integer optimization, no such conversions are performed.
+ */
+#ifndef USE_SMALL_INT_OPT
+#define isl_int_n_promotion()	0UL
+#endif
+
 #ifndef USE_SMALL_INT_OPT
 #define isl_int_print(out,i,width)					\
 	do {								\
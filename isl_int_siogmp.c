@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <isl_int.h>
+
+ISL_THREAD_LOCAL unsigned long isl_siogmp_n_promotion;
+
+extern int isl_siogmp_is_small(isl_siogmp val);
+extern int isl_siogmp_is_big(isl_siogmp val);
+extern int64_t isl_siogmp_get_small(isl_siogmp val);
+extern mpz_ptr isl_siogmp_get_big(isl_siogmp val);
+extern int isl_siogmp_decode_small(isl_siogmp val, int64_t *small);
+extern isl_siogmp isl_siogmp_encode_small(int64_t val);
+extern isl_siogmp isl_siogmp_encode_big(mpz_ptr val);
+extern int isl_siogmp_fits_small(int64_t val);
+extern mpz_srcptr isl_siogmp_si64arg_src(int64_t arg,
+	isl_siogmp_scratchspace_t *scratch);
+extern mpz_srcptr isl_siogmp_bigarg_src(isl_siogmp arg,
+	isl_siogmp_scratchspace_t *scratch);
+extern mpz_ptr isl_siogmp_reinit_big(isl_siogmp_ptr ptr);
+extern void isl_siogmp_set_small(isl_siogmp_ptr ptr, int64_t val);
+extern void isl_siogmp_set_int64(isl_siogmp_ptr ptr, int64_t val);
+extern void isl_siogmp_promote(isl_siogmp_ptr dst);
+extern void isl_siogmp_try_demote(isl_siogmp_ptr dst);
+extern void isl_siogmp_init(isl_siogmp_ptr dst);
+extern void isl_siogmp_clear(isl_siogmp_ptr dst);
+extern void isl_siogmp_set(isl_siogmp_ptr dst, isl_siogmp_src val);
+extern void isl_siogmp_set_si(isl_siogmp_ptr dst, long val);
+extern void isl_siogmp_set_ui(isl_siogmp_ptr dst, unsigned long val);
+extern int isl_siogmp_fits_slong(isl_siogmp_src val);
+extern long isl_siogmp_get_si(isl_siogmp_src val);
+extern int isl_siogmp_fits_ulong(isl_siogmp_src val);
+extern unsigned long isl_siogmp_get_ui(isl_siogmp_src val);
+extern double isl_siogmp_get_d(isl_siogmp_src val);
+extern char *isl_siogmp_get_str(isl_siogmp_src val);
+extern void isl_siogmp_abs(isl_siogmp_ptr dst, isl_siogmp_src arg);
+extern void isl_siogmp_neg(isl_siogmp_ptr dst, isl_siogmp_src arg);
+extern void isl_siogmp_swap(isl_siogmp_ptr lhs, isl_siogmp_ptr rhs);
+extern void isl_siogmp_add_ui(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs);
+extern void isl_siogmp_sub_ui(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs);
+extern void isl_siogmp_add(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_sub(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_mul(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_mul_2exp(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs);
+extern void isl_siogmp_mul_si(isl_siogmp_ptr dst, isl_siogmp lhs,
+	signed long rhs);
+extern void isl_siogmp_mul_ui(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs);
+extern void isl_siogmp_pow_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs);
+extern int isl_siogmp_small_addmul(isl_siogmp_ptr dst, int64_t lhs,
+	int64_t rhs, int sign);
+extern void isl_siogmp_addmul(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_addmul_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs);
+extern void isl_siogmp_submul(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_submul_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs);
+
+
+/* Implements the Euclidean algorithm to compute the greatest common divisor of
+ * two values in small representation.
+ */
+static uint64_t isl_siogmp_smallgcd(int64_t lhs, int64_t rhs)
+{
+	uint64_t dividend, divisor, remainder;
+
+	dividend = lhs < 0 ? -lhs : lhs;
+	divisor = rhs < 0 ? -rhs : rhs;
+	while (divisor) {
+		remainder = dividend % divisor;
+		dividend = divisor;
+		divisor = remainder;
+	}
+
+	return dividend;
+}
+
+/* Compute the greatest common divisor.
+ *
+ * Per GMP convention, gcd(0,0)==0 and otherwise always positive.
+ */
+void isl_siogmp_gcd(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	int64_t lhssmall, rhssmall;
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		isl_siogmp_set_small(dst,
+				    isl_siogmp_smallgcd(lhssmall, rhssmall));
+		return;
+	}
+
+	mpz_gcd(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Compute the lowest common multiple of two numbers.
+ *
+ * If both arguments are small, then the multiple is computed
+ * as |lhs| / gcd * |rhs|, unless this overflows.
+ */
+void isl_siogmp_lcm(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	int64_t lhssmall, rhssmall, multiple;
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		if (lhssmall == 0 || rhssmall == 0) {
+			isl_siogmp_set_small(dst, 0);
+			return;
+		}
+		lhssmall = lhssmall < 0 ? -lhssmall : lhssmall;
+		rhssmall = rhssmall < 0 ? -rhssmall : rhssmall;
+		lhssmall /= (int64_t) isl_siogmp_smallgcd(lhssmall, rhssmall);
+		if (!isl_siogmp_mul_overflow(lhssmall, rhssmall, &multiple)) {
+			isl_siogmp_set_int64(dst, multiple);
+			return;
+		}
+	}
+
+	mpz_lcm(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+extern void isl_siogmp_tdiv_q(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_tdiv_q_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs);
+extern void isl_siogmp_cdiv_q(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_cdiv_q_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs);
+extern void isl_siogmp_fdiv_q(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern void isl_siogmp_fdiv_q_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs);
+extern void isl_siogmp_fdiv_r(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+
+
+/* Parse a number from a string.
+ * If it has less than 19 characters then it will fit into the small
+ * representation (i.e. strlen("4611686018427387903")).
+ * Otherwise, let GMP parse it.
+ */
+void isl_siogmp_read(isl_siogmp_ptr dst, const char *str)
+{
+	int64_t small;
+
+	if (strlen(str) < 19) {
+		small = strtoll(str, NULL, 10);
+		isl_siogmp_set_small(dst, small);
+		return;
+	}
+
+	mpz_set_str(isl_siogmp_reinit_big(dst), str, 10);
+	isl_siogmp_try_demote(dst);
+}
+
+extern int isl_siogmp_sgn(isl_siogmp_src arg);
+extern int isl_siogmp_cmp(isl_siogmp_src lhs, isl_siogmp_src rhs);
+extern int isl_siogmp_cmp_si(isl_siogmp_src lhs, signed long rhs);
+extern int isl_siogmp_abs_cmp(isl_siogmp_src lhs, isl_siogmp_src rhs);
+extern int isl_siogmp_is_divisible_by(isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+extern uint32_t isl_siogmp_hash(isl_siogmp_src arg, uint32_t hash);
+extern size_t isl_siogmp_sizeinbase(isl_siogmp_src arg, int base);
+extern void isl_siogmp_print(FILE *out, isl_siogmp_src i, int width);
+
+/* Print an isl_int to FILE*. Adds space padding to the left until at least
+ * width characters are printed.
+ */
+void isl_siogmp_print(FILE *out, isl_siogmp_src i, int width)
+{
+	int64_t small;
+	char *buf;
+
+	if (isl_siogmp_decode_small(i, &small)) {
+		fprintf(out, "%*" PRIi64, width, small);
+		return;
+	}
+
+	buf = isl_siogmp_get_str(i);
+	if (!buf)
+		return;
+	fprintf(out, "%*s", width, buf);
+	free(buf);
+}
+
+/* Print a number to stdout. Meant for debugging.
+ */
+void isl_siogmp_dump(isl_siogmp_src arg)
+{
+	isl_siogmp_print(stdout, arg, 0);
+}
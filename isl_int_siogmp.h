@@ -0,0 +1,1102 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+#ifndef ISL_INT_SIOGMP_H
+#define ISL_INT_SIOGMP_H
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gmp.h>
+#include <isl/hash.h>
+
+#define ARRAY_SIZE(array) (sizeof(array)/sizeof(*array))
+
+/* The type to represent integers optimized for small values,
+ * using GMP for the values that do not fit in the small representation.
+ * It is either a pointer to a heap allocated __mpz_struct
+ * (big representation) or a 63 bit signed integer
+ * (small representation) with a discriminator at the least significant bit.
+ * In big representation, the discriminator is always zero
+ * because of heap alignment.  In small representation, it is set to 1 and
+ * the integer is stored in the 63 most significant bits.
+ *
+ * Big representation:
+ * MSB                                                          LSB
+ * |------------------------------------------------------------000
+ * |                          __mpz_struct *                      |
+ * |                             != NULL                          |
+ *
+ * Small representation:
+ * MSB                                                          LSB
+ * |---------------------------------------------------------------1
+ * |                           int64_t >> 1                      |
+ * |          4611686018427387903 ... -4611686018427387903       |
+ *
+ * Compared to the 32 bit payload of isl_sioimath, the wider payload means
+ * that the product of two small values no longer fits in a native integer.
+ * Multiplications therefore use the overflow checking builtins of the compiler
+ * (if available) to detect when the big representation is needed.
+ * The sum of two small values always fits in an int64_t.
+ *
+ * This implementation makes the following assumptions:
+ * - right shifts of negative int64_t values are arithmetic
+ * - long is at most 64 bits wide
+ * - GMP is compiled without nail bits
+ * - adresses returned by malloc are aligned to 2-byte boundaries (leastmost
+ *   bit is zero)
+ */
+typedef uint64_t isl_siogmp;
+
+/* Exclude INT64_MIN >> 1 from the small representation such that
+ * the negation and the absolute value of a small value are also small.
+ */
+#define ISL_SIOGMP_SMALL_MAX	(INT64_MAX >> 1)
+#define ISL_SIOGMP_SMALL_MIN	(-ISL_SIOGMP_SMALL_MAX)
+
+/* Used for function parameters the function modifies. */
+typedef isl_siogmp *isl_siogmp_ptr;
+
+/* Used for function parameters that are read-only. */
+typedef isl_siogmp isl_siogmp_src;
+
+/* Multiply "lhs" and "rhs", store the result in "res" and return
+ * whether the multiplication overflowed.
+ * Without compiler support, overflow is detected using a division,
+ * which is correct because the arguments are small values and
+ * can therefore not be equal to INT64_MIN.
+ */
+#ifdef HAVE___BUILTIN_MUL_OVERFLOW
+#define isl_siogmp_mul_overflow(lhs, rhs, res)				\
+	__builtin_mul_overflow(lhs, rhs, res)
+#else
+#define isl_siogmp_mul_overflow(lhs, rhs, res)				\
+	((lhs) != 0 && ((rhs) < 0 ? -(rhs) : (rhs)) >			\
+		INT64_MAX / ((lhs) < 0 ? -(lhs) : (lhs)) ?		\
+		1 : (*(res) = (lhs) * (rhs), 0))
+#endif
+
+/* Return whether the argument is stored in small representation.
+ */
+inline int isl_siogmp_is_small(isl_siogmp val)
+{
+	return val & 0x00000001;
+}
+
+/* Return whether the argument is stored in big representation.
+ */
+inline int isl_siogmp_is_big(isl_siogmp val)
+{
+	return !isl_siogmp_is_small(val);
+}
+
+/* Get the number of an isl_int in small representation. Result is undefined if
+ * val is not stored in that format.
+ */
+inline int64_t isl_siogmp_get_small(isl_siogmp val)
+{
+	return ((int64_t) val) >> 1;
+}
+
+/* Get the number of an isl_int in big representation. Result is undefined if
+ * val is not stored in that format.
+ */
+inline mpz_ptr isl_siogmp_get_big(isl_siogmp val)
+{
+	return (mpz_ptr)(uintptr_t) val;
+}
+
+/* Return 1 if val is stored in small representation and store its value to
+ * small.
+ */
+inline int isl_siogmp_decode_small(isl_siogmp val, int64_t *small)
+{
+	*small = isl_siogmp_get_small(val);
+	return isl_siogmp_is_small(val);
+}
+
+/* Encode a small representation into an isl_int.
+ */
+inline isl_siogmp isl_siogmp_encode_small(int64_t val)
+{
+	return ((isl_siogmp) val) << 1 | 0x00000001;
+}
+
+/* Encode a big representation.
+ */
+inline isl_siogmp isl_siogmp_encode_big(mpz_ptr val)
+{
+	return (isl_siogmp)(uintptr_t) val;
+}
+
+/* Is "val" within the range of the small representation?
+ */
+inline int isl_siogmp_fits_small(int64_t val)
+{
+	return ISL_SIOGMP_SMALL_MIN <= val && val <= ISL_SIOGMP_SMALL_MAX;
+}
+
+/* Scratch space for a read-only GMP representation of a native integer.
+ * As in isl_sioimath_scratchspace_t, the limbs are reserved on the stack
+ * to avoid heap allocations.
+ */
+typedef struct {
+	__mpz_struct big;
+	mp_limb_t limbs[(sizeof(uint64_t) + sizeof(mp_limb_t) - 1) /
+			sizeof(mp_limb_t)];
+} isl_siogmp_scratchspace_t;
+
+/* Create a temporary read-only GMP integer for an int64_t
+ * by filling in the internal representation of "scratch".
+ * Note that the result of num>>(sizeof(num)*CHAR_BIT) is undefined.
+ */
+inline mpz_srcptr isl_siogmp_si64arg_src(int64_t arg,
+	isl_siogmp_scratchspace_t *scratch)
+{
+	int i;
+	uint64_t num;
+
+	num = arg >= 0 ? (uint64_t) arg : -(uint64_t) arg;
+	for (i = 0; num != 0; ++i) {
+		scratch->limbs[i] = (mp_limb_t) num;
+		if (sizeof(mp_limb_t) >= sizeof(uint64_t))
+			num = 0;
+		else
+			num >>= (sizeof(mp_limb_t) * CHAR_BIT) %
+				(sizeof(uint64_t) * CHAR_BIT);
+	}
+
+	scratch->big._mp_d = scratch->limbs;
+	scratch->big._mp_alloc = ARRAY_SIZE(scratch->limbs);
+	scratch->big._mp_size = arg >= 0 ? i : -i;
+	return &scratch->big;
+}
+
+/* Get the GMP representation of an isl_int without modifying it.
+ * For the case it is not in big representation yet, pass some scratch space we
+ * can use to store the big representation in.
+ */
+inline mpz_srcptr isl_siogmp_bigarg_src(isl_siogmp arg,
+	isl_siogmp_scratchspace_t *scratch)
+{
+	if (isl_siogmp_is_big(arg))
+		return isl_siogmp_get_big(arg);
+	return isl_siogmp_si64arg_src(isl_siogmp_get_small(arg), scratch);
+}
+
+/* The number of times the current thread has converted a number
+ * from small to big representation.
+ */
+extern ISL_THREAD_LOCAL unsigned long isl_siogmp_n_promotion;
+
+/* Ensure big representation. Does not preserve the current number.
+ * Callers may use the fact that the value _is_ preserved if the presentation
+ * was big before.
+ */
+inline mpz_ptr isl_siogmp_reinit_big(isl_siogmp_ptr ptr)
+{
+	mpz_ptr big;
+
+	if (isl_siogmp_is_big(*ptr))
+		return isl_siogmp_get_big(*ptr);
+
+	isl_siogmp_n_promotion++;
+	big = malloc(sizeof(__mpz_struct));
+	mpz_init(big);
+	*ptr = isl_siogmp_encode_big(big);
+	return big;
+}
+
+/* Set ptr to a number in small representation.
+ */
+inline void isl_siogmp_set_small(isl_siogmp_ptr ptr, int64_t val)
+{
+	mpz_ptr big;
+
+	if (isl_siogmp_is_big(*ptr)) {
+		big = isl_siogmp_get_big(*ptr);
+		mpz_clear(big);
+		free(big);
+	}
+	*ptr = isl_siogmp_encode_small(val);
+}
+
+/* Assign an int64_t number using small representation if possible.
+ */
+inline void isl_siogmp_set_int64(isl_siogmp_ptr ptr, int64_t val)
+{
+	isl_siogmp_scratchspace_t scratch;
+
+	if (isl_siogmp_fits_small(val)) {
+		isl_siogmp_set_small(ptr, val);
+		return;
+	}
+
+	mpz_set(isl_siogmp_reinit_big(ptr),
+	    isl_siogmp_si64arg_src(val, &scratch));
+}
+
+/* Convert to big representation while preserving the current number.
+ */
+inline void isl_siogmp_promote(isl_siogmp_ptr dst)
+{
+	int64_t small;
+	isl_siogmp_scratchspace_t scratch;
+
+	if (isl_siogmp_is_big(*dst))
+		return;
+
+	small = isl_siogmp_get_small(*dst);
+	mpz_set(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_si64arg_src(small, &scratch));
+}
+
+/* Convert to small representation while preserving the current number. Does
+ * nothing if dst doesn't fit small representation.
+ *
+ * A value fits if its absolute value has at most 62 bits.
+ */
+inline void isl_siogmp_try_demote(isl_siogmp_ptr dst)
+{
+	int i, n;
+	mpz_ptr big;
+	uint64_t num;
+
+	if (isl_siogmp_is_small(*dst))
+		return;
+
+	big = isl_siogmp_get_big(*dst);
+	if (mpz_sizeinbase(big, 2) > 62)
+		return;
+
+	num = 0;
+	n = mpz_size(big);
+	for (i = n - 1; i >= 0; --i) {
+		if (sizeof(mp_limb_t) < sizeof(uint64_t))
+			num <<= (sizeof(mp_limb_t) * CHAR_BIT) %
+				(sizeof(uint64_t) * CHAR_BIT);
+		num |= mpz_getlimbn(big, i);
+	}
+
+	isl_siogmp_set_small(dst,
+			    mpz_sgn(big) < 0 ? -(int64_t) num : (int64_t) num);
+}
+
+/* Initialize an isl_int. The implicit value is 0 in small representation.
+ */
+inline void isl_siogmp_init(isl_siogmp_ptr dst)
+{
+	*dst = isl_siogmp_encode_small(0);
+}
+
+/* Free the resources taken by an isl_int.
+ */
+inline void isl_siogmp_clear(isl_siogmp_ptr dst)
+{
+	isl_siogmp_set_small(dst, 0);
+}
+
+/* Copy the value of one isl_int to another.
+ */
+inline void isl_siogmp_set(isl_siogmp_ptr dst, isl_siogmp_src val)
+{
+	if (isl_siogmp_is_small(val)) {
+		isl_siogmp_set_small(dst, isl_siogmp_get_small(val));
+		return;
+	}
+
+	mpz_set(isl_siogmp_reinit_big(dst), isl_siogmp_get_big(val));
+}
+
+/* Store a signed long into an isl_int.
+ */
+inline void isl_siogmp_set_si(isl_siogmp_ptr dst, long val)
+{
+	isl_siogmp_set_int64(dst, val);
+}
+
+/* Store an unsigned long into an isl_int.
+ */
+inline void isl_siogmp_set_ui(isl_siogmp_ptr dst, unsigned long val)
+{
+	if (val <= ISL_SIOGMP_SMALL_MAX) {
+		isl_siogmp_set_small(dst, val);
+		return;
+	}
+
+	mpz_set_ui(isl_siogmp_reinit_big(dst), val);
+}
+
+/* Return whether a number can be represented by a signed long.
+ */
+inline int isl_siogmp_fits_slong(isl_siogmp_src val)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(val, &small))
+		return LONG_MIN <= small && small <= LONG_MAX;
+
+	return mpz_fits_slong_p(isl_siogmp_get_big(val));
+}
+
+/* Return a number as signed long. Result is undefined if the number cannot be
+ * represented as long.
+ */
+inline long isl_siogmp_get_si(isl_siogmp_src val)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(val, &small))
+		return small;
+
+	return mpz_get_si(isl_siogmp_get_big(val));
+}
+
+/* Return whether a number can be represented as unsigned long.
+ */
+inline int isl_siogmp_fits_ulong(isl_siogmp_src val)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(val, &small))
+		return small >= 0 && (uint64_t) small <= ULONG_MAX;
+
+	return mpz_fits_ulong_p(isl_siogmp_get_big(val));
+}
+
+/* Return a number as unsigned long. Result is undefined if the number cannot be
+ * represented as unsigned long.
+ */
+inline unsigned long isl_siogmp_get_ui(isl_siogmp_src val)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(val, &small))
+		return small;
+
+	return mpz_get_ui(isl_siogmp_get_big(val));
+}
+
+/* Return a number as floating point value.
+ */
+inline double isl_siogmp_get_d(isl_siogmp_src val)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(val, &small))
+		return small;
+
+	return mpz_get_d(isl_siogmp_get_big(val));
+}
+
+/* Format a number as decimal string.
+ *
+ * The largest possible string from small representation is 21 characters
+ * ("-4611686018427387903" plus the terminating null).
+ * The result is allocated using malloc and should be freed using free.
+ */
+inline char *isl_siogmp_get_str(isl_siogmp_src val)
+{
+	char *result;
+	mpz_ptr big;
+	int64_t small;
+
+	if (isl_siogmp_decode_small(val, &small)) {
+		result = malloc(21);
+		if (result)
+			snprintf(result, 21, "%" PRIi64, small);
+		return result;
+	}
+
+	big = isl_siogmp_get_big(val);
+	result = malloc(mpz_sizeinbase(big, 10) + 2);
+	if (result)
+		mpz_get_str(result, 10, big);
+	return result;
+}
+
+/* Return the absolute value.
+ */
+inline void isl_siogmp_abs(isl_siogmp_ptr dst, isl_siogmp_src arg)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(arg, &small)) {
+		isl_siogmp_set_small(dst, small < 0 ? -small : small);
+		return;
+	}
+
+	mpz_abs(isl_siogmp_reinit_big(dst), isl_siogmp_get_big(arg));
+}
+
+/* Return the negation of a number.
+ */
+inline void isl_siogmp_neg(isl_siogmp_ptr dst, isl_siogmp_src arg)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(arg, &small)) {
+		isl_siogmp_set_small(dst, -small);
+		return;
+	}
+
+	mpz_neg(isl_siogmp_reinit_big(dst), isl_siogmp_get_big(arg));
+}
+
+/* Swap two isl_ints.
+ *
+ * isl_siogmp can be copied bytewise; nothing depends on its address. It can
+ * also be stored in a CPU register.
+ */
+inline void isl_siogmp_swap(isl_siogmp_ptr lhs, isl_siogmp_ptr rhs)
+{
+	isl_siogmp tmp = *lhs;
+	*lhs = *rhs;
+	*rhs = tmp;
+}
+
+/* Add an unsigned long to the number.
+ *
+ * The sum of two small values fits in an int64_t.
+ */
+inline void isl_siogmp_add_ui(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs)
+{
+	int64_t small;
+	isl_siogmp_scratchspace_t lhsscratch;
+
+	if (isl_siogmp_decode_small(lhs, &small) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX) {
+		isl_siogmp_set_int64(dst, small + (int64_t) rhs);
+		return;
+	}
+
+	mpz_add_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Subtract an unsigned long.
+ */
+inline void isl_siogmp_sub_ui(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs)
+{
+	int64_t small;
+	isl_siogmp_scratchspace_t lhsscratch;
+
+	if (isl_siogmp_decode_small(lhs, &small) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX) {
+		isl_siogmp_set_int64(dst, small - (int64_t) rhs);
+		return;
+	}
+
+	mpz_sub_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Sum of two isl_ints.
+ */
+inline void isl_siogmp_add(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+	int64_t smalllhs, smallrhs;
+
+	if (isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    isl_siogmp_decode_small(rhs, &smallrhs)) {
+		isl_siogmp_set_int64(dst, smalllhs + smallrhs);
+		return;
+	}
+
+	mpz_add(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Subtract two isl_ints.
+ */
+inline void isl_siogmp_sub(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+	int64_t smalllhs, smallrhs;
+
+	if (isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    isl_siogmp_decode_small(rhs, &smallrhs)) {
+		isl_siogmp_set_int64(dst, smalllhs - smallrhs);
+		return;
+	}
+
+	mpz_sub(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Multiply two isl_ints.
+ */
+inline void isl_siogmp_mul(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+	int64_t smalllhs, smallrhs, product;
+
+	if (isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    isl_siogmp_decode_small(rhs, &smallrhs) &&
+	    !isl_siogmp_mul_overflow(smalllhs, smallrhs, &product)) {
+		isl_siogmp_set_int64(dst, product);
+		return;
+	}
+
+	mpz_mul(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Shift lhs by rhs bits to the left and store the result in dst. Effectively,
+ * this operation computes 'lhs * 2^rhs'.
+ */
+inline void isl_siogmp_mul_2exp(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs;
+	int64_t smalllhs;
+
+	if (isl_siogmp_decode_small(lhs, &smalllhs) && rhs < 62 &&
+	    (smalllhs < 0 ? -smalllhs : smalllhs) <=
+						ISL_SIOGMP_SMALL_MAX >> rhs) {
+		isl_siogmp_set_small(dst, smalllhs * ((int64_t) 1 << rhs));
+		return;
+	}
+
+	mpz_mul_2exp(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Multiply an isl_int and a signed long.
+ */
+inline void isl_siogmp_mul_si(isl_siogmp_ptr dst, isl_siogmp lhs,
+	signed long rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs;
+	int64_t smalllhs, product;
+
+	if (isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    isl_siogmp_fits_small(rhs) &&
+	    !isl_siogmp_mul_overflow(smalllhs, (int64_t) rhs, &product)) {
+		isl_siogmp_set_int64(dst, product);
+		return;
+	}
+
+	mpz_mul_si(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Multiply an isl_int and an unsigned long.
+ */
+inline void isl_siogmp_mul_ui(isl_siogmp_ptr dst, isl_siogmp lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs;
+	int64_t smalllhs, product;
+
+	if (isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX &&
+	    !isl_siogmp_mul_overflow(smalllhs, (int64_t) rhs, &product)) {
+		isl_siogmp_set_int64(dst, product);
+		return;
+	}
+
+	mpz_mul_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Compute the power of an isl_int to an unsigned long.
+ * Always let GMP compute it.
+ */
+inline void isl_siogmp_pow_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs;
+
+	mpz_pow_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Fused multiply-add: dst += lhs * rhs, where "dst", "lhs" and "rhs"
+ * are all in small representation and the sign of the product
+ * is given by "sign".
+ * Return 0 if the result was computed and -1 if the big representation
+ * is needed.
+ *
+ * If the absolute value of the product is within the range
+ * of the small representation, then the sum with "dst" fits in an int64_t.
+ */
+inline int isl_siogmp_small_addmul(isl_siogmp_ptr dst, int64_t lhs,
+	int64_t rhs, int sign)
+{
+	int64_t product;
+
+	if (isl_siogmp_mul_overflow(lhs, rhs, &product) ||
+	    !isl_siogmp_fits_small(product))
+		return -1;
+
+	isl_siogmp_set_int64(dst,
+	    isl_siogmp_get_small(*dst) + (sign > 0 ? product : -product));
+	return 0;
+}
+
+/* Multiply two isl_ints and add the result to the value in dst.
+ */
+inline void isl_siogmp_addmul(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+	int64_t smalllhs, smallrhs;
+
+	if (isl_siogmp_is_small(*dst) &&
+	    isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    isl_siogmp_decode_small(rhs, &smallrhs) &&
+	    isl_siogmp_small_addmul(dst, smalllhs, smallrhs, 1) == 0)
+		return;
+
+	isl_siogmp_promote(dst);
+	mpz_addmul(isl_siogmp_get_big(*dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Multiply an isl_int and an unsigned long and add the result to the value
+ * in dst.
+ */
+inline void isl_siogmp_addmul_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs;
+	int64_t smalllhs;
+
+	if (isl_siogmp_is_small(*dst) &&
+	    isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX &&
+	    isl_siogmp_small_addmul(dst, smalllhs, rhs, 1) == 0)
+		return;
+
+	isl_siogmp_promote(dst);
+	mpz_addmul_ui(isl_siogmp_get_big(*dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Multiply two isl_ints and subtract the result from the value in dst.
+ */
+inline void isl_siogmp_submul(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs, scratchrhs;
+	int64_t smalllhs, smallrhs;
+
+	if (isl_siogmp_is_small(*dst) &&
+	    isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    isl_siogmp_decode_small(rhs, &smallrhs) &&
+	    isl_siogmp_small_addmul(dst, smalllhs, smallrhs, -1) == 0)
+		return;
+
+	isl_siogmp_promote(dst);
+	mpz_submul(isl_siogmp_get_big(*dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs),
+	    isl_siogmp_bigarg_src(rhs, &scratchrhs));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Subtract the product of an isl_int and an unsigned long from the value
+ * in dst.
+ */
+inline void isl_siogmp_submul_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t scratchlhs;
+	int64_t smalllhs;
+
+	if (isl_siogmp_is_small(*dst) &&
+	    isl_siogmp_decode_small(lhs, &smalllhs) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX &&
+	    isl_siogmp_small_addmul(dst, smalllhs, rhs, -1) == 0)
+		return;
+
+	isl_siogmp_promote(dst);
+	mpz_submul_ui(isl_siogmp_get_big(*dst),
+	    isl_siogmp_bigarg_src(lhs, &scratchlhs), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+void isl_siogmp_gcd(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+void isl_siogmp_lcm(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs);
+
+/* Divide lhs by rhs, rounding to zero (Truncate).
+ *
+ * The quotient of two small values is small.
+ */
+inline void isl_siogmp_tdiv_q(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		isl_siogmp_set_small(dst, lhssmall / rhssmall);
+		return;
+	}
+
+	mpz_tdiv_q(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Divide lhs by an unsigned long rhs, rounding to zero (Truncate).
+ */
+inline void isl_siogmp_tdiv_q_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch;
+	int64_t lhssmall;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX) {
+		isl_siogmp_set_small(dst, lhssmall / (int64_t) rhs);
+		return;
+	}
+
+	mpz_tdiv_q_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Divide lhs by rhs, rounding to positive infinity (Ceil).
+ */
+inline void isl_siogmp_cdiv_q(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall, q;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		q = lhssmall / rhssmall;
+		if (lhssmall % rhssmall != 0 &&
+		    (lhssmall > 0) == (rhssmall > 0))
+			q += 1;
+		isl_siogmp_set_small(dst, q);
+		return;
+	}
+
+	mpz_cdiv_q(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Compute the division of lhs by a rhs of type unsigned long, rounding towards
+ * positive infinity (Ceil).
+ */
+inline void isl_siogmp_cdiv_q_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch;
+	int64_t lhssmall, q;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX) {
+		q = lhssmall / (int64_t) rhs;
+		if (lhssmall % (int64_t) rhs > 0)
+			q += 1;
+		isl_siogmp_set_small(dst, q);
+		return;
+	}
+
+	mpz_cdiv_q_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Divide lhs by rhs, rounding to negative infinity (Floor).
+ */
+inline void isl_siogmp_fdiv_q(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall, q;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		q = lhssmall / rhssmall;
+		if (lhssmall % rhssmall != 0 &&
+		    (lhssmall < 0) != (rhssmall < 0))
+			q -= 1;
+		isl_siogmp_set_small(dst, q);
+		return;
+	}
+
+	mpz_fdiv_q(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+	isl_siogmp_try_demote(dst);
+}
+
+/* Compute the division of lhs by a rhs of type unsigned long, rounding towards
+ * negative infinity (Floor).
+ */
+inline void isl_siogmp_fdiv_q_ui(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	unsigned long rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch;
+	int64_t lhssmall, q;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    rhs <= ISL_SIOGMP_SMALL_MAX) {
+		q = lhssmall / (int64_t) rhs;
+		if (lhssmall % (int64_t) rhs < 0)
+			q -= 1;
+		isl_siogmp_set_small(dst, q);
+		return;
+	}
+
+	mpz_fdiv_q_ui(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch), rhs);
+	isl_siogmp_try_demote(dst);
+}
+
+/* Get the remainder of: lhs divided by rhs rounded towards negative infinite
+ * (Floor).
+ */
+inline void isl_siogmp_fdiv_r(isl_siogmp_ptr dst, isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall, r;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		r = lhssmall % rhssmall;
+		if (r != 0 && (r < 0) != (rhssmall < 0))
+			r += rhssmall;
+		isl_siogmp_set_small(dst, r);
+		return;
+	}
+
+	mpz_fdiv_r(isl_siogmp_reinit_big(dst),
+	    isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+	isl_siogmp_try_demote(dst);
+}
+
+void isl_siogmp_read(isl_siogmp_ptr dst, const char *str);
+
+/* Return:
+ *   +1 for a positive number
+ *   -1 for a negative number
+ *    0 if the number is zero
+ */
+inline int isl_siogmp_sgn(isl_siogmp_src arg)
+{
+	int64_t small;
+
+	if (isl_siogmp_decode_small(arg, &small))
+		return (small > 0) - (small < 0);
+
+	return mpz_sgn(isl_siogmp_get_big(arg));
+}
+
+/* Return:
+ *   +1 if lhs > rhs
+ *   -1 if lhs < rhs
+ *    0 if lhs = rhs
+ */
+inline int isl_siogmp_cmp(isl_siogmp_src lhs, isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall))
+		return (lhssmall > rhssmall) - (lhssmall < rhssmall);
+
+	return mpz_cmp(isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+}
+
+/* As isl_siogmp_cmp, but with signed long rhs.
+ */
+inline int isl_siogmp_cmp_si(isl_siogmp_src lhs, signed long rhs)
+{
+	int64_t lhssmall;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall))
+		return (lhssmall > rhs) - (lhssmall < rhs);
+
+	return mpz_cmp_si(isl_siogmp_get_big(lhs), rhs);
+}
+
+/* Return:
+ *   +1 if |lhs| > |rhs|
+ *   -1 if |lhs| < |rhs|
+ *    0 if |lhs| = |rhs|
+ */
+inline int isl_siogmp_abs_cmp(isl_siogmp_src lhs, isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		lhssmall = lhssmall < 0 ? -lhssmall : lhssmall;
+		rhssmall = rhssmall < 0 ? -rhssmall : rhssmall;
+		return (lhssmall > rhssmall) - (lhssmall < rhssmall);
+	}
+
+	return mpz_cmpabs(isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+}
+
+/* Return whether lhs is divisible by rhs.
+ * In particular, can rhs be multiplied by some integer to result in lhs?
+ *
+ * If rhs is zero, then this means lhs has to be zero too.
+ */
+inline int isl_siogmp_is_divisible_by(isl_siogmp_src lhs,
+	isl_siogmp_src rhs)
+{
+	isl_siogmp_scratchspace_t lhsscratch, rhsscratch;
+	int64_t lhssmall, rhssmall;
+
+	if (isl_siogmp_decode_small(lhs, &lhssmall) &&
+	    isl_siogmp_decode_small(rhs, &rhssmall)) {
+		if (rhssmall == 0)
+			return lhssmall == 0;
+		return lhssmall % rhssmall == 0;
+	}
+
+	return mpz_divisible_p(isl_siogmp_bigarg_src(lhs, &lhsscratch),
+	    isl_siogmp_bigarg_src(rhs, &rhsscratch));
+}
+
+uint32_t isl_gmp_hash(mpz_t v, uint32_t hash);
+
+/* Return a hash code of an isl_int.
+ * The hash code for a number in small and big representation must be
+ * identical because a number that fits in the small representation
+ * may still be stored in big representation.
+ * The hash is therefore always computed from the GMP representation.
+ */
+inline uint32_t isl_siogmp_hash(isl_siogmp_src arg, uint32_t hash)
+{
+	isl_siogmp_scratchspace_t scratch;
+
+	return isl_gmp_hash((mpz_ptr) isl_siogmp_bigarg_src(arg, &scratch),
+			    hash);
+}
+
+/* Return the number of digits in a number of the given base or more, i.e. the
+ * string length without sign and null terminator.
+ */
+inline size_t isl_siogmp_sizeinbase(isl_siogmp_src arg, int base)
+{
+	isl_siogmp_scratchspace_t scratch;
+
+	return mpz_sizeinbase(isl_siogmp_bigarg_src(arg, &scratch), base);
+}
+
+void isl_siogmp_print(FILE *out, isl_siogmp_src i, int width);
+void isl_siogmp_dump(isl_siogmp_src arg);
+
+typedef isl_siogmp isl_int[1];
+#define isl_int_n_promotion()		isl_siogmp_n_promotion
+#define isl_int_init(i)			isl_siogmp_init((i))
+#define isl_int_clear(i)		isl_siogmp_clear((i))
+
+#define isl_int_set(r, i)		isl_siogmp_set((r), *(i))
+#define isl_int_set_si(r, i)		isl_siogmp_set_si((r), i)
+#define isl_int_set_ui(r, i)		isl_siogmp_set_ui((r), i)
+#define isl_int_fits_slong(r)		isl_siogmp_fits_slong(*(r))
+#define isl_int_get_si(r)		isl_siogmp_get_si(*(r))
+#define isl_int_fits_ulong(r)		isl_siogmp_fits_ulong(*(r))
+#define isl_int_get_ui(r)		isl_siogmp_get_ui(*(r))
+#define isl_int_get_d(r)		isl_siogmp_get_d(*(r))
+#define isl_int_get_str(r)		isl_siogmp_get_str(*(r))
+#define isl_int_abs(r, i)		isl_siogmp_abs((r), *(i))
+#define isl_int_neg(r, i)		isl_siogmp_neg((r), *(i))
+#define isl_int_swap(i, j)		isl_siogmp_swap((i), (j))
+#define isl_int_swap_or_set(i, j)	isl_siogmp_swap((i), (j))
+#define isl_int_add_ui(r, i, j)		isl_siogmp_add_ui((r), *(i), j)
+#define isl_int_sub_ui(r, i, j)		isl_siogmp_sub_ui((r), *(i), j)
+
+#define isl_int_add(r, i, j)		isl_siogmp_add((r), *(i), *(j))
+#define isl_int_sub(r, i, j)		isl_siogmp_sub((r), *(i), *(j))
+#define isl_int_mul(r, i, j)		isl_siogmp_mul((r), *(i), *(j))
+#define isl_int_mul_2exp(r, i, j)	isl_siogmp_mul_2exp((r), *(i), j)
+#define isl_int_mul_si(r, i, j)		isl_siogmp_mul_si((r), *(i), j)
+#define isl_int_mul_ui(r, i, j)		isl_siogmp_mul_ui((r), *(i), j)
+#define isl_int_pow_ui(r, i, j)		isl_siogmp_pow_ui((r), *(i), j)
+#define isl_int_addmul(r, i, j)		isl_siogmp_addmul((r), *(i), *(j))
+#define isl_int_addmul_ui(r, i, j)	isl_siogmp_addmul_ui((r), *(i), j)
+#define isl_int_submul(r, i, j)		isl_siogmp_submul((r), *(i), *(j))
+#define isl_int_submul_ui(r, i, j)	isl_siogmp_submul_ui((r), *(i), j)
+
+#define isl_int_gcd(r, i, j)		isl_siogmp_gcd((r), *(i), *(j))
+#define isl_int_lcm(r, i, j)		isl_siogmp_lcm((r), *(i), *(j))
+#define isl_int_divexact(r, i, j)	isl_siogmp_tdiv_q((r), *(i), *(j))
+#define isl_int_divexact_ui(r, i, j)	isl_siogmp_tdiv_q_ui((r), *(i), j)
+#define isl_int_tdiv_q(r, i, j)		isl_siogmp_tdiv_q((r), *(i), *(j))
+#define isl_int_cdiv_q(r, i, j)		isl_siogmp_cdiv_q((r), *(i), *(j))
+#define isl_int_cdiv_q_ui(r, i, j)	isl_siogmp_cdiv_q_ui((r), *(i), j)
+#define isl_int_fdiv_q(r, i, j)		isl_siogmp_fdiv_q((r), *(i), *(j))
+#define isl_int_fdiv_r(r, i, j)		isl_siogmp_fdiv_r((r), *(i), *(j))
+#define isl_int_fdiv_q_ui(r, i, j)	isl_siogmp_fdiv_q_ui((r), *(i), j)
+
+#define isl_int_read(r, s)		isl_siogmp_read((r), s)
+#define isl_int_sgn(i)			isl_siogmp_sgn(*(i))
+#define isl_int_cmp(i, j)		isl_siogmp_cmp(*(i), *(j))
+#define isl_int_cmp_si(i, si)		isl_siogmp_cmp_si(*(i), si)
+#define isl_int_eq(i, j)		(isl_siogmp_cmp(*(i), *(j)) == 0)
+#define isl_int_ne(i, j)		(isl_siogmp_cmp(*(i), *(j)) != 0)
+#define isl_int_lt(i, j)		(isl_siogmp_cmp(*(i), *(j)) < 0)
+#define isl_int_le(i, j)		(isl_siogmp_cmp(*(i), *(j)) <= 0)
+#define isl_int_gt(i, j)		(isl_siogmp_cmp(*(i), *(j)) > 0)
+#define isl_int_ge(i, j)		(isl_siogmp_cmp(*(i), *(j)) >= 0)
+#define isl_int_abs_cmp(i, j)		isl_siogmp_abs_cmp(*(i), *(j))
+#define isl_int_abs_eq(i, j)		(isl_siogmp_abs_cmp(*(i), *(j)) == 0)
+#define isl_int_abs_ne(i, j)		(isl_siogmp_abs_cmp(*(i), *(j)) != 0)
+#define isl_int_abs_lt(i, j)		(isl_siogmp_abs_cmp(*(i), *(j)) < 0)
+#define isl_int_abs_gt(i, j)		(isl_siogmp_abs_cmp(*(i), *(j)) > 0)
+#define isl_int_abs_ge(i, j)		(isl_siogmp_abs_cmp(*(i), *(j)) >= 0)
+#define isl_int_is_divisible_by(i, j)	isl_siogmp_is_divisible_by(*(i), *(j))
+
+#define isl_int_hash(v, h)		isl_siogmp_hash(*(v), h)
+#define isl_int_free_str(s)		free(s)
+#define isl_int_print(out, i, width)	isl_siogmp_print(out, *(i), width)
+
+/* Direct access to the representation for the kernels in isl_seq.c.
+ * A value "v" in small representation is stored in the word
+ * (v << ISL_INT_SMALL_SHIFT) | 1.
+ */
+#define ISL_INT_SMALL_SHIFT		1
+#define ISL_INT_SMALL_MAX		ISL_SIOGMP_SMALL_MAX
+#define isl_int_is_small(i)		isl_siogmp_is_small(*(i))
+#define isl_int_get_small(i)		isl_siogmp_get_small(*(i))
+#define isl_int_set_int64(r, v)		isl_siogmp_set_int64((r), v)
+
+#endif /* ISL_INT_SIOGMP_H */
@@ -3,15 +3,21 @@
 
 #include <isl_int.h>
 
-extern int isl_sioimath_decode(isl_sioimath val, int32_t *small, mp_int *big);
+ISL_THREAD_LOCAL unsigned long isl_sioimath_n_promotion;
+
+extern int isl_sioimath_decode(isl_sioimath val, isl_sioimath_small *small,
+	mp_int *big);
 extern int isl_sioimath_decode_big(isl_sioimath val, mp_int *big);
-extern int isl_sioimath_decode_small(isl_sioimath val, int32_t *small);
+extern int isl_sioimath_decode_small(isl_sioimath val,
+	isl_sioimath_small *small);
 
-extern isl_sioimath isl_sioimath_encode_small(int32_t val);
+extern isl_sioimath isl_sioimath_encode_small(isl_sioimath_small val);
+extern int isl_sioimath_mul_overflow_int64(int64_t lhs, int64_t rhs,
+	int64_t *res);
 extern isl_sioimath isl_sioimath_encode_big(mp_int val);
 extern int isl_sioimath_is_small(isl_sioimath val);
 extern int isl_sioimath_is_big(isl_sioimath val);
-extern int32_t isl_sioimath_get_small(isl_sioimath val);
+extern isl_sioimath_small isl_sioimath_get_small(isl_sioimath val);
 extern mp_int isl_sioimath_get_big(isl_sioimath val);
 
 extern void isl_siomath_uint32_to_digits(uint32_t num, mp_digit *digits,
@@ -30,7 +36,8 @@ extern mp_int isl_sioimath_si64arg_src(int64_t arg,
 extern mp_int isl_sioimath_uiarg_src(unsigned long arg,
 	isl_sioimath_scratchspace_t *scratch);
 extern mp_int isl_sioimath_reinit_big(isl_sioimath_ptr ptr);
-extern void isl_sioimath_set_small(isl_sioimath_ptr ptr, int32_t val);
+extern void isl_sioimath_set_small(isl_sioimath_ptr ptr,
+	isl_sioimath_small val);
 extern void isl_sioimath_set_int32(isl_sioimath_ptr ptr, int32_t val);
 extern void isl_sioimath_set_int64(isl_sioimath_ptr ptr, int64_t val);
 extern void isl_sioimath_promote(isl_sioimath_ptr dst);
@@ -69,6 +76,8 @@ extern void isl_sioimath_mul_ui(isl_sioimath_ptr dst, isl_sioimath lhs,
 	unsigned long rhs);
 extern void isl_sioimath_pow_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs);
+extern int isl_sioimath_small_addmul(isl_sioimath_ptr dst, int64_t lhs,
+	int64_t rhs, int sign);
 extern void isl_sioimath_addmul(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs);
 extern void isl_sioimath_addmul_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
@@ -81,9 +90,10 @@ extern void isl_sioimath_submul_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 /* Implements the Euclidean algorithm to compute the greatest common divisor of
  * two values in small representation.
  */
-static uint32_t isl_sioimath_smallgcd(int32_t lhs, int32_t rhs)
+static uint64_t isl_sioimath_smallgcd(isl_sioimath_small lhs,
+	isl_sioimath_small rhs)
 {
-	uint32_t dividend, divisor, remainder;
+	uint64_t dividend, divisor, remainder;
 
 	dividend = labs(lhs);
 	divisor = labs(rhs);
@@ -103,8 +113,8 @@ static uint32_t isl_sioimath_smallgcd(int32_t lhs, int32_t rhs)
 void isl_sioimath_gcd(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
-	int32_t lhssmall, rhssmall;
-	uint32_t smallgcd;
+	isl_sioimath_small lhssmall, rhssmall;
+	uint64_t smallgcd;
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
@@ -121,13 +131,16 @@ void isl_sioimath_gcd(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 }
 
 /* Compute the lowest common multiple of two numbers.
+ *
+ * If both arguments are small, then the multiple is computed
+ * as |lhs| / gcd * |rhs|, unless this overflows.
  */
 void isl_sioimath_lcm(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
-	int32_t lhssmall, rhssmall;
-	uint32_t smallgcd;
-	uint64_t multiple;
+	isl_sioimath_small lhssmall, rhssmall;
+	uint64_t smallgcd;
+	int64_t multiple;
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
@@ -137,9 +150,12 @@ void isl_sioimath_lcm(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 			return;
 		}
 		smallgcd = isl_sioimath_smallgcd(lhssmall, rhssmall);
-		multiple = (uint64_t) abs(lhssmall) * (uint64_t) abs(rhssmall);
-		isl_sioimath_set_int64(dst, multiple / smallgcd);
-		return;
+		if (!isl_sioimath_mul_overflow(
+		    (int64_t) (labs(lhssmall) / smallgcd),
+		    (int64_t) labs(rhssmall), &multiple)) {
+			isl_sioimath_set_int64(dst, multiple);
+			return;
+		}
 	}
 
 	impz_lcm(isl_sioimath_reinit_big(dst),
@@ -164,15 +180,16 @@ extern void isl_sioimath_fdiv_r(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs);
 
 /* Parse a number from a string.
- * If it has less than 10 characters then it will fit into the small
- * representation (i.e. strlen("2147483647")). Otherwise, let IMath parse it.
+ * If it has at most ISL_SIOIMATH_SMALL_DIGITS characters then it will fit
+ * into the small representation (i.e. strlen("2147483647") - 1 or
+ * strlen("4611686018427387903") - 1). Otherwise, let IMath parse it.
  */
 void isl_sioimath_read(isl_sioimath_ptr dst, const char *str)
 {
-	int32_t small;
+	isl_sioimath_small small;
 
-	if (strlen(str) < 10) {
-		small = strtol(str, NULL, 10);
+	if (strlen(str) <= ISL_SIOIMATH_SMALL_DIGITS) {
+		small = strtoll(str, NULL, 10);
 		isl_sioimath_set_small(dst, small);
 		return;
 	}
@@ -198,12 +215,12 @@ extern void isl_sioimath_print(FILE *out, isl_sioimath_src i, int width);
 void isl_sioimath_print(FILE *out, isl_sioimath_src i, int width)
 {
 	size_t len;
-	int32_t small;
+	isl_sioimath_small small;
 	mp_int big;
 	char *buf;
 
 	if (isl_sioimath_decode_small(i, &small)) {
-		fprintf(out, "%*" PRIi32, width, small);
+		fprintf(out, "%*" PRIi64, width, (int64_t) small);
 		return;
 	}
 
@@ -55,15 +55,27 @@
  * On 32 bit machines isl_sioimath type is blown up to 8 bytes, i.e.
  * isl_sioimath is guaranteed to be at least 8 bytes. This is to ensure the
  * int32_t can be hidden in that type without data loss. In the future we might
- * optimize this to use 31 hidden bits in a 32 bit pointer. We may also use 63
- * bits on 64 bit machines, but this comes with the cost of additional overflow
- * checks because there is no standardized 128 bit integer we could expand to.
+ * optimize this to use 31 hidden bits in a 32 bit pointer.
+ *
+ * If USE_SMALL_INT_64 is defined (imath-64), then the small representation
+ * instead uses the 63 most significant bits:
+ *
+ * MSB                                                          LSB
+ * |---------------------------------------------------------------1
+ * |                          int64_t >> 1                       |
+ * |          4611686018427387903 ... -4611686018427387903       |
+ *
+ * The product of two such values no longer fits in an int64_t.
+ * Multiplications therefore use the overflow checking builtins
+ * of the compiler (if available) to detect when the big representation
+ * is needed.  The sum of two small values still fits in an int64_t.
  *
  * We use native integer types and avoid union structures to avoid assumptions
  * on the machine's endianness.
  *
  * This implementation makes the following assumptions:
- * - long can represent any int32_t
+ * - long can represent any small value
+ * - right shifts of negative int64_t values are arithmetic
  * - mp_small is signed long
  * - mp_usmall is unsigned long
  * - adresses returned by malloc are aligned to 2-byte boundaries (leastmost
@@ -75,6 +87,18 @@ typedef uint64_t isl_sioimath;
 typedef uintptr_t isl_sioimath;
 #endif
 
+/* The type of a number in small representation.
+ * "ISL_SIOIMATH_SMALL_DIGITS" is the number of decimal digits
+ * that always fit in the small representation.
+ */
+#ifdef USE_SMALL_INT_64
+typedef int64_t isl_sioimath_small;
+#define ISL_SIOIMATH_SMALL_DIGITS	18
+#else
+typedef int32_t isl_sioimath_small;
+#define ISL_SIOIMATH_SMALL_DIGITS	9
+#endif
+
 /* The negation of the smallest possible number in int32_t, INT32_MIN
  * (0x80000000u, -2147483648), cannot be represented in an int32_t, therefore
  * every operation that may produce this value needs to special-case it.
@@ -84,12 +108,29 @@ typedef uintptr_t isl_sioimath;
  * -1 * INT32_MIN (multiplication)
  * INT32_MIN/-1 (any division: divexact, fdiv, cdiv, tdiv)
  * To avoid checking these cases, we exclude INT32_MIN from small
- * representation.
+ * representation.  Similarly, in the 63 bit representation,
+ * the smallest representable number is excluded.
  */
-#define ISL_SIOIMATH_SMALL_MIN (-INT32_MAX)
+#define ISL_SIOIMATH_SMALL_MIN (-ISL_SIOIMATH_SMALL_MAX)
 
 /* Largest possible number in small representation */
+#ifdef USE_SMALL_INT_64
+#define ISL_SIOIMATH_SMALL_MAX (INT64_MAX >> 1)
+#else
 #define ISL_SIOIMATH_SMALL_MAX INT32_MAX
+#endif
+
+/* Multiply "lhs" and "rhs", store the result in "res" and return
+ * whether the multiplication overflowed.
+ * Without compiler support, overflow is detected using a division.
+ */
+#ifdef HAVE___BUILTIN_MUL_OVERFLOW
+#define isl_sioimath_mul_overflow(lhs, rhs, res)			\
+	__builtin_mul_overflow(lhs, rhs, res)
+#else
+#define isl_sioimath_mul_overflow(lhs, rhs, res)			\
+	isl_sioimath_mul_overflow_int64(lhs, rhs, res)
+#endif
 
 /* Used for function parameters the function modifies. */
 typedef isl_sioimath *isl_sioimath_ptr;
@@ -114,9 +155,13 @@ inline int isl_sioimath_is_big(isl_sioimath val)
 /* Get the number of an isl_int in small representation. Result is undefined if
  * val is not stored in that format.
  */
-inline int32_t isl_sioimath_get_small(isl_sioimath val)
+inline isl_sioimath_small isl_sioimath_get_small(isl_sioimath val)
 {
+#ifdef USE_SMALL_INT_64
+	return ((int64_t) val) >> 1;
+#else
 	return val >> 32;
+#endif
 }
 
 /* Get the number of an in isl_int in big representation. Result is undefined if
@@ -133,7 +178,8 @@ inline mp_int isl_sioimath_get_big(isl_sioimath val)
  * representation. If there is no such branch, then a single shift is still
  * cheaper than introducing branching code.
  */
-inline int isl_sioimath_decode_small(isl_sioimath val, int32_t *small)
+inline int isl_sioimath_decode_small(isl_sioimath val,
+	isl_sioimath_small *small)
 {
 	*small = isl_sioimath_get_small(val);
 	return isl_sioimath_is_small(val);
@@ -149,9 +195,31 @@ inline int isl_sioimath_decode_big(isl_sioimath val, mp_int *big)
 
 /* Encode a small representation into an isl_int.
  */
-inline isl_sioimath isl_sioimath_encode_small(int32_t val)
+inline isl_sioimath isl_sioimath_encode_small(isl_sioimath_small val)
 {
+#ifdef USE_SMALL_INT_64
+	return ((isl_sioimath) val) << 1 | 0x00000001;
+#else
 	return ((isl_sioimath) val) << 32 | 0x00000001;
+#endif
+}
+
+/* Multiply "lhs" and "rhs", store the result in "res" and return
+ * whether the multiplication overflowed, without relying on compiler support.
+ */
+inline int isl_sioimath_mul_overflow_int64(int64_t lhs, int64_t rhs,
+	int64_t *res)
+{
+	if (lhs == 0 || rhs == 0) {
+		*res = 0;
+		return 0;
+	}
+	if (lhs == INT64_MIN || rhs == INT64_MIN)
+		return 1;
+	if ((lhs < 0 ? -lhs : lhs) > INT64_MAX / (rhs < 0 ? -rhs : rhs))
+		return 1;
+	*res = lhs * rhs;
+	return 0;
 }
 
 /* Encode a big representation.
@@ -248,8 +316,12 @@ inline mp_int isl_sioimath_bigarg_src(isl_sioimath arg,
 	isl_sioimath_scratchspace_t *scratch)
 {
 	mp_int big;
-	int32_t small;
+	isl_sioimath_small small;
+#ifdef USE_SMALL_INT_64
+	uint64_t num;
+#else
 	uint32_t num;
+#endif
 
 	if (isl_sioimath_decode_big(arg, &big))
 		return big;
@@ -265,7 +337,11 @@ inline mp_int isl_sioimath_bigarg_src(isl_sioimath arg,
 		num = -small;
 	}
 
+#ifdef USE_SMALL_INT_64
+	isl_siomath_uint64_to_digits(num, scratch->digits, &scratch->big.used);
+#else
 	isl_siomath_uint32_to_digits(num, scratch->digits, &scratch->big.used);
+#endif
 	return &scratch->big;
 }
 
@@ -324,20 +400,28 @@ inline mp_int isl_sioimath_uiarg_src(unsigned long arg,
 	return &scratch->big;
 }
 
+/* The number of times the current thread has converted a number
+ * from small to big representation.
+ */
+extern ISL_THREAD_LOCAL unsigned long isl_sioimath_n_promotion;
+
 /* Ensure big representation. Does not preserve the current number.
  * Callers may use the fact that the value _is_ preserved if the presentation
  * was big before.
  */
 inline mp_int isl_sioimath_reinit_big(isl_sioimath_ptr ptr)
 {
-	if (isl_sioimath_is_small(*ptr))
+	if (isl_sioimath_is_small(*ptr)) {
+		isl_sioimath_n_promotion++;
 		*ptr = isl_sioimath_encode_big(mp_int_alloc());
+	}
 	return isl_sioimath_get_big(*ptr);
 }
 
 /* Set ptr to a number in small representation.
  */
-inline void isl_sioimath_set_small(isl_sioimath_ptr ptr, int32_t val)
+inline void isl_sioimath_set_small(isl_sioimath_ptr ptr,
+	isl_sioimath_small val)
 {
 	if (isl_sioimath_is_big(*ptr))
 		mp_int_free(isl_sioimath_get_big(*ptr));
@@ -374,7 +458,7 @@ inline void isl_sioimath_set_int64(isl_sioimath_ptr ptr, int64_t val)
  */
 inline void isl_sioimath_promote(isl_sioimath_ptr dst)
 {
-	int32_t small;
+	isl_sioimath_small small;
 
 	if (isl_sioimath_is_big(*dst))
 		return;
@@ -530,15 +614,17 @@ inline double isl_sioimath_get_d(isl_sioimath_src val)
 /* Format a number as decimal string.
  *
  * The largest possible string from small representation is 12 characters
- * ("-2147483647").
+ * ("-2147483647") or 21 characters ("-4611686018427387903")
+ * in the 63 bit representation.
  */
 inline char *isl_sioimath_get_str(isl_sioimath_src val)
 {
 	char *result;
 
 	if (isl_sioimath_is_small(val)) {
-		result = malloc(12);
-		snprintf(result, 12, "%" PRIi32, isl_sioimath_get_small(val));
+		result = malloc(21);
+		snprintf(result, 21, "%" PRIi64,
+			(int64_t) isl_sioimath_get_small(val));
 		return result;
 	}
 
@@ -589,7 +675,7 @@ inline void isl_sioimath_swap(isl_sioimath_ptr lhs, isl_sioimath_ptr rhs)
 inline void isl_sioimath_add_ui(isl_sioimath_ptr dst, isl_sioimath lhs,
 	unsigned long rhs)
 {
-	int32_t smalllhs;
+	isl_sioimath_small smalllhs;
 	isl_sioimath_scratchspace_t lhsscratch;
 
 	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
@@ -606,17 +692,17 @@ inline void isl_sioimath_add_ui(isl_sioimath_ptr dst, isl_sioimath lhs,
 /* Subtract an unsigned long.
  *
  * On LP64 unsigned long exceeds the range of an int64_t.  If
- * ISL_SIOIMATH_SMALL_MIN-rhs>=INT64_MIN we can do the calculation using int64_t
- * without risking an overflow.
+ * ISL_SIOIMATH_SMALL_MIN-rhs>=-INT64_MAX we can do the calculation using
+ * int64_t without risking an overflow.
  */
 inline void isl_sioimath_sub_ui(isl_sioimath_ptr dst, isl_sioimath lhs,
 				unsigned long rhs)
 {
-	int32_t smalllhs;
+	isl_sioimath_small smalllhs;
 	isl_sioimath_scratchspace_t lhsscratch;
 
 	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
-	    (rhs < (uint64_t) INT64_MIN - (uint64_t) ISL_SIOIMATH_SMALL_MIN)) {
+	    (rhs <= (uint64_t) INT64_MAX - (uint64_t) ISL_SIOIMATH_SMALL_MAX)) {
 		isl_sioimath_set_int64(dst, (int64_t) smalllhs - rhs);
 		return;
 	}
@@ -632,7 +718,7 @@ inline void isl_sioimath_add(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
-	int32_t smalllhs, smallrhs;
+	isl_sioimath_small smalllhs, smallrhs;
 
 	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
 	    isl_sioimath_decode_small(rhs, &smallrhs)) {
@@ -653,7 +739,7 @@ inline void isl_sioimath_sub(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
-	int32_t smalllhs, smallrhs;
+	isl_sioimath_small smalllhs, smallrhs;
 
 	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
 	    isl_sioimath_decode_small(rhs, &smallrhs)) {
@@ -674,12 +760,14 @@ inline void isl_sioimath_mul(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
-	int32_t smalllhs, smallrhs;
+	isl_sioimath_small smalllhs, smallrhs;
+	int64_t product;
 
 	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
-	    isl_sioimath_decode_small(rhs, &smallrhs)) {
-		isl_sioimath_set_int64(
-		    dst, (int64_t) smalllhs * (int64_t) smallrhs);
+	    isl_sioimath_decode_small(rhs, &smallrhs) &&
+	    !isl_sioimath_mul_overflow((int64_t) smalllhs, (int64_t) smallrhs,
+					&product)) {
+		isl_sioimath_set_int64(dst, product);
 		return;
 	}
 
@@ -696,10 +784,13 @@ inline void isl_sioimath_mul_2exp(isl_sioimath_ptr dst, isl_sioimath lhs,
 	unsigned long rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs;
-	int32_t smalllhs;
+	isl_sioimath_small smalllhs;
 
-	if (isl_sioimath_decode_small(lhs, &smalllhs) && (rhs <= 32ul)) {
-		isl_sioimath_set_int64(dst, ((int64_t) smalllhs) << rhs);
+	if (isl_sioimath_decode_small(lhs, &smalllhs) && (rhs < 63ul) &&
+	    (uint64_t) (smalllhs < 0 ? -(int64_t) smalllhs : smalllhs) <=
+					((uint64_t) INT64_MAX >> rhs)) {
+		isl_sioimath_set_int64(dst,
+		    (int64_t) smalllhs * ((int64_t) 1 << rhs));
 		return;
 	}
 
@@ -713,11 +804,13 @@ inline void isl_sioimath_mul_si(isl_sioimath_ptr dst, isl_sioimath lhs,
 	signed long rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
-	int32_t smalllhs;
+	isl_sioimath_small smalllhs;
+	int64_t product;
 
-	if (isl_sioimath_decode_small(lhs, &smalllhs) && (rhs > LONG_MIN) &&
-	    (labs(rhs) <= UINT32_MAX)) {
-		isl_sioimath_set_int64(dst, (int64_t) smalllhs * (int64_t) rhs);
+	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
+	    !isl_sioimath_mul_overflow((int64_t) smalllhs, (int64_t) rhs,
+					&product)) {
+		isl_sioimath_set_int64(dst, product);
 		return;
 	}
 
@@ -733,10 +826,14 @@ inline void isl_sioimath_mul_ui(isl_sioimath_ptr dst, isl_sioimath lhs,
 	unsigned long rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
-	int32_t smalllhs;
+	isl_sioimath_small smalllhs;
+	int64_t product;
 
-	if (isl_sioimath_decode_small(lhs, &smalllhs) && (rhs <= UINT32_MAX)) {
-		isl_sioimath_set_int64(dst, (int64_t) smalllhs * (int64_t) rhs);
+	if (isl_sioimath_decode_small(lhs, &smalllhs) &&
+	    (rhs <= (uint64_t) INT64_MAX) &&
+	    !isl_sioimath_mul_overflow((int64_t) smalllhs, (int64_t) rhs,
+					&product)) {
+		isl_sioimath_set_int64(dst, product);
 		return;
 	}
 
@@ -755,7 +852,7 @@ inline void isl_sioimath_pow_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs)
 {
 	isl_sioimath_scratchspace_t scratchlhs, scratchrhs;
-	int32_t smalllhs;
+	isl_sioimath_small smalllhs;
 
 	switch (rhs) {
 	case 0:
@@ -797,12 +894,42 @@ inline void isl_sioimath_pow_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_try_demote(dst);
 }
 
+/* Add "sign" times the product of "lhs" and "rhs" to "dst",
+ * where "dst" is in small representation.
+ * Return 0 if the result was computed and -1 if the big representation
+ * is needed for the product.
+ *
+ * If the absolute value of the product is within the range
+ * of the small representation, then the sum with "dst" fits in an int64_t.
+ */
+inline int isl_sioimath_small_addmul(isl_sioimath_ptr dst, int64_t lhs,
+	int64_t rhs, int sign)
+{
+	int64_t product;
+
+	if (isl_sioimath_mul_overflow(lhs, rhs, &product) ||
+	    product < ISL_SIOIMATH_SMALL_MIN || product > ISL_SIOIMATH_SMALL_MAX)
+		return -1;
+
+	isl_sioimath_set_int64(dst, (int64_t) isl_sioimath_get_small(*dst) +
+	    (sign > 0 ? product : -product));
+	return 0;
+}
+
 /* Fused multiply-add.
  */
 inline void isl_sioimath_addmul(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath tmp;
+	isl_sioimath_small smalllhs, smallrhs;
+
+	if (isl_sioimath_is_small(*dst) &&
+	    isl_sioimath_decode_small(lhs, &smalllhs) &&
+	    isl_sioimath_decode_small(rhs, &smallrhs) &&
+	    isl_sioimath_small_addmul(dst, smalllhs, smallrhs, 1) == 0)
+		return;
+
 	isl_sioimath_init(&tmp);
 	isl_sioimath_mul(&tmp, lhs, rhs);
 	isl_sioimath_add(dst, *dst, tmp);
@@ -815,6 +942,14 @@ inline void isl_sioimath_addmul_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs)
 {
 	isl_sioimath tmp;
+	isl_sioimath_small smalllhs;
+
+	if (isl_sioimath_is_small(*dst) &&
+	    isl_sioimath_decode_small(lhs, &smalllhs) &&
+	    rhs <= ISL_SIOIMATH_SMALL_MAX &&
+	    isl_sioimath_small_addmul(dst, smalllhs, rhs, 1) == 0)
+		return;
+
 	isl_sioimath_init(&tmp);
 	isl_sioimath_mul_ui(&tmp, lhs, rhs);
 	isl_sioimath_add(dst, *dst, tmp);
@@ -827,18 +962,34 @@ inline void isl_sioimath_submul(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath tmp;
+	isl_sioimath_small smalllhs, smallrhs;
+
+	if (isl_sioimath_is_small(*dst) &&
+	    isl_sioimath_decode_small(lhs, &smalllhs) &&
+	    isl_sioimath_decode_small(rhs, &smallrhs) &&
+	    isl_sioimath_small_addmul(dst, smalllhs, smallrhs, -1) == 0)
+		return;
+
 	isl_sioimath_init(&tmp);
 	isl_sioimath_mul(&tmp, lhs, rhs);
 	isl_sioimath_sub(dst, *dst, tmp);
 	isl_sioimath_clear(&tmp);
 }
 
-/* Fused multiply-add with an unsigned long.
+/* Fused multiply-subtract with an unsigned long.
  */
 inline void isl_sioimath_submul_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs)
 {
 	isl_sioimath tmp;
+	isl_sioimath_small smalllhs;
+
+	if (isl_sioimath_is_small(*dst) &&
+	    isl_sioimath_decode_small(lhs, &smalllhs) &&
+	    rhs <= ISL_SIOIMATH_SMALL_MAX &&
+	    isl_sioimath_small_addmul(dst, smalllhs, rhs, -1) == 0)
+		return;
+
 	isl_sioimath_init(&tmp);
 	isl_sioimath_mul_ui(&tmp, lhs, rhs);
 	isl_sioimath_sub(dst, *dst, tmp);
@@ -856,7 +1007,7 @@ inline void isl_sioimath_tdiv_q(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, rhssmall;
+	isl_sioimath_small lhssmall, rhssmall;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
 	    isl_sioimath_decode_small(rhs, &rhssmall)) {
@@ -877,11 +1028,12 @@ inline void isl_sioimath_tdiv_q_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall;
+	isl_sioimath_small lhssmall;
 
-	if (isl_sioimath_is_small(lhs) && (rhs <= (unsigned long) INT32_MAX)) {
+	if (isl_sioimath_is_small(lhs) &&
+	    (rhs <= (unsigned long) ISL_SIOIMATH_SMALL_MAX)) {
 		lhssmall = isl_sioimath_get_small(lhs);
-		isl_sioimath_set_small(dst, lhssmall / (int32_t) rhs);
+		isl_sioimath_set_small(dst, lhssmall / (isl_sioimath_small) rhs);
 		return;
 	}
 
@@ -903,9 +1055,9 @@ inline void isl_sioimath_tdiv_q_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 inline void isl_sioimath_cdiv_q(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
-	int32_t lhssmall, rhssmall;
+	isl_sioimath_small lhssmall, rhssmall;
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t q;
+	isl_sioimath_small q;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
 	    isl_sioimath_decode_small(rhs, &rhssmall)) {
@@ -934,14 +1086,15 @@ inline void isl_sioimath_cdiv_q_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, q;
+	isl_sioimath_small lhssmall, q;
 
-	if (isl_sioimath_decode_small(lhs, &lhssmall) && (rhs <= INT32_MAX)) {
+	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
+	    (rhs <= ISL_SIOIMATH_SMALL_MAX)) {
 		if (lhssmall >= 0)
 			q = ((int64_t) lhssmall + ((int64_t) rhs - 1)) /
 			    (int64_t) rhs;
 		else
-			q = lhssmall / (int32_t) rhs;
+			q = lhssmall / (isl_sioimath_small) rhs;
 		isl_sioimath_set_small(dst, q);
 		return;
 	}
@@ -958,8 +1111,8 @@ inline void isl_sioimath_fdiv_q(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, rhssmall;
-	int32_t q;
+	isl_sioimath_small lhssmall, rhssmall;
+	isl_sioimath_small q;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
 	    isl_sioimath_decode_small(rhs, &rhssmall)) {
@@ -988,11 +1141,12 @@ inline void isl_sioimath_fdiv_q_ui(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 	unsigned long rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, q;
+	isl_sioimath_small lhssmall, q;
 
-	if (isl_sioimath_decode_small(lhs, &lhssmall) && (rhs <= INT32_MAX)) {
+	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
+	    (rhs <= ISL_SIOIMATH_SMALL_MAX)) {
 		if (lhssmall >= 0)
-			q = (uint32_t) lhssmall / rhs;
+			q = (uint64_t) lhssmall / rhs;
 		else
 			q = ((int64_t) lhssmall - ((int64_t) rhs - 1)) /
 			    (int64_t) rhs;
@@ -1014,7 +1168,7 @@ inline void isl_sioimath_fdiv_r(isl_sioimath_ptr dst, isl_sioimath_src lhs,
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
 	int64_t lhssmall, rhssmall;
-	int32_t r;
+	isl_sioimath_small r;
 
 	if (isl_sioimath_is_small(lhs) && isl_sioimath_is_small(rhs)) {
 		lhssmall = isl_sioimath_get_small(lhs);
@@ -1039,7 +1193,7 @@ void isl_sioimath_read(isl_sioimath_ptr dst, const char *str);
  */
 inline int isl_sioimath_sgn(isl_sioimath_src arg)
 {
-	int32_t small;
+	isl_sioimath_small small;
 
 	if (isl_sioimath_decode_small(arg, &small))
 		return (small > 0) - (small < 0);
@@ -1055,7 +1209,7 @@ inline int isl_sioimath_sgn(isl_sioimath_src arg)
 inline int isl_sioimath_cmp(isl_sioimath_src lhs, isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, rhssmall;
+	isl_sioimath_small lhssmall, rhssmall;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
 	    isl_sioimath_decode_small(rhs, &rhssmall))
@@ -1077,7 +1231,7 @@ inline int isl_sioimath_cmp(isl_sioimath_src lhs, isl_sioimath_src rhs)
  */
 inline int isl_sioimath_cmp_si(isl_sioimath_src lhs, signed long rhs)
 {
-	int32_t lhssmall;
+	isl_sioimath_small lhssmall;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall))
 		return (lhssmall > rhs) - (lhssmall < rhs);
@@ -1093,7 +1247,7 @@ inline int isl_sioimath_cmp_si(isl_sioimath_src lhs, signed long rhs)
 inline int isl_sioimath_abs_cmp(isl_sioimath_src lhs, isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, rhssmall;
+	isl_sioimath_small lhssmall, rhssmall;
 
 	if (isl_sioimath_decode_small(lhs, &lhssmall) &&
 	    isl_sioimath_decode_small(rhs, &rhssmall)) {
@@ -1115,7 +1269,7 @@ inline int isl_sioimath_is_divisible_by(isl_sioimath_src lhs,
 					isl_sioimath_src rhs)
 {
 	isl_sioimath_scratchspace_t lhsscratch, rhsscratch;
-	int32_t lhssmall, rhssmall;
+	isl_sioimath_small lhssmall, rhssmall;
 	mpz_t rem;
 	int cmp;
 
@@ -1144,10 +1298,10 @@ inline int isl_sioimath_is_divisible_by(isl_sioimath_src lhs,
  */
 inline uint32_t isl_sioimath_hash(isl_sioimath_src arg, uint32_t hash)
 {
-	int32_t small;
+	isl_sioimath_small small;
 	int i;
-	uint32_t num;
-	mp_digit digits[(sizeof(uint32_t) + sizeof(mp_digit) - 1) /
+	uint64_t num;
+	mp_digit digits[(sizeof(uint64_t) + sizeof(mp_digit) - 1) /
 	                sizeof(mp_digit)];
 	mp_size used;
 	const unsigned char *digitdata = (const unsigned char *) &digits;
@@ -1157,7 +1311,7 @@ inline uint32_t isl_sioimath_hash(isl_sioimath_src arg, uint32_t hash)
 			isl_hash_byte(hash, 0xFF);
 		num = labs(small);
 
-		isl_siomath_uint32_to_digits(num, digits, &used);
+		isl_siomath_uint64_to_digits(num, digits, &used);
 		for (i = 0; i < used * sizeof(mp_digit); i += 1)
 			isl_hash_byte(hash, digitdata[i]);
 		return hash;
@@ -1175,10 +1329,10 @@ inline uint32_t isl_sioimath_hash(isl_sioimath_src arg, uint32_t hash)
  */
 inline size_t isl_sioimath_sizeinbase(isl_sioimath_src arg, int base)
 {
-	int32_t small;
+	isl_sioimath_small small;
 
 	if (isl_sioimath_decode_small(arg, &small))
-		return sizeof(int32_t) * CHAR_BIT - 1;
+		return sizeof(isl_sioimath_small) * CHAR_BIT - 1;
 
 	return impz_sizeinbase(isl_sioimath_get_big(arg), base);
 }
@@ -1187,6 +1341,7 @@ void isl_sioimath_print(FILE *out, isl_sioimath_src i, int width);
 void isl_sioimath_dump(isl_sioimath_src arg);
 
 typedef isl_sioimath isl_int[1];
+#define isl_int_n_promotion()		isl_sioimath_n_promotion
 #define isl_int_init(i)			isl_sioimath_init((i))
 #define isl_int_clear(i)		isl_sioimath_clear((i))
 
@@ -1251,4 +1406,18 @@ typedef isl_sioimath isl_int[1];
 #define isl_int_free_str(s)		free(s)
 #define isl_int_print(out, i, width)	isl_sioimath_print(out, *(i), width)
 
+/* Direct access to the representation for the kernels in isl_seq.c.
+ * A value "v" in small representation is stored in the word
+ * (v << ISL_INT_SMALL_SHIFT) | 1.
+ */
+#ifdef USE_SMALL_INT_64
+#define ISL_INT_SMALL_SHIFT		1
+#else
+#define ISL_INT_SMALL_SHIFT		32
+#endif
+#define ISL_INT_SMALL_MAX		ISL_SIOIMATH_SMALL_MAX
+#define isl_int_is_small(i)		isl_sioimath_is_small(*(i))
+#define isl_int_get_small(i)		((int64_t) isl_sioimath_get_small(*(i)))
+#define isl_int_set_int64(r, v)		isl_sioimath_set_int64((r), v)
+
 #endif /* ISL_INT_SIOIMATH_H */
@@ -13,6 +13,7 @@
  * and Ecole Normale Superieure, 45 rue d’Ulm, 75230 Paris, France
  */
 
+#include <isl_ctx_private.h>
 #include <isl_sort.h>
 #include <isl_tarjan.h>
 #include <isl/printer.h>
@@ -59,7 +60,7 @@ __isl_give LIST(EL) *FN(LIST(EL),copy)(__isl_keep LIST(EL) *list)
 	if (!list)
 		return NULL;
 
-	list->ref++;
+	isl_atomic_inc(&list->ref);
 	return list;
 }
 
@@ -81,13 +82,16 @@ __isl_give LIST(EL) *FN(LIST(EL),dup)(__isl_keep LIST(EL) *list)
 
 __isl_give LIST(EL) *FN(LIST(EL),cow)(__isl_take LIST(EL) *list)
 {
+	LIST(EL) *dup;
+
 	if (!list)
 		return NULL;
 
-	if (list->ref == 1)
+	if (isl_atomic_get(&list->ref) == 1)
 		return list;
-	list->ref--;
-	return FN(LIST(EL),dup)(list);
+	dup = FN(LIST(EL),dup)(list);
+	FN(LIST(EL),free)(list);
+	return dup;
 }
 
 /* Make sure "list" has room for at least "n" more pieces.
@@ -104,12 +108,12 @@ static __isl_give LIST(EL) *FN(LIST(EL),grow)(__isl_take LIST(EL) *list, int n)
 
 	if (!list)
 		return NULL;
-	if (list->ref == 1 && list->n + n <= list->size)
+	if (isl_atomic_get(&list->ref) == 1 && list->n + n <= list->size)
 		return list;
 
 	ctx = FN(LIST(EL),get_ctx)(list);
 	new_size = ((list->n + n + 1) * 3) / 2;
-	if (list->ref == 1) {
+	if (isl_atomic_get(&list->ref) == 1) {
 		res = isl_realloc(ctx, list, LIST(EL),
 			    sizeof(LIST(EL)) + (new_size - 1) * sizeof(EL *));
 		if (!res)
@@ -205,7 +209,7 @@ __isl_give LIST(EL) *FN(LIST(EL),insert)(__isl_take LIST(EL) *list,
 		isl_die(ctx, isl_error_invalid,
 			"index out of bounds", goto error);
 
-	if (list->ref == 1 && list->size > list->n) {
+	if (isl_atomic_get(&list->ref) == 1 && list->size > list->n) {
 		for (i = list->n; i > pos; --i)
 			list->p[i] = list->p[i - 1];
 		list->n++;
@@ -235,7 +239,7 @@ __isl_null LIST(EL) *FN(LIST(EL),free)(__isl_take LIST(EL) *list)
 	if (!list)
 		return NULL;
 
-	if (--list->ref > 0)
+	if (isl_atomic_dec(&list->ref) > 0)
 		return NULL;
 
 	isl_ctx_deref(list->ctx);
@@ -300,7 +304,7 @@ static __isl_give EL *FN(FN(LIST(EL),take),BASE)(__isl_keep LIST(EL) *list,
 
 	if (FN(LIST(EL),check_index)(list, index) < 0)
 		return NULL;
-	if (list->ref != 1)
+	if (isl_atomic_get(&list->ref) != 1)
 		return FN(FN(LIST(EL),get),BASE)(list, index);
 	el = list->p[index];
 	list->p[index] = NULL;
@@ -558,7 +562,8 @@ __isl_give LIST(EL) *FN(LIST(EL),concat)(__isl_take LIST(EL) *list1,
 	if (!list1 || !list2)
 		goto error;
 
-	if (list1->ref == 1 && list1->n + list2->n <= list1->size)
+	if (isl_atomic_get(&list1->ref) == 1 &&
+	    list1->n + list2->n <= list1->size)
 		return FN(LIST(EL),concat_inplace)(list1, list2);
 
 	ctx = FN(LIST(EL),get_ctx)(list1);
@@ -96,7 +96,7 @@ __isl_give isl_local_space *isl_local_space_copy(__isl_keep isl_local_space *ls)
 	if (!ls)
 		return NULL;
 
-	ls->ref++;
+	isl_atomic_inc(&ls->ref);
 	return ls;
 }
 
@@ -112,13 +112,16 @@ __isl_give isl_local_space *isl_local_space_dup(__isl_keep isl_local_space *ls)
 
 __isl_give isl_local_space *isl_local_space_cow(__isl_take isl_local_space *ls)
 {
+	isl_local_space *dup;
+
 	if (!ls)
 		return NULL;
 
-	if (ls->ref == 1)
+	if (isl_atomic_get(&ls->ref) == 1)
 		return ls;
-	ls->ref--;
-	return isl_local_space_dup(ls);
+	dup = isl_local_space_dup(ls);
+	isl_local_space_free(ls);
+	return dup;
 }
 
 __isl_null isl_local_space *isl_local_space_free(
@@ -127,7 +130,7 @@ __isl_null isl_local_space *isl_local_space_free(
 	if (!ls)
 		return NULL;
 
-	if (--ls->ref > 0)
+	if (isl_atomic_dec(&ls->ref) > 0)
 		return NULL;
 
 	isl_space_free(ls->dim);
@@ -386,7 +389,7 @@ __isl_give isl_space *isl_local_space_take_space(__isl_keep isl_local_space *ls)
 
 	if (!ls)
 		return NULL;
-	if (ls->ref != 1)
+	if (isl_atomic_get(&ls->ref) != 1)
 		return isl_local_space_get_space(ls);
 	space = ls->dim;
 	ls->dim = NULL;
@@ -949,21 +952,23 @@ __isl_give isl_local_space *isl_local_space_add_dims(
  */
 static void normalize_div(__isl_keep isl_local_space *ls, int div)
 {
-	isl_ctx *ctx = ls->div->ctx;
+	struct isl_ctx_local *local = isl_ctx_local(ls->div->ctx);
 	unsigned total = ls->div->n_col - 2;
 
-	isl_seq_gcd(ls->div->row[div] + 2, total, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd,
-		    ctx->normalize_gcd, ls->div->row[div][0]);
-	if (isl_int_is_one(ctx->normalize_gcd))
+	if (!local)
+		return;
+	isl_seq_gcd(ls->div->row[div] + 2, total, &local->normalize_gcd);
+	isl_int_gcd(local->normalize_gcd,
+		    local->normalize_gcd, ls->div->row[div][0]);
+	if (isl_int_is_one(local->normalize_gcd))
 		return;
 
 	isl_seq_scale_down(ls->div->row[div] + 2, ls->div->row[div] + 2,
-			    ctx->normalize_gcd, total);
+			    local->normalize_gcd, total);
 	isl_int_divexact(ls->div->row[div][0], ls->div->row[div][0],
-			    ctx->normalize_gcd);
+			    local->normalize_gcd);
 	isl_int_fdiv_q(ls->div->row[div][1], ls->div->row[div][1],
-			    ctx->normalize_gcd);
+			    local->normalize_gcd);
 }
 
 /* Exploit the equalities in "eq" to simplify the expressions of
@@ -21,6 +21,7 @@
 
 #include <string.h>
 #include <isl_ctx_private.h>
+#include <isl_arena_private.h>
 #include <isl_map_private.h>
 #include <isl_blk.h>
 #include <isl/constraint.h>
@@ -43,6 +44,7 @@
 #include <isl_options_private.h>
 #include <isl_morph.h>
 #include <isl_val_private.h>
+#include <isl_memo.h>
 
 #include <bset_to_bmap.c>
 #include <bset_from_bmap.c>
@@ -1117,7 +1119,7 @@ static struct isl_basic_map *basic_map_init(struct isl_ctx *ctx,
 	if (isl_blk_is_error(bmap->block))
 		goto error;
 
-	bmap->ineq = isl_alloc_array(ctx, isl_int *, n_ineq + n_eq);
+	bmap->ineq = isl_arena_alloc_array(ctx, isl_int *, n_ineq + n_eq);
 	if ((n_ineq + n_eq) && !bmap->ineq)
 		goto error;
 
@@ -1129,7 +1131,7 @@ static struct isl_basic_map *basic_map_init(struct isl_ctx *ctx,
 		if (isl_blk_is_error(bmap->block2))
 			goto error;
 
-		bmap->div = isl_alloc_array(ctx, isl_int *, extra);
+		bmap->div = isl_arena_alloc_array(ctx, isl_int *, extra);
 		if (!bmap->div)
 			goto error;
 	}
@@ -1192,7 +1194,7 @@ struct isl_basic_map *isl_basic_map_alloc_space(__isl_take isl_space *dim,
 
 	if (!dim)
 		return NULL;
-	bmap = isl_calloc_type(dim->ctx, struct isl_basic_map);
+	bmap = isl_arena_calloc_type(dim->ctx, struct isl_basic_map);
 	if (!bmap)
 		goto error;
 	bmap->dim = dim;
@@ -1265,13 +1267,17 @@ struct isl_basic_set *isl_basic_set_dup(struct isl_basic_set *bset)
 	return bset_from_bmap(dup);
 }
 
+/* Return a copy of "bset".
+ * See isl_basic_map_copy.
+ */
 __isl_give isl_basic_set *isl_basic_set_copy(__isl_keep isl_basic_set *bset)
 {
 	if (!bset)
 		return NULL;
 
-	if (ISL_F_ISSET(bset, ISL_BASIC_SET_FINAL)) {
-		bset->ref++;
+	if (ISL_F_ISSET(bset, ISL_BASIC_SET_FINAL) &&
+	    !isl_ctx_concurrent(bset->ctx)) {
+		isl_atomic_inc(&bset->ref);
 		return bset;
 	}
 	return isl_basic_set_dup(bset);
@@ -1282,17 +1288,28 @@ __isl_give isl_set *isl_set_copy(__isl_keep isl_set *set)
 	if (!set)
 		return NULL;
 
-	set->ref++;
+	isl_atomic_inc(&set->ref);
 	return set;
 }
 
+/* Return a copy of "bmap".
+ *
+ * A basic map is only shared if it has been marked final.
+ * Many operations modify the basic maps that they are passed
+ * in place, without changing their meaning, even if
+ * they are shared, e.g., by marking them final or
+ * by temporarily negating some of their constraints.
+ * In a concurrent isl_ctx, this is only safe if no other thread
+ * can access the basic map, so basic maps are then never shared.
+ */
 __isl_give isl_basic_map *isl_basic_map_copy(__isl_keep isl_basic_map *bmap)
 {
 	if (!bmap)
 		return NULL;
 
-	if (ISL_F_ISSET(bmap, ISL_BASIC_SET_FINAL)) {
-		bmap->ref++;
+	if (ISL_F_ISSET(bmap, ISL_BASIC_SET_FINAL) &&
+	    !isl_ctx_concurrent(bmap->ctx)) {
+		isl_atomic_inc(&bmap->ref);
 		return bmap;
 	}
 	bmap = isl_basic_map_dup(bmap);
@@ -1306,7 +1323,7 @@ __isl_give isl_map *isl_map_copy(__isl_keep isl_map *map)
 	if (!map)
 		return NULL;
 
-	map->ref++;
+	isl_atomic_inc(&map->ref);
 	return map;
 }
 
@@ -1315,17 +1332,17 @@ __isl_null isl_basic_map *isl_basic_map_free(__isl_take isl_basic_map *bmap)
 	if (!bmap)
 		return NULL;
 
-	if (--bmap->ref > 0)
+	if (isl_atomic_dec(&bmap->ref) > 0)
 		return NULL;
 
 	isl_ctx_deref(bmap->ctx);
-	free(bmap->div);
+	isl_arena_free(bmap->ctx, bmap->div);
 	isl_blk_free(bmap->ctx, bmap->block2);
-	free(bmap->ineq);
+	isl_arena_free(bmap->ctx, bmap->ineq);
 	isl_blk_free(bmap->ctx, bmap->block);
 	isl_vec_free(bmap->sample);
 	isl_space_free(bmap->dim);
-	free(bmap);
+	isl_arena_free(bmap->ctx, bmap);
 
 	return NULL;
 }
@@ -1915,9 +1932,10 @@ __isl_give isl_basic_map *isl_basic_map_cow(__isl_take isl_basic_map *bmap)
 	if (!bmap)
 		return NULL;
 
-	if (bmap->ref > 1) {
-		bmap->ref--;
-		bmap = isl_basic_map_dup(bmap);
+	if (isl_atomic_get(&bmap->ref) > 1) {
+		isl_basic_map *dup = isl_basic_map_dup(bmap);
+		isl_basic_map_free(bmap);
+		bmap = dup;
 	}
 	if (bmap) {
 		ISL_F_CLR(bmap, ISL_BASIC_SET_FINAL);
@@ -1957,13 +1975,16 @@ __isl_give isl_set *isl_set_cow(__isl_take isl_set *set)
  */
 __isl_give isl_map *isl_map_cow(__isl_take isl_map *map)
 {
+	isl_map *dup;
+
 	if (!map)
 		return NULL;
 
-	if (map->ref == 1)
+	if (isl_atomic_get(&map->ref) == 1)
 		return clear_caches(map);
-	map->ref--;
-	return isl_map_dup(map);
+	dup = isl_map_dup(map);
+	isl_map_free(map);
+	return dup;
 }
 
 static void swap_vars(struct isl_blk blk, isl_int *a,
@@ -4227,7 +4248,8 @@ static __isl_give isl_basic_map *insert_div_rows(__isl_take isl_basic_map *bmap,
 					(bmap->extra + n) * (1 + row_size));
 	if (!bmap->block2.data)
 		return isl_basic_map_free(bmap);
-	new_div = isl_alloc_array(bmap->ctx, isl_int *, bmap->extra + n);
+	new_div = isl_arena_alloc_array(bmap->ctx, isl_int *,
+					bmap->extra + n);
 	if (!new_div)
 		return isl_basic_map_free(bmap);
 	for (i = 0; i < n; ++i) {
@@ -4237,7 +4259,7 @@ static __isl_give isl_basic_map *insert_div_rows(__isl_take isl_basic_map *bmap,
 	}
 	for (i = 0; i < bmap->extra; ++i)
 		new_div[n + i] = bmap->block2.data + (bmap->div[i] - old);
-	free(bmap->div);
+	isl_arena_free(bmap->ctx, bmap->div);
 	bmap->div = new_div;
 	bmap->n_div += n;
 	bmap->extra += n;
@@ -5396,7 +5418,8 @@ __isl_give isl_basic_map *isl_basic_map_overlying_set(
 					bmap->extra * (1 + 1 + total));
 		if (isl_blk_is_error(bmap->block2))
 			goto error;
-		div = isl_realloc_array(ctx, bmap->div, isl_int *, bmap->extra);
+		div = isl_arena_realloc_array(ctx, bmap->div, isl_int *,
+						bmap->extra);
 		if (!div)
 			goto error;
 		bmap->div = div;
@@ -6062,7 +6085,7 @@ __isl_null isl_map *isl_map_free(__isl_take isl_map *map)
 	if (!map)
 		return NULL;
 
-	if (--map->ref > 0)
+	if (isl_atomic_dec(&map->ref) > 0)
 		return NULL;
 
 	clear_caches(map);
@@ -6211,6 +6234,21 @@ static int remove_if_empty(__isl_keep isl_map *map, int i)
 	return 0;
 }
 
+/* Return "map" itself if its basic maps may be replaced in place
+ * by equivalent basic maps, even if we are not holding the only reference,
+ * and a copy with a single reference otherwise.
+ * The basic maps of a map that may be accessed by other threads
+ * cannot be replaced in place.
+ */
+static __isl_give isl_map *cow_if_concurrent(__isl_take isl_map *map)
+{
+	if (!map)
+		return NULL;
+	if (isl_ctx_may_update_shared(map->ctx, &map->ref))
+		return map;
+	return isl_map_cow(map);
+}
+
 /* Perform "fn" on each basic map of "map", where we may not be holding
  * the only reference to "map".
  * In particular, "fn" should be a semantics preserving operation
@@ -6224,6 +6262,7 @@ __isl_give isl_map *isl_map_inline_foreach_basic_map(__isl_take isl_map *map,
 	struct isl_basic_map *bmap;
 	int i;
 
+	map = cow_if_concurrent(map);
 	if (!map)
 		return NULL;
 
@@ -8394,7 +8433,7 @@ isl_bool isl_basic_set_is_equal(__isl_keep isl_basic_set *bset1,
 		bset_to_bmap(bset1), bset_to_bmap(bset2));
 }
 
-isl_bool isl_map_is_empty(__isl_keep isl_map *map)
+static isl_bool map_is_empty(__isl_keep isl_map *map)
 {
 	int i;
 	int is_empty;
@@ -8411,6 +8450,32 @@ isl_bool isl_map_is_empty(__isl_keep isl_map *map)
 	return isl_bool_true;
 }
 
+/* Is "map" empty?
+ *
+ * If the memo table is enabled for emptiness tests, then first check
+ * whether the emptiness of an identical map has been determined before.
+ */
+isl_bool isl_map_is_empty(__isl_keep isl_map *map)
+{
+	struct isl_memo_key key;
+	isl_bool memo, empty;
+
+	if (!map)
+		return isl_bool_error;
+	if (map->n == 0)
+		return isl_bool_true;
+
+	memo = isl_memo_key_init(&key, ISL_MEMO_IS_EMPTY, map, NULL);
+	if (!memo)
+		return map_is_empty(map);
+	empty = isl_memo_find_bool(&key);
+	if (empty >= 0)
+		return empty;
+	empty = map_is_empty(map);
+	isl_memo_add_bool(&key, empty);
+	return empty;
+}
+
 isl_bool isl_map_plain_is_empty(__isl_keep isl_map *map)
 {
 	return map ? map->n == 0 : isl_bool_error;
@@ -8602,11 +8667,60 @@ isl_bool isl_set_plain_is_universe(__isl_keep isl_set *set)
 	return isl_map_plain_is_universe(set_to_map(set));
 }
 
+/* Is the rational basic map "bmap" empty?
+ *
+ * Any point satisfying all constraints of a non-empty tableau
+ * is a valid (rational) sample of "bmap".
+ * If "update" is set, then this sample is stored inside "bmap"
+ * for later reuse or "bmap" is marked empty.
+ */
+static isl_bool basic_map_rational_is_empty(__isl_keep isl_basic_map *bmap,
+	int update)
+{
+	struct isl_tab *tab;
+	struct isl_vec *sample = NULL;
+	isl_bool empty;
+
+	tab = isl_tab_from_basic_map(bmap, 0);
+	if (!tab)
+		return isl_bool_error;
+	empty = tab->empty;
+	if (!empty && update) {
+		sample = isl_tab_get_sample_value(tab);
+		if (!sample)
+			empty = isl_bool_error;
+	}
+	isl_tab_free(tab);
+
+	if (empty < 0 || !update)
+		return empty;
+	if (empty) {
+		ISL_F_SET(bmap, ISL_BASIC_MAP_EMPTY);
+	} else {
+		isl_vec_free(bmap->sample);
+		bmap->sample = sample;
+	}
+
+	return empty;
+}
+
+/* Is "bmap" empty?
+ *
+ * The sample computed along the way is stored inside "bmap"
+ * for later reuse, unless "bmap" may be accessed by other threads,
+ * which is the case for any object in a concurrent isl_ctx
+ * since "bmap" may be part of a shared object.
+ * Similarly, "bmap" is marked empty if it turns out to be empty.
+ * Since the cached sample is only used after checking that
+ * it still satisfies the constraints of "bmap", it does not need
+ * to be invalidated when "bmap" is modified.
+ */
 isl_bool isl_basic_map_is_empty(__isl_keep isl_basic_map *bmap)
 {
 	struct isl_basic_set *bset = NULL;
 	struct isl_vec *sample = NULL;
 	isl_bool empty, non_empty;
+	int update;
 
 	if (!bmap)
 		return isl_bool_error;
@@ -8617,21 +8731,20 @@ isl_bool isl_basic_map_is_empty(__isl_keep isl_basic_map *bmap)
 	if (isl_basic_map_plain_is_universe(bmap))
 		return isl_bool_false;
 
-	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL)) {
-		struct isl_basic_map *copy = isl_basic_map_copy(bmap);
-		copy = isl_basic_map_remove_redundancies(copy);
-		empty = isl_basic_map_plain_is_empty(copy);
-		isl_basic_map_free(copy);
-		return empty;
-	}
-
 	non_empty = isl_basic_map_plain_is_non_empty(bmap);
 	if (non_empty < 0)
 		return isl_bool_error;
 	if (non_empty)
 		return isl_bool_false;
-	isl_vec_free(bmap->sample);
-	bmap->sample = NULL;
+	update = isl_ctx_may_update_kept(bmap->ctx);
+
+	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
+		return basic_map_rational_is_empty(bmap, update);
+
+	if (update) {
+		isl_vec_free(bmap->sample);
+		bmap->sample = NULL;
+	}
 	bset = isl_basic_map_underlying_set(isl_basic_map_copy(bmap));
 	if (!bset)
 		return isl_bool_error;
@@ -8639,6 +8752,10 @@ isl_bool isl_basic_map_is_empty(__isl_keep isl_basic_map *bmap)
 	if (!sample)
 		return isl_bool_error;
 	empty = sample->size == 0;
+	if (!update) {
+		isl_vec_free(sample);
+		return empty;
+	}
 	isl_vec_free(bmap->sample);
 	bmap->sample = sample;
 	if (empty)
@@ -8664,6 +8781,7 @@ isl_bool isl_basic_set_plain_is_empty(__isl_keep isl_basic_set *bset)
 /* Is "bmap" known to be non-empty?
  *
  * That is, is the cached sample still valid?
+ * The sample may only be a rational point if "bmap" is rational.
  */
 isl_bool isl_basic_map_plain_is_non_empty(__isl_keep isl_basic_map *bmap)
 {
@@ -8676,6 +8794,9 @@ isl_bool isl_basic_map_plain_is_non_empty(__isl_keep isl_basic_map *bmap)
 	total = 1 + isl_basic_map_total_dim(bmap);
 	if (bmap->sample->size != total)
 		return isl_bool_false;
+	if (!ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL) &&
+	    !isl_int_is_one(bmap->sample->el[0]))
+		return isl_bool_false;
 	return isl_basic_map_contains(bmap, bmap->sample);
 }
 
@@ -9619,6 +9740,9 @@ __isl_give isl_map *isl_map_remove_obvious_duplicates(__isl_take isl_map *map)
 		return map;
 	if (ISL_F_ISSET(map, ISL_MAP_NORMALIZED | ISL_MAP_DISJOINT))
 		return map;
+	map = cow_if_concurrent(map);
+	if (!map)
+		return NULL;
 	for (i = 0; i < map->n; ++i) {
 		bmap = isl_basic_map_copy(map->p[i]);
 		bmap = isl_basic_map_sort_constraints(bmap);
@@ -9645,6 +9769,9 @@ __isl_give isl_map *isl_map_normalize(__isl_take isl_map *map)
 		return NULL;
 	if (ISL_F_ISSET(map, ISL_MAP_NORMALIZED))
 		return map;
+	map = cow_if_concurrent(map);
+	if (!map)
+		return NULL;
 	for (i = 0; i < map->n; ++i) {
 		bmap = isl_basic_map_normalize(isl_basic_map_copy(map->p[i]));
 		if (!bmap)
@@ -13488,18 +13615,20 @@ __isl_give isl_basic_map *isl_basic_map_set_div_expr_constant_num_si_inplace(
 static isl_bool is_internal(__isl_keep isl_vec *inner,
 	__isl_keep isl_basic_set *bset, int ineq)
 {
-	isl_ctx *ctx;
+	struct isl_ctx_local *local;
 	int pos;
 	unsigned total;
 
 	if (!inner || !bset)
 		return isl_bool_error;
 
-	ctx = isl_basic_set_get_ctx(bset);
+	local = isl_ctx_local(isl_basic_set_get_ctx(bset));
+	if (!local)
+		return isl_bool_error;
 	isl_seq_inner_product(inner->el, bset->ineq[ineq], inner->size,
-				&ctx->normalize_gcd);
-	if (!isl_int_is_zero(ctx->normalize_gcd))
-		return isl_int_is_nonneg(ctx->normalize_gcd);
+				&local->normalize_gcd);
+	if (!isl_int_is_zero(local->normalize_gcd))
+		return isl_int_is_nonneg(local->normalize_gcd);
 
 	total = isl_basic_set_dim(bset, isl_dim_all);
 	pos = isl_seq_first_non_zero(bset->ineq[ineq] + 1, total);
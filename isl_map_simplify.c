@@ -22,6 +22,7 @@
 #include <isl_space_private.h>
 #include <isl_mat_private.h>
 #include <isl_vec_private.h>
+#include <isl_memo.h>
 
 #include <bset_to_bmap.c>
 #include <bset_from_bmap.c>
@@ -237,20 +238,23 @@ static __isl_give isl_basic_map *reduce_div_coefficients(
 static void normalize_div_expression(__isl_keep isl_basic_map *bmap, int div)
 {
 	unsigned total = isl_basic_map_total_dim(bmap);
-	isl_ctx *ctx = bmap->ctx;
+	struct isl_ctx_local *local = isl_ctx_local(bmap->ctx);
 
+	if (!local)
+		return;
 	if (isl_int_is_zero(bmap->div[div][0]))
 		return;
-	isl_seq_gcd(bmap->div[div] + 2, total, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd, ctx->normalize_gcd, bmap->div[div][0]);
-	if (isl_int_is_one(ctx->normalize_gcd))
+	isl_seq_gcd(bmap->div[div] + 2, total, &local->normalize_gcd);
+	isl_int_gcd(local->normalize_gcd,
+		    local->normalize_gcd, bmap->div[div][0]);
+	if (isl_int_is_one(local->normalize_gcd))
 		return;
 	isl_int_fdiv_q(bmap->div[div][1], bmap->div[div][1],
-			ctx->normalize_gcd);
+			local->normalize_gcd);
 	isl_int_divexact(bmap->div[div][0], bmap->div[div][0],
-			ctx->normalize_gcd);
+			local->normalize_gcd);
 	isl_seq_scale_down(bmap->div[div] + 2, bmap->div[div] + 2,
-			ctx->normalize_gcd, total);
+			local->normalize_gcd, total);
 }
 
 /* Remove any common factor in numerator and denominator of a div expression,
@@ -2486,7 +2490,7 @@ static __isl_give isl_basic_set *uset_gist_compressed(
 	__isl_take isl_basic_set *bset, __isl_take isl_basic_set *context,
 	__isl_take isl_mat *T)
 {
-	isl_ctx *ctx;
+	struct isl_ctx_local *local;
 	isl_mat *ineq;
 	int i, n_row, n_col;
 	isl_int rem;
@@ -2503,21 +2507,24 @@ static __isl_give isl_basic_set *uset_gist_compressed(
 		return isl_basic_set_set_to_empty(bset);
 	}
 
-	ctx = isl_mat_get_ctx(ineq);
+	local = isl_ctx_local(isl_mat_get_ctx(ineq));
+	if (!local)
+		goto error;
 	n_row = isl_mat_rows(ineq);
 	n_col = isl_mat_cols(ineq);
 	isl_int_init(rem);
 	for (i = 0; i < n_row; ++i) {
-		isl_seq_gcd(ineq->row[i] + 1, n_col - 1, &ctx->normalize_gcd);
-		if (isl_int_is_zero(ctx->normalize_gcd))
+		isl_seq_gcd(ineq->row[i] + 1, n_col - 1,
+			    &local->normalize_gcd);
+		if (isl_int_is_zero(local->normalize_gcd))
 			continue;
-		if (isl_int_is_one(ctx->normalize_gcd))
+		if (isl_int_is_one(local->normalize_gcd))
 			continue;
 		isl_seq_scale_down(ineq->row[i] + 1, ineq->row[i] + 1,
-				    ctx->normalize_gcd, n_col - 1);
-		isl_int_fdiv_r(rem, ineq->row[i][0], ctx->normalize_gcd);
+				    local->normalize_gcd, n_col - 1);
+		isl_int_fdiv_r(rem, ineq->row[i][0], local->normalize_gcd);
 		isl_int_fdiv_q(ineq->row[i][0],
-				ineq->row[i][0], ctx->normalize_gcd);
+				ineq->row[i][0], local->normalize_gcd);
 		if (isl_int_is_zero(rem))
 			continue;
 		bset = isl_basic_set_cow(bset);
@@ -3495,10 +3502,39 @@ error:
 	return NULL;
 }
 
+/* Simplify "map" with respect to "context".
+ *
+ * If the memo table is enabled for gist operations, then first check
+ * whether an identical map has been simplified before with respect
+ * to an identical context and, if so, return the earlier result.
+ * Otherwise, the computation is performed on duplicates of the inputs
+ * such that the originals, which serve as the key in the memo table,
+ * are not modified in place.
+ */
 __isl_give isl_map *isl_map_gist(__isl_take isl_map *map,
 	__isl_take isl_map *context)
 {
-	return isl_map_align_params_map_map_and(map, context, &map_gist);
+	struct isl_memo_key key;
+	isl_bool memo;
+	isl_map *res;
+
+	if (!map || !context)
+		memo = isl_bool_false;
+	else
+		memo = isl_memo_key_init(&key, ISL_MEMO_GIST, map, context);
+	if (!memo)
+		return isl_map_align_params_map_map_and(map, context,
+							&map_gist);
+
+	res = isl_memo_find_map(&key);
+	if (!res) {
+		res = isl_map_align_params_map_map_and(isl_map_dup(map),
+					isl_map_dup(context), &map_gist);
+		isl_memo_add_map(&key, res);
+	}
+	isl_map_free(map);
+	isl_map_free(context);
+	return res;
 }
 
 struct isl_basic_set *isl_basic_set_gist(struct isl_basic_set *bset,
@@ -5042,23 +5078,26 @@ static int has_multiple_var_equality(__isl_keep isl_basic_map *bmap)
 static __isl_give isl_vec *normalize_constraint(__isl_take isl_vec *v,
 	int *tightened)
 {
-	isl_ctx *ctx;
+	struct isl_ctx_local *local;
 
 	if (!v)
 		return NULL;
-	ctx = isl_vec_get_ctx(v);
-	isl_seq_gcd(v->el + 1, v->size - 1, &ctx->normalize_gcd);
-	if (isl_int_is_zero(ctx->normalize_gcd))
+	local = isl_ctx_local(isl_vec_get_ctx(v));
+	if (!local)
+		return isl_vec_free(v);
+	isl_seq_gcd(v->el + 1, v->size - 1, &local->normalize_gcd);
+	if (isl_int_is_zero(local->normalize_gcd))
 		return v;
-	if (isl_int_is_one(ctx->normalize_gcd))
+	if (isl_int_is_one(local->normalize_gcd))
 		return v;
 	v = isl_vec_cow(v);
 	if (!v)
 		return NULL;
-	if (tightened && !isl_int_is_divisible_by(v->el[0], ctx->normalize_gcd))
+	if (tightened &&
+	    !isl_int_is_divisible_by(v->el[0], local->normalize_gcd))
 		*tightened = 1;
-	isl_int_fdiv_q(v->el[0], v->el[0], ctx->normalize_gcd);
-	isl_seq_scale_down(v->el + 1, v->el + 1, ctx->normalize_gcd,
+	isl_int_fdiv_q(v->el[0], v->el[0], local->normalize_gcd);
+	isl_seq_scale_down(v->el + 1, v->el + 1, local->normalize_gcd,
 				v->size - 1);
 	return v;
 }
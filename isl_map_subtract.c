@@ -14,6 +14,7 @@
 #include "isl_tab.h"
 #include <isl_point_private.h>
 #include <isl_vec_private.h>
+#include <isl_memo.h>
 
 #include <set_to_map.c>
 #include <set_from_map.c>
@@ -823,11 +824,49 @@ static isl_bool map_is_singleton_subset(__isl_keep isl_map *map1,
 	return is_subset;
 }
 
+/* Does any basic map in "map1" have a cached integer sample
+ * that does not belong to "map2"?
+ * If so, "map1" is clearly not a subset of "map2".
+ * The samples are typically cached by a preceding emptiness test.
+ * Assumes "map2" has known divs.
+ */
+static isl_bool has_cached_sample_outside(__isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
+{
+	int i;
+
+	for (i = 0; i < map1->n; ++i) {
+		isl_basic_map *bmap = map1->p[i];
+		isl_bool non_empty, contains;
+		isl_point *point;
+
+		non_empty = isl_basic_map_plain_is_non_empty(bmap);
+		if (non_empty < 0)
+			return isl_bool_error;
+		if (!non_empty || !isl_int_is_one(bmap->sample->el[0]))
+			continue;
+		point = isl_point_alloc(isl_basic_map_get_space(bmap),
+					isl_vec_copy(bmap->sample));
+		contains = isl_map_contains_point(map2, point);
+		isl_point_free(point);
+		if (contains < 0 || !contains)
+			return isl_bool_not(contains);
+	}
+
+	return isl_bool_false;
+}
+
+/* Is "map1" a subset of "map2"?
+ *
+ * Before performing the expensive check whether the difference
+ * is empty, look for a cached sample of "map1" that is
+ * not an element of "map2".
+ */
 static isl_bool map_is_subset(__isl_keep isl_map *map1,
 	__isl_keep isl_map *map2)
 {
 	isl_bool is_subset = isl_bool_false;
-	isl_bool empty, single;
+	isl_bool empty, single, outside;
 	isl_bool rat1, rat2;
 
 	if (!map1 || !map2)
@@ -862,6 +901,13 @@ static isl_bool map_is_subset(__isl_keep isl_map *map1,
 	if (single < 0)
 		return isl_bool_error;
 	map2 = isl_map_compute_divs(isl_map_copy(map2));
+	if (!map2)
+		return isl_bool_error;
+	outside = has_cached_sample_outside(map1, map2);
+	if (outside < 0 || outside) {
+		isl_map_free(map2);
+		return isl_bool_not(outside);
+	}
 	if (single) {
 		is_subset = map_is_singleton_subset(map1, map2);
 		isl_map_free(map2);
@@ -873,10 +919,30 @@ static isl_bool map_is_subset(__isl_keep isl_map *map1,
 	return is_subset;
 }
 
+/* Is "map1" a subset of "map2"?
+ *
+ * If the memo table is enabled for subset tests, then first check
+ * whether the test has been performed before on identical maps.
+ */
 isl_bool isl_map_is_subset(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
 {
-	return isl_map_align_params_map_map_and_test(map1, map2,
+	struct isl_memo_key key;
+	isl_bool memo, is_subset;
+
+	if (!map1 || !map2)
+		return isl_bool_error;
+
+	memo = isl_memo_key_init(&key, ISL_MEMO_IS_SUBSET, map1, map2);
+	if (!memo)
+		return isl_map_align_params_map_map_and_test(map1, map2,
 							&map_is_subset);
+	is_subset = isl_memo_find_bool(&key);
+	if (is_subset >= 0)
+		return is_subset;
+	is_subset = isl_map_align_params_map_map_and_test(map1, map2,
+							&map_is_subset);
+	isl_memo_add_bool(&key, is_subset);
+	return is_subset;
 }
 
 isl_bool isl_set_is_subset(__isl_keep isl_set *set1, __isl_keep isl_set *set2)
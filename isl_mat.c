@@ -14,6 +14,7 @@
  */
 
 #include <isl_ctx_private.h>
+#include <isl_arena_private.h>
 #include <isl_map_private.h>
 #include <isl/space.h>
 #include <isl_seq.h>
@@ -56,7 +57,7 @@ struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 	int i;
 	struct isl_mat *mat;
 
-	mat = isl_alloc_type(ctx, struct isl_mat);
+	mat = isl_arena_alloc_type(ctx, struct isl_mat);
 	if (!mat)
 		return NULL;
 
@@ -64,7 +65,7 @@ struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 	mat->block = isl_blk_alloc(ctx, n_row * n_col);
 	if (isl_blk_is_error(mat->block))
 		goto error;
-	mat->row = isl_alloc_array(ctx, isl_int *, n_row);
+	mat->row = isl_arena_alloc_array(ctx, isl_int *, n_row);
 	if (n_row && !mat->row)
 		goto error;
 
@@ -82,7 +83,7 @@ struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 	return mat;
 error:
 	isl_blk_free(ctx, mat->block);
-	free(mat);
+	isl_arena_free(ctx, mat);
 	return NULL;
 }
 
@@ -124,7 +125,7 @@ struct isl_mat *isl_mat_extend(struct isl_mat *mat,
 	mat->block = isl_blk_extend(mat->ctx, mat->block, n_row * mat->max_col);
 	if (isl_blk_is_error(mat->block))
 		goto error;
-	row = isl_realloc_array(mat->ctx, mat->row, isl_int *, n_row);
+	row = isl_arena_realloc_array(mat->ctx, mat->row, isl_int *, n_row);
 	if (n_row && !row)
 		goto error;
 	mat->row = row;
@@ -149,10 +150,10 @@ __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
 	int i;
 	struct isl_mat *mat;
 
-	mat = isl_alloc_type(ctx, struct isl_mat);
+	mat = isl_arena_alloc_type(ctx, struct isl_mat);
 	if (!mat)
 		return NULL;
-	mat->row = isl_alloc_array(ctx, isl_int *, n_row);
+	mat->row = isl_arena_alloc_array(ctx, isl_int *, n_row);
 	if (n_row && !mat->row)
 		goto error;
 	for (i = 0; i < n_row; ++i)
@@ -166,7 +167,7 @@ __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
 	mat->flags = ISL_MAT_BORROWED;
 	return mat;
 error:
-	free(mat);
+	isl_arena_free(ctx, mat);
 	return NULL;
 }
 
@@ -202,7 +203,7 @@ __isl_give isl_mat *isl_mat_copy(__isl_keep isl_mat *mat)
 	if (!mat)
 		return NULL;
 
-	mat->ref++;
+	isl_atomic_inc(&mat->ref);
 	return mat;
 }
 
@@ -227,7 +228,8 @@ __isl_give isl_mat *isl_mat_cow(__isl_take isl_mat *mat)
 	if (!mat)
 		return NULL;
 
-	if (mat->ref == 1 && !ISL_F_ISSET(mat, ISL_MAT_BORROWED))
+	if (isl_atomic_get(&mat->ref) == 1 &&
+	    !ISL_F_ISSET(mat, ISL_MAT_BORROWED))
 		return mat;
 
 	mat2 = isl_mat_dup(mat);
@@ -240,14 +242,14 @@ __isl_null isl_mat *isl_mat_free(__isl_take isl_mat *mat)
 	if (!mat)
 		return NULL;
 
-	if (--mat->ref > 0)
+	if (isl_atomic_dec(&mat->ref) > 0)
 		return NULL;
 
 	if (!ISL_F_ISSET(mat, ISL_MAT_BORROWED))
 		isl_blk_free(mat->ctx, mat->block);
 	isl_ctx_deref(mat->ctx);
-	free(mat->row);
-	free(mat);
+	isl_arena_free(mat->ctx, mat->row);
+	isl_arena_free(mat->ctx, mat);
 
 	return NULL;
 }
@@ -0,0 +1,462 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_map_private.h>
+#include <isl_space_private.h>
+#include <isl_seq.h>
+#include <isl/hash.h>
+#include <isl_memo.h>
+
+/* An entry in the memo table.
+ *
+ * "key" describes the operation and its arguments.
+ * The arguments are owned by the entry.
+ * "map_res" is the result of an operation that produces a map and
+ * "bool_res" that of an operation that produces a boolean.
+ * "prev" and "next" link the entries in order of most recent use.
+ */
+struct isl_memo_entry {
+	struct isl_memo_key key;
+	isl_map *map_res;
+	isl_bool bool_res;
+
+	struct isl_memo_entry *prev;
+	struct isl_memo_entry *next;
+};
+
+/* The memo table of an isl_ctx.
+ *
+ * "table" contains "n" entries, each of which also appears
+ * in the list starting at "head" (the most recently used entry)
+ * and ending at "tail" (the least recently used entry).
+ * "hits" and "misses" keep track of the number of successful and
+ * unsuccessful lookups.
+ */
+struct isl_memo {
+	int n;
+	struct isl_hash_table table;
+	struct isl_memo_entry *head;
+	struct isl_memo_entry *tail;
+
+	unsigned long hits;
+	unsigned long misses;
+};
+
+/* Combine "hash" with a hash of the representation of "bmap"
+ * (without normalizing it).
+ */
+static uint32_t basic_map_raw_hash(uint32_t hash,
+	__isl_keep isl_basic_map *bmap)
+{
+	int i;
+	unsigned total;
+
+	total = isl_basic_map_total_dim(bmap);
+	isl_hash_byte(hash, ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL) ? 1 : 0);
+	isl_hash_byte(hash, bmap->n_eq & 0xFF);
+	for (i = 0; i < bmap->n_eq; ++i)
+		isl_hash_hash(hash, isl_seq_get_hash(bmap->eq[i], 1 + total));
+	isl_hash_byte(hash, bmap->n_ineq & 0xFF);
+	for (i = 0; i < bmap->n_ineq; ++i)
+		isl_hash_hash(hash, isl_seq_get_hash(bmap->ineq[i], 1 + total));
+	isl_hash_byte(hash, bmap->n_div & 0xFF);
+	for (i = 0; i < bmap->n_div; ++i)
+		isl_hash_hash(hash,
+			isl_seq_get_hash(bmap->div[i], 1 + 1 + total));
+
+	return hash;
+}
+
+/* Combine "hash" with a hash of the representation of "map"
+ * (without normalizing it).
+ * Unlike isl_map_get_hash, this hash depends on the order
+ * of the basic maps and constraints, but it is much cheaper to compute.
+ */
+static uint32_t map_raw_hash(uint32_t hash, __isl_keep isl_map *map)
+{
+	int i;
+
+	isl_hash_hash(hash, isl_space_get_hash(map->dim));
+	isl_hash_byte(hash, map->n & 0xFF);
+	for (i = 0; i < map->n; ++i)
+		hash = basic_map_raw_hash(hash, map->p[i]);
+
+	return hash;
+}
+
+/* Are "map1" and "map2" represented in exactly the same way?
+ */
+static int map_plain_is_identical(__isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
+{
+	int i;
+
+	if (map1 == map2)
+		return 1;
+	if (!map1 || !map2)
+		return 0;
+	if (map1->n != map2->n)
+		return 0;
+	if (isl_space_cmp(map1->dim, map2->dim) != 0)
+		return 0;
+	for (i = 0; i < map1->n; ++i)
+		if (isl_basic_map_plain_cmp(map1->p[i], map2->p[i]) != 0)
+			return 0;
+
+	return 1;
+}
+
+/* Does the memo table entry "entry" correspond to the key "val"?
+ */
+static int has_key(const void *entry, const void *val)
+{
+	const struct isl_memo_entry *e = entry;
+	const struct isl_memo_key *key = val;
+
+	if (e->key.op != key->op)
+		return 0;
+	return map_plain_is_identical(e->key.arg[0], key->arg[0]) &&
+		map_plain_is_identical(e->key.arg[1], key->arg[1]);
+}
+
+/* Is "entry" equal to "val"?
+ */
+static int is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Initialize "key" for looking up or storing the result of operation "op"
+ * on "map1" and "map2" in the memo table of the isl_ctx of "map1".
+ * "map2" is NULL for operations that take a single argument.
+ *
+ * Return isl_bool_true if the memo table should be used
+ * for this operation, i.e., if the memo table is enabled and
+ * the operation is among those selected by the memo_operations option.
+ * The arguments are only hashed in this case.
+ */
+isl_bool isl_memo_key_init(struct isl_memo_key *key, unsigned op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+{
+	isl_ctx *ctx;
+	uint32_t hash;
+
+	if (!map1)
+		return isl_bool_false;
+	ctx = isl_map_get_ctx(map1);
+	if (ctx->opt->memo_size <= 0 || !(ctx->opt->memo_operations & op))
+		return isl_bool_false;
+
+	key->op = op;
+	key->arg[0] = map1;
+	key->arg[1] = map2;
+	hash = isl_hash_init();
+	isl_hash_byte(hash, op & 0xFF);
+	hash = map_raw_hash(hash, map1);
+	if (map2)
+		hash = map_raw_hash(hash, map2);
+	key->hash = hash;
+
+	return isl_bool_true;
+}
+
+/* Return the memo table of "ctx", allocating it if needed.
+ * The caller is assumed to hold the lock on "ctx".
+ */
+static struct isl_memo *get_memo(isl_ctx *ctx)
+{
+	struct isl_memo *memo;
+
+	if (ctx->memo)
+		return ctx->memo;
+
+	memo = isl_calloc_type(ctx, struct isl_memo);
+	if (!memo)
+		return NULL;
+	if (isl_hash_table_init(ctx, &memo->table, 16) < 0) {
+		free(memo);
+		return NULL;
+	}
+	ctx->memo = memo;
+
+	return memo;
+}
+
+/* Remove "entry" from the list of entries of "memo".
+ */
+static void unlink_entry(struct isl_memo *memo, struct isl_memo_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		memo->head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		memo->tail = entry->prev;
+}
+
+/* Add "entry" to the front of the list of entries of "memo".
+ */
+static void link_entry(struct isl_memo *memo, struct isl_memo_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = memo->head;
+	if (memo->head)
+		memo->head->prev = entry;
+	else
+		memo->tail = entry;
+	memo->head = entry;
+}
+
+/* Free "entry" along with the objects it owns.
+ */
+static void free_entry(struct isl_memo_entry *entry)
+{
+	isl_map_free(entry->key.arg[0]);
+	isl_map_free(entry->key.arg[1]);
+	isl_map_free(entry->map_res);
+	free(entry);
+}
+
+/* Remove "entry" from "memo".
+ * The caller is responsible for freeing the entry.
+ */
+static void remove_entry(isl_ctx *ctx, struct isl_memo *memo,
+	struct isl_memo_entry *entry)
+{
+	struct isl_hash_table_entry *t;
+
+	t = isl_hash_table_find(ctx, &memo->table, entry->key.hash,
+				&is_entry, entry, 0);
+	if (t)
+		isl_hash_table_remove(ctx, &memo->table, t);
+	unlink_entry(memo, entry);
+	memo->n--;
+}
+
+/* Look up "key" in the memo table of its isl_ctx.
+ * If it is found, then mark the entry as the most recently used one.
+ * The caller is assumed to hold the lock on the isl_ctx.
+ */
+static struct isl_memo_entry *find_entry(isl_ctx *ctx,
+	struct isl_memo_key *key)
+{
+	struct isl_memo *memo;
+	struct isl_hash_table_entry *t;
+	struct isl_memo_entry *entry;
+
+	memo = get_memo(ctx);
+	if (!memo)
+		return NULL;
+	t = isl_hash_table_find(ctx, &memo->table, key->hash,
+				&has_key, key, 0);
+	if (!t) {
+		memo->misses++;
+		return NULL;
+	}
+	memo->hits++;
+	entry = t->data;
+	unlink_entry(memo, entry);
+	link_entry(memo, entry);
+
+	return entry;
+}
+
+/* Return the map result stored for "key" in the memo table
+ * or NULL if there is no such result.
+ */
+__isl_give isl_map *isl_memo_find_map(struct isl_memo_key *key)
+{
+	isl_ctx *ctx;
+	struct isl_memo_entry *entry;
+	isl_map *res = NULL;
+
+	ctx = isl_map_get_ctx(key->arg[0]);
+	isl_ctx_lock(ctx);
+	entry = find_entry(ctx, key);
+	if (entry)
+		res = isl_map_copy(entry->map_res);
+	isl_ctx_unlock(ctx);
+
+	return res;
+}
+
+/* Return the boolean result stored for "key" in the memo table
+ * or isl_bool_error if there is no such result.
+ * Since errors are never stored in the table, the result
+ * is unambiguous.
+ */
+isl_bool isl_memo_find_bool(struct isl_memo_key *key)
+{
+	isl_ctx *ctx;
+	struct isl_memo_entry *entry;
+	isl_bool res = isl_bool_error;
+
+	ctx = isl_map_get_ctx(key->arg[0]);
+	isl_ctx_lock(ctx);
+	entry = find_entry(ctx, key);
+	if (entry)
+		res = entry->bool_res;
+	isl_ctx_unlock(ctx);
+
+	return res;
+}
+
+/* Add an entry for "key" with results "map_res" and "bool_res"
+ * to the memo table, evicting the least recently used entries
+ * if the table would otherwise exceed the size specified by
+ * the memo_size option.
+ * If some other thread has added an entry for the same key
+ * in the mean time, then the existing entry is kept.
+ * The arguments of "key" are duplicated such that they are not affected
+ * by any in-place modifications of the original arguments,
+ * while "map_res" is taken.
+ * The evicted entries are only freed after releasing the lock
+ * on the isl_ctx since freeing the objects they contain
+ * may require the lock.
+ *
+ * Failures are not reported since the memo table
+ * only serves to speed up the computations.
+ */
+static void add_entry(struct isl_memo_key *key, __isl_take isl_map *map_res,
+	isl_bool bool_res)
+{
+	isl_ctx *ctx;
+	struct isl_memo *memo;
+	struct isl_memo_entry *entry, *evicted = NULL;
+	struct isl_hash_table_entry *t;
+
+	ctx = isl_map_get_ctx(key->arg[0]);
+	entry = isl_calloc_type(ctx, struct isl_memo_entry);
+	if (!entry) {
+		isl_map_free(map_res);
+		return;
+	}
+	entry->key = *key;
+	entry->key.arg[0] = isl_map_dup(key->arg[0]);
+	entry->key.arg[1] = isl_map_dup(key->arg[1]);
+	entry->map_res = map_res;
+	entry->bool_res = bool_res;
+	if (!entry->key.arg[0] || (key->arg[1] && !entry->key.arg[1])) {
+		free_entry(entry);
+		return;
+	}
+
+	isl_ctx_lock(ctx);
+	memo = get_memo(ctx);
+	if (!memo)
+		goto error;
+	t = isl_hash_table_find(ctx, &memo->table, key->hash,
+				&has_key, key, 1);
+	if (!t || t->data)
+		goto error;
+	t->data = entry;
+	link_entry(memo, entry);
+	memo->n++;
+	while (memo->n > ctx->opt->memo_size && memo->tail) {
+		struct isl_memo_entry *tail = memo->tail;
+
+		remove_entry(ctx, memo, tail);
+		tail->next = evicted;
+		evicted = tail;
+	}
+	isl_ctx_unlock(ctx);
+
+	while (evicted) {
+		entry = evicted;
+		evicted = entry->next;
+		free_entry(entry);
+	}
+
+	return;
+error:
+	isl_ctx_unlock(ctx);
+	free_entry(entry);
+}
+
+/* Store "res" as the map result for "key" in the memo table.
+ * Failed computations are not stored.
+ */
+void isl_memo_add_map(struct isl_memo_key *key, __isl_keep isl_map *res)
+{
+	if (!res)
+		return;
+	add_entry(key, isl_map_copy(res), isl_bool_error);
+}
+
+/* Store "res" as the boolean result for "key" in the memo table.
+ * Failed computations are not stored.
+ */
+void isl_memo_add_bool(struct isl_memo_key *key, isl_bool res)
+{
+	if (res < 0)
+		return;
+	add_entry(key, NULL, res);
+}
+
+/* Free "memo" along with all its entries.
+ */
+void isl_memo_free(isl_ctx *ctx, struct isl_memo *memo)
+{
+	struct isl_memo_entry *entry, *next;
+
+	if (!memo)
+		return;
+
+	for (entry = memo->head; entry; entry = next) {
+		next = entry->next;
+		free_entry(entry);
+	}
+	isl_hash_table_clear(&memo->table);
+	free(memo);
+}
+
+/* Return the number of successful lookups in the memo table of "ctx".
+ */
+unsigned long isl_ctx_get_memo_hits(isl_ctx *ctx)
+{
+	unsigned long hits;
+
+	if (!ctx)
+		return 0;
+	isl_ctx_lock(ctx);
+	hits = ctx->memo ? ctx->memo->hits : 0;
+	isl_ctx_unlock(ctx);
+
+	return hits;
+}
+
+/* Return the number of unsuccessful lookups in the memo table of "ctx".
+ */
+unsigned long isl_ctx_get_memo_misses(isl_ctx *ctx)
+{
+	unsigned long misses;
+
+	if (!ctx)
+		return 0;
+	isl_ctx_lock(ctx);
+	misses = ctx->memo ? ctx->memo->misses : 0;
+	isl_ctx_unlock(ctx);
+
+	return misses;
+}
+
+/* Remove all entries from the memo table of "ctx" and
+ * reset the hit and miss counters.
+ */
+void isl_ctx_reset_memo(isl_ctx *ctx)
+{
+	struct isl_memo *memo;
+
+	if (!ctx)
+		return;
+	isl_ctx_lock(ctx);
+	memo = ctx->memo;
+	ctx->memo = NULL;
+	isl_ctx_unlock(ctx);
+	isl_memo_free(ctx, memo);
+}
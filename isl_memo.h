@@ -0,0 +1,32 @@
+#ifndef ISL_MEMO_H
+#define ISL_MEMO_H
+
+#include <isl/map.h>
+#include <isl/options.h>
+
+struct isl_memo;
+
+/* A key into the memo table of an isl_ctx.
+ *
+ * "op" is the operation (one of ISL_MEMO_*), while "arg" are
+ * its (at most two) arguments.  The second argument is NULL
+ * for operations that only take a single argument.
+ * "hash" is a hash of "op" and the representations of the arguments.
+ */
+struct isl_memo_key {
+	unsigned op;
+	isl_map *arg[2];
+	uint32_t hash;
+};
+
+isl_bool isl_memo_key_init(struct isl_memo_key *key, unsigned op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2);
+
+__isl_give isl_map *isl_memo_find_map(struct isl_memo_key *key);
+isl_bool isl_memo_find_bool(struct isl_memo_key *key);
+void isl_memo_add_map(struct isl_memo_key *key, __isl_keep isl_map *res);
+void isl_memo_add_bool(struct isl_memo_key *key, isl_bool res);
+
+void isl_memo_free(isl_ctx *ctx, struct isl_memo *memo);
+
+#endif
@@ -10,6 +10,7 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_aff_private.h>
 #include <isl_morph.h>
@@ -59,7 +60,7 @@ __isl_give isl_morph *isl_morph_copy(__isl_keep isl_morph *morph)
 	if (!morph)
 		return NULL;
 
-	morph->ref++;
+	isl_atomic_inc(&morph->ref);
 	return morph;
 }
 
@@ -75,13 +76,16 @@ __isl_give isl_morph *isl_morph_dup(__isl_keep isl_morph *morph)
 
 __isl_give isl_morph *isl_morph_cow(__isl_take isl_morph *morph)
 {
+	isl_morph *dup;
+
 	if (!morph)
 		return NULL;
 
-	if (morph->ref == 1)
+	if (isl_atomic_get(&morph->ref) == 1)
 		return morph;
-	morph->ref--;
-	return isl_morph_dup(morph);
+	dup = isl_morph_dup(morph);
+	isl_morph_free(morph);
+	return dup;
 }
 
 __isl_null isl_morph *isl_morph_free(__isl_take isl_morph *morph)
@@ -89,7 +93,7 @@ __isl_null isl_morph *isl_morph_free(__isl_take isl_morph *morph)
 	if (!morph)
 		return NULL;
 
-	if (--morph->ref > 0)
+	if (isl_atomic_dec(&morph->ref) > 0)
 		return NULL;
 
 	isl_basic_set_free(morph->dom);
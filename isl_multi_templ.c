@@ -8,6 +8,7 @@
  * Ecole Normale Superieure, 45 rue d’Ulm, 75230 Paris, France
  */
 
+#include <isl_ctx_private.h>
 #include <isl_space_private.h>
 #include <isl/set.h>
 #include <isl_reordering.h>
@@ -92,14 +93,17 @@ __isl_give MULTI(BASE) *FN(MULTI(BASE),dup)(__isl_keep MULTI(BASE) *multi)
 
 __isl_give MULTI(BASE) *FN(MULTI(BASE),cow)(__isl_take MULTI(BASE) *multi)
 {
+	MULTI(BASE) *dup;
+
 	if (!multi)
 		return NULL;
 
-	if (multi->ref == 1)
+	if (isl_atomic_get(&multi->ref) == 1)
 		return multi;
 
-	multi->ref--;
-	return FN(MULTI(BASE),dup)(multi);
+	dup = FN(MULTI(BASE),dup)(multi);
+	FN(MULTI(BASE),free)(multi);
+	return dup;
 }
 
 __isl_give MULTI(BASE) *FN(MULTI(BASE),copy)(__isl_keep MULTI(BASE) *multi)
@@ -107,7 +111,7 @@ __isl_give MULTI(BASE) *FN(MULTI(BASE),copy)(__isl_keep MULTI(BASE) *multi)
 	if (!multi)
 		return NULL;
 
-	multi->ref++;
+	isl_atomic_inc(&multi->ref);
 	return multi;
 }
 
@@ -118,7 +122,7 @@ __isl_null MULTI(BASE) *FN(MULTI(BASE),free)(__isl_take MULTI(BASE) *multi)
 	if (!multi)
 		return NULL;
 
-	if (--multi->ref > 0)
+	if (isl_atomic_dec(&multi->ref) > 0)
 		return NULL;
 
 	isl_space_free(multi->space);
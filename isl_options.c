@@ -55,6 +55,22 @@ static struct isl_arg_choice isl_schedule_algorithm_choice[] = {
 	{0}
 };
 
+static struct isl_arg_choice print_stats_format[] = {
+	{"text",	ISL_PRINT_STATS_TEXT},
+	{"json",	ISL_PRINT_STATS_JSON},
+	{0}
+};
+
+static struct isl_arg_flags memo_operations[] = {
+	{"none",	ISL_MEMO_ALL,	0},
+	{"all",		ISL_MEMO_ALL,	ISL_MEMO_ALL},
+	{"coalesce",	ISL_MEMO_COALESCE,	ISL_MEMO_COALESCE},
+	{"is-subset",	ISL_MEMO_IS_SUBSET,	ISL_MEMO_IS_SUBSET},
+	{"is-empty",	ISL_MEMO_IS_EMPTY,	ISL_MEMO_IS_EMPTY},
+	{"gist",	ISL_MEMO_GIST,	ISL_MEMO_GIST},
+	{ 0 }
+};
+
 static struct isl_arg_flags bernstein_recurse[] = {
 	{"none",	ISL_BERNSTEIN_FACTORS | ISL_BERNSTEIN_INTERVALS, 0},
 	{"factors",	ISL_BERNSTEIN_FACTORS | ISL_BERNSTEIN_INTERVALS,
@@ -134,6 +150,29 @@ ISL_ARG_CHOICE(struct isl_options, convex, 0, "convex-hull", \
 	convex,	ISL_CONVEX_HULL_WRAP, "convex hull algorithm to use")
 ISL_ARG_BOOL(struct isl_options, coalesce_bounded_wrapping, 0,
 	"coalesce-bounded-wrapping", 1, "bound wrapping during coalescing")
+ISL_ARG_BOOL(struct isl_options, lp_float_presolve, 0,
+	"lp-float-presolve", 0, "use a floating point simplex to find "
+	"a starting basis for the exact simplex in linear optimization "
+	"of a single objective function")
+ISL_ARG_BOOL(struct isl_options, union_map_parallel, 0,
+	"union-map-parallel", 0, "combine the pairs of maps in binary "
+	"operations on union maps in parallel in a concurrent isl_ctx")
+ISL_ARG_BOOL(struct isl_options, flow_parallel, 0,
+	"flow-parallel", 0, "compute the dataflow for different sink "
+	"accesses in parallel in a concurrent isl_ctx")
+ISL_ARG_INT(struct isl_options, n_threads, 0,
+	"n-threads", "n", 0, "Use at most <n> threads for operations "
+	"that are performed in parallel. A value of 0 uses as many threads "
+	"as there are processors.")
+ISL_ARG_INT(struct isl_options, memo_size, 0,
+	"memo-size", "n", 0, "Keep the results of at most <n> recent "
+	"operations in a memo table. A value of 0 disables the memo table.")
+ISL_ARG_FLAGS(struct isl_options, memo_operations, 0,
+	"memo-operations", memo_operations, ISL_MEMO_ALL,
+	"operations for which results are kept in the memo table")
+ISL_ARG_INT(struct isl_options, blk_cache_size, 0,
+	"blk-cache-size", "bytes", 1 << 20, "Keep at most <bytes> bytes "
+	"of freed blocks of integers per thread for later reuse.")
 ISL_ARG_INT(struct isl_options, schedule_max_coefficient, 0,
 	"schedule-max-coefficient", "limit", -1, "Only consider schedules "
 	"where the coefficients of the variable and parameter dimensions "
@@ -174,6 +213,13 @@ ISL_ARG_BOOL(struct isl_options, schedule_carry_self_first, 0,
 ISL_ARG_BOOL(struct isl_options, schedule_serialize_sccs, 0,
 	"schedule-serialize-sccs", 0,
 	"serialize strongly connected components in dependence graph")
+ISL_ARG_BOOL(struct isl_options, schedule_parallel_components, 0,
+	"schedule-parallel-components", 0,
+	"schedule the components of the dependence graph in parallel "
+	"in a concurrent isl_ctx")
+ISL_ARG_BOOL(struct isl_options, schedule_reuse_lp, 0,
+	"schedule-reuse-lp", 1,
+	"reuse the ILP tableau across the rows of a band")
 ISL_ARG_PHANTOM_USER_CHOICE_F(0, "schedule-fuse", fuse, &set_fuse,
 	ISL_SCHEDULE_FUSE_MAX, "level of fusion during scheduling",
 	ISL_ARG_HIDDEN)
@@ -201,6 +247,10 @@ ISL_ARG_BOOL(struct isl_options, ast_build_exploit_nested_bounds, 0,
 ISL_ARG_BOOL(struct isl_options, ast_build_group_coscheduled, 0,
 	"ast-build-group-coscheduled", 0,
 	"keep coscheduled domain elements together")
+ISL_ARG_INT(struct isl_options, ast_build_separation_max_pieces, 0,
+	"ast-build-separation-max-pieces", "n", 0, "Generate atomic code "
+	"instead of separating the domain at a given level if separation "
+	"would result in more than <n> pieces. A value of 0 means no limit.")
 ISL_ARG_CHOICE(struct isl_options, ast_build_separation_bounds, 0,
 	"ast-build-separation-bounds", separation_bounds,
 	ISL_AST_BUILD_SEPARATION_BOUNDS_EXPLICIT,
@@ -212,8 +262,23 @@ ISL_ARG_BOOL(struct isl_options, ast_build_allow_else, 0,
 	"ast-build-allow-else", 1, "generate if statements with else branches")
 ISL_ARG_BOOL(struct isl_options, ast_build_allow_or, 0,
 	"ast-build-allow-or", 1, "generate if conditions with disjunctions")
+ISL_ARG_BOOL(struct isl_options, ast_build_parallel, 0,
+	"ast-build-parallel", 0, "generate the ASTs for the children "
+	"of sequence and set nodes in parallel in a concurrent isl_ctx")
+ISL_ARG_INT(struct isl_options, ast_build_cache_size, 0,
+	"ast-build-cache-size", "n", 0, "Keep at most <n> recently "
+	"generated ASTs of children of sequence and set nodes in a cache. "
+	"A value of 0 disables the cache.")
+ISL_ARG_INT(struct isl_options, ast_build_expr_cache_size, 0,
+	"ast-build-expr-cache-size", "n", 0, "Keep at most <n> AST "
+	"expressions constructed during an AST generation in a cache. "
+	"A value of 0 disables the cache.")
 ISL_ARG_BOOL(struct isl_options, print_stats, 0, "print-stats", 0,
-	"print statistics for every isl_ctx")
+	"print statistics and a profile of the main operations "
+	"for every isl_ctx")
+ISL_ARG_CHOICE(struct isl_options, print_stats_format, 0,
+	"print-stats-format", print_stats_format, ISL_PRINT_STATS_TEXT,
+	"format of the statistics printed by --print-stats")
 ISL_ARG_ULONG(struct isl_options, max_operations, 0,
 	"max-operations", 0, "default number of maximal operations per isl_ctx")
 ISL_ARG_VERSION(print_version)
@@ -241,11 +306,46 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	coalesce_bounded_wrapping)
 
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	lp_float_presolve)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	lp_float_presolve)
+
 ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	gbr_only_first)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	gbr_only_first)
 
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	union_map_parallel)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	union_map_parallel)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	flow_parallel)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	flow_parallel)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	n_threads)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	n_threads)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	memo_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	memo_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	memo_operations)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	memo_operations)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	blk_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	blk_cache_size)
+
 ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
 	schedule_max_coefficient)
 ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
@@ -306,6 +406,16 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	schedule_serialize_sccs)
 
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	schedule_parallel_components)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	schedule_parallel_components)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	schedule_reuse_lp)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	schedule_reuse_lp)
+
 ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	tile_scale_tile_loops)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
@@ -361,6 +471,11 @@ ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
 ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_separation_bounds)
 
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_separation_max_pieces)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_separation_max_pieces)
+
 ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_scale_strides)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
@@ -375,3 +490,28 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_allow_or)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_allow_or)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_parallel)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_parallel)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_cache_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_expr_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_expr_cache_size)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	print_stats)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	print_stats)
+
+ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
+	print_stats_format)
+ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
+	print_stats_format)
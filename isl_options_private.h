@@ -35,6 +35,17 @@ struct isl_options {
 
 	int			coalesce_bounded_wrapping;
 
+	int			lp_float_presolve;
+
+	int			union_map_parallel;
+	int			flow_parallel;
+	int			n_threads;
+
+	int			memo_size;
+	int			memo_operations;
+
+	int			blk_cache_size;
+
 	int			schedule_max_coefficient;
 	int			schedule_max_constant_term;
 	int			schedule_parametric;
@@ -48,6 +59,8 @@ struct isl_options {
 	unsigned		schedule_algorithm;
 	int			schedule_carry_self_first;
 	int			schedule_serialize_sccs;
+	int			schedule_parallel_components;
+	int			schedule_reuse_lp;
 
 	int			tile_scale_tile_loops;
 	int			tile_shift_point_loops;
@@ -62,11 +75,16 @@ struct isl_options {
 	int			ast_build_exploit_nested_bounds;
 	int			ast_build_group_coscheduled;
 	int			ast_build_separation_bounds;
+	int			ast_build_separation_max_pieces;
 	int			ast_build_scale_strides;
 	int			ast_build_allow_else;
 	int			ast_build_allow_or;
+	int			ast_build_parallel;
+	int			ast_build_cache_size;
+	int			ast_build_expr_cache_size;
 
 	int			print_stats;
+	int			print_stats_format;
 	unsigned long		max_operations;
 };
 
@@ -0,0 +1,454 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_parallel.h>
+#include <isl_profile_private.h>
+
+#ifdef USE_THREADS
+#include <unistd.h>
+#endif
+
+/* Return the number of threads that isl_parallel_for would use
+ * for performing "n" independent tasks in "ctx".
+ *
+ * Tasks are only performed in parallel if "ctx" is concurrent.
+ * The number of threads is then determined by the n_threads option,
+ * where zero means that as many threads as there are online processors
+ * should be used.  There is no point in using more threads than tasks.
+ * Tasks that are themselves performed by isl_parallel_for
+ * do not start any further threads since all available threads
+ * are presumably already in use.
+ */
+int isl_parallel_n_threads(isl_ctx *ctx, int n)
+{
+#ifdef USE_THREADS
+	int n_threads;
+	struct isl_ctx_local *local;
+
+	if (!ctx || !ctx->concurrent || n <= 1)
+		return 1;
+	local = isl_ctx_local(ctx);
+	if (!local || local->in_parallel)
+		return 1;
+	n_threads = ctx->opt->n_threads;
+	if (n_threads == 0) {
+		long n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+		n_threads = n_cpu > 0 ? n_cpu : 1;
+	}
+	if (n_threads > n)
+		n_threads = n;
+	return n_threads >= 1 ? n_threads : 1;
+#else
+	return 1;
+#endif
+}
+
+#ifdef USE_THREADS
+/* Internal data structure for isl_parallel_for.
+ *
+ * "fn" is called on each integer in [0, "n") with argument "user".
+ * "next" is the next integer that has not been handed out yet.
+ * "failed" is set as soon as any call to "fn" fails.
+ * The error information of the first failing call is kept
+ * in "error", "msg", "file" and "line".
+ * "lock" protects "failed" and the error information.
+ * "profile" is the innermost profiled operation and
+ * "budget" is the innermost budget of the thread
+ * that called isl_parallel_for.
+ */
+struct isl_parallel_data {
+	isl_ctx *ctx;
+	int n;
+	isl_stat (*fn)(int i, void *user);
+	void *user;
+	struct isl_profile_node *profile;
+	struct isl_budget *budget;
+
+	int next;
+	int failed;
+	enum isl_error error;
+	const char *msg;
+	const char *file;
+	int line;
+	pthread_mutex_t lock;
+};
+
+/* Record that a call to data->fn has failed in the current thread,
+ * keeping track of the error information of the first failure.
+ */
+static void parallel_fail(struct isl_parallel_data *data)
+{
+	enum isl_error error;
+
+	pthread_mutex_lock(&data->lock);
+	error = isl_ctx_last_error(data->ctx);
+	if (!data->failed && error != isl_error_none) {
+		data->error = error;
+		data->msg = isl_ctx_last_error_msg(data->ctx);
+		data->file = isl_ctx_last_error_file(data->ctx);
+		data->line = isl_ctx_last_error_line(data->ctx);
+	}
+	data->failed = 1;
+	pthread_mutex_unlock(&data->lock);
+}
+
+/* Has any call to data->fn failed?
+ */
+static int parallel_failed(struct isl_parallel_data *data)
+{
+	int failed;
+
+	pthread_mutex_lock(&data->lock);
+	failed = data->failed;
+	pthread_mutex_unlock(&data->lock);
+
+	return failed;
+}
+
+/* Keep calling data->fn on integers that have not been handed out yet
+ * until they have all been handled or until some call has failed.
+ *
+ * The error state of the current thread is reset first such that
+ * only errors that occur during the calls are picked up by parallel_fail.
+ * The current thread is marked as performing tasks for isl_parallel_for
+ * during the calls, such that the calls do not start any further threads.
+ * The mark is removed afterwards since the current thread
+ * may be the thread that called isl_parallel_for.
+ * Similarly, the calls are profiled as part of the innermost
+ * profiled operation and charged to the budgets
+ * of the thread that called isl_parallel_for and
+ * the original profiling scope and budgets of the current thread
+ * are restored afterwards.
+ */
+static void *parallel_worker(void *user)
+{
+	struct isl_parallel_data *data = user;
+	struct isl_ctx_local *local;
+	struct isl_profile_node *profile;
+	struct isl_budget *budget;
+
+	local = isl_ctx_local(data->ctx);
+	if (!local) {
+		parallel_fail(data);
+		return NULL;
+	}
+	local->in_parallel = 1;
+	isl_profile_sync(data->ctx, local);
+	profile = local->profile;
+	local->profile = data->profile;
+	budget = local->budget;
+	local->budget = data->budget;
+	isl_ctx_reset_error(data->ctx);
+	while (!parallel_failed(data)) {
+		int i;
+
+		i = __atomic_fetch_add(&data->next, 1, __ATOMIC_RELAXED);
+		if (i >= data->n)
+			break;
+		if (data->fn(i, data->user) < 0)
+			parallel_fail(data);
+	}
+	isl_profile_sync(data->ctx, local);
+	local->profile = profile;
+	local->budget = budget;
+	local->in_parallel = 0;
+
+	return NULL;
+}
+
+/* A pool of worker threads of a concurrent isl_ctx
+ * that perform the tasks of isl_parallel_for.
+ *
+ * The threads are only started when they are first needed and
+ * they are kept around until the isl_ctx is freed,
+ * such that calls to isl_parallel_for do not need
+ * to create and join threads.
+ *
+ * "threads" contains the "n" threads that have been started so far.
+ * "job" is the isl_parallel_for call that is currently being performed
+ * with the help of the pool, if any.  Only one call is performed
+ * with the help of the pool at any given time and
+ * "busy" is set while this is the case.
+ * "generation" is incremented for each such call, such that
+ * each thread can keep track of whether it has already joined the call.
+ * "n_wanted" is the number of threads that still need to join the call and
+ * "n_active" is the number of threads that have not finished the call yet.
+ * "shutdown" is set when the threads should exit.
+ * "lock" protects all other fields, while threads wait on "start"
+ * for a call to join and the thread that called isl_parallel_for
+ * waits on "done" for the other threads to finish.
+ */
+struct isl_parallel_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+
+	int n;
+	int size;
+	pthread_t *threads;
+
+	int busy;
+	struct isl_parallel_data *job;
+	unsigned long generation;
+	int n_wanted;
+	int n_active;
+	int shutdown;
+};
+
+/* The main function of a thread in "pool".
+ *
+ * Wait for a call of isl_parallel_for that still needs threads and
+ * that the thread has not joined yet, help performing the tasks
+ * of that call and repeat until the pool is shut down.
+ */
+static void *pool_thread(void *user)
+{
+	struct isl_parallel_pool *pool = user;
+	unsigned long generation = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		struct isl_parallel_data *job;
+
+		while (!pool->shutdown &&
+		    (pool->n_wanted == 0 || pool->generation == generation))
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->shutdown)
+			break;
+		generation = pool->generation;
+		pool->n_wanted--;
+		job = pool->job;
+		pthread_mutex_unlock(&pool->lock);
+
+		parallel_worker(job);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->n_active == 0)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Return the worker pool of "ctx", allocating it if needed.
+ */
+static struct isl_parallel_pool *get_pool(isl_ctx *ctx)
+{
+	struct isl_parallel_pool *pool;
+
+	isl_ctx_lock(ctx);
+	pool = ctx->parallel_pool;
+	if (pool)
+		goto done;
+
+	pool = isl_calloc_type(ctx, struct isl_parallel_pool);
+	if (!pool)
+		goto done;
+	if (pthread_mutex_init(&pool->lock, NULL) != 0)
+		goto error_lock;
+	if (pthread_cond_init(&pool->start, NULL) != 0)
+		goto error_start;
+	if (pthread_cond_init(&pool->done, NULL) != 0)
+		goto error_done;
+	ctx->parallel_pool = pool;
+done:
+	isl_ctx_unlock(ctx);
+
+	return pool;
+error_done:
+	pthread_cond_destroy(&pool->start);
+error_start:
+	pthread_mutex_destroy(&pool->lock);
+error_lock:
+	free(pool);
+	isl_ctx_unlock(ctx);
+	isl_die(ctx, isl_error_unknown, "unable to initialize worker pool",
+		return NULL);
+}
+
+/* Make sure "pool" has at least "n" threads, starting extra threads
+ * if needed, and return the number of threads in the pool,
+ * which may be smaller than "n" if some threads could not be started.
+ * "pool" is assumed to be locked.
+ */
+static int pool_grow(isl_ctx *ctx, struct isl_parallel_pool *pool, int n)
+{
+	if (n <= pool->n)
+		return pool->n;
+	if (n > pool->size) {
+		pthread_t *threads;
+
+		threads = isl_realloc_array(ctx, pool->threads, pthread_t, n);
+		if (!threads)
+			return pool->n;
+		pool->threads = threads;
+		pool->size = n;
+	}
+	for (; pool->n < n; ++pool->n)
+		if (pthread_create(&pool->threads[pool->n], NULL,
+				    &pool_thread, pool) != 0)
+			break;
+	return pool->n;
+}
+
+/* Let at most "n" threads of the worker pool of "ctx" help performing
+ * the tasks described by "data" and return the number of threads
+ * that will help.
+ * If the pool is already busy helping another call of isl_parallel_for,
+ * then no threads will help.
+ */
+static int pool_start(isl_ctx *ctx, struct isl_parallel_data *data, int n)
+{
+	struct isl_parallel_pool *pool;
+
+	pool = get_pool(ctx);
+	if (!pool)
+		return 0;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->busy)
+		n = 0;
+	else if (pool_grow(ctx, pool, n) < n)
+		n = pool->n;
+	if (n > 0) {
+		pool->busy = 1;
+		pool->job = data;
+		pool->generation++;
+		pool->n_wanted = n;
+		pool->n_active = n;
+		pthread_cond_broadcast(&pool->start);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return n;
+}
+
+/* Wait for the threads of the worker pool of "ctx" that were asked
+ * to help by pool_start to finish and release the pool.
+ */
+static void pool_finish(isl_ctx *ctx)
+{
+	struct isl_parallel_pool *pool = ctx->parallel_pool;
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->n_active > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pool->job = NULL;
+	pool->busy = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Stop the threads in "pool" and free all memory associated to "pool".
+ * This function should only be called when "pool" is not busy.
+ */
+void isl_parallel_pool_free(struct isl_parallel_pool *pool)
+{
+	int i;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->n; ++i)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+/* Call "fn" on each integer in [0, "n") using "n_threads" threads,
+ * one of which is the current thread and the others
+ * are taken from the worker pool of "ctx".
+ * If not enough threads are available in the pool,
+ * then the available threads perform the work of the missing threads.
+ *
+ * If any call fails, then the error information of the first
+ * failure is stored in the error state of the current thread.
+ */
+static isl_stat parallel_for(isl_ctx *ctx, int n, int n_threads,
+	isl_stat (*fn)(int i, void *user), void *user)
+{
+	int n_helper;
+	struct isl_parallel_data data = { ctx, n, fn, user, NULL, NULL, 0, 0,
+					  isl_error_none, NULL, NULL, -1 };
+	struct isl_ctx_local *local;
+	enum isl_error error;
+	const char *msg, *file;
+	int line;
+
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return isl_stat_error;
+	data.profile = local->profile;
+	data.budget = local->budget;
+
+	if (pthread_mutex_init(&data.lock, NULL) != 0)
+		isl_die(ctx, isl_error_unknown, "unable to initialize mutex",
+			return isl_stat_error);
+
+	error = isl_ctx_last_error(ctx);
+	msg = isl_ctx_last_error_msg(ctx);
+	file = isl_ctx_last_error_file(ctx);
+	line = isl_ctx_last_error_line(ctx);
+
+	n_helper = pool_start(ctx, &data, n_threads - 1);
+	parallel_worker(&data);
+	if (n_helper > 0)
+		pool_finish(ctx);
+
+	pthread_mutex_destroy(&data.lock);
+
+	if (data.failed && data.error != isl_error_none)
+		isl_ctx_set_full_error(ctx, data.error, data.msg,
+					data.file, data.line);
+	else
+		isl_ctx_set_full_error(ctx, error, msg, file, line);
+
+	return data.failed ? isl_stat_error : isl_stat_ok;
+}
+#endif
+
+/* Call "fn" on each integer in [0, "n"), where the calls
+ * may be performed in parallel by several threads.
+ * The calls are therefore required to be independent of each other.
+ * In particular, "fn" should only modify data that is specific to "i".
+ *
+ * If the calls are performed in parallel, then no further calls are
+ * started as soon as one of the calls has failed.
+ * Otherwise, the calls are performed in order and the first failure
+ * aborts the loop.
+ * In both cases, the error information of the first failure,
+ * if any, is available in the error state of the current thread.
+ */
+isl_stat isl_parallel_for(isl_ctx *ctx, int n,
+	isl_stat (*fn)(int i, void *user), void *user)
+{
+	int i;
+
+	if (!ctx)
+		return isl_stat_error;
+
+#ifdef USE_THREADS
+	{
+		int n_threads = isl_parallel_n_threads(ctx, n);
+		if (n_threads > 1)
+			return parallel_for(ctx, n, n_threads, fn, user);
+	}
+#endif
+
+	for (i = 0; i < n; ++i)
+		if (fn(i, user) < 0)
+			return isl_stat_error;
+
+	return isl_stat_ok;
+}
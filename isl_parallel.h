@@ -0,0 +1,14 @@
+#ifndef ISL_PARALLEL_H
+#define ISL_PARALLEL_H
+
+#include <isl/ctx.h>
+
+struct isl_parallel_pool;
+
+void isl_parallel_pool_free(struct isl_parallel_pool *pool);
+
+int isl_parallel_n_threads(isl_ctx *ctx, int n);
+isl_stat isl_parallel_for(isl_ctx *ctx, int n,
+	isl_stat (*fn)(int i, void *user), void *user);
+
+#endif
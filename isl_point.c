@@ -1,3 +1,4 @@
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_point_private.h>
 #include <isl/set.h>
@@ -85,7 +86,7 @@ __isl_give isl_point *isl_point_cow(__isl_take isl_point *pnt)
 	if (!pnt)
 		return NULL;
 
-	if (pnt->ref == 1)
+	if (isl_atomic_get(&pnt->ref) == 1)
 		return pnt;
 
 	pnt2 = isl_point_dup(pnt);
@@ -98,7 +99,7 @@ __isl_give isl_point *isl_point_copy(__isl_keep isl_point *pnt)
 	if (!pnt)
 		return NULL;
 
-	pnt->ref++;
+	isl_atomic_inc(&pnt->ref);
 	return pnt;
 }
 
@@ -107,7 +108,7 @@ __isl_null isl_point *isl_point_free(__isl_take isl_point *pnt)
 	if (!pnt)
 		return NULL;
 
-	if (--pnt->ref > 0)
+	if (isl_atomic_dec(&pnt->ref) > 0)
 		return NULL;
 
 	isl_space_free(pnt->dim);
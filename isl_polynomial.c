@@ -548,7 +548,7 @@ __isl_give struct isl_upoly *isl_upoly_copy(__isl_keep struct isl_upoly *up)
 	if (!up)
 		return NULL;
 
-	up->ref++;
+	isl_atomic_inc(&up->ref);
 	return up;
 }
 
@@ -610,13 +610,16 @@ __isl_give struct isl_upoly *isl_upoly_dup(__isl_keep struct isl_upoly *up)
 
 __isl_give struct isl_upoly *isl_upoly_cow(__isl_take struct isl_upoly *up)
 {
+	struct isl_upoly *dup;
+
 	if (!up)
 		return NULL;
 
-	if (up->ref == 1)
+	if (isl_atomic_get(&up->ref) == 1)
 		return up;
-	up->ref--;
-	return isl_upoly_dup(up);
+	dup = isl_upoly_dup(up);
+	isl_upoly_free(up);
+	return dup;
 }
 
 __isl_null struct isl_upoly *isl_upoly_free(__isl_take struct isl_upoly *up)
@@ -624,7 +627,7 @@ __isl_null struct isl_upoly *isl_upoly_free(__isl_take struct isl_upoly *up)
 	if (!up)
 		return NULL;
 
-	if (--up->ref > 0)
+	if (isl_atomic_dec(&up->ref) > 0)
 		return NULL;
 
 	if (up->var < 0)
@@ -1163,7 +1166,7 @@ __isl_give isl_qpolynomial *isl_qpolynomial_copy(__isl_keep isl_qpolynomial *qp)
 	if (!qp)
 		return NULL;
 
-	qp->ref++;
+	isl_atomic_inc(&qp->ref);
 	return qp;
 }
 
@@ -1191,13 +1194,16 @@ error:
 
 __isl_give isl_qpolynomial *isl_qpolynomial_cow(__isl_take isl_qpolynomial *qp)
 {
+	isl_qpolynomial *dup;
+
 	if (!qp)
 		return NULL;
 
-	if (qp->ref == 1)
+	if (isl_atomic_get(&qp->ref) == 1)
 		return qp;
-	qp->ref--;
-	return isl_qpolynomial_dup(qp);
+	dup = isl_qpolynomial_dup(qp);
+	isl_qpolynomial_free(qp);
+	return dup;
 }
 
 __isl_null isl_qpolynomial *isl_qpolynomial_free(
@@ -1206,7 +1212,7 @@ __isl_null isl_qpolynomial *isl_qpolynomial_free(
 	if (!qp)
 		return NULL;
 
-	if (--qp->ref > 0)
+	if (isl_atomic_dec(&qp->ref) > 0)
 		return NULL;
 
 	isl_space_free(qp->dim);
@@ -2180,21 +2186,23 @@ __isl_give struct isl_upoly *isl_upoly_from_affine(isl_ctx *ctx, isl_int *f,
  */
 static void normalize_div(__isl_keep isl_qpolynomial *qp, int div)
 {
-	isl_ctx *ctx = qp->div->ctx;
+	struct isl_ctx_local *local = isl_ctx_local(qp->div->ctx);
 	unsigned total = qp->div->n_col - 2;
 
-	isl_seq_gcd(qp->div->row[div] + 2, total, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd,
-		    ctx->normalize_gcd, qp->div->row[div][0]);
-	if (isl_int_is_one(ctx->normalize_gcd))
+	if (!local)
+		return;
+	isl_seq_gcd(qp->div->row[div] + 2, total, &local->normalize_gcd);
+	isl_int_gcd(local->normalize_gcd,
+		    local->normalize_gcd, qp->div->row[div][0]);
+	if (isl_int_is_one(local->normalize_gcd))
 		return;
 
 	isl_seq_scale_down(qp->div->row[div] + 2, qp->div->row[div] + 2,
-			    ctx->normalize_gcd, total);
+			    local->normalize_gcd, total);
 	isl_int_divexact(qp->div->row[div][0], qp->div->row[div][0],
-			    ctx->normalize_gcd);
+			    local->normalize_gcd);
 	isl_int_fdiv_q(qp->div->row[div][1], qp->div->row[div][1],
-			    ctx->normalize_gcd);
+			    local->normalize_gcd);
 }
 
 /* Replace the integer division identified by "div" by the polynomial "s".
@@ -3773,7 +3781,7 @@ __isl_give isl_term *isl_term_copy(__isl_keep isl_term *term)
 	if (!term)
 		return NULL;
 
-	term->ref++;
+	isl_atomic_inc(&term->ref);
 	return term;
 }
 
@@ -3803,13 +3811,16 @@ __isl_give isl_term *isl_term_dup(__isl_keep isl_term *term)
 
 __isl_give isl_term *isl_term_cow(__isl_take isl_term *term)
 {
+	isl_term *dup;
+
 	if (!term)
 		return NULL;
 
-	if (term->ref == 1)
+	if (isl_atomic_get(&term->ref) == 1)
 		return term;
-	term->ref--;
-	return isl_term_dup(term);
+	dup = isl_term_dup(term);
+	isl_term_free(term);
+	return dup;
 }
 
 void isl_term_free(__isl_take isl_term *term)
@@ -3817,7 +3828,7 @@ void isl_term_free(__isl_take isl_term *term)
 	if (!term)
 		return;
 
-	if (--term->ref > 0)
+	if (isl_atomic_dec(&term->ref) > 0)
 		return;
 
 	isl_space_free(term->dim);
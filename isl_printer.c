@@ -2,6 +2,15 @@
 #include <isl_int.h>
 #include <isl_printer_private.h>
 
+#ifdef HAVE_UNISTD_H
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+/* The size of the buffer of a printer to a file descriptor or a callback.
+ */
+#define ISL_PRINTER_CHUNK_SIZE	(1 << 16)
+
 static __isl_give isl_printer *file_start_line(__isl_take isl_printer *p)
 {
 	fprintf(p->file, "%s%*s%s", p->indent_prefix ? p->indent_prefix : "",
@@ -178,6 +187,183 @@ static __isl_give isl_printer *str_print_isl_int(__isl_take isl_printer *p,
 	return p;
 }
 
+/* Write out the "len" bytes in "s" for the printer "p"
+ * to a file descriptor or a callback.
+ */
+static isl_stat chunk_write(__isl_keep isl_printer *p, const char *s,
+	size_t len)
+{
+	if (p->write)
+		return p->write(s, len, p->write_user);
+#ifdef HAVE_UNISTD_H
+	while (len > 0) {
+		ssize_t written = write(p->fd, s, len);
+
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written < 0)
+			isl_die(p->ctx, isl_error_unknown,
+				"unable to write to file descriptor",
+				return isl_stat_error);
+		s += written;
+		len -= written;
+	}
+	return isl_stat_ok;
+#else
+	isl_die(p->ctx, isl_error_unsupported,
+		"writing to file descriptors not supported",
+		return isl_stat_error);
+#endif
+}
+
+/* Write out the buffered output of the printer "p"
+ * to a file descriptor or a callback.
+ */
+static isl_stat chunk_write_buf(__isl_keep isl_printer *p)
+{
+	isl_stat r;
+
+	if (p->buf_n == 0)
+		return isl_stat_ok;
+	r = chunk_write(p, p->buf, p->buf_n);
+	p->buf_n = 0;
+	return r;
+}
+
+/* Make sure there is room for at least "len" more bytes
+ * in the buffer of the printer "p"
+ * to a file descriptor or a callback,
+ * writing out the buffer if needed.
+ */
+static __isl_give isl_printer *chunk_reserve(__isl_take isl_printer *p,
+	int len)
+{
+	if (p->buf_n + len > p->buf_size && chunk_write_buf(p) < 0)
+		return isl_printer_free(p);
+	return p;
+}
+
+/* Print the "len" bytes in "s" to the printer "p"
+ * to a file descriptor or a callback.
+ * The bytes are appended to the buffer of "p", after writing out
+ * the buffer if there is not enough room left.
+ * Strings that do not fit in the buffer are written out directly.
+ */
+static __isl_give isl_printer *chunk_print(__isl_take isl_printer *p,
+	const char *s, int len)
+{
+	p = chunk_reserve(p, len);
+	if (!p)
+		return NULL;
+	if (len > p->buf_size) {
+		if (chunk_write(p, s, len) < 0)
+			return isl_printer_free(p);
+		return p;
+	}
+	memcpy(p->buf + p->buf_n, s, len);
+	p->buf_n += len;
+
+	return p;
+}
+
+static __isl_give isl_printer *chunk_print_indent(__isl_take isl_printer *p,
+	int indent)
+{
+	while (p && indent > 0) {
+		int n;
+
+		if (p->buf_n == p->buf_size && chunk_write_buf(p) < 0)
+			return isl_printer_free(p);
+		n = p->buf_size - p->buf_n;
+		if (n > indent)
+			n = indent;
+		memset(p->buf + p->buf_n, ' ', n);
+		p->buf_n += n;
+		indent -= n;
+	}
+	return p;
+}
+
+static __isl_give isl_printer *chunk_start_line(__isl_take isl_printer *p)
+{
+	if (p->indent_prefix)
+		p = chunk_print(p, p->indent_prefix, strlen(p->indent_prefix));
+	if (p)
+		p = chunk_print_indent(p, p->indent);
+	if (p && p->prefix)
+		p = chunk_print(p, p->prefix, strlen(p->prefix));
+	return p;
+}
+
+static __isl_give isl_printer *chunk_end_line(__isl_take isl_printer *p)
+{
+	if (p->suffix)
+		p = chunk_print(p, p->suffix, strlen(p->suffix));
+	if (p)
+		p = chunk_print(p, "\n", 1);
+	return p;
+}
+
+static __isl_give isl_printer *chunk_flush(__isl_take isl_printer *p)
+{
+	if (chunk_write_buf(p) < 0)
+		return isl_printer_free(p);
+	return p;
+}
+
+static __isl_give isl_printer *chunk_print_str(__isl_take isl_printer *p,
+	const char *s)
+{
+	return chunk_print(p, s, strlen(s));
+}
+
+/* The maximal number of bytes printed by chunk_print_double and
+ * chunk_print_int, including the terminating null byte.
+ */
+#define ISL_PRINTER_CHUNK_NUMBER_SIZE	64
+
+/* Print "d" directly into the buffer of "p".
+ */
+static __isl_give isl_printer *chunk_print_double(__isl_take isl_printer *p,
+	double d)
+{
+	p = chunk_reserve(p, ISL_PRINTER_CHUNK_NUMBER_SIZE);
+	if (!p)
+		return NULL;
+	p->buf_n += snprintf(p->buf + p->buf_n, ISL_PRINTER_CHUNK_NUMBER_SIZE,
+				"%g", d);
+	return p;
+}
+
+/* Print "i" directly into the buffer of "p".
+ */
+static __isl_give isl_printer *chunk_print_int(__isl_take isl_printer *p,
+	int i)
+{
+	p = chunk_reserve(p, ISL_PRINTER_CHUNK_NUMBER_SIZE);
+	if (!p)
+		return NULL;
+	p->buf_n += snprintf(p->buf + p->buf_n, ISL_PRINTER_CHUNK_NUMBER_SIZE,
+				"%d", i);
+	return p;
+}
+
+static __isl_give isl_printer *chunk_print_isl_int(__isl_take isl_printer *p,
+	isl_int i)
+{
+	char *s;
+	int len;
+
+	s = isl_int_get_str(i);
+	len = strlen(s);
+	if (len < p->width)
+		p = chunk_print_indent(p, p->width - len);
+	if (p)
+		p = chunk_print(p, s, len);
+	isl_int_free_str(s);
+	return p;
+}
+
 struct isl_printer_ops {
 	__isl_give isl_printer *(*start_line)(__isl_take isl_printer *p);
 	__isl_give isl_printer *(*end_line)(__isl_take isl_printer *p);
@@ -211,6 +397,16 @@ static struct isl_printer_ops str_ops = {
 	str_flush
 };
 
+static struct isl_printer_ops chunk_ops = {
+	chunk_start_line,
+	chunk_end_line,
+	chunk_print_double,
+	chunk_print_int,
+	chunk_print_isl_int,
+	chunk_print_str,
+	chunk_flush
+};
+
 __isl_give isl_printer *isl_printer_to_file(isl_ctx *ctx, FILE *file)
 {
 	struct isl_printer *p = isl_calloc_type(ctx, struct isl_printer);
@@ -263,10 +459,83 @@ error:
 	return NULL;
 }
 
+/* Create a printer that collects its output in a fixed-size buffer and
+ * that writes out the buffer whenever it is full, when it is flushed and
+ * when it is freed.
+ * The buffer is written to "fd" if "write" is NULL and
+ * by calling "write" otherwise.
+ */
+static __isl_give isl_printer *isl_printer_to_chunks(isl_ctx *ctx, int fd,
+	isl_stat (*write)(const char *buf, size_t len, void *user),
+	void *user)
+{
+	struct isl_printer *p = isl_calloc_type(ctx, struct isl_printer);
+	if (!p)
+		return NULL;
+	p->ctx = ctx;
+	isl_ctx_ref(p->ctx);
+	p->ops = &chunk_ops;
+	p->file = NULL;
+	p->buf = isl_alloc_array(ctx, char, ISL_PRINTER_CHUNK_SIZE);
+	if (!p->buf)
+		goto error;
+	p->buf_n = 0;
+	p->buf_size = ISL_PRINTER_CHUNK_SIZE;
+	p->indent = 0;
+	p->output_format = ISL_FORMAT_ISL;
+	p->indent_prefix = NULL;
+	p->prefix = NULL;
+	p->suffix = NULL;
+	p->width = 0;
+	p->yaml_style = ISL_YAML_STYLE_FLOW;
+	p->fd = fd;
+	p->write = write;
+	p->write_user = user;
+
+	return p;
+error:
+	isl_printer_free(p);
+	return NULL;
+}
+
+/* Create a printer that writes to the file descriptor "fd".
+ * The output is buffered and only written to "fd" when the buffer
+ * is full, when the printer is flushed and when it is freed.
+ */
+__isl_give isl_printer *isl_printer_to_fd(isl_ctx *ctx, int fd)
+{
+#ifndef HAVE_UNISTD_H
+	isl_die(ctx, isl_error_unsupported,
+		"writing to file descriptors not supported", return NULL);
+#endif
+	return isl_printer_to_chunks(ctx, fd, NULL, NULL);
+}
+
+/* Create a printer that passes its output to "write".
+ * The output is buffered and only passed to "write" when the buffer
+ * is full, when the printer is flushed and when it is freed.
+ */
+__isl_give isl_printer *isl_printer_to_callback(isl_ctx *ctx,
+	isl_stat (*write)(const char *buf, size_t len, void *user),
+	void *user)
+{
+	if (!write)
+		isl_die(ctx, isl_error_invalid, "no callback specified",
+			return NULL);
+	return isl_printer_to_chunks(ctx, -1, write, user);
+}
+
+/* Free "p".
+ * If "p" is a printer to a file descriptor or a callback,
+ * then first write out any pending output.
+ * Any failure to do so can no longer be reported to the caller.
+ */
 __isl_null isl_printer *isl_printer_free(__isl_take isl_printer *p)
 {
 	if (!p)
 		return NULL;
+	if (p->ops == &chunk_ops && p->buf)
+		chunk_write_buf(p);
 	free(p->buf);
 	free(p->indent_prefix);
 	free(p->prefix);
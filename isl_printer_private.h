@@ -22,6 +22,13 @@ struct isl_printer_ops;
  * notes keeps track of arbitrary notes as a mapping between
  * name identifiers and note identifiers.  It may be NULL
  * if there are no notes yet.
+ *
+ * For a printer to a file descriptor or a callback,
+ * "buf" is a fixed-size buffer of "buf_size" bytes, the first "buf_n"
+ * of which still need to be written out.
+ * If "write" is set, then the buffer is written out by calling "write"
+ * with "write_user" as last argument.
+ * Otherwise, it is written to the file descriptor "fd".
  */
 struct isl_printer {
 	struct isl_ctx	*ctx;
@@ -44,6 +51,10 @@ struct isl_printer {
 	enum isl_yaml_state	*yaml_state;
 
 	isl_id_to_id	*notes;
+
+	isl_stat	(*write)(const char *buf, size_t len, void *user);
+	void		*write_user;
+	int		fd;
 };
 
 __isl_give isl_printer *isl_printer_set_dump(__isl_take isl_printer *p,
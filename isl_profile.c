@@ -0,0 +1,532 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <stdlib.h>
+#include <isl_profile_private.h>
+#include <isl_options_private.h>
+#include <isl/printer.h>
+
+/* A node in the profile tree of an isl_ctx.
+ *
+ * "name" is the name of the profiled operation.  It is not copied and
+ * is assumed to be a string literal.
+ * "parent" is the node of the scope in which the operation was called,
+ * with the root of the tree collecting the events that occur
+ * outside of any profiled operation.
+ * The children of a node form a singly linked list
+ * starting at "child" and connected through "next".
+ * "calls" is the number of times the operation was called
+ * from within the scope of "parent".
+ * "time" is the total time (in nanoseconds) spent in these calls,
+ * including the time spent in nested operations.
+ * "counter" keeps track of the events that occurred directly
+ * in the scope, i.e., excluding those that occurred in nested operations.
+ *
+ * The structure of the tree is protected by the lock of the isl_ctx.
+ * The statistics are updated atomically.
+ */
+struct isl_profile_node {
+	const char *name;
+	struct isl_profile_node *parent;
+	struct isl_profile_node *child;
+	struct isl_profile_node *next;
+
+	unsigned long calls;
+	uint64_t time;
+	unsigned long counter[isl_profile_n_counter];
+};
+
+/* The names of the counters, in the order of enum isl_profile_counter.
+ */
+static const char *counter_name[isl_profile_n_counter] = {
+	[isl_profile_pivots] = "pivots",
+	[isl_profile_gbr_lps] = "gbr_lps",
+	[isl_profile_allocations] = "allocations",
+	[isl_profile_operations] = "operations",
+	[isl_profile_promotions] = "promotions",
+};
+
+/* Allocate a profile tree node for the operation called "name"
+ * that is called from within "parent".
+ */
+static struct isl_profile_node *node_alloc(isl_ctx *ctx, const char *name,
+	struct isl_profile_node *parent)
+{
+	struct isl_profile_node *node;
+
+	node = isl_calloc_type(ctx, struct isl_profile_node);
+	if (!node)
+		return NULL;
+	node->name = name;
+	node->parent = parent;
+	return node;
+}
+
+/* Free the profile tree rooted at "root".
+ */
+void isl_profile_free(struct isl_profile_node *root)
+{
+	struct isl_profile_node *child, *next;
+
+	if (!root)
+		return;
+	for (child = root->child; child; child = next) {
+		next = child->next;
+		isl_profile_free(child);
+	}
+	free(root);
+}
+
+/* Return the child of "parent" for the operation called "name",
+ * creating it if it does not exist yet.
+ * The caller is responsible for holding the lock of "ctx".
+ */
+static struct isl_profile_node *get_child(isl_ctx *ctx,
+	struct isl_profile_node *parent, const char *name)
+{
+	struct isl_profile_node *child;
+
+	for (child = parent->child; child; child = child->next)
+		if (child->name == name)
+			return child;
+
+	child = node_alloc(ctx, name, parent);
+	if (!child)
+		return NULL;
+	child->next = parent->child;
+	parent->child = child;
+	return child;
+}
+
+/* Attribute the conversions of integers from small to big representation
+ * that the current thread has performed since the previous call
+ * to the innermost profiling scope of the thread, with per-thread state
+ * "local", or to the root of the profile tree
+ * if the thread is not inside any profiled operation.
+ * These conversions are performed by the integer layer,
+ * which is not aware of any isl_ctx, so they cannot be counted
+ * through isl_profile_count.
+ * This function is therefore called whenever the innermost profiling scope
+ * of a thread changes.
+ * Conversions that occur while there is no profile tree are dropped.
+ */
+void isl_profile_sync(isl_ctx *ctx, struct isl_ctx_local *local)
+{
+	unsigned long n, delta;
+	struct isl_profile_node *node;
+
+	n = isl_int_n_promotion();
+	delta = n - local->n_promotion;
+	local->n_promotion = n;
+	if (delta == 0 || !ctx->profile)
+		return;
+	node = local->profile ? local->profile : ctx->profile;
+	isl_atomic_add(&node->counter[isl_profile_promotions], delta);
+}
+
+/* Enter a profiling scope for the operation called "name",
+ * nested inside the innermost scope of the current thread.
+ * "name" is expected to be a string literal and
+ * different calls for the same operation are expected to pass
+ * the same pointer.
+ *
+ * Profiling is only performed if the print_stats option is set.
+ * If it is not set, then this function returns immediately,
+ * without even looking up the per-thread state.
+ * The profile tree is created on first use.
+ * If anything goes wrong, then the scope is simply not profiled.
+ */
+void isl_profile_enter(isl_ctx *ctx, const char *name,
+	struct isl_profile_scope *scope)
+{
+	struct isl_ctx_local *local;
+	struct isl_profile_node *node = NULL;
+
+	scope->node = NULL;
+	if (!ctx || !ctx->opt->print_stats)
+		return;
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return;
+	isl_profile_sync(ctx, local);
+
+	isl_ctx_lock(ctx);
+	if (!ctx->profile)
+		ctx->profile = node_alloc(ctx, "total", NULL);
+	if (ctx->profile) {
+		scope->parent = local->profile;
+		node = get_child(ctx, local->profile ? local->profile :
+						ctx->profile, name);
+	}
+	isl_ctx_unlock(ctx);
+	if (!node)
+		return;
+
+	isl_atomic_inc(&node->calls);
+	local->profile = node;
+	scope->node = node;
+	scope->start = isl_time_ns();
+}
+
+/* Leave the profiling scope "scope" entered by isl_profile_enter,
+ * adding the time spent in the scope to its node in the profile tree.
+ */
+void isl_profile_leave(isl_ctx *ctx, struct isl_profile_scope *scope)
+{
+	struct isl_ctx_local *local;
+
+	if (!scope->node)
+		return;
+	isl_atomic_add(&scope->node->time, isl_time_ns() - scope->start);
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return;
+	isl_profile_sync(ctx, local);
+	local->profile = scope->parent;
+}
+
+/* Count an occurrence of "counter" in the innermost profiling scope
+ * of the current thread, or in the root of the profile tree
+ * if the thread is not inside any profiled operation.
+ * The caller has checked that the profile tree of "ctx" exists.
+ */
+void isl_profile_inc(isl_ctx *ctx, enum isl_profile_counter counter)
+{
+	struct isl_ctx_local *local;
+	struct isl_profile_node *node;
+
+	local = isl_ctx_local(ctx);
+	node = local && local->profile ? local->profile : ctx->profile;
+	isl_atomic_inc(&node->counter[counter]);
+}
+
+/* Statistics about a node in the profile tree, including
+ * the contributions of all its descendants.
+ *
+ * "self_time" is the time spent in the node itself,
+ * i.e., the total time minus the total time of the children.
+ */
+struct isl_profile_totals {
+	uint64_t time;
+	uint64_t self_time;
+	unsigned long counter[isl_profile_n_counter];
+};
+
+/* Compute the totals of "node".
+ * The root of the tree is not timed itself.
+ * Its total time is the sum of the times of its children.
+ */
+static void compute_totals(struct isl_profile_node *node,
+	struct isl_profile_totals *totals)
+{
+	int i;
+	uint64_t children = 0;
+	struct isl_profile_node *child;
+
+	for (i = 0; i < isl_profile_n_counter; ++i)
+		totals->counter[i] = node->counter[i];
+	for (child = node->child; child; child = child->next) {
+		struct isl_profile_totals sub;
+
+		compute_totals(child, &sub);
+		children += sub.time;
+		for (i = 0; i < isl_profile_n_counter; ++i)
+			totals->counter[i] += sub.counter[i];
+	}
+	totals->time = node->parent ? node->time : children;
+	totals->self_time = totals->time > children ?
+				totals->time - children : 0;
+}
+
+/* Print "u" to "p".
+ */
+static __isl_give isl_printer *print_ulong(__isl_take isl_printer *p,
+	unsigned long u)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%lu", u);
+	return isl_printer_print_str(p, buf);
+}
+
+/* Print the time "t" (in nanoseconds) to "p",
+ * expressed in units of "scale" nanoseconds.
+ */
+static __isl_give isl_printer *print_time(__isl_take isl_printer *p,
+	uint64_t t, double scale)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%.6g", t / scale);
+	return isl_printer_print_str(p, buf);
+}
+
+/* Print a line describing "node" (with totals "totals") to "p"
+ * in text format.
+ */
+static __isl_give isl_printer *print_node_text(__isl_take isl_printer *p,
+	struct isl_profile_node *node, struct isl_profile_totals *totals)
+{
+	int i;
+
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, node->name);
+	p = isl_printer_print_str(p, ": calls ");
+	p = print_ulong(p, node->calls);
+	p = isl_printer_print_str(p, ", time ");
+	p = print_time(p, totals->time, 1e6);
+	p = isl_printer_print_str(p, "ms, self ");
+	p = print_time(p, totals->self_time, 1e6);
+	p = isl_printer_print_str(p, "ms");
+	for (i = 0; i < isl_profile_n_counter; ++i) {
+		p = isl_printer_print_str(p, ", ");
+		p = isl_printer_print_str(p, counter_name[i]);
+		p = isl_printer_print_str(p, " ");
+		p = print_ulong(p, totals->counter[i]);
+	}
+	return isl_printer_end_line(p);
+}
+
+/* Print the profile tree rooted at "node" to "p" in text format,
+ * with each node on a separate line and
+ * the children of a node indented with respect to the node.
+ */
+static __isl_give isl_printer *print_tree_text(__isl_take isl_printer *p,
+	struct isl_profile_node *node)
+{
+	struct isl_profile_totals totals;
+	struct isl_profile_node *child;
+
+	compute_totals(node, &totals);
+	p = print_node_text(p, node, &totals);
+	p = isl_printer_indent(p, 2);
+	for (child = node->child; child; child = child->next)
+		p = print_tree_text(p, child);
+	p = isl_printer_indent(p, -2);
+
+	return p;
+}
+
+/* Print a JSON key "key" to "p".
+ */
+static __isl_give isl_printer *print_key(__isl_take isl_printer *p,
+	const char *key)
+{
+	p = isl_printer_print_str(p, "\"");
+	p = isl_printer_print_str(p, key);
+	return isl_printer_print_str(p, "\": ");
+}
+
+/* Print the profile tree rooted at "node" to "p" as a JSON object.
+ * Times are expressed in seconds.
+ */
+static __isl_give isl_printer *print_tree_json(__isl_take isl_printer *p,
+	struct isl_profile_node *node)
+{
+	int i;
+	struct isl_profile_totals totals;
+	struct isl_profile_node *child;
+
+	compute_totals(node, &totals);
+	p = isl_printer_print_str(p, "{ ");
+	p = print_key(p, "name");
+	p = isl_printer_print_str(p, "\"");
+	p = isl_printer_print_str(p, node->name);
+	p = isl_printer_print_str(p, "\", ");
+	p = print_key(p, "calls");
+	p = print_ulong(p, node->calls);
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "time");
+	p = print_time(p, totals.time, 1e9);
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "self_time");
+	p = print_time(p, totals.self_time, 1e9);
+	for (i = 0; i < isl_profile_n_counter; ++i) {
+		p = isl_printer_print_str(p, ", ");
+		p = print_key(p, counter_name[i]);
+		p = print_ulong(p, totals.counter[i]);
+	}
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "children");
+	p = isl_printer_print_str(p, "[");
+	for (child = node->child; child; child = child->next) {
+		p = isl_printer_print_str(p, child == node->child ? "" : ", ");
+		p = print_tree_json(p, child);
+	}
+	p = isl_printer_print_str(p, "] }");
+
+	return p;
+}
+
+/* Print the global statistics of "ctx" to "p" in text format,
+ * followed by the profile tree, if any.
+ */
+static __isl_give isl_printer *print_stats_text(__isl_take isl_printer *p,
+	isl_ctx *ctx)
+{
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, "operations: ");
+	p = print_ulong(p, ctx->operations);
+	p = isl_printer_end_line(p);
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, "gbr solved lps: ");
+	p = print_ulong(p, ctx->stats->gbr_solved_lps);
+	p = isl_printer_end_line(p);
+	if (ctx->opt->memo_size > 0) {
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, "memo hits: ");
+		p = print_ulong(p, isl_ctx_get_memo_hits(ctx));
+		p = isl_printer_end_line(p);
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, "memo misses: ");
+		p = print_ulong(p, isl_ctx_get_memo_misses(ctx));
+		p = isl_printer_end_line(p);
+	}
+	if (ctx->opt->ast_build_cache_size > 0) {
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, "ast cache hits: ");
+		p = print_ulong(p, isl_ctx_get_ast_cache_hits(ctx));
+		p = isl_printer_end_line(p);
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, "ast cache misses: ");
+		p = print_ulong(p, isl_ctx_get_ast_cache_misses(ctx));
+		p = isl_printer_end_line(p);
+	}
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, "blk cache hits: ");
+	p = print_ulong(p, isl_ctx_get_blk_cache_hits(ctx));
+	p = isl_printer_end_line(p);
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, "blk cache misses: ");
+	p = print_ulong(p, isl_ctx_get_blk_cache_misses(ctx));
+	p = isl_printer_end_line(p);
+	isl_ctx_lock(ctx);
+	if (ctx->profile)
+		p = print_tree_text(p, ctx->profile);
+	isl_ctx_unlock(ctx);
+
+	return p;
+}
+
+/* Print the global statistics of "ctx" and the profile tree, if any,
+ * to "p" as a JSON object.
+ */
+static __isl_give isl_printer *print_stats_json(__isl_take isl_printer *p,
+	isl_ctx *ctx)
+{
+	p = isl_printer_print_str(p, "{ ");
+	p = print_key(p, "operations");
+	p = print_ulong(p, ctx->operations);
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "gbr_solved_lps");
+	p = print_ulong(p, ctx->stats->gbr_solved_lps);
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "memo_hits");
+	p = print_ulong(p, isl_ctx_get_memo_hits(ctx));
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "memo_misses");
+	p = print_ulong(p, isl_ctx_get_memo_misses(ctx));
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "ast_cache_hits");
+	p = print_ulong(p, isl_ctx_get_ast_cache_hits(ctx));
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "ast_cache_misses");
+	p = print_ulong(p, isl_ctx_get_ast_cache_misses(ctx));
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "blk_cache_hits");
+	p = print_ulong(p, isl_ctx_get_blk_cache_hits(ctx));
+	p = isl_printer_print_str(p, ", ");
+	p = print_key(p, "blk_cache_misses");
+	p = print_ulong(p, isl_ctx_get_blk_cache_misses(ctx));
+	isl_ctx_lock(ctx);
+	if (ctx->profile) {
+		p = isl_printer_print_str(p, ", ");
+		p = print_key(p, "profile");
+		p = print_tree_json(p, ctx->profile);
+	}
+	isl_ctx_unlock(ctx);
+	p = isl_printer_print_str(p, " }");
+
+	return p;
+}
+
+/* Return a textual description of the statistics collected by "ctx",
+ * including the profile of the operations performed
+ * while the print_stats option was set.
+ */
+__isl_give char *isl_ctx_stats_to_str(isl_ctx *ctx)
+{
+	struct isl_ctx_local *local;
+	isl_printer *p;
+	char *s;
+
+	if (!ctx)
+		return NULL;
+	local = isl_ctx_local(ctx);
+	if (local)
+		isl_profile_sync(ctx, local);
+	p = isl_printer_to_str(ctx);
+	p = print_stats_text(p, ctx);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	return s;
+}
+
+/* Return a JSON description of the statistics collected by "ctx",
+ * including the profile of the operations performed
+ * while the print_stats option was set.
+ */
+__isl_give char *isl_ctx_stats_to_json(isl_ctx *ctx)
+{
+	struct isl_ctx_local *local;
+	isl_printer *p;
+	char *s;
+
+	if (!ctx)
+		return NULL;
+	local = isl_ctx_local(ctx);
+	if (local)
+		isl_profile_sync(ctx, local);
+	p = isl_printer_to_str(ctx);
+	p = print_stats_json(p, ctx);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	return s;
+}
+
+/* Print the statistics collected by "ctx" to "out"
+ * in the format selected by the print_stats_format option.
+ */
+void isl_profile_print_stats(isl_ctx *ctx, FILE *out)
+{
+	char *s;
+
+	if (ctx->opt->print_stats_format == ISL_PRINT_STATS_JSON)
+		s = isl_ctx_stats_to_json(ctx);
+	else
+		s = isl_ctx_stats_to_str(ctx);
+	if (!s)
+		return;
+	fprintf(out, "%s", s);
+	if (ctx->opt->print_stats_format == ISL_PRINT_STATS_JSON)
+		fprintf(out, "\n");
+	free(s);
+}
+
+/* Discard the profile collected by "ctx".
+ * This should not be called while any profiled operation
+ * is being performed on "ctx".
+ */
+void isl_ctx_reset_profile(isl_ctx *ctx)
+{
+	if (!ctx)
+		return;
+	isl_ctx_lock(ctx);
+	isl_profile_free(ctx->profile);
+	ctx->profile = NULL;
+	isl_ctx_unlock(ctx);
+	ctx->local.profile = NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef ISL_PROFILE_PRIVATE_H
+#define ISL_PROFILE_PRIVATE_H
+
+#include <stdio.h>
+#include <isl_ctx_private.h>
+
+/* The events that are counted by the profiler.
+ * They are attributed to the innermost profiling scope
+ * of the thread in which they occur.
+ */
+enum isl_profile_counter {
+	isl_profile_pivots,
+	isl_profile_gbr_lps,
+	isl_profile_allocations,
+	isl_profile_operations,
+	isl_profile_promotions,
+	isl_profile_n_counter
+};
+
+/* A profiling scope entered by isl_profile_enter.
+ *
+ * "node" is the node in the profile tree of the isl_ctx
+ * that collects the results of the scope or NULL
+ * if profiling was disabled when the scope was entered.
+ * "parent" is the innermost scope of the thread at the point
+ * where the scope was entered.
+ * "start" is the time (in nanoseconds) at which the scope was entered.
+ */
+struct isl_profile_scope {
+	struct isl_profile_node *node;
+	struct isl_profile_node *parent;
+	uint64_t start;
+};
+
+void isl_profile_enter(isl_ctx *ctx, const char *name,
+	struct isl_profile_scope *scope);
+void isl_profile_leave(isl_ctx *ctx, struct isl_profile_scope *scope);
+
+void isl_profile_inc(isl_ctx *ctx, enum isl_profile_counter counter);
+void isl_profile_sync(isl_ctx *ctx, struct isl_ctx_local *local);
+
+/* Count an occurrence of "counter" in the innermost profiling scope,
+ * provided profiling has been enabled on "ctx".
+ */
+static inline void isl_profile_count(isl_ctx *ctx,
+	enum isl_profile_counter counter)
+{
+	if (ctx->profile)
+		isl_profile_inc(ctx, counter);
+}
+
+void isl_profile_print_stats(isl_ctx *ctx, FILE *out);
+void isl_profile_free(struct isl_profile_node *root);
+
+#endif
@@ -12,6 +12,7 @@
  */
 
 #include <isl/aff.h>
+#include <isl_ctx_private.h>
 #include <isl_sort.h>
 #include <isl_val_private.h>
 
@@ -185,13 +186,16 @@ __isl_give PW *FN(PW,dup)(__isl_keep PW *pw)
 
 __isl_give PW *FN(PW,cow)(__isl_take PW *pw)
 {
+	PW *dup;
+
 	if (!pw)
 		return NULL;
 
-	if (pw->ref == 1)
+	if (isl_atomic_get(&pw->ref) == 1)
 		return pw;
-	pw->ref--;
-	return FN(PW,dup)(pw);
+	dup = FN(PW,dup)(pw);
+	FN(PW,free)(pw);
+	return dup;
 }
 
 __isl_give PW *FN(PW,copy)(__isl_keep PW *pw)
@@ -199,7 +203,7 @@ __isl_give PW *FN(PW,copy)(__isl_keep PW *pw)
 	if (!pw)
 		return NULL;
 
-	pw->ref++;
+	isl_atomic_inc(&pw->ref);
 	return pw;
 }
 
@@ -209,7 +213,7 @@ __isl_null PW *FN(PW,free)(__isl_take PW *pw)
 
 	if (!pw)
 		return NULL;
-	if (--pw->ref > 0)
+	if (isl_atomic_dec(&pw->ref) > 0)
 		return NULL;
 
 	for (i = 0; i < pw->n; ++i) {
@@ -500,7 +504,7 @@ static __isl_give PW *FN(PW,grow)(__isl_take PW *pw, int n)
 		return pw;
 	ctx = FN(PW,get_ctx)(pw);
 	n += pw->n;
-	if (pw->ref == 1) {
+	if (isl_atomic_get(&pw->ref) == 1) {
 		res = isl_realloc(ctx, pw, struct PW,
 			    sizeof(struct PW) + (n - 1) * sizeof(S(PW,piece)));
 		if (!res)
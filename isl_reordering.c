@@ -33,7 +33,7 @@ __isl_give isl_reordering *isl_reordering_copy(__isl_keep isl_reordering *exp)
 	if (!exp)
 		return NULL;
 
-	exp->ref++;
+	isl_atomic_inc(&exp->ref);
 	return exp;
 }
 
@@ -60,13 +60,16 @@ __isl_give isl_reordering *isl_reordering_dup(__isl_keep isl_reordering *r)
 
 __isl_give isl_reordering *isl_reordering_cow(__isl_take isl_reordering *r)
 {
+	isl_reordering *dup;
+
 	if (!r)
 		return NULL;
 
-	if (r->ref == 1)
+	if (isl_atomic_get(&r->ref) == 1)
 		return r;
-	r->ref--;
-	return isl_reordering_dup(r);
+	dup = isl_reordering_dup(r);
+	isl_reordering_free(r);
+	return dup;
 }
 
 void *isl_reordering_free(__isl_take isl_reordering *exp)
@@ -74,7 +77,7 @@ void *isl_reordering_free(__isl_take isl_reordering *exp)
 	if (!exp)
 		return NULL;
 
-	if (--exp->ref > 0)
+	if (isl_atomic_dec(&exp->ref) > 0)
 		return NULL;
 
 	isl_space_free(exp->dim);
@@ -369,6 +369,8 @@ static int greedy_search(isl_ctx *ctx, struct isl_tab *tab,
  * When ctx->opt->gbr is set to ISL_GBR_ALWAYS, then we allow the basis
  * reduction computation to return early.  That is, as soon as it
  * finds a reasonable first direction.
+ * The options are not modified, such that they can be shared
+ * with other threads.
  */ 
 struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 {
@@ -456,17 +458,12 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 				if (g)
 					break;
 			}
-			if (!reduced && choice &&
-			    ctx->opt->gbr != ISL_GBR_NEVER) {
-				unsigned gbr_only_first;
-				if (ctx->opt->gbr == ISL_GBR_ONCE)
-					ctx->opt->gbr = ISL_GBR_NEVER;
+			if (!reduced && choice && gbr != ISL_GBR_NEVER) {
+				if (gbr == ISL_GBR_ONCE)
+					gbr = ISL_GBR_NEVER;
 				tab->n_zero = level;
-				gbr_only_first = ctx->opt->gbr_only_first;
-				ctx->opt->gbr_only_first =
-					ctx->opt->gbr == ISL_GBR_ALWAYS;
-				tab = isl_tab_compute_reduced_basis(tab);
-				ctx->opt->gbr_only_first = gbr_only_first;
+				tab = isl_tab_compute_reduced_basis_only_first(
+					tab, gbr == ISL_GBR_ALWAYS);
 				if (!tab || !tab->basis)
 					goto error;
 				reduced = 1;
@@ -511,13 +508,11 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 	} else
 		sample = isl_vec_alloc(ctx, 0);
 
-	ctx->opt->gbr = gbr;
 	isl_vec_free(min);
 	isl_vec_free(max);
 	free(snap);
 	return sample;
 error:
-	ctx->opt->gbr = gbr;
 	isl_vec_free(min);
 	isl_vec_free(max);
 	free(snap);
@@ -646,7 +641,8 @@ static __isl_give isl_vec *sample_bounded(__isl_take isl_basic_set *bset)
 	if (!sample)
 		goto error;
 
-	if (sample->size > 0) {
+	if (sample->size > 0 &&
+	    isl_ctx_may_update_shared(bset->ctx, &bset->ref)) {
 		isl_vec_free(bset->sample);
 		bset->sample = isl_vec_copy(sample);
 	}
@@ -1138,7 +1134,8 @@ static __isl_give isl_vec *basic_set_sample(__isl_take isl_basic_set *bset,
 	isl_assert(ctx, isl_basic_set_n_param(bset) == 0, goto error);
 	isl_assert(ctx, bset->n_div == 0, goto error);
 
-	if (bset->sample && bset->sample->size == 1 + dim) {
+	if (bset->sample && bset->sample->size == 1 + dim &&
+	    isl_int_is_one(bset->sample->el[0])) {
 		int contains = isl_basic_set_contains(bset, bset->sample);
 		if (contains < 0)
 			goto error;
@@ -1148,8 +1145,10 @@ static __isl_give isl_vec *basic_set_sample(__isl_take isl_basic_set *bset,
 			return sample;
 		}
 	}
-	isl_vec_free(bset->sample);
-	bset->sample = NULL;
+	if (isl_ctx_may_update_shared(bset->ctx, &bset->ref)) {
+		isl_vec_free(bset->sample);
+		bset->sample = NULL;
+	}
 
 	if (bset->n_eq > 0)
 		return sample_eq(bset, bounded ? isl_basic_set_sample_bounded
@@ -1212,10 +1211,27 @@ error:
 	return NULL;
 }
 
+/* Return a basic map containing a single integer point of "bmap" or
+ * an empty basic map if "bmap" does not contain any integer points.
+ *
+ * If "bmap" has a valid cached integer sample, then it is used directly.
+ * Otherwise, a sample is computed and cached inside "bmap",
+ * unless "bmap" may be accessed by other threads.
+ */
 __isl_give isl_basic_map *isl_basic_map_sample(__isl_take isl_basic_map *bmap)
 {
 	struct isl_basic_set *bset;
 	struct isl_vec *sample_vec;
+	isl_bool non_empty;
+
+	non_empty = isl_basic_map_plain_is_non_empty(bmap);
+	if (non_empty < 0)
+		goto error;
+	if (non_empty && isl_int_is_one(bmap->sample->el[0])) {
+		sample_vec = isl_vec_copy(bmap->sample);
+		bset = isl_basic_set_from_vec(sample_vec);
+		return isl_basic_map_overlying_set(bset, bmap);
+	}
 
 	bset = isl_basic_map_underlying_set(isl_basic_map_copy(bmap));
 	sample_vec = isl_basic_set_sample_vec(bset);
@@ -1225,8 +1241,10 @@ __isl_give isl_basic_map *isl_basic_map_sample(__isl_take isl_basic_map *bmap)
 		isl_vec_free(sample_vec);
 		return isl_basic_map_set_to_empty(bmap);
 	}
-	isl_vec_free(bmap->sample);
-	bmap->sample = isl_vec_copy(sample_vec);
+	if (isl_ctx_may_update_shared(bmap->ctx, &bmap->ref)) {
+		isl_vec_free(bmap->sample);
+		bmap->sample = isl_vec_copy(sample_vec);
+	}
 	bset = isl_basic_set_from_vec(sample_vec);
 	return isl_basic_map_overlying_set(bset, bmap);
 error:
@@ -13,6 +13,7 @@
 
 #include <isl/ctx.h>
 #include <isl/val.h>
+#include <isl_ctx_private.h>
 #include <isl_aff_private.h>
 #include <isl/map.h>
 #include <isl/set.h>
@@ -95,7 +96,7 @@ __isl_give isl_schedule *isl_schedule_copy(__isl_keep isl_schedule *sched)
 	if (!sched)
 		return NULL;
 
-	sched->ref++;
+	isl_atomic_inc(&sched->ref);
 	return sched;
 }
 
@@ -109,12 +110,12 @@ __isl_give isl_schedule *isl_schedule_cow(__isl_take isl_schedule *schedule)
 
 	if (!schedule)
 		return NULL;
-	if (schedule->ref == 1)
+	if (isl_atomic_get(&schedule->ref) == 1)
 		return schedule;
 
 	ctx = isl_schedule_get_ctx(schedule);
-	schedule->ref--;
 	tree = isl_schedule_tree_copy(schedule->root);
+	isl_schedule_free(schedule);
 	return isl_schedule_from_schedule_tree(ctx, tree);
 }
 
@@ -123,7 +124,7 @@ __isl_null isl_schedule *isl_schedule_free(__isl_take isl_schedule *sched)
 	if (!sched)
 		return NULL;
 
-	if (--sched->ref > 0)
+	if (isl_atomic_dec(&sched->ref) > 0)
 		return NULL;
 
 	isl_schedule_tree_free(sched->root);
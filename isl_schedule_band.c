@@ -15,6 +15,7 @@
 #include <isl/space.h>
 #include <isl/map.h>
 #include <isl/schedule_node.h>
+#include <isl_ctx_private.h>
 #include <isl_schedule_band.h>
 #include <isl_schedule_private.h>
 
@@ -133,13 +134,16 @@ __isl_give isl_schedule_band *isl_schedule_band_dup(
 __isl_give isl_schedule_band *isl_schedule_band_cow(
 	__isl_take isl_schedule_band *band)
 {
+	isl_schedule_band *dup;
+
 	if (!band)
 		return NULL;
 
-	if (band->ref == 1)
+	if (isl_atomic_get(&band->ref) == 1)
 		return band;
-	band->ref--;
-	return isl_schedule_band_dup(band);
+	dup = isl_schedule_band_dup(band);
+	isl_schedule_band_free(band);
+	return dup;
 }
 
 /* Return a new reference to "band".
@@ -150,7 +154,7 @@ __isl_give isl_schedule_band *isl_schedule_band_copy(
 	if (!band)
 		return NULL;
 
-	band->ref++;
+	isl_atomic_inc(&band->ref);
 	return band;
 }
 
@@ -162,7 +166,7 @@ __isl_null isl_schedule_band *isl_schedule_band_free(
 	if (!band)
 		return NULL;
 
-	if (--band->ref > 0)
+	if (isl_atomic_dec(&band->ref) > 0)
 		return NULL;
 
 	isl_multi_union_pw_aff_free(band->mupa);
@@ -14,6 +14,7 @@
 #include <isl/val.h>
 #include <isl/space.h>
 #include <isl/set.h>
+#include <isl_ctx_private.h>
 #include <isl_schedule_band.h>
 #include <isl_schedule_private.h>
 #include <isl_schedule_node_private.h>
@@ -196,13 +197,16 @@ __isl_take isl_schedule_node *isl_schedule_node_dup(
 __isl_give isl_schedule_node *isl_schedule_node_cow(
 	__isl_take isl_schedule_node *node)
 {
+	isl_schedule_node *dup;
+
 	if (!node)
 		return NULL;
 
-	if (node->ref == 1)
+	if (isl_atomic_get(&node->ref) == 1)
 		return node;
-	node->ref--;
-	return isl_schedule_node_dup(node);
+	dup = isl_schedule_node_dup(node);
+	isl_schedule_node_free(node);
+	return dup;
 }
 
 /* Return a new reference to "node".
@@ -213,7 +217,7 @@ __isl_give isl_schedule_node *isl_schedule_node_copy(
 	if (!node)
 		return NULL;
 
-	node->ref++;
+	isl_atomic_inc(&node->ref);
 	return node;
 }
 
@@ -224,7 +228,7 @@ __isl_null isl_schedule_node *isl_schedule_node_free(
 {
 	if (!node)
 		return NULL;
-	if (--node->ref > 0)
+	if (isl_atomic_dec(&node->ref) > 0)
 		return NULL;
 
 	isl_schedule_tree_list_free(node->ancestors);
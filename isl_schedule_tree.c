@@ -16,6 +16,7 @@
 #include <isl/val.h>
 #include <isl/space.h>
 #include <isl/map.h>
+#include <isl_ctx_private.h>
 #include <isl_schedule_band.h>
 #include <isl_schedule_private.h>
 
@@ -149,13 +150,16 @@ __isl_take isl_schedule_tree *isl_schedule_tree_dup(
 __isl_give isl_schedule_tree *isl_schedule_tree_cow(
 	__isl_take isl_schedule_tree *tree)
 {
+	isl_schedule_tree *dup;
+
 	if (!tree)
 		return NULL;
 
-	if (tree->ref == 1)
+	if (isl_atomic_get(&tree->ref) == 1)
 		return tree;
-	tree->ref--;
-	return isl_schedule_tree_dup(tree);
+	dup = isl_schedule_tree_dup(tree);
+	isl_schedule_tree_free(tree);
+	return dup;
 }
 
 /* Return a new reference to "tree".
@@ -166,7 +170,7 @@ __isl_give isl_schedule_tree *isl_schedule_tree_copy(
 	if (!tree)
 		return NULL;
 
-	tree->ref++;
+	isl_atomic_inc(&tree->ref);
 	return tree;
 }
 
@@ -177,7 +181,7 @@ __isl_null isl_schedule_tree *isl_schedule_tree_free(
 {
 	if (!tree)
 		return NULL;
-	if (--tree->ref > 0)
+	if (isl_atomic_dec(&tree->ref) > 0)
 		return NULL;
 
 	switch (tree->type) {
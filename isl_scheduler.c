@@ -23,7 +23,7 @@
 #include <isl/constraint.h>
 #include <isl/schedule.h>
 #include <isl_schedule_constraints.h>
-#include <isl/schedule_node.h>
+#include <isl_schedule_node_private.h>
 #include <isl_mat_private.h>
 #include <isl_vec_private.h>
 #include <isl/set.h>
@@ -34,6 +34,8 @@
 #include <isl/map_to_basic_set.h>
 #include <isl_sort.h>
 #include <isl_options_private.h>
+#include <isl_parallel.h>
+#include <isl_profile_private.h>
 #include <isl_tarjan.h>
 #include <isl_morph.h>
 #include <isl/ilp.h>
@@ -2710,6 +2712,20 @@ static isl_stat add_var_sum_constraint(struct isl_sched_graph *graph,
 	return isl_stat_ok;
 }
 
+/* Update the vmap, indep and rank fields of all nodes in "graph"
+ * to reflect the current schedule rows.
+ */
+static isl_stat update_vmaps(struct isl_sched_graph *graph)
+{
+	int i;
+
+	for (i = 0; i < graph->n; ++i)
+		if (node_update_vmap(&graph->node[i]) < 0)
+			return isl_stat_error;
+
+	return isl_stat_ok;
+}
+
 /* Construct an ILP problem for finding schedule coefficients
  * that result in non-negative, but small dependence distances
  * over all dependences.
@@ -2755,10 +2771,10 @@ static isl_stat setup_lp(isl_ctx *ctx, struct isl_sched_graph *graph,
 	nparam = isl_space_dim(graph->node[0].space, isl_dim_param);
 	param_pos = 4;
 	total = param_pos + 2 * nparam;
+	if (update_vmaps(graph) < 0)
+		return isl_stat_error;
 	for (i = 0; i < graph->n; ++i) {
 		struct isl_sched_node *node = &graph->node[graph->sorted[i]];
-		if (node_update_vmap(node) < 0)
-			return isl_stat_error;
 		node->start = total;
 		total += 1 + node->nparam + 2 * node->nvar;
 	}
@@ -2883,12 +2899,16 @@ static __isl_give isl_mat *construct_trivial(__isl_keep isl_mat *indep)
  * This region imposes that the next row is independent of previous rows.
  * In particular, the non-triviality region enforces that at least
  * one of the linear combinations in the rows of node->indep is non-zero.
+ *
+ * "tl" is a tableau for the ILP problem constructed from graph->lp.
+ * It is left unmodified such that it can be reused for the next row
+ * as long as graph->lp does not change.
  */
-static __isl_give isl_vec *solve_lp(isl_ctx *ctx, struct isl_sched_graph *graph)
+static __isl_give isl_vec *solve_lp(isl_ctx *ctx, struct isl_sched_graph *graph,
+	__isl_keep isl_tab_lexmin *tl)
 {
 	int i;
 	isl_vec *sol;
-	isl_basic_set *lp;
 
 	for (i = 0; i < graph->n; ++i) {
 		struct isl_sched_node *node = &graph->node[i];
@@ -2901,8 +2921,7 @@ static __isl_give isl_vec *solve_lp(isl_ctx *ctx, struct isl_sched_graph *graph)
 			trivial = isl_mat_zero(ctx, 0, 0);
 		graph->region[i].trivial = trivial;
 	}
-	lp = isl_basic_set_copy(graph->lp);
-	sol = isl_tab_basic_set_non_trivial_lexmin(lp, 2, graph->n,
+	sol = isl_tab_lexmin_non_trivial(tl, 2, graph->n,
 				       graph->region, &check_conflict, graph);
 	for (i = 0; i < graph->n; ++i)
 		isl_mat_free(graph->region[i].trivial);
@@ -5628,6 +5647,22 @@ static __isl_give isl_schedule_node *compute_schedule_finish_band(
  * until we are no longer able to compute a schedule.
  * Since there are only a finite number of dependences,
  * there will only be a finite number of iterations.
+ *
+ * The ILP problem constructed by setup_lp only depends on
+ * the (local) edges of the graph and on whether coincidence edges
+ * are being treated as local edges.  In particular, it does not depend
+ * on the schedule rows that have already been computed for the current band.
+ * The corresponding tableau "tl" is therefore kept alive across
+ * the rows of the band and only reconstructed when use_coincidence
+ * changes or when the band is reset, unless the schedule_reuse_lp
+ * option is turned off.
+ * The dependence on the previous rows is encoded in the non-triviality
+ * regions, which are passed separately to solve_lp.
+ * If conditional validity constraints need to be checked, then
+ * the tableau is not reused since has_violated_conditional_constraint
+ * may mark additional condition edges as local, even if it does not
+ * find any violation, and these then need to be forced to be local
+ * in the computation of the next row.
  */
 static isl_stat compute_schedule_wcc_band(isl_ctx *ctx,
 	struct isl_sched_graph *graph)
@@ -5636,6 +5671,8 @@ static isl_stat compute_schedule_wcc_band(isl_ctx *ctx,
 	int use_coincidence;
 	int force_coincidence = 0;
 	int check_conditional;
+	int reuse_lp;
+	isl_tab_lexmin *tl = NULL;
 
 	if (sort_sccs(graph) < 0)
 		return isl_stat_error;
@@ -5643,6 +5680,7 @@ static isl_stat compute_schedule_wcc_band(isl_ctx *ctx,
 	clear_local_edges(graph);
 	check_conditional = need_condition_check(graph);
 	has_coincidence = has_any_coincidence(graph);
+	reuse_lp = ctx->opt->schedule_reuse_lp && !check_conditional;
 
 	if (ctx->opt->schedule_outer_coincidence)
 		force_coincidence = 1;
@@ -5656,15 +5694,26 @@ static isl_stat compute_schedule_wcc_band(isl_ctx *ctx,
 		graph->src_scc = -1;
 		graph->dst_scc = -1;
 
-		if (setup_lp(ctx, graph, use_coincidence) < 0)
-			return isl_stat_error;
-		sol = solve_lp(ctx, graph);
+		if (!tl) {
+			if (setup_lp(ctx, graph, use_coincidence) < 0)
+				return isl_stat_error;
+			tl = isl_tab_lexmin_from_basic_set(
+					isl_basic_set_copy(graph->lp));
+			if (!tl)
+				return isl_stat_error;
+		} else if (update_vmaps(graph) < 0) {
+			goto error;
+		}
+		sol = solve_lp(ctx, graph, tl);
+		if (!reuse_lp)
+			tl = isl_tab_lexmin_free(tl);
 		if (!sol)
-			return isl_stat_error;
+			goto error;
 		if (sol->size == 0) {
 			int empty = graph->n_total_row == graph->band_start;
 
 			isl_vec_free(sol);
+			tl = isl_tab_lexmin_free(tl);
 			if (use_coincidence && (!force_coincidence || !empty)) {
 				use_coincidence = 0;
 				continue;
@@ -5673,21 +5722,26 @@ static isl_stat compute_schedule_wcc_band(isl_ctx *ctx,
 		}
 		coincident = !has_coincidence || use_coincidence;
 		if (update_schedule(graph, sol, coincident) < 0)
-			return isl_stat_error;
+			goto error;
 
 		if (!check_conditional)
 			continue;
 		violated = has_violated_conditional_constraint(ctx, graph);
 		if (violated < 0)
-			return isl_stat_error;
+			goto error;
 		if (!violated)
 			continue;
+		tl = isl_tab_lexmin_free(tl);
 		if (reset_band(graph) < 0)
 			return isl_stat_error;
 		use_coincidence = has_coincidence;
 	}
 
+	isl_tab_lexmin_free(tl);
 	return isl_stat_ok;
+error:
+	isl_tab_lexmin_free(tl);
+	return isl_stat_error;
 }
 
 /* Compute a schedule for a connected dependence graph by considering
@@ -7266,6 +7320,104 @@ static __isl_give isl_schedule_node *compute_schedule_wcc(
 		return compute_schedule_wcc_clustering(node, graph);
 }
 
+/* Internal data structure for compute_component_schedules_parallel.
+ *
+ * "graph" is the graph of which the components are being scheduled.
+ * "wcc" is set if each component is known to be weakly connected.
+ * "filters" contains the domains of the components.
+ * "trees" collects the schedule trees computed for the components.
+ */
+struct isl_sched_component_data {
+	struct isl_sched_graph *graph;
+	int wcc;
+	isl_union_set_list *filters;
+	isl_schedule_tree **trees;
+};
+
+/* isl_parallel_for callback for compute_component_schedules_parallel.
+ * Compute a schedule for the component "component" of data->graph
+ * in a separate schedule tree that has the domain of the component
+ * as its root and store the subtree below this root
+ * in data->trees[component].
+ * The schedule computation only depends on data->graph and
+ * not on the position in the schedule tree, so the subtree
+ * is the same as the one that would have been constructed
+ * in the original schedule tree.
+ * The subgraph is extracted from data->graph in the current thread,
+ * but data->graph itself is not modified.
+ */
+static isl_stat compute_component_schedule_task(int component, void *user)
+{
+	struct isl_sched_component_data *data = user;
+	isl_ctx *ctx;
+	isl_union_set *domain;
+	isl_schedule_node *node;
+
+	domain = isl_union_set_list_get_union_set(data->filters, component);
+	if (!domain)
+		return isl_stat_error;
+	ctx = isl_union_set_get_ctx(domain);
+	node = isl_schedule_node_from_domain(domain);
+	node = isl_schedule_node_child(node, 0);
+	node = compute_sub_schedule(node, ctx, data->graph,
+				    &node_scc_exactly,
+				    &edge_scc_exactly, component, data->wcc);
+	data->trees[component] = isl_schedule_node_get_tree(node);
+	isl_schedule_node_free(node);
+
+	return data->trees[component] ? isl_stat_ok : isl_stat_error;
+}
+
+/* Compute a schedule for each group of nodes identified by node->scc
+ * in parallel and combine them in a sequence node (or as set node
+ * if graph->weak is set) with filters "filters",
+ * inserted at position "node" of the schedule tree.
+ * Return the updated schedule node.
+ *
+ * The schedules are first all computed in separate schedule trees and
+ * are then grafted into the schedule tree in the original order,
+ * such that the result is the same as when the schedules are
+ * computed one by one in compute_component_schedule.
+ */
+static __isl_give isl_schedule_node *compute_component_schedules_parallel(
+	__isl_take isl_schedule_node *node, struct isl_sched_graph *graph,
+	__isl_take isl_union_set_list *filters, int wcc)
+{
+	int component;
+	isl_ctx *ctx;
+	isl_stat r;
+	struct isl_sched_component_data data = { graph, wcc, filters };
+
+	ctx = isl_schedule_node_get_ctx(node);
+	data.trees = isl_calloc_array(ctx, isl_schedule_tree *, graph->scc);
+	r = filters && data.trees ? isl_stat_ok : isl_stat_error;
+	if (r >= 0)
+		r = isl_parallel_for(ctx, graph->scc,
+				&compute_component_schedule_task, &data);
+
+	if (r < 0)
+		node = isl_schedule_node_free(node);
+	else if (graph->weak)
+		node = isl_schedule_node_insert_set(node, filters);
+	else
+		node = isl_schedule_node_insert_sequence(node, filters);
+	if (r < 0)
+		isl_union_set_list_free(filters);
+
+	for (component = 0; data.trees && component < graph->scc; ++component) {
+		isl_schedule_tree *tree = data.trees[component];
+
+		node = isl_schedule_node_child(node, component);
+		node = isl_schedule_node_child(node, 0);
+		node = isl_schedule_node_graft_tree(node, tree);
+		node = isl_schedule_node_parent(node);
+		node = isl_schedule_node_parent(node);
+	}
+	free(data.trees);
+
+	return node;
+}
+
 /* Compute a schedule for each group of nodes identified by node->scc
  * separately and then combine them in a sequence node (or as set node
  * if graph->weak is set) inserted at position "node" of the schedule tree.
@@ -7283,6 +7435,11 @@ static __isl_give isl_schedule_node *compute_schedule_wcc(
  * can be executed in arbitrary order, which is also expressed
  * by the absence of any node.  Refrain from inserting any nodes
  * in this case and simply return.
+ *
+ * If the schedule_parallel_components option is set and
+ * if the components can be handled by several threads,
+ * then the schedules of the components are computed
+ * in compute_component_schedules_parallel.
  */
 static __isl_give isl_schedule_node *compute_component_schedule(
 	__isl_take isl_schedule_node *node, struct isl_sched_graph *graph,
@@ -7304,6 +7461,10 @@ static __isl_give isl_schedule_node *compute_component_schedule(
 
 	ctx = isl_schedule_node_get_ctx(node);
 	filters = extract_sccs(ctx, graph);
+	if (ctx->opt->schedule_parallel_components &&
+	    isl_parallel_n_threads(ctx, graph->scc) > 1)
+		return compute_component_schedules_parallel(node, graph,
+							    filters, wcc);
 	if (graph->weak)
 		node = isl_schedule_node_insert_set(node, filters);
 	else
@@ -7370,7 +7531,7 @@ static __isl_give isl_schedule_node *compute_schedule(isl_schedule_node *node,
  * a tilable band, provided they have no adjacent non-local
  * condition dependences.
  */
-__isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
+static __isl_give isl_schedule *schedule_constraints_compute_schedule(
 	__isl_take isl_schedule_constraints *sc)
 {
 	isl_ctx *ctx = isl_schedule_constraints_get_ctx(sc);
@@ -7403,6 +7564,28 @@ __isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
 	return sched;
 }
 
+/* Compute a schedule on the domain of "sc" that respects the
+ * schedule constraints in "sc", profiling the operation if requested.
+ */
+__isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
+	__isl_take isl_schedule_constraints *sc)
+{
+	isl_ctx *ctx;
+	isl_schedule *schedule;
+	struct isl_profile_scope scope;
+
+	if (!sc)
+		return NULL;
+
+	ctx = isl_schedule_constraints_get_ctx(sc);
+	isl_profile_enter(ctx, "isl_schedule_constraints_compute_schedule",
+			&scope);
+	schedule = schedule_constraints_compute_schedule(sc);
+	isl_profile_leave(ctx, &scope);
+
+	return schedule;
+}
+
 /* Compute a schedule for the given union of domains that respects
  * all the validity dependences and minimizes
  * the dependence distances over the proximity dependences.
@@ -11,6 +11,252 @@
 #include <isl_ctx_private.h>
 #include <isl_seq.h>
 
+#if defined(USE_SMALL_INT_OPT) && defined(HAVE_AVX2_TARGET) && \
+    defined(__x86_64__)
+#define ISL_SEQ_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef ISL_SEQ_AVX2
+
+/* The kernels below operate directly on the words representing
+ * the isl_ints in a sequence, four at a time, and are only used
+ * if the processor supports AVX2.
+ *
+ * A value is called narrow if it is stored in small representation and
+ * its absolute value is at most NARROW_MAX.  The product of two narrow
+ * values and the sum of two such products fit in an int64_t.
+ * NARROW_WORD_MIN and NARROW_WORD_MAX are the (signed) words
+ * representing -NARROW_MAX and NARROW_MAX.
+ * Since AVX2 does not support 64-bit multiplication,
+ * the multiplications are performed by _mm256_mul_epi32 on
+ * the lower halves of the values, which is exact for narrow values.
+ * The lower half of a narrow value is obtained by shifting the word
+ * logically to the right over ISL_INT_SMALL_SHIFT positions.
+ */
+#define NARROW_MAX	((int64_t) INT32_MAX)
+#define NARROW_WORD_MIN	\
+	((int64_t) ((uint64_t) -NARROW_MAX << ISL_INT_SMALL_SHIFT | 1))
+#define NARROW_WORD_MAX	\
+	((int64_t) ((uint64_t) NARROW_MAX << ISL_INT_SMALL_SHIFT | 1))
+
+/* The word representing a zero in small representation.
+ */
+#define SMALL_ZERO_WORD	((uint64_t) 1)
+
+/* Return the word representing "v".
+ */
+static uint64_t word(isl_int v)
+{
+	return *(uint64_t *) v;
+}
+
+/* Is "v" narrow?
+ */
+static int is_narrow(isl_int v)
+{
+	int64_t w = word(v);
+
+	return (w & 1) && NARROW_WORD_MIN <= w && w <= NARROW_WORD_MAX;
+}
+
+/* Set "r" to a + b and return whether the addition overflowed,
+ * i.e., whether "a" and "b" have the same sign and the result
+ * has a different sign.
+ */
+static int add_overflow(int64_t a, int64_t b, int64_t *r)
+{
+	uint64_t sum = (uint64_t) a + (uint64_t) b;
+
+	*r = sum;
+	return (int64_t) ((a ^ sum) & (b ^ sum)) < 0;
+}
+
+/* Is the processor able to execute the AVX2 kernels?
+ */
+static int use_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+/* Are all "len" elements of "p" narrow?
+ * If "small" is set, then only check that they are all
+ * in small representation.
+ */
+__attribute__((target("avx2")))
+static int seq_is_narrow_avx2(isl_int *p, unsigned len, int small)
+{
+	int i;
+	const __m256i one = _mm256_set1_epi64x(1);
+	const __m256i lo = _mm256_set1_epi64x(NARROW_WORD_MIN - 1);
+	const __m256i hi = _mm256_set1_epi64x(NARROW_WORD_MAX + 1);
+	__m256i tag = one;
+	__m256i bad = _mm256_setzero_si256();
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256i w = _mm256_loadu_si256((__m256i *) p[i]);
+
+		tag = _mm256_and_si256(tag, w);
+		if (small)
+			continue;
+		bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(w, hi));
+		bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(lo, w));
+	}
+	bad = _mm256_or_si256(bad, _mm256_cmpeq_epi64(tag,
+						_mm256_setzero_si256()));
+	if (!_mm256_testz_si256(bad, bad))
+		return 0;
+	for (; i < len; ++i) {
+		if (small ? !isl_int_is_small(p[i]) : !is_narrow(p[i]))
+			return 0;
+	}
+	return 1;
+}
+
+/* Return the position of the first non-zero element of "p",
+ * skipping over blocks of four elements that are all small zeros.
+ * Since big representations are not necessarily normalized,
+ * any other element still needs to be checked explicitly.
+ */
+__attribute__((target("avx2")))
+static int seq_first_non_zero_avx2(isl_int *p, unsigned len)
+{
+	int i, j;
+	const __m256i zero = _mm256_set1_epi64x(SMALL_ZERO_WORD);
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256i w = _mm256_loadu_si256((__m256i *) p[i]);
+		int mask;
+
+		mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpeq_epi64(w, zero)));
+		if (mask == 0xf)
+			continue;
+		for (j = 0; j < 4; ++j)
+			if (!(mask & (1 << j)) && !isl_int_is_zero(p[i + j]))
+				return i + j;
+	}
+	for (; i < len; ++i)
+		if (!isl_int_is_zero(p[i]))
+			return i;
+	return -1;
+}
+
+/* Set dst to m1 * src1 + m2 * src2, provided "m1", "m2", "src1" and "src2"
+ * are all narrow.  The elements of "dst" that are not aliased
+ * to "src1" or "src2" need to be in small representation such that
+ * they can be overwritten without freeing any memory.
+ * Results that do not fit in the small representation are
+ * stored through isl_int_set_int64.
+ * Return 1 if the combination was computed and 0 if the inputs
+ * do not satisfy the requirements.
+ */
+__attribute__((target("avx2")))
+static int seq_combine_avx2(isl_int *dst, isl_int m1, isl_int *src1,
+	isl_int m2, isl_int *src2, unsigned len)
+{
+	int i, j;
+	int64_t v1, v2;
+	__m256i f1, f2;
+	const __m256i one = _mm256_set1_epi64x(1);
+	const __m256i min = _mm256_set1_epi64x(-ISL_INT_SMALL_MAX);
+	const __m256i max = _mm256_set1_epi64x(ISL_INT_SMALL_MAX);
+
+	if (!is_narrow(m1) || !is_narrow(m2))
+		return 0;
+	if (!seq_is_narrow_avx2(src1, len, 0) ||
+	    !seq_is_narrow_avx2(src2, len, 0))
+		return 0;
+	if (dst != src1 && dst != src2 && !seq_is_narrow_avx2(dst, len, 1))
+		return 0;
+
+	v1 = isl_int_get_small(m1);
+	v2 = isl_int_get_small(m2);
+	f1 = _mm256_set1_epi64x(v1);
+	f2 = _mm256_set1_epi64x(v2);
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256i a = _mm256_loadu_si256((__m256i *) src1[i]);
+		__m256i b = _mm256_loadu_si256((__m256i *) src2[i]);
+		__m256i r, out;
+
+		a = _mm256_srli_epi64(a, ISL_INT_SMALL_SHIFT);
+		b = _mm256_srli_epi64(b, ISL_INT_SMALL_SHIFT);
+		r = _mm256_add_epi64(_mm256_mul_epi32(a, f1),
+				     _mm256_mul_epi32(b, f2));
+		out = _mm256_or_si256(_mm256_cmpgt_epi64(r, max),
+				      _mm256_cmpgt_epi64(min, r));
+		if (_mm256_testz_si256(out, out)) {
+			r = _mm256_slli_epi64(r, ISL_INT_SMALL_SHIFT);
+			r = _mm256_or_si256(r, one);
+			_mm256_storeu_si256((__m256i *) dst[i], r);
+		} else {
+			int64_t res[4];
+
+			_mm256_storeu_si256((__m256i *) res, r);
+			for (j = 0; j < 4; ++j)
+				isl_int_set_int64(dst[i + j], res[j]);
+		}
+	}
+	for (; i < len; ++i)
+		isl_int_set_int64(dst[i], v1 * isl_int_get_small(src1[i]) +
+					  v2 * isl_int_get_small(src2[i]));
+
+	return 1;
+}
+
+/* Set "prod" to the inner product of "p1" and "p2", provided
+ * all their elements are narrow.
+ * The products are accumulated in four int64_t lanes, keeping track
+ * of any overflow in "ov" in the same way as in add_overflow.
+ * Return 1 if the inner product was computed and 0 if the inputs
+ * are not narrow or if the computation overflowed.
+ */
+__attribute__((target("avx2")))
+static int seq_inner_product_avx2(isl_int *p1, isl_int *p2, unsigned len,
+	isl_int *prod)
+{
+	int i;
+	int64_t lane[4];
+	int64_t sum;
+	__m256i acc = _mm256_setzero_si256();
+	__m256i ov = _mm256_setzero_si256();
+
+	if (!seq_is_narrow_avx2(p1, len, 0) || !seq_is_narrow_avx2(p2, len, 0))
+		return 0;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256i a = _mm256_loadu_si256((__m256i *) p1[i]);
+		__m256i b = _mm256_loadu_si256((__m256i *) p2[i]);
+		__m256i t, r;
+
+		a = _mm256_srli_epi64(a, ISL_INT_SMALL_SHIFT);
+		b = _mm256_srli_epi64(b, ISL_INT_SMALL_SHIFT);
+		t = _mm256_mul_epi32(a, b);
+		r = _mm256_add_epi64(acc, t);
+		ov = _mm256_or_si256(ov,
+			_mm256_andnot_si256(_mm256_xor_si256(acc, t),
+					    _mm256_xor_si256(acc, r)));
+		acc = r;
+	}
+	if (_mm256_movemask_pd(_mm256_castsi256_pd(ov)))
+		return 0;
+	_mm256_storeu_si256((__m256i *) lane, acc);
+	sum = 0;
+	for (i = 0; i < 4; ++i)
+		if (add_overflow(sum, lane[i], &sum))
+			return 0;
+	for (i = len & ~3U; i < len; ++i) {
+		int64_t t = isl_int_get_small(p1[i]) * isl_int_get_small(p2[i]);
+		if (add_overflow(sum, t, &sum))
+			return 0;
+	}
+	isl_int_set_int64(*prod, sum);
+
+	return 1;
+}
+
+#endif
+
 void isl_seq_clr(isl_int *p, unsigned len)
 {
 	int i;
@@ -111,11 +357,21 @@ void isl_seq_combine(isl_int *dst, isl_int m1, isl_int *src1,
 	if (dst == src1 && isl_int_is_one(m1)) {
 		if (isl_int_is_zero(m2))
 			return;
+#ifdef ISL_SEQ_AVX2
+		if (use_avx2() &&
+		    seq_combine_avx2(dst, m1, src1, m2, src2, len))
+			return;
+#endif
 		for (i = 0; i < len; ++i)
 			isl_int_addmul(src1[i], m2, src2[i]);
 		return;
 	}
 
+#ifdef ISL_SEQ_AVX2
+	if (use_avx2() && seq_combine_avx2(dst, m1, src1, m2, src2, len))
+		return;
+#endif
+
 	isl_int_init(tmp);
 	for (i = 0; i < len; ++i) {
 		isl_int_mul(tmp, m1, src1[i]);
@@ -194,6 +450,10 @@ int isl_seq_first_non_zero(isl_int *p, unsigned len)
 {
 	int i;
 
+#ifdef ISL_SEQ_AVX2
+	if (use_avx2())
+		return seq_first_non_zero_avx2(p, len);
+#endif
 	for (i = 0; i < len; ++i)
 		if (!isl_int_is_zero(p[i]))
 			return i;
@@ -255,12 +515,17 @@ void isl_seq_gcd(isl_int *p, unsigned len, isl_int *gcd)
 
 void isl_seq_normalize(struct isl_ctx *ctx, isl_int *p, unsigned len)
 {
+	struct isl_ctx_local *local;
+
 	if (len == 0)
 		return;
-	isl_seq_gcd(p, len, &ctx->normalize_gcd);
-	if (!isl_int_is_zero(ctx->normalize_gcd) &&
-	    !isl_int_is_one(ctx->normalize_gcd))
-		isl_seq_scale_down(p, p, ctx->normalize_gcd, len);
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return;
+	isl_seq_gcd(p, len, &local->normalize_gcd);
+	if (!isl_int_is_zero(local->normalize_gcd) &&
+	    !isl_int_is_one(local->normalize_gcd))
+		isl_seq_scale_down(p, p, local->normalize_gcd, len);
 }
 
 void isl_seq_lcm(isl_int *p, unsigned len, isl_int *lcm)
@@ -284,6 +549,10 @@ void isl_seq_inner_product(isl_int *p1, isl_int *p2, unsigned len,
 		isl_int_set_si(*prod, 0);
 		return;
 	}
+#ifdef ISL_SEQ_AVX2
+	if (use_avx2() && seq_inner_product_avx2(p1, p2, len, prod))
+		return;
+#endif
 	isl_int_mul(*prod, p1[0], p2[0]);
 	for (i = 1; i < len; ++i)
 		isl_int_addmul(*prod, p1[i], p2[i]);
@@ -0,0 +1,149 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+/* Microbenchmark for the isl_seq primitives that dominate
+ * the constraint manipulations, run on rows that resemble
+ * typical constraints, i.e., short sequences with few small
+ * non-zero coefficients.
+ *
+ * Usage: isl_seq_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <isl_ctx_private.h>
+#include <isl_seq.h>
+
+#define N_ROW	64
+#define ROW_LEN	24
+
+struct bench_data {
+	isl_ctx *ctx;
+	isl_int rows[N_ROW][ROW_LEN];
+	isl_int dst[ROW_LEN];
+	isl_int m1, m2, prod;
+	int sink;
+};
+
+/* Fill up the rows with a deterministic pseudo-random pattern
+ * of small coefficients, with roughly one in three elements non-zero
+ * and a couple of leading zeros.
+ */
+static void init_rows(struct bench_data *data)
+{
+	int i, j;
+	unsigned seed = 1;
+
+	for (i = 0; i < N_ROW; ++i)
+		for (j = 0; j < ROW_LEN; ++j) {
+			int v = 0;
+
+			seed = seed * 1103515245 + 12345;
+			if (j >= 1 + i % 8 && (seed >> 16) % 3 == 0)
+				v = (int) ((seed >> 8) % 19) - 9;
+			isl_int_init(data->rows[i][j]);
+			isl_int_set_si(data->rows[i][j], v);
+		}
+	for (j = 0; j < ROW_LEN; ++j)
+		isl_int_init(data->dst[j]);
+	isl_int_init(data->m1);
+	isl_int_init(data->m2);
+	isl_int_init(data->prod);
+	isl_int_set_si(data->m1, 3);
+	isl_int_set_si(data->m2, -7);
+}
+
+static void clear_rows(struct bench_data *data)
+{
+	int i, j;
+
+	for (i = 0; i < N_ROW; ++i)
+		for (j = 0; j < ROW_LEN; ++j)
+			isl_int_clear(data->rows[i][j]);
+	for (j = 0; j < ROW_LEN; ++j)
+		isl_int_clear(data->dst[j]);
+	isl_int_clear(data->m1);
+	isl_int_clear(data->m2);
+	isl_int_clear(data->prod);
+}
+
+static void bench_combine(struct bench_data *data, int i)
+{
+	isl_seq_combine(data->dst, data->m1, data->rows[i % N_ROW],
+			data->m2, data->rows[(i + 1) % N_ROW], ROW_LEN);
+}
+
+/* Eliminate the coefficient at position 8 from a copy of a row.
+ */
+static void bench_elim(struct bench_data *data, int i)
+{
+	isl_int *src = data->rows[(i + 1) % N_ROW];
+
+	isl_seq_cpy(data->dst, data->rows[i % N_ROW], ROW_LEN);
+	if (!isl_int_is_zero(src[8]))
+		isl_seq_elim(data->dst, src, 8, ROW_LEN, NULL);
+}
+
+static void bench_gcd(struct bench_data *data, int i)
+{
+	isl_seq_gcd(data->rows[i % N_ROW], ROW_LEN, &data->prod);
+}
+
+static void bench_normalize(struct bench_data *data, int i)
+{
+	isl_seq_cpy(data->dst, data->rows[i % N_ROW], ROW_LEN);
+	isl_seq_normalize(data->ctx, data->dst, ROW_LEN);
+}
+
+static void bench_inner_product(struct bench_data *data, int i)
+{
+	isl_seq_inner_product(data->rows[i % N_ROW],
+			data->rows[(i + 1) % N_ROW], ROW_LEN, &data->prod);
+}
+
+static void bench_first_non_zero(struct bench_data *data, int i)
+{
+	data->sink += isl_seq_first_non_zero(data->rows[i % N_ROW], ROW_LEN);
+}
+
+struct {
+	const char *name;
+	void (*fn)(struct bench_data *data, int i);
+} benchmarks[] = {
+	{ "combine", &bench_combine },
+	{ "elim", &bench_elim },
+	{ "gcd", &bench_gcd },
+	{ "normalize", &bench_normalize },
+	{ "inner_product", &bench_inner_product },
+	{ "first_non_zero", &bench_first_non_zero },
+};
+
+int main(int argc, char **argv)
+{
+	int i, k;
+	long n = 2000000;
+	struct bench_data data;
+
+	if (argc > 1)
+		n = strtol(argv[1], NULL, 10);
+
+	data.ctx = isl_ctx_alloc();
+	data.sink = 0;
+	init_rows(&data);
+	for (k = 0; k < sizeof(benchmarks) / sizeof(benchmarks[0]); ++k) {
+		clock_t start = clock();
+		double s;
+
+		for (i = 0; i < n; ++i)
+			benchmarks[k].fn(&data, i);
+		s = (double) (clock() - start) / CLOCKS_PER_SEC;
+		printf("%-16s %8.2f ns/op\n", benchmarks[k].name,
+			n ? 1e9 * s / n : 0.);
+	}
+	clear_rows(&data);
+	isl_ctx_free(data.ctx);
+
+	return data.sink == -1;
+}
@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <isl_ctx_private.h>
 #include <isl_space_private.h>
 #include <isl_id_private.h>
 #include <isl_reordering.h>
@@ -320,13 +321,16 @@ error:
 
 __isl_give isl_space *isl_space_cow(__isl_take isl_space *dim)
 {
+	isl_space *dup;
+
 	if (!dim)
 		return NULL;
 
-	if (dim->ref == 1)
+	if (isl_atomic_get(&dim->ref) == 1)
 		return dim;
-	dim->ref--;
-	return isl_space_dup(dim);
+	dup = isl_space_dup(dim);
+	isl_space_free(dim);
+	return dup;
 }
 
 __isl_give isl_space *isl_space_copy(__isl_keep isl_space *dim)
@@ -334,7 +338,7 @@ __isl_give isl_space *isl_space_copy(__isl_keep isl_space *dim)
 	if (!dim)
 		return NULL;
 
-	dim->ref++;
+	isl_atomic_inc(&dim->ref);
 	return dim;
 }
 
@@ -345,7 +349,7 @@ __isl_null isl_space *isl_space_free(__isl_take isl_space *space)
 	if (!space)
 		return NULL;
 
-	if (--space->ref > 0)
+	if (isl_atomic_dec(&space->ref) > 0)
 		return NULL;
 
 	isl_id_free(space->tuple_id[0]);
@@ -2001,7 +2005,8 @@ static uint32_t isl_hash_params(uint32_t hash, __isl_keep isl_space *space)
 }
 
 /* Update "hash" by hashing in the tuples of "space".
- * Changes in this function should be reflected in isl_hash_tuples_domain.
+ * Changes in this function should be reflected in isl_hash_tuples_domain
+ * and isl_hash_tuples_range.
  */
 static uint32_t isl_hash_tuples(uint32_t hash, __isl_keep isl_space *space)
 {
@@ -2048,6 +2053,30 @@ static uint32_t isl_hash_tuples_domain(uint32_t hash,
 	return hash;
 }
 
+/* Update "hash" by hashing in the range tuple of "space".
+ * The result of this function is equal to the result of applying
+ * isl_hash_tuples to the range of "space".
+ */
+static uint32_t isl_hash_tuples_range(uint32_t hash,
+	__isl_keep isl_space *space)
+{
+	isl_id *id;
+
+	if (!space)
+		return hash;
+
+	isl_hash_byte(hash, 0);
+	isl_hash_byte(hash, space->n_out % 256);
+
+	hash = isl_hash_id(hash, &isl_id_none);
+	id = tuple_id(space, isl_dim_out);
+	hash = isl_hash_id(hash, id);
+
+	hash = isl_hash_tuples(hash, space->nested[1]);
+
+	return hash;
+}
+
 /* Return a hash value that digests the tuples of "space",
  * i.e., that ignores the parameters.
  */
@@ -2096,6 +2125,24 @@ uint32_t isl_space_get_domain_hash(__isl_keep isl_space *space)
 	return hash;
 }
 
+/* Return the hash value of the range of "space".
+ * That is, isl_space_get_range_hash(space) is equal to
+ * isl_space_get_hash(isl_space_range(space)).
+ */
+uint32_t isl_space_get_range_hash(__isl_keep isl_space *space)
+{
+	uint32_t hash;
+
+	if (!space)
+		return 0;
+
+	hash = isl_hash_init();
+	hash = isl_hash_params(hash, space);
+	hash = isl_hash_tuples_range(hash, space);
+
+	return hash;
+}
+
 isl_bool isl_space_is_wrapping(__isl_keep isl_space *dim)
 {
 	if (!dim)
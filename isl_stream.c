@@ -15,6 +15,13 @@
 #include <isl/aff.h>
 #include <isl_val_private.h>
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USE_MMAP
+#endif
+
 struct isl_keyword {
 	char			*name;
 	enum isl_token_type	type;
@@ -177,6 +184,9 @@ static __isl_give isl_stream* isl_stream_new(struct isl_ctx *ctx)
 	isl_ctx_ref(s->ctx);
 	s->file = NULL;
 	s->str = NULL;
+	s->str_end = NULL;
+	s->map = NULL;
+	s->map_size = 0;
 	s->len = 0;
 	s->line = 1;
 	s->col = 1;
@@ -198,12 +208,66 @@ error:
 	return NULL;
 }
 
+#ifdef USE_MMAP
+/* Map the entire input file of "s" into memory and read the remainder
+ * of the file, starting at its current position, from the mapping.
+ * This avoids the overhead of reading the file one character
+ * at a time through the C library.
+ * If the file cannot be mapped (e.g., because it is a pipe or a terminal),
+ * then the characters are read from the file instead.
+ */
+static void stream_map_file(__isl_keep isl_stream *s)
+{
+	struct stat st;
+	long pos;
+	void *map;
+	int fd;
+
+	fd = fileno(s->file);
+	if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+		return;
+	pos = ftell(s->file);
+	if (pos < 0 || st.st_size <= pos)
+		return;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return;
+	s->map = map;
+	s->map_size = st.st_size;
+	s->str = (char *) map + pos;
+	s->str_end = (char *) map + st.st_size;
+}
+
+/* Release the memory mapping of the input file of "s", if any,
+ * after moving the position of the file to just after
+ * the last character that was read from the mapping.
+ */
+static void stream_unmap_file(__isl_keep isl_stream *s)
+{
+	if (!s->map)
+		return;
+	fseek(s->file, s->str - (char *) s->map, SEEK_SET);
+	munmap(s->map, s->map_size);
+	s->map = NULL;
+}
+#else
+static void stream_map_file(__isl_keep isl_stream *s)
+{
+}
+
+static void stream_unmap_file(__isl_keep isl_stream *s)
+{
+}
+#endif
+
 __isl_give isl_stream* isl_stream_new_file(struct isl_ctx *ctx, FILE *file)
 {
 	isl_stream *s = isl_stream_new(ctx);
 	if (!s)
 		return NULL;
 	s->file = file;
+	if (file)
+		stream_map_file(s);
 	return s;
 }
 
@@ -229,7 +293,9 @@ static int stream_getc(__isl_keep isl_stream *s)
 		return -1;
 	if (s->n_un)
 		return s->c = s->un[--s->n_un];
-	if (s->file)
+	if (s->str_end)
+		c = s->str < s->str_end ? (unsigned char) *s->str++ : -1;
+	else if (s->file)
 		c = fgetc(s->file);
 	else {
 		c = *s->str++;
@@ -788,6 +854,7 @@ void isl_stream_free(__isl_take isl_stream *s)
 		isl_stream_error(s, tok, "unexpected token");
 		isl_token_free(tok);
 	}
+	stream_unmap_file(s);
 	if (s->keywords) {
 		isl_hash_table_foreach(s->ctx, s->keywords, &free_keyword, NULL);
 		isl_hash_table_free(s->ctx, s->keywords);
@@ -22,6 +22,14 @@ struct isl_token *isl_token_new(isl_ctx *ctx,
 	int line, int col, unsigned on_new_line);
 
 /* An input stream that may be either a file or a string.
+ *
+ * If "str" is set, then characters are read from "str" rather than
+ * from "file".  "str" is terminated by a NUL character, unless
+ * "str_end" is set, in which case it ends at "str_end".
+ * If "map" is set, then "str" points inside the memory mapping "map"
+ * (of size "map_size") of the entire input file "file".
+ * The position of "file" is updated to match the number of characters
+ * read from "str" when the stream is freed.
  *
  * line and col are the line and column number of the next character (1-based).
  * start_line and start_col are set by isl_stream_getc to point
@@ -42,6 +50,9 @@ struct isl_stream {
 	struct isl_ctx	*ctx;
 	FILE        	*file;
 	const char  	*str;
+	const char	*str_end;
+	void		*map;
+	size_t		map_size;
 	int	    	line;
 	int	    	col;
 	int		start_line;
@@ -14,12 +14,17 @@
  */
 
 #include <isl_ctx_private.h>
+#include <isl_arena_private.h>
 #include <isl_mat_private.h>
 #include <isl_vec_private.h>
 #include "isl_map_private.h"
 #include "isl_tab.h"
 #include <isl_seq.h>
 #include <isl_config.h>
+#include <isl_options_private.h>
+#include <isl_profile_private.h>
+#include <limits.h>
+#include <math.h>
 
 #include <bset_to_bmap.c>
 #include <bset_from_bmap.c>
@@ -37,22 +42,23 @@ struct isl_tab *isl_tab_alloc(struct isl_ctx *ctx,
 	struct isl_tab *tab;
 	unsigned off = 2 + M;
 
-	tab = isl_calloc_type(ctx, struct isl_tab);
+	tab = isl_arena_calloc_type(ctx, struct isl_tab);
 	if (!tab)
 		return NULL;
+	tab->ctx = ctx;
 	tab->mat = isl_mat_alloc(ctx, n_row, off + n_var);
 	if (!tab->mat)
 		goto error;
-	tab->var = isl_alloc_array(ctx, struct isl_tab_var, n_var);
+	tab->var = isl_arena_alloc_array(ctx, struct isl_tab_var, n_var);
 	if (n_var && !tab->var)
 		goto error;
-	tab->con = isl_alloc_array(ctx, struct isl_tab_var, n_row);
+	tab->con = isl_arena_alloc_array(ctx, struct isl_tab_var, n_row);
 	if (n_row && !tab->con)
 		goto error;
-	tab->col_var = isl_alloc_array(ctx, int, n_var);
+	tab->col_var = isl_arena_alloc_array(ctx, int, n_var);
 	if (n_var && !tab->col_var)
 		goto error;
-	tab->row_var = isl_alloc_array(ctx, int, n_row);
+	tab->row_var = isl_arena_alloc_array(ctx, int, n_row);
 	if (n_row && !tab->row_var)
 		goto error;
 	for (i = 0; i < n_var; ++i) {
@@ -114,7 +120,7 @@ int isl_tab_extend_cons(struct isl_tab *tab, unsigned n_new)
 	if (tab->max_con < tab->n_con + n_new) {
 		struct isl_tab_var *con;
 
-		con = isl_realloc_array(tab->mat->ctx, tab->con,
+		con = isl_arena_realloc_array(tab->mat->ctx, tab->con,
 				    struct isl_tab_var, tab->max_con + n_new);
 		if (!con)
 			return -1;
@@ -128,15 +134,16 @@ int isl_tab_extend_cons(struct isl_tab *tab, unsigned n_new)
 					tab->n_row + n_new, off + tab->n_col);
 		if (!tab->mat)
 			return -1;
-		row_var = isl_realloc_array(tab->mat->ctx, tab->row_var,
+		row_var = isl_arena_realloc_array(tab->mat->ctx, tab->row_var,
 					    int, tab->mat->n_row);
 		if (!row_var)
 			return -1;
 		tab->row_var = row_var;
 		if (tab->row_sign) {
 			enum isl_tab_row_sign *s;
-			s = isl_realloc_array(tab->mat->ctx, tab->row_sign,
-					enum isl_tab_row_sign, tab->mat->n_row);
+			s = isl_arena_realloc_array(tab->mat->ctx,
+					tab->row_sign, enum isl_tab_row_sign,
+					tab->mat->n_row);
 			if (!s)
 				return -1;
 			tab->row_sign = s;
@@ -154,7 +161,7 @@ int isl_tab_extend_vars(struct isl_tab *tab, unsigned n_new)
 	unsigned off = 2 + tab->M;
 
 	if (tab->max_var < tab->n_var + n_new) {
-		var = isl_realloc_array(tab->mat->ctx, tab->var,
+		var = isl_arena_realloc_array(tab->mat->ctx, tab->var,
 				    struct isl_tab_var, tab->n_var + n_new);
 		if (!var)
 			return -1;
@@ -169,7 +176,7 @@ int isl_tab_extend_vars(struct isl_tab *tab, unsigned n_new)
 				    tab->mat->n_row, off + tab->n_col + n_new);
 		if (!tab->mat)
 			return -1;
-		p = isl_realloc_array(tab->mat->ctx, tab->col_var,
+		p = isl_arena_realloc_array(tab->mat->ctx, tab->col_var,
 					    int, tab->n_col + n_new);
 		if (!p)
 			return -1;
@@ -179,15 +186,15 @@ int isl_tab_extend_vars(struct isl_tab *tab, unsigned n_new)
 	return 0;
 }
 
-static void free_undo_record(struct isl_tab_undo *undo)
+static void free_undo_record(struct isl_tab *tab, struct isl_tab_undo *undo)
 {
 	switch (undo->type) {
 	case isl_tab_undo_saved_basis:
-		free(undo->u.col_var);
+		isl_arena_free(tab->ctx, undo->u.col_var);
 		break;
 	default:;
 	}
-	free(undo);
+	isl_arena_free(tab->ctx, undo);
 }
 
 static void free_undo(struct isl_tab *tab)
@@ -196,7 +203,7 @@ static void free_undo(struct isl_tab *tab)
 
 	for (undo = tab->top; undo && undo != &tab->bottom; undo = next) {
 		next = undo->next;
-		free_undo_record(undo);
+		free_undo_record(tab, undo);
 	}
 	tab->top = undo;
 }
@@ -209,15 +216,16 @@ void isl_tab_free(struct isl_tab *tab)
 	isl_mat_free(tab->mat);
 	isl_vec_free(tab->dual);
 	isl_basic_map_free(tab->bmap);
-	free(tab->var);
-	free(tab->con);
-	free(tab->row_var);
-	free(tab->col_var);
-	free(tab->row_sign);
+	isl_arena_free(tab->ctx, tab->var);
+	isl_arena_free(tab->ctx, tab->con);
+	isl_arena_free(tab->ctx, tab->row_var);
+	isl_arena_free(tab->ctx, tab->col_var);
+	isl_arena_free(tab->ctx, tab->row_sign);
 	isl_mat_free(tab->samples);
-	free(tab->sample_index);
+	isl_arena_free(tab->ctx, tab->sample_index);
 	isl_mat_free(tab->basis);
-	free(tab);
+	isl_arena_free(tab->ctx, tab->small);
+	isl_arena_free(tab->ctx, tab);
 }
 
 struct isl_tab *isl_tab_dup(struct isl_tab *tab)
@@ -230,35 +238,40 @@ struct isl_tab *isl_tab_dup(struct isl_tab *tab)
 		return NULL;
 
 	off = 2 + tab->M;
-	dup = isl_calloc_type(tab->mat->ctx, struct isl_tab);
+	dup = isl_arena_calloc_type(tab->mat->ctx, struct isl_tab);
 	if (!dup)
 		return NULL;
+	dup->ctx = tab->mat->ctx;
 	dup->mat = isl_mat_dup(tab->mat);
 	if (!dup->mat)
 		goto error;
-	dup->var = isl_alloc_array(tab->mat->ctx, struct isl_tab_var, tab->max_var);
+	dup->var = isl_arena_alloc_array(tab->mat->ctx, struct isl_tab_var,
+					tab->max_var);
 	if (tab->max_var && !dup->var)
 		goto error;
 	for (i = 0; i < tab->n_var; ++i)
 		dup->var[i] = tab->var[i];
-	dup->con = isl_alloc_array(tab->mat->ctx, struct isl_tab_var, tab->max_con);
+	dup->con = isl_arena_alloc_array(tab->mat->ctx, struct isl_tab_var,
+					tab->max_con);
 	if (tab->max_con && !dup->con)
 		goto error;
 	for (i = 0; i < tab->n_con; ++i)
 		dup->con[i] = tab->con[i];
-	dup->col_var = isl_alloc_array(tab->mat->ctx, int, tab->mat->n_col - off);
+	dup->col_var = isl_arena_alloc_array(tab->mat->ctx, int,
+					tab->mat->n_col - off);
 	if ((tab->mat->n_col - off) && !dup->col_var)
 		goto error;
 	for (i = 0; i < tab->n_col; ++i)
 		dup->col_var[i] = tab->col_var[i];
-	dup->row_var = isl_alloc_array(tab->mat->ctx, int, tab->mat->n_row);
+	dup->row_var = isl_arena_alloc_array(tab->mat->ctx, int,
+					tab->mat->n_row);
 	if (tab->mat->n_row && !dup->row_var)
 		goto error;
 	for (i = 0; i < tab->n_row; ++i)
 		dup->row_var[i] = tab->row_var[i];
 	if (tab->row_sign) {
-		dup->row_sign = isl_alloc_array(tab->mat->ctx, enum isl_tab_row_sign,
-						tab->mat->n_row);
+		dup->row_sign = isl_arena_alloc_array(tab->mat->ctx,
+				enum isl_tab_row_sign, tab->mat->n_row);
 		if (tab->mat->n_row && !dup->row_sign)
 			goto error;
 		for (i = 0; i < tab->n_row; ++i)
@@ -268,7 +281,7 @@ struct isl_tab *isl_tab_dup(struct isl_tab *tab)
 		dup->samples = isl_mat_dup(tab->samples);
 		if (!dup->samples)
 			goto error;
-		dup->sample_index = isl_alloc_array(tab->mat->ctx, int,
+		dup->sample_index = isl_arena_alloc_array(tab->mat->ctx, int,
 							tab->samples->n_row);
 		if (tab->samples->n_row && !dup->sample_index)
 			goto error;
@@ -456,15 +469,16 @@ struct isl_tab *isl_tab_product(struct isl_tab *tab1, struct isl_tab *tab2)
 	r2 = tab2->n_redundant;
 	d1 = tab1->n_dead;
 	d2 = tab2->n_dead;
-	prod = isl_calloc_type(tab1->mat->ctx, struct isl_tab);
+	prod = isl_arena_calloc_type(tab1->mat->ctx, struct isl_tab);
 	if (!prod)
 		return NULL;
+	prod->ctx = tab1->mat->ctx;
 	prod->mat = tab_mat_product(tab1->mat, tab2->mat,
 				tab1->n_row, tab2->n_row,
 				tab1->n_col, tab2->n_col, off, r1, r2, d1, d2);
 	if (!prod->mat)
 		goto error;
-	prod->var = isl_alloc_array(tab1->mat->ctx, struct isl_tab_var,
+	prod->var = isl_arena_alloc_array(tab1->mat->ctx, struct isl_tab_var,
 					tab1->max_var + tab2->max_var);
 	if ((tab1->max_var + tab2->max_var) && !prod->var)
 		goto error;
@@ -478,7 +492,7 @@ struct isl_tab *isl_tab_product(struct isl_tab *tab1, struct isl_tab *tab2)
 				tab1->n_row, tab1->n_col,
 				r1, r2, d1, d2);
 	}
-	prod->con = isl_alloc_array(tab1->mat->ctx, struct isl_tab_var,
+	prod->con = isl_arena_alloc_array(tab1->mat->ctx, struct isl_tab_var,
 					tab1->max_con +  tab2->max_con);
 	if ((tab1->max_con + tab2->max_con) && !prod->con)
 		goto error;
@@ -492,7 +506,7 @@ struct isl_tab *isl_tab_product(struct isl_tab *tab1, struct isl_tab *tab2)
 				tab1->n_row, tab1->n_col,
 				r1, r2, d1, d2);
 	}
-	prod->col_var = isl_alloc_array(tab1->mat->ctx, int,
+	prod->col_var = isl_arena_alloc_array(tab1->mat->ctx, int,
 					tab1->n_col + tab2->n_col);
 	if ((tab1->n_col + tab2->n_col) && !prod->col_var)
 		goto error;
@@ -509,7 +523,7 @@ struct isl_tab *isl_tab_product(struct isl_tab *tab1, struct isl_tab *tab2)
 			t -= tab1->n_con;
 		prod->col_var[pos] = t;
 	}
-	prod->row_var = isl_alloc_array(tab1->mat->ctx, int,
+	prod->row_var = isl_arena_alloc_array(tab1->mat->ctx, int,
 					tab1->mat->n_row + tab2->mat->n_row);
 	if ((tab1->mat->n_row + tab2->mat->n_row) && !prod->row_var)
 		goto error;
@@ -806,7 +820,7 @@ static isl_stat push_union(struct isl_tab *tab,
 	if (!tab->need_undo)
 		return isl_stat_ok;
 
-	undo = isl_alloc_type(tab->mat->ctx, struct isl_tab_undo);
+	undo = isl_arena_alloc_type(tab->mat->ctx, struct isl_tab_undo);
 	if (!undo)
 		goto error;
 	undo->type = type;
@@ -846,7 +860,7 @@ isl_stat isl_tab_push_basis(struct isl_tab *tab)
 	int i;
 	union isl_tab_undo_val u;
 
-	u.col_var = isl_alloc_array(tab->mat->ctx, int, tab->n_col);
+	u.col_var = isl_arena_alloc_array(tab->mat->ctx, int, tab->n_col);
 	if (tab->n_col && !u.col_var)
 		return isl_stat_error;
 	for (i = 0; i < tab->n_col; ++i)
@@ -872,7 +886,7 @@ struct isl_tab *isl_tab_init_samples(struct isl_tab *tab)
 	tab->samples = isl_mat_alloc(tab->mat->ctx, 1, 1 + tab->n_var);
 	if (!tab->samples)
 		goto error;
-	tab->sample_index = isl_alloc_array(tab->mat->ctx, int, 1);
+	tab->sample_index = isl_arena_alloc_array(tab->mat->ctx, int, 1);
 	if (!tab->sample_index)
 		goto error;
 	return tab;
@@ -887,7 +901,7 @@ int isl_tab_add_sample(struct isl_tab *tab, __isl_take isl_vec *sample)
 		goto error;
 
 	if (tab->n_sample + 1 > tab->samples->n_row) {
-		int *t = isl_realloc_array(tab->mat->ctx,
+		int *t = isl_arena_realloc_array(tab->mat->ctx,
 			    tab->sample_index, int, tab->n_sample + 1);
 		if (!t)
 			goto error;
@@ -1072,6 +1086,135 @@ static void update_row_sign(struct isl_tab *tab, int row, int col, int row_sgn)
 	}
 }
 
+/* Make sure "tab->small" can hold two rows of the tableau.
+ * The rows are stored contiguously, the first starting at tab->small and
+ * the second at tab->small + tab->mat->n_col.
+ */
+static long *tab_small_buffer(struct isl_tab *tab)
+{
+	unsigned size = 2 * tab->mat->n_col;
+
+	if (tab->small_size >= size)
+		return tab->small;
+	isl_arena_free(tab->ctx, tab->small);
+	tab->small_size = 0;
+	tab->small = isl_arena_alloc_array(isl_tab_get_ctx(tab), long, size);
+	if (tab->small)
+		tab->small_size = size;
+	return tab->small;
+}
+
+/* Copy the "len" elements of "p" to "dst", provided they all
+ * fit in a long (excluding LONG_MIN), storing the maximal absolute value
+ * of the elements in "max".
+ * Return 1 if all elements were copied and 0 otherwise.
+ */
+static int seq_to_small(isl_int *p, unsigned len, long *dst,
+	unsigned long *max)
+{
+	int i;
+	unsigned long m = 0;
+
+	for (i = 0; i < len; ++i) {
+		long v;
+
+		if (!isl_int_fits_slong(p[i]))
+			return 0;
+		v = isl_int_get_si(p[i]);
+		if (v == LONG_MIN)
+			return 0;
+		dst[i] = v;
+		if (v < 0)
+			v = -v;
+		if (v > m)
+			m = v;
+	}
+
+	*max = m;
+	return 1;
+}
+
+/* Return the greatest common divisor of the absolute values
+ * of the "len" elements of "p".
+ */
+static unsigned long small_gcd(long *p, unsigned len)
+{
+	int i;
+	unsigned long g = 0;
+
+	for (i = 0; i < len && g != 1; ++i) {
+		unsigned long a = p[i] < 0 ? -(unsigned long) p[i] : p[i];
+
+		while (a) {
+			unsigned long t = g % a;
+			g = a;
+			a = t;
+		}
+	}
+
+	return g;
+}
+
+/* Perform the update of row "i" of "tab" in isl_tab_pivot
+ * on native integers, where "pivot" contains a copy of the (normalized)
+ * pivot row, "pivot_max" is the maximal absolute value of its elements
+ * beyond the denominator and "c" is the position of the pivot column.
+ * The updated row is first computed in "buf", which follows "pivot"
+ * in the scratch buffer.
+ *
+ * The elements of the updated row are of the form
+ *
+ *	n_ji d_r + n_jc n_ri
+ *
+ * so that they are all bounded in absolute value by
+ * max_j |n_ji| d_r + |n_jc| pivot_max.
+ * If this bound fits in a long, then the entire update can be performed
+ * without any further overflow checks.
+ * Otherwise, or if some element of row "i" does not fit in a long,
+ * return 0, leaving row "i" untouched, such that the caller can
+ * fall back to isl_int arithmetic.
+ * Return 1 if the update was performed.
+ */
+static int pivot_row_small(struct isl_tab *tab, int i, long *pivot,
+	unsigned long pivot_max, unsigned c)
+{
+	int j;
+	unsigned len = 2 + tab->M + tab->n_col;
+	long *buf = pivot + tab->mat->n_col;
+	isl_int *row = tab->mat->row[i];
+	unsigned long max, n_c, bound;
+	long d_r = pivot[0];
+	long n_jc;
+	unsigned long g;
+
+	if (!seq_to_small(row, len, buf, &max))
+		return 0;
+	n_jc = buf[c];
+	n_c = n_jc < 0 ? -(unsigned long) n_jc : n_jc;
+	if (max > LONG_MAX / d_r)
+		return 0;
+	bound = max * d_r;
+	if (pivot_max > (LONG_MAX - bound) / n_c)
+		return 0;
+
+	buf[0] *= d_r;
+	for (j = 1; j < len; ++j)
+		buf[j] = buf[j] * d_r + n_jc * pivot[j];
+	buf[c] = n_jc * pivot[c];
+
+	if (buf[0] != 1) {
+		g = small_gcd(buf, len);
+		if (g > 1)
+			for (j = 0; j < len; ++j)
+				buf[j] /= (long) g;
+	}
+
+	for (j = 0; j < len; ++j)
+		isl_int_set_si(row[j], buf[j]);
+
+	return 1;
+}
+
 /* Given a row number "row" and a column number "col", pivot the tableau
  * such that the associated variables are interchanged.
  * The given row in the tableau expresses
@@ -1121,8 +1264,18 @@ static void update_row_sign(struct isl_tab *tab, int row, int col, int row_sgn)
  * s(n_rc)d_r/|n_rc|		-s(n_rc)n_ri/|n_rc|
  * s(n_rc)d_r n_jc/(|n_rc| d_j)	(n_ji |n_rc| - s(n_rc)n_jc n_ri)/(|n_rc| d_j)
  *
+ * If all elements of the pivot row fit in a long, then a copy
+ * of the pivot row is kept in the contiguous scratch buffer tab->small and
+ * the other rows are updated on native integers as long as the result
+ * is guaranteed not to overflow (see pivot_row_small).
+ * Rows that cannot be handled in this way are updated using
+ * isl_int arithmetic.
+ *
+ * This function only performs the pivot itself.
+ * isl_tab_pivot additionally looks for rows that have become
+ * obviously redundant.
  */
-int isl_tab_pivot(struct isl_tab *tab, int row, int col)
+static int pivot(struct isl_tab *tab, int row, int col)
 {
 	int i, j;
 	int sgn;
@@ -1131,6 +1284,8 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 	struct isl_mat *mat = tab->mat;
 	struct isl_tab_var *var;
 	unsigned off = 2 + tab->M;
+	long *small;
+	unsigned long small_max;
 
 	ctx = isl_tab_get_ctx(tab);
 	if (isl_ctx_next_operation(ctx) < 0)
@@ -1149,11 +1304,18 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 		}
 	if (!isl_int_is_one(mat->row[row][0]))
 		isl_seq_normalize(mat->ctx, mat->row[row], off + tab->n_col);
+	small = tab_small_buffer(tab);
+	if (small && !seq_to_small(mat->row[row], off + tab->n_col,
+				small, &small_max))
+		small = NULL;
 	for (i = 0; i < tab->n_row; ++i) {
 		if (i == row)
 			continue;
 		if (isl_int_is_zero(mat->row[i][off + col]))
 			continue;
+		if (small &&
+		    pivot_row_small(tab, i, small, small_max, off + col))
+			continue;
 		isl_int_mul(mat->row[i][0], mat->row[i][0], mat->row[row][0]);
 		for (j = 0; j < off - 1 + tab->n_col; ++j) {
 			if (j == off - 1 + col)
@@ -1178,6 +1340,21 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 	var->is_row = 0;
 	var->index = col;
 	update_row_sign(tab, row, col, sgn);
+	return 0;
+}
+
+/* Pivot the tableau at row "row" and column "col" (see pivot) and
+ * mark any row that may have become obviously redundant as such.
+ */
+int isl_tab_pivot(struct isl_tab *tab, int row, int col)
+{
+	int i;
+	struct isl_mat *mat = tab->mat;
+	unsigned off = 2 + tab->M;
+
+	if (pivot(tab, row, col) < 0)
+		return -1;
+	isl_profile_count(tab->mat->ctx, isl_profile_pivots);
 	if (tab->in_undo)
 		return 0;
 	for (i = tab->n_redundant; i < tab->n_row; ++i) {
@@ -3224,6 +3401,277 @@ int isl_tab_is_equality(struct isl_tab *tab, int con)
 					tab->n_col - tab->n_dead) == -1;
 }
 
+/* A floating point copy of the tableau "tab", used by float_presolve.
+ * "val" holds the n_row rows, each consisting of 1 + n_col entries.
+ * The first entry of a row is the constant term and the remaining
+ * entries are the coefficients of the column variables,
+ * all divided by the common denominator of the row.
+ * "row_var" and "col_var" have the same meaning as in isl_tab.
+ */
+struct isl_tab_float {
+	unsigned n_row;
+	unsigned n_col;
+	double *val;
+	int *row_var;
+	int *col_var;
+};
+
+/* Tolerance used for deciding whether a floating point value
+ * should be considered to be zero.
+ */
+#define ISL_TAB_FLOAT_EPS	1e-9
+
+static void tab_float_free(struct isl_tab_float *ft)
+{
+	free(ft->val);
+	free(ft->row_var);
+	free(ft->col_var);
+}
+
+/* Initialize "ft" to a floating point copy of "tab".
+ */
+static isl_stat tab_float_init(struct isl_tab *tab, struct isl_tab_float *ft)
+{
+	int i, j;
+	unsigned off = 2 + tab->M;
+	isl_ctx *ctx = isl_tab_get_ctx(tab);
+
+	ft->n_row = tab->n_row;
+	ft->n_col = tab->n_col;
+	ft->val = isl_alloc_array(ctx, double, tab->n_row * (1 + tab->n_col));
+	ft->row_var = isl_alloc_array(ctx, int, tab->n_row);
+	ft->col_var = isl_alloc_array(ctx, int, tab->n_col);
+	if (!ft->val || !ft->row_var || !ft->col_var)
+		return isl_stat_error;
+
+	for (i = 0; i < tab->n_row; ++i) {
+		isl_int *row = tab->mat->row[i];
+		double *v = ft->val + i * (1 + tab->n_col);
+		double d = isl_int_get_d(row[0]);
+
+		v[0] = isl_int_get_d(row[1]) / d;
+		for (j = 0; j < tab->n_col; ++j)
+			v[1 + j] = isl_int_get_d(row[off + j]) / d;
+		ft->row_var[i] = tab->row_var[i];
+	}
+	for (j = 0; j < tab->n_col; ++j)
+		ft->col_var[j] = tab->col_var[j];
+
+	return isl_stat_ok;
+}
+
+/* Pivot the floating point tableau "ft" at row "row" and column "col".
+ * The row
+ *
+ *	x_r = b_r + a_rc x_c + \sum_{j \ne c} a_rj x_j
+ *
+ * is rewritten to
+ *
+ *	x_c = -b_r/a_rc + 1/a_rc x_r - \sum_{j \ne c} a_rj/a_rc x_j
+ *
+ * and this expression is substituted in the other rows.
+ */
+static void tab_float_pivot(struct isl_tab_float *ft, int row, int col)
+{
+	int i, j, t;
+	unsigned n = 1 + ft->n_col;
+	double *p = ft->val + row * n;
+	double inv = 1 / p[1 + col];
+
+	for (j = 0; j < n; ++j)
+		p[j] *= -inv;
+	p[1 + col] = inv;
+
+	for (i = 0; i < ft->n_row; ++i) {
+		double *r = ft->val + i * n;
+		double f = r[1 + col];
+
+		if (i == row || f == 0)
+			continue;
+		for (j = 0; j < n; ++j)
+			r[j] += f * p[j];
+		r[1 + col] = f * inv;
+	}
+
+	t = ft->row_var[row];
+	ft->row_var[row] = ft->col_var[col];
+	ft->col_var[col] = t;
+}
+
+/* Minimize the row variable in row "obj" of the floating point tableau "ft"
+ * using the same constraints as those used by the exact simplex method
+ * on "tab", i.e., rows beyond the redundant rows with non-negative
+ * row variables bound the pivots and dead columns are ignored.
+ * Variables that are not non-negative may move in either direction.
+ * The column with the largest objective coefficient (in absolute value)
+ * that allows the objective to decrease is selected in each iteration.
+ *
+ * Return 1 if an optimal basis was found and 0 if the problem
+ * appears to be unbounded or if no optimum was found within
+ * a reasonable number of iterations.
+ */
+static int tab_float_minimize(struct isl_tab *tab, struct isl_tab_float *ft,
+	int obj)
+{
+	int i, j, it;
+	unsigned n = 1 + ft->n_col;
+	int max_it = 4 * (ft->n_row + ft->n_col) + 16;
+
+	for (it = 0; it < max_it; ++it) {
+		double *o = ft->val + obj * n;
+		int col = -1, row = -1;
+		double best = 0, ratio = 0;
+		int dir;
+
+		for (j = tab->n_dead; j < ft->n_col; ++j) {
+			double a = o[1 + j];
+
+			if (fabs(a) <= ISL_TAB_FLOAT_EPS)
+				continue;
+			if (a > 0 && var_from_index(tab, ft->col_var[j])->is_nonneg)
+				continue;
+			if (fabs(a) > best) {
+				best = fabs(a);
+				col = j;
+			}
+		}
+		if (col < 0)
+			return 1;
+		dir = o[1 + col] < 0 ? 1 : -1;
+
+		best = 0;
+		for (i = tab->n_redundant; i < ft->n_row; ++i) {
+			double *r = ft->val + i * n;
+			double a = dir * r[1 + col];
+			double b = r[0] > 0 ? r[0] : 0;
+
+			if (i == obj || a >= -ISL_TAB_FLOAT_EPS)
+				continue;
+			if (!var_from_index(tab, ft->row_var[i])->is_nonneg)
+				continue;
+			if (row < 0 || b / -a < ratio ||
+			    (b / -a == ratio && -a > best)) {
+				row = i;
+				ratio = b / -a;
+				best = -a;
+			}
+		}
+		if (row < 0)
+			return 0;
+		tab_float_pivot(ft, row, col);
+	}
+
+	return 0;
+}
+
+/* Return the position of variable "v" (as encoded in row_var or col_var)
+ * in an array containing first all variables and then all constraints.
+ */
+static int var_pos(struct isl_tab *tab, int v)
+{
+	return v >= 0 ? v : tab->n_var + ~v;
+}
+
+/* Pivot the exact tableau "tab" such that the variables that
+ * appear in the rows of "ft" also appear in the rows of "tab".
+ * The pivots do not maintain the feasibility of the sample value
+ * in the intermediate tableaus, so no redundancy detection
+ * is performed.  If the final tableau turns out not to be feasible,
+ * then all pivots are undone, by performing them again in reverse order.
+ *
+ * Return 1 if the tableau was moved to the basis of "ft",
+ * 0 if it was left untouched and -1 on error.
+ */
+static int tab_move_to_float_basis(struct isl_tab *tab,
+	struct isl_tab_float *ft, int obj)
+{
+	int i, j, n = 0;
+	isl_ctx *ctx = isl_tab_get_ctx(tab);
+	unsigned off = 2 + tab->M;
+	char *basic;
+	int *piv_row = NULL, *piv_col = NULL;
+	int ok = 1;
+
+	basic = isl_calloc_array(ctx, char, tab->n_var + tab->n_con);
+	piv_row = isl_alloc_array(ctx, int, tab->n_col);
+	piv_col = isl_alloc_array(ctx, int, tab->n_col);
+	if (!basic || (tab->n_col && (!piv_row || !piv_col)))
+		goto error;
+	for (i = 0; i < ft->n_row; ++i)
+		basic[var_pos(tab, ft->row_var[i])] = 1;
+
+	for (j = tab->n_dead; ok && j < tab->n_col; ++j) {
+		int row = -1;
+
+		if (!basic[var_pos(tab, tab->col_var[j])])
+			continue;
+		for (i = tab->n_redundant; i < tab->n_row; ++i) {
+			if (i == obj || basic[var_pos(tab, tab->row_var[i])])
+				continue;
+			if (isl_int_is_zero(tab->mat->row[i][off + j]))
+				continue;
+			row = i;
+			break;
+		}
+		if (row < 0) {
+			ok = 0;
+			break;
+		}
+		if (pivot(tab, row, j) < 0)
+			goto error;
+		piv_row[n] = row;
+		piv_col[n] = j;
+		++n;
+	}
+
+	for (i = tab->n_redundant; ok && i < tab->n_row; ++i)
+		if (isl_tab_var_from_row(tab, i)->is_nonneg &&
+		    isl_int_is_neg(tab->mat->row[i][1]))
+			ok = 0;
+	if (!ok)
+		while (n-- > 0)
+			if (pivot(tab, piv_row[n], piv_col[n]) < 0)
+				goto error;
+
+	free(basic);
+	free(piv_row);
+	free(piv_col);
+	return ok;
+error:
+	free(basic);
+	free(piv_row);
+	free(piv_col);
+	return -1;
+}
+
+/* Try and move the tableau "tab" to a basis where the row variable "var"
+ * attains its minimal value, using a floating point simplex
+ * to determine the candidate basis.
+ * The result only serves as a starting point for the exact simplex
+ * in isl_tab_min, which verifies that the basis is optimal and
+ * performs any remaining pivots, so the final result is not affected
+ * by any inaccuracies in the floating point computations.
+ * This is only tried on tableaus without big parameter.
+ *
+ * Return -1 on error and 0 otherwise.
+ */
+static int float_presolve(struct isl_tab *tab, struct isl_tab_var *var)
+{
+	struct isl_tab_float ft = { 0 };
+	int r = 0;
+
+	if (tab->M || tab->n_col - tab->n_dead < 2)
+		return 0;
+
+	if (tab_float_init(tab, &ft) < 0)
+		r = -1;
+	else if (tab_float_minimize(tab, &ft, var->index) == 1)
+		r = tab_move_to_float_basis(tab, &ft, var->index);
+	tab_float_free(&ft);
+
+	return r < 0 ? -1 : 0;
+}
+
 /* Return the minimal value of the affine expression "f" with denominator
  * "denom" in *opt, *opt_denom, assuming the tableau is not empty and
  * the expression cannot attain arbitrarily small values.
@@ -3233,6 +3681,11 @@ int isl_tab_is_equality(struct isl_tab *tab, int con)
  *
  * This function assumes that at least one more row and at least
  * one more element in the constraint array are available in the tableau.
+ *
+ * If the lp_float_presolve option is set, then the tableau is first
+ * moved to a basis that is optimal according to a floating point
+ * simplex (see float_presolve).  The exact simplex then only needs
+ * to perform the remaining pivots, if any.
  */
 enum isl_lp_result isl_tab_min(struct isl_tab *tab,
 	isl_int *f, isl_int denom, isl_int *opt, isl_int *opt_denom,
@@ -3254,6 +3707,9 @@ enum isl_lp_result isl_tab_min(struct isl_tab *tab,
 	if (r < 0)
 		return isl_lp_error;
 	var = &tab->con[r];
+	if (tab->mat->ctx->opt->lp_float_presolve &&
+	    float_presolve(tab, var) < 0)
+		return isl_lp_error;
 	for (;;) {
 		int row, col;
 		find_pivot(tab, var, var, -1, &row, &col);
@@ -3913,7 +4369,7 @@ int isl_tab_rollback(struct isl_tab *tab, struct isl_tab_undo *snap)
 			tab->in_undo = 0;
 			return -1;
 		}
-		free_undo_record(undo);
+		free_undo_record(tab, undo);
 	}
 	tab->in_undo = 0;
 	tab->top = undo;
@@ -124,6 +124,14 @@ struct isl_tab_undo {
  *
  * If "preserve" is set, then we want to keep all constraints in the
  * tableau, even if they turn out to be redundant.
+ *
+ * "small" is a scratch buffer of "small_size" native integers
+ * that is used by isl_tab_pivot to update rows with small coefficients
+ * without going through isl_int arithmetic.
+ *
+ * "ctx" is the isl_ctx on which the tableau was allocated.
+ * It is needed to release the memory of the tableau, even if
+ * "mat" has been lost due to an error.
  */
 enum isl_tab_row_sign {
 	isl_tab_row_unknown = 0,
@@ -132,6 +140,7 @@ enum isl_tab_row_sign {
 	isl_tab_row_any,
 };
 struct isl_tab {
+	isl_ctx *ctx;
 	struct isl_mat *mat;
 
 	unsigned n_row;
@@ -167,6 +176,9 @@ struct isl_tab {
 	int n_unbounded;
 	struct isl_mat *basis;
 
+	long *small;
+	unsigned small_size;
+
 	int (*conflict)(int con, void *user);
 	void *conflict_user;
 
@@ -286,6 +298,9 @@ __isl_give isl_tab_lexmin *isl_tab_lexmin_add_eq(__isl_take isl_tab_lexmin *tl,
 __isl_give isl_tab_lexmin *isl_tab_lexmin_cut_to_integer(
 	__isl_take isl_tab_lexmin *tl);
 __isl_give isl_vec *isl_tab_lexmin_get_solution(__isl_keep isl_tab_lexmin *tl);
+__isl_give isl_vec *isl_tab_lexmin_non_trivial(__isl_keep isl_tab_lexmin *tl,
+	int n_op, int n_region, struct isl_trivial_region *region,
+	int (*conflict)(int con, void *user), void *user);
 __isl_null isl_tab_lexmin *isl_tab_lexmin_free(__isl_take isl_tab_lexmin *tl);
 
 /* private */
@@ -12,6 +12,7 @@
  */
 
 #include <isl_ctx_private.h>
+#include <isl_arena_private.h>
 #include "isl_map_private.h"
 #include <isl_seq.h>
 #include "isl_tab.h"
@@ -917,18 +918,21 @@ static struct isl_vec *get_row_parameter_ineq(struct isl_tab *tab, int row)
  */
 static void normalize_div(__isl_keep isl_vec *div)
 {
-	isl_ctx *ctx = isl_vec_get_ctx(div);
+	struct isl_ctx_local *local = isl_ctx_local(isl_vec_get_ctx(div));
 	int len = div->size - 2;
 
-	isl_seq_gcd(div->el + 2, len, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd, ctx->normalize_gcd, div->el[0]);
+	if (!local)
+		return;
+	isl_seq_gcd(div->el + 2, len, &local->normalize_gcd);
+	isl_int_gcd(local->normalize_gcd, local->normalize_gcd, div->el[0]);
 
-	if (isl_int_is_one(ctx->normalize_gcd))
+	if (isl_int_is_one(local->normalize_gcd))
 		return;
 
-	isl_int_divexact(div->el[0], div->el[0], ctx->normalize_gcd);
-	isl_int_fdiv_q(div->el[1], div->el[1], ctx->normalize_gcd);
-	isl_seq_scale_down(div->el + 2, div->el + 2, ctx->normalize_gcd, len);
+	isl_int_divexact(div->el[0], div->el[0], local->normalize_gcd);
+	isl_int_fdiv_q(div->el[1], div->el[1], local->normalize_gcd);
+	isl_seq_scale_down(div->el + 2, div->el + 2,
+			    local->normalize_gcd, len);
 }
 
 /* Return an integer division for use in a parametric cut based
@@ -2293,7 +2297,7 @@ static __isl_give struct isl_tab *tab_for_lexmin(__isl_keep isl_basic_map *bmap,
 	if (dom) {
 		tab->n_param = isl_basic_set_total_dim(dom) - dom->n_div;
 		tab->n_div = dom->n_div;
-		tab->row_sign = isl_calloc_array(bmap->ctx,
+		tab->row_sign = isl_arena_calloc_array(bmap->ctx,
 					enum isl_tab_row_sign, tab->mat->n_row);
 		if (tab->mat->n_row && !tab->row_sign)
 			goto error;
@@ -5195,15 +5199,14 @@ struct isl_local_region {
  * the ILP problem "bset".
  */
 static isl_stat init_lexmin_data(struct isl_lexmin_data *data,
-	__isl_keep isl_basic_set *bset)
+	struct isl_tab *tab)
 {
 	isl_ctx *ctx;
 
-	ctx = isl_basic_set_get_ctx(bset);
-
-	data->tab = tab_for_lexmin(bset, NULL, 0, 0);
+	data->tab = tab;
 	if (!data->tab)
 		return isl_stat_error;
+	ctx = isl_tab_get_ctx(tab);
 
 	data->v = isl_vec_alloc(ctx, 1 + data->tab->n_var);
 	if (!data->v)
@@ -5400,13 +5403,58 @@ static isl_stat pick_side(struct isl_local_region *local,
 	return isl_stat_ok;
 }
 
-/* Free the memory associated to "data".
+/* Free the memory associated to "data", except for the tableau,
+ * which is returned.
  */
-static void clear_lexmin_data(struct isl_lexmin_data *data)
+static struct isl_tab *clear_lexmin_data(struct isl_lexmin_data *data)
 {
 	free(data->local);
 	isl_vec_free(data->v);
-	isl_tab_free(data->tab);
+	return data->tab;
+}
+
+/* Perform the backtracking search of isl_tab_basic_set_non_trivial_lexmin
+ * on data->tab and return the best solution found.
+ * data->tab may get replaced in the process and is set to NULL
+ * in case of error.
+ */
+static __isl_give isl_vec *non_trivial_lexmin(struct isl_lexmin_data *data)
+{
+	int level, init;
+
+	level = 0;
+	init = 1;
+
+	while (level >= 0) {
+		enum isl_next next;
+		struct isl_local_region *local = &data->local[level];
+
+		next = enter_level(level, init, data);
+		if (next < 0)
+			goto error;
+		if (next == isl_next_done)
+			break;
+		if (next == isl_next_backtrack) {
+			level--;
+			init = 0;
+			continue;
+		}
+
+		if (better_next_side(local, data) < 0)
+			goto error;
+		if (pick_side(local, data) < 0)
+			goto error;
+
+		local->side++;
+		level++;
+		init = 1;
+	}
+
+	return data->sol;
+error:
+	isl_vec_free(data->sol);
+	data->sol = NULL;
+	return NULL;
 }
 
 /* Return the lexicographically smallest non-trivial solution of the
@@ -5451,50 +5499,24 @@ __isl_give isl_vec *isl_tab_basic_set_non_trivial_lexmin(
 	int (*conflict)(int con, void *user), void *user)
 {
 	struct isl_lexmin_data data = { n_op, n_region, region };
-	int level, init;
+	isl_vec *sol;
 
 	if (!bset)
 		return NULL;
 
-	if (init_lexmin_data(&data, bset) < 0)
+	if (init_lexmin_data(&data, tab_for_lexmin(bset, NULL, 0, 0)) < 0)
 		goto error;
 	data.tab->conflict = conflict;
 	data.tab->conflict_user = user;
 
-	level = 0;
-	init = 1;
-
-	while (level >= 0) {
-		enum isl_next next;
-		struct isl_local_region *local = &data.local[level];
-
-		next = enter_level(level, init, &data);
-		if (next < 0)
-			goto error;
-		if (next == isl_next_done)
-			break;
-		if (next == isl_next_backtrack) {
-			level--;
-			init = 0;
-			continue;
-		}
-
-		if (better_next_side(local, &data) < 0)
-			goto error;
-		if (pick_side(local, &data) < 0)
-			goto error;
+	sol = non_trivial_lexmin(&data);
 
-		local->side++;
-		level++;
-		init = 1;
-	}
-
-	clear_lexmin_data(&data);
+	isl_tab_free(clear_lexmin_data(&data));
 	isl_basic_set_free(bset);
 
-	return data.sol;
+	return sol;
 error:
-	clear_lexmin_data(&data);
+	isl_tab_free(clear_lexmin_data(&data));
 	isl_basic_set_free(bset);
 	isl_vec_free(data.sol);
 	return NULL;
@@ -5553,11 +5575,69 @@ error:
 	return NULL;
 }
 
+/* Return the lexicographically smallest non-trivial solution
+ * of the ILP problem represented by "tl", in the same way
+ * as isl_tab_basic_set_non_trivial_lexmin, but without
+ * destroying the tableau of "tl".
+ * This allows the same problem to be solved repeatedly
+ * with different non-triviality regions, without having to
+ * reconstruct the tableau each time.
+ *
+ * All constraints added during the search are removed again
+ * by rolling back to a snapshot taken at the start.
+ * The basis is saved as well such that the tableau also returns
+ * to the original (lexicographically minimal) sample value.
+ * In case of error, the tableau of "tl" may have been freed,
+ * in which case any further operations on "tl" will fail.
+ */
+__isl_give isl_vec *isl_tab_lexmin_non_trivial(__isl_keep isl_tab_lexmin *tl,
+	int n_op, int n_region, struct isl_trivial_region *region,
+	int (*conflict)(int con, void *user), void *user)
+{
+	struct isl_lexmin_data data = { n_op, n_region, region };
+	struct isl_tab_undo *snap;
+	isl_vec *sol;
+
+	if (!tl || !tl->tab)
+		return NULL;
+
+	snap = isl_tab_snap(tl->tab);
+	if (isl_tab_push_basis(tl->tab) < 0)
+		return NULL;
+	if (init_lexmin_data(&data, tl->tab) < 0)
+		goto error;
+	data.tab->conflict = conflict;
+	data.tab->conflict_user = user;
+
+	sol = non_trivial_lexmin(&data);
+
+	tl->tab = clear_lexmin_data(&data);
+	if (!tl->tab)
+		return isl_vec_free(sol);
+	tl->tab->conflict = NULL;
+	tl->tab->conflict_user = NULL;
+	if (isl_tab_rollback(tl->tab, snap) < 0) {
+		isl_tab_free(tl->tab);
+		tl->tab = NULL;
+		return isl_vec_free(sol);
+	}
+
+	return sol;
+error:
+	tl->tab = clear_lexmin_data(&data);
+	isl_vec_free(data.sol);
+	if (tl->tab && isl_tab_rollback(tl->tab, snap) < 0) {
+		isl_tab_free(tl->tab);
+		tl->tab = NULL;
+	}
+	return NULL;
+}
+
 /* Return the dimension of the set represented by "tl".
  */
 int isl_tab_lexmin_dim(__isl_keep isl_tab_lexmin *tl)
 {
-	return tl ? tl->tab->n_var : -1;
+	return tl && tl->tab ? tl->tab->n_var : -1;
 }
 
 /* Add the equality with coefficients "eq" to "tl", updating the optimal
@@ -5606,7 +5686,7 @@ __isl_give isl_tab_lexmin *isl_tab_lexmin_cut_to_integer(
  */
 __isl_give isl_vec *isl_tab_lexmin_get_solution(__isl_keep isl_tab_lexmin *tl)
 {
-	if (!tl)
+	if (!tl || !tl->tab)
 		return NULL;
 	if (tl->tab->empty)
 		return isl_vec_alloc(tl->ctx, 0);
@@ -19,10 +19,12 @@
 #include <stdio.h>
 #include <limits.h>
 #include <isl_ctx_private.h>
+#include <isl_blk.h>
 #include <isl_map_private.h>
 #include <isl_aff_private.h>
 #include <isl_space_private.h>
 #include <isl/set.h>
+#include <isl/vec.h>
 #include <isl/flow.h>
 #include <isl_constraint_private.h>
 #include <isl/polynomial.h>
@@ -192,6 +194,14 @@ struct {
 	  "{ [x] -> [] : 0 <= x <= 15 }" },
 	{ "{ [x] -> [x] : }",
 	  "{ [x] -> [x] }" },
+	{ "{ [i,j] : 2 i + 3 - i + 2*j - j*2 + j >= 3j - 1 }",
+	  "{ [i,j] : i + 4 >= 2j }" },
+	{ "{ [i,j] : -i + 3 * (i + j) - 2j = 5 }",
+	  "{ [i,j] : 2i + j = 5 }" },
+	{ "{ [i] : i - 3 < 2 * i < 5 }",
+	  "{ [i] : -3 < i <= 2 }" },
+	{ "[n] -> { [i] : n - i * 2 + -1 >= -n + i % 2 }",
+	  "[n] -> { [i] : 2n - 1 >= 2i + i % 2 }" },
 };
 
 int test_parse(struct isl_ctx *ctx)
@@ -256,6 +266,51 @@ int test_parse(struct isl_ctx *ctx)
 	return 0;
 }
 
+/* Check that consecutive objects can be read from the same file and
+ * that they are the same as when they are read from a string.
+ * In particular, check that reading from a (possibly memory mapped) file
+ * leaves the file position right after the object that was read.
+ */
+static int test_read_sequence(isl_ctx *ctx)
+{
+	const char *str1 = "[n] -> { [i] : 0 <= i < n }";
+	const char *str2 = "{ [i, j] : i + j >= 2 }";
+	FILE *input;
+	isl_set *set1, *set2;
+	isl_bool equal;
+
+	input = tmpfile();
+	if (!input)
+		isl_die(ctx, isl_error_unknown, "unable to create file",
+			return -1);
+	fprintf(input, "%s\n%s\n", str1, str2);
+	rewind(input);
+
+	set1 = isl_set_read_from_file(ctx, input);
+	set2 = isl_set_read_from_str(ctx, str1);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+
+	if (equal == isl_bool_true) {
+		set1 = isl_set_read_from_file(ctx, input);
+		set2 = isl_set_read_from_str(ctx, str2);
+		equal = isl_set_is_equal(set1, set2);
+		isl_set_free(set1);
+		isl_set_free(set2);
+	}
+
+	fclose(input);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"read sets not equal", return -1);
+
+	return 0;
+}
+
 static int test_read(isl_ctx *ctx)
 {
 	char *filename;
@@ -286,6 +341,235 @@ static int test_read(isl_ctx *ctx)
 		isl_die(ctx, isl_error_unknown,
 			"read sets not equal", return -1);
 
+	if (test_read_sequence(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Relations that are stored in binary format and read back in
+ * by test_binary_map.
+ * They include integer divisions, nested and named spaces,
+ * rational relations and coefficients that do not fit in 64 bits.
+ */
+static const char *binary_map_tests[] = {
+	"{ [i] : exists (a : i = 3a) }",
+	"[n] -> { A[i, j] -> [B[i] -> C[j]] : 0 <= i < n and j = floor(i/7) }",
+	"{ [x, y] : 100000000000000000000 x >= -123456789012345678901234 + 3y }",
+	"{ [x, y] : x >= 0 or (y <= -4611686018427387904 and x < 0) }",
+	"{ rat: [x] -> [y] : 2y <= x }",
+	"[n, m] -> { : n >= m }",
+	"{ S[] }",
+	"{ [i] : false }",
+};
+
+/* Store the relation described by "str" in binary format,
+ * read it back in and check that the result has the same representation,
+ * including the flags of the basic relations.
+ */
+static int test_binary_map(isl_ctx *ctx, const char *str)
+{
+	int i;
+	isl_map *map, *map2;
+	void *data;
+	size_t size;
+	isl_bool equal;
+
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_coalesce(map);
+	data = isl_map_to_binary(map, &size);
+	map2 = data ? isl_map_read_from_binary(ctx, data, size) : NULL;
+	free(data);
+	equal = isl_map_plain_is_equal(map, map2);
+	for (i = 0; equal == isl_bool_true && i < map->n; ++i)
+		if (map->p[i]->flags != map2->p[i]->flags)
+			equal = isl_bool_false;
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"binary round trip changes relation", return -1);
+	return 0;
+}
+
+/* A schedule tree that is stored in binary format and
+ * read back in by test_binary.
+ * It contains a node of each type.
+ */
+static const char *binary_schedule_str =
+	"domain: \"[n] -> { A[i] : 0 <= i < n; B[i, j] : 0 <= i, j < n }\"\n"
+	"child:\n"
+	"  context: \"[n] -> { [] : n >= 2 }\"\n"
+	"  child:\n"
+	"    sequence:\n"
+	"    - filter: \"{ A[i] }\"\n"
+	"      child:\n"
+	"        mark: \"M\"\n"
+	"        child:\n"
+	"          schedule: \"[{ A[i] -> [(i)] }]\"\n"
+	"          permutable: 1\n"
+	"          coincident: [ 1 ]\n"
+	"          options: \"{ unroll[0] }\"\n"
+	"    - filter: \"{ B[i, j] }\"\n"
+	"      child:\n"
+	"        contraction: \"{ B2[i, j] -> B[i, j] }\"\n"
+	"        expansion: \"{ B[i, j] -> B2[i, j] }\"\n"
+	"        child:\n"
+	"          schedule: \"[{ B2[i, j] -> [(i)] }, "
+				"{ B2[i, j] -> [(floor((j)/2))] }]\"\n"
+	"          child:\n"
+	"            guard: \"[n] -> { [i, j] : n >= 3 }\"\n"
+	"            child:\n"
+	"              extension: \"[n] -> { [i, j] -> C[i] }\"\n"
+	"              child:\n"
+	"                set:\n"
+	"                - filter: \"{ B2[i, j] }\"\n"
+	"                - filter: \"{ C[i] }\"\n";
+
+/* Check that a schedule tree in binary format that is nested
+ * more deeply than the reader allows is rejected.
+ * The tree consists of a long chain of sequence nodes
+ * with a single child each, ending in a leaf.
+ */
+static isl_stat test_binary_depth(isl_ctx *ctx)
+{
+	const int depth = 5000;
+	unsigned char *data;
+	size_t size;
+	int i, on_error;
+	const char *msg;
+	isl_schedule *schedule;
+
+	size = 4 + 3 + 2 * depth + 2;
+	data = isl_alloc_array(ctx, unsigned char, size);
+	if (!data)
+		return isl_stat_error;
+	memcpy(data, "ISLB", 4);
+	data[4] = 1;
+	data[5] = 9;
+	data[6] = 0;
+	for (i = 0; i < depth; ++i) {
+		data[7 + 2 * i] = isl_schedule_node_sequence;
+		data[7 + 2 * i + 1] = 1;
+	}
+	data[size - 2] = isl_schedule_node_leaf;
+	data[size - 1] = 0;
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	isl_ctx_reset_error(ctx);
+	schedule = isl_schedule_read_from_binary(ctx, data, size);
+	msg = isl_ctx_last_error_msg(ctx);
+	isl_options_set_on_error(ctx, on_error);
+	free(data);
+	isl_schedule_free(schedule);
+	if (schedule || !msg || strcmp(msg, "binary data nested too deeply"))
+		isl_die(ctx, isl_error_unknown,
+			"deeply nested binary data not rejected",
+			return isl_stat_error);
+
+	return isl_stat_ok;
+}
+
+/* Check that objects can be stored in binary format and read back in and
+ * that invalid binary data is rejected.
+ */
+static int test_binary(isl_ctx *ctx)
+{
+	int i;
+	const char *str;
+	isl_union_map *umap, *umap2;
+	isl_pw_aff *pa, *pa2;
+	isl_pw_multi_aff *pma, *pma2;
+	isl_schedule *schedule, *schedule2;
+	isl_set *set;
+	void *data;
+	size_t size;
+	isl_bool equal;
+	int on_error;
+
+	for (i = 0; i < ARRAY_SIZE(binary_map_tests); ++i)
+		if (test_binary_map(ctx, binary_map_tests[i]) < 0)
+			return -1;
+
+	str = "{ A[i] -> B[i + 1]; C[] -> D[x] : x > 0; [i] -> [j] }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	data = isl_union_map_to_binary(umap, &size);
+	umap2 = data ? isl_union_map_read_from_binary(ctx, data, size) : NULL;
+	free(data);
+	equal = isl_union_map_is_equal(umap, umap2);
+	isl_union_map_free(umap);
+	isl_union_map_free(umap2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"binary round trip changes union map", return -1);
+
+	str = "[n] -> { [i] -> [floor(i/3) + n] : i >= 0; [i] -> [-i] : i < 0 }";
+	pa = isl_pw_aff_read_from_str(ctx, str);
+	data = isl_pw_aff_to_binary(pa, &size);
+	pa2 = data ? isl_pw_aff_read_from_binary(ctx, data, size) : NULL;
+	free(data);
+	equal = isl_pw_aff_plain_is_equal(pa, pa2);
+	isl_pw_aff_free(pa);
+	isl_pw_aff_free(pa2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"binary round trip changes pw_aff", return -1);
+
+	str = "{ [i, j] -> A[i + j, floor(j/2)] : i > j; "
+		"[i, j] -> A[0, 1] : i <= j }";
+	pma = isl_pw_multi_aff_read_from_str(ctx, str);
+	data = isl_pw_multi_aff_to_binary(pma, &size);
+	pma2 = data ? isl_pw_multi_aff_read_from_binary(ctx, data, size) : NULL;
+	free(data);
+	equal = isl_pw_multi_aff_plain_is_equal(pma, pma2);
+	isl_pw_multi_aff_free(pma);
+	isl_pw_multi_aff_free(pma2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"binary round trip changes pw_multi_aff", return -1);
+
+	schedule = isl_schedule_read_from_str(ctx, binary_schedule_str);
+	data = isl_schedule_to_binary(schedule, &size);
+	schedule2 = data ? isl_schedule_read_from_binary(ctx, data, size) : NULL;
+	equal = isl_schedule_plain_is_equal(schedule, schedule2);
+	isl_schedule_free(schedule);
+	isl_schedule_free(schedule2);
+	if (equal < 0 || !data) {
+		free(data);
+		return -1;
+	}
+	if (!equal) {
+		free(data);
+		isl_die(ctx, isl_error_unknown,
+			"binary round trip changes schedule", return -1);
+	}
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	schedule = isl_schedule_read_from_binary(ctx, data, size - 1);
+	set = isl_set_read_from_binary(ctx, data, size);
+	isl_options_set_on_error(ctx, on_error);
+	free(data);
+	equal = !schedule && !set ? isl_bool_true : isl_bool_false;
+	isl_schedule_free(schedule);
+	isl_set_free(set);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"invalid binary data not rejected", return -1);
+
+	if (test_binary_depth(ctx) < 0)
+		return -1;
+
 	return 0;
 }
 
@@ -1562,6 +1846,434 @@ static int test_gist(struct isl_ctx *ctx)
 	return 0;
 }
 
+/* Perform a coalescing, a subset test, an emptiness test and
+ * a gist operation on inputs that are parsed anew and
+ * return a string representation of the results.
+ */
+static char *memo_ops(isl_ctx *ctx)
+{
+	isl_set *set, *context;
+	isl_bool subset, empty;
+	char *s1, *s2, *res;
+
+	set = isl_set_read_from_str(ctx,
+		"{ [i, j] : 0 <= i <= 10 and 0 <= j <= 5; "
+		"[i, j] : 11 <= i <= 20 and 0 <= j <= 5 }");
+	set = isl_set_coalesce(set);
+	s1 = isl_set_to_str(set);
+	isl_set_free(set);
+
+	set = isl_set_read_from_str(ctx,
+		"{ [i] : 0 <= i <= 10; [i] : 20 <= i <= 30 }");
+	context = isl_set_read_from_str(ctx, "{ [i] : 0 <= i <= 40 }");
+	subset = isl_set_is_subset(set, context);
+	empty = isl_set_is_empty(set);
+	set = isl_set_gist(set, context);
+	s2 = isl_set_to_str(set);
+	isl_set_free(set);
+
+	res = NULL;
+	if (s1 && s2 && subset >= 0 && empty >= 0) {
+		res = isl_alloc_array(ctx, char, strlen(s1) + strlen(s2) + 4);
+		if (res)
+			sprintf(res, "%s%s%d%d", s1, s2, subset, empty);
+	}
+	free(s1);
+	free(s2);
+	return res;
+}
+
+/* Check that the memo table does not affect the results of
+ * the operations performed by memo_ops, with "ref" the result
+ * computed without memo table, that a repetition
+ * of these operations is served entirely from the memo table
+ * and that results are evicted from a memo table that is too small.
+ */
+static int check_memo(isl_ctx *ctx, const char *ref)
+{
+	char *res;
+	unsigned long hits, misses;
+	int i, ok;
+
+	if (isl_options_set_memo_size(ctx, 16) < 0)
+		return -1;
+	for (i = 0; i < 2; ++i) {
+		hits = isl_ctx_get_memo_hits(ctx);
+		misses = isl_ctx_get_memo_misses(ctx);
+		res = memo_ops(ctx);
+		ok = res && !strcmp(ref, res);
+		free(res);
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"memo table changes result", return -1);
+	}
+	if (isl_ctx_get_memo_hits(ctx) != hits + 4 ||
+	    isl_ctx_get_memo_misses(ctx) != misses)
+		isl_die(ctx, isl_error_unknown,
+			"repeated operations not found in memo table",
+			return -1);
+
+	isl_ctx_reset_memo(ctx);
+	if (isl_options_set_memo_size(ctx, 1) < 0)
+		return -1;
+	for (i = 0; i < 2; ++i) {
+		misses = isl_ctx_get_memo_misses(ctx);
+		res = memo_ops(ctx);
+		ok = res && !strcmp(ref, res);
+		free(res);
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"memo table changes result", return -1);
+	}
+	if (isl_ctx_get_memo_misses(ctx) == misses)
+		isl_die(ctx, isl_error_unknown,
+			"results not evicted from memo table", return -1);
+
+	return 0;
+}
+
+/* Perform check_memo, starting from an empty memo table.
+ * The memo table is emptied again afterwards and
+ * the memo_size option is reset to its original value.
+ */
+static int test_memo(isl_ctx *ctx)
+{
+	int memo_size, r;
+	char *ref;
+
+	memo_size = isl_options_get_memo_size(ctx);
+	isl_ctx_reset_memo(ctx);
+	if (isl_options_set_memo_size(ctx, 0) < 0)
+		return -1;
+	ref = memo_ops(ctx);
+	r = ref ? check_memo(ctx, ref) : -1;
+	free(ref);
+	isl_ctx_reset_memo(ctx);
+	if (isl_options_set_memo_size(ctx, memo_size) < 0)
+		return -1;
+
+	return r;
+}
+
+/* Check that the operations performed while the print_stats option is set
+ * are profiled and that nested operations appear inside
+ * the operations from which they are called, both in the textual
+ * and in the JSON description of the statistics.
+ * In particular, isl_map_transitive_closure calls isl_map_coalesce.
+ * The map involves a constant that does not fit in a machine integer,
+ * so in builds with small integer optimization, the conversions
+ * to big representation should be counted as well.
+ */
+static int check_profile(isl_ctx *ctx)
+{
+	isl_map *map;
+	char *text, *json;
+	const char *total;
+	int ok;
+
+	map = isl_map_read_from_str(ctx,
+		"{ [i] -> [i + 100000000000000000000] : 0 <= i < 10 }");
+	map = isl_map_transitive_closure(map, NULL);
+	if (!map)
+		return -1;
+	isl_map_free(map);
+	text = isl_ctx_stats_to_str(ctx);
+	json = isl_ctx_stats_to_json(ctx);
+	ok = text && json &&
+	    strstr(text, "\n  isl_map_transitive_closure: calls 1,") &&
+	    strstr(text, "\n    isl_map_coalesce: calls ") &&
+	    strstr(json, "\"name\": \"isl_map_transitive_closure\", "
+			"\"calls\": 1,") &&
+	    strstr(json, "\"children\": [{ \"name\": \"isl_map_coalesce\"");
+	total = ok ? strstr(text, ", promotions ") : NULL;
+#ifdef USE_SMALL_INT_OPT
+	ok = total && strtoul(total + strlen(", promotions "), NULL, 10) > 0;
+#else
+	ok = total != NULL;
+#endif
+	free(text);
+	free(json);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown, "unexpected profile",
+			return -1);
+
+	isl_ctx_reset_profile(ctx);
+	text = isl_ctx_stats_to_str(ctx);
+	ok = text && !strstr(text, "isl_map_transitive_closure");
+	free(text);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown, "profile not reset",
+			return -1);
+
+	return 0;
+}
+
+/* Perform check_profile with the print_stats option set,
+ * starting from an empty profile.
+ * The profile is discarded again afterwards and
+ * the print_stats option is reset to its original value.
+ */
+static int test_profile(isl_ctx *ctx)
+{
+	int print_stats, r;
+
+	print_stats = isl_options_get_print_stats(ctx);
+	isl_ctx_reset_profile(ctx);
+	if (isl_options_set_print_stats(ctx, 1) < 0)
+		return -1;
+	r = check_profile(ctx);
+	isl_ctx_reset_profile(ctx);
+	if (isl_options_set_print_stats(ctx, print_stats) < 0)
+		return -1;
+
+	return r;
+}
+
+/* Compute the transitive closure of a simple map in "ctx" and
+ * return isl_bool_true if it succeeded and isl_bool_false
+ * if it failed because of a quota error.
+ */
+static isl_bool budget_op(isl_ctx *ctx)
+{
+	isl_map *map;
+
+	isl_ctx_reset_error(ctx);
+	map = isl_map_read_from_str(ctx, "{ [i] -> [i + 1] : 0 <= i < 10 }");
+	map = isl_map_transitive_closure(map, NULL);
+	isl_map_free(map);
+	if (map)
+		return isl_bool_true;
+	if (isl_ctx_last_error(ctx) == isl_error_quota)
+		return isl_bool_false;
+	return isl_bool_error;
+}
+
+/* Check that the last error in "ctx" has message "msg".
+ */
+static isl_stat check_budget_msg(isl_ctx *ctx, const char *msg)
+{
+	const char *last;
+
+	last = isl_ctx_last_error_msg(ctx);
+	if (!last || strcmp(last, msg))
+		isl_die(ctx, isl_error_unknown,
+			"unexpected budget error message",
+			return isl_stat_error);
+	return isl_stat_ok;
+}
+
+/* Check that an operation fails when it exceeds a budget pushed
+ * by isl_ctx_push_budget, that only the budget that ran out
+ * is reported as exhausted (both by isl_ctx_pop_budget and
+ * in the error message, also for deeply nested budgets) and
+ * that the isl_ctx can be used again after popping the exhausted budget.
+ */
+static int test_budget(isl_ctx *ctx)
+{
+	int i;
+	int on_error;
+	isl_bool ok, exhausted, outer_exhausted;
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+
+	if (isl_ctx_push_budget(ctx, 10, 0) < 0)
+		goto error;
+	ok = budget_op(ctx);
+	if (check_budget_msg(ctx, "operation budget "
+			"of budget scope 1 exceeded") < 0)
+		goto error;
+	exhausted = isl_ctx_pop_budget(ctx);
+	if (ok < 0 || exhausted < 0)
+		goto error;
+	if (ok || !exhausted)
+		isl_die(ctx, isl_error_unknown,
+			"operation budget not enforced", goto error);
+	ok = budget_op(ctx);
+	if (ok < 0)
+		goto error;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"budget still enforced after pop", goto error);
+
+	if (isl_ctx_push_budget(ctx, 1000000000, 0) < 0 ||
+	    isl_ctx_push_budget(ctx, 0, 1e-9) < 0)
+		goto error;
+	ok = budget_op(ctx);
+	if (check_budget_msg(ctx,
+			"time budget of budget scope 2 exceeded") < 0)
+		goto error;
+	exhausted = isl_ctx_pop_budget(ctx);
+	if (ok < 0 || exhausted < 0)
+		goto error;
+	if (ok || !exhausted)
+		isl_die(ctx, isl_error_unknown,
+			"time budget not enforced", goto error);
+	ok = budget_op(ctx);
+	outer_exhausted = isl_ctx_pop_budget(ctx);
+	if (ok < 0 || outer_exhausted < 0)
+		goto error;
+	if (!ok || outer_exhausted)
+		isl_die(ctx, isl_error_unknown,
+			"outer budget affected by inner budget", goto error);
+
+	for (i = 0; i < 11; ++i)
+		if (isl_ctx_push_budget(ctx, 0, 0) < 0)
+			goto error;
+	if (isl_ctx_push_budget(ctx, 10, 0) < 0)
+		goto error;
+	ok = budget_op(ctx);
+	if (check_budget_msg(ctx, "operation budget "
+			"of budget scope 12 exceeded") < 0)
+		goto error;
+	for (i = 0; i < 12; ++i)
+		if (isl_ctx_pop_budget(ctx) < 0)
+			goto error;
+	if (ok < 0)
+		goto error;
+	if (ok)
+		isl_die(ctx, isl_error_unknown,
+			"deeply nested budget not enforced", goto error);
+
+	isl_options_set_on_error(ctx, on_error);
+	return 0;
+error:
+	isl_options_set_on_error(ctx, on_error);
+	return -1;
+}
+
+/* Allocate and free a vector of size "n" in "ctx" twice and
+ * check that this results in "hits" allocations that are served
+ * from the block cache and "misses" allocations that are not.
+ */
+static int check_blk_cache(isl_ctx *ctx, int n1, int n2,
+	unsigned long hits, unsigned long misses)
+{
+	unsigned long hits0, misses0;
+
+	hits0 = isl_ctx_get_blk_cache_hits(ctx);
+	misses0 = isl_ctx_get_blk_cache_misses(ctx);
+	isl_vec_free(isl_vec_alloc(ctx, n1));
+	isl_vec_free(isl_vec_alloc(ctx, n2));
+	if (isl_ctx_get_blk_cache_hits(ctx) != hits0 + hits ||
+	    isl_ctx_get_blk_cache_misses(ctx) != misses0 + misses)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected block cache statistics", return -1);
+
+	return 0;
+}
+
+/* Check that a freed block of integers is reused by a subsequent
+ * allocation of a block in the same size class,
+ * but only if the size of the block cache allows it to be kept.
+ * The cache of the current thread is cleared before the test
+ * since it may still contain blocks freed by previous tests and
+ * after the test since it may then contain more blocks
+ * than allowed by the original value of the blk_cache_size option,
+ * which is restored afterwards.
+ */
+static int test_blk_cache(isl_ctx *ctx)
+{
+	int r = 0;
+	int size;
+	struct isl_ctx_local *local;
+
+	local = isl_ctx_local(ctx);
+	if (!local)
+		return -1;
+	size = isl_options_get_blk_cache_size(ctx);
+	if (isl_options_set_blk_cache_size(ctx, 0) < 0)
+		return -1;
+	isl_blk_clear_cache(local);
+	if (check_blk_cache(ctx, 100, 100, 0, 2) < 0 ||
+	    isl_options_set_blk_cache_size(ctx, 1 << 20) < 0 ||
+	    check_blk_cache(ctx, 100, 120, 1, 1) < 0 ||
+	    check_blk_cache(ctx, 128, 300, 1, 1) < 0)
+		r = -1;
+	isl_blk_clear_cache(local);
+
+	if (isl_options_set_blk_cache_size(ctx, size) < 0)
+		return -1;
+	return r;
+}
+
+/* Subtract two sets and coalesce the result.
+ */
+static __isl_give isl_set *arena_op(isl_ctx *ctx)
+{
+	isl_set *set1, *set2;
+
+	set1 = isl_set_read_from_str(ctx,
+		"{ [i, j] : 0 <= i, j <= 100 and i + j <= 150 }");
+	set2 = isl_set_read_from_str(ctx,
+		"{ [i, j] : exists a : i = 3a and 10 <= j <= 20 }");
+	return isl_set_coalesce(isl_set_subtract(set1, set2));
+}
+
+/* Check that operations performed inside an arena scope
+ * produce the same result as outside such a scope,
+ * that the result remains valid after the scope has been left and
+ * that the memory it occupies is released when it is freed.
+ * The arena scopes are left again on error such that
+ * "ctx" can still be used by subsequent tests.
+ */
+static int test_arena(isl_ctx *ctx)
+{
+	int on_error;
+	isl_bool equal;
+	isl_set *set, *ref;
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	if (isl_ctx_pop_arena(ctx) >= 0) {
+		isl_options_set_on_error(ctx, on_error);
+		isl_die(ctx, isl_error_unknown,
+			"popping non-existent arena should fail", return -1);
+	}
+	isl_options_set_on_error(ctx, on_error);
+
+	ref = arena_op(ctx);
+	if (isl_ctx_push_arena(ctx) < 0)
+		goto error_ref;
+	if (isl_ctx_push_arena(ctx) < 0) {
+		isl_ctx_pop_arena(ctx);
+		goto error_ref;
+	}
+	set = arena_op(ctx);
+	if (isl_ctx_pop_arena(ctx) < 0)
+		goto error_set;
+	if (isl_ctx_get_arena_retained(ctx) != 0) {
+		isl_ctx_pop_arena(ctx);
+		isl_die(ctx, isl_error_unknown,
+			"memory retained by inner arena scope", goto error_set);
+	}
+	if (isl_ctx_pop_arena(ctx) < 0)
+		goto error_set;
+	if (isl_ctx_get_arena_retained(ctx) == 0)
+		isl_die(ctx, isl_error_unknown,
+			"result not retained", goto error_set);
+
+	equal = isl_set_is_equal(set, ref);
+	if (equal < 0)
+		goto error_set;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"arena scope changes result", goto error_set);
+	isl_set_free(set);
+	isl_set_free(ref);
+
+	if (isl_ctx_get_arena_retained(ctx) != 0)
+		isl_die(ctx, isl_error_unknown,
+			"memory not released", return -1);
+
+	return 0;
+error_set:
+	isl_set_free(set);
+error_ref:
+	isl_set_free(ref);
+	return -1;
+}
+
 int test_coalesce_set(isl_ctx *ctx, const char *str, int check_one)
 {
 	isl_set *set, *set2;
@@ -1891,6 +2603,14 @@ struct {
 	{ 0, "{ [a, b] : a >= 0 and 0 <= b <= 1 - a; [-1, 3] }" },
 	{ 1, "{ [a, b] : a, b >= 0 and a + 2b <= 2; [1, 1] }" },
 	{ 0, "{ [a, b] : a, b >= 0 and a + 2b <= 2; [2, 1] }" },
+	{ 1, "{ [x, y] : 0 <= x <= 2 and 0 <= y <= 2; "
+		"[x, y] : 6 <= x <= 8 and 0 <= y <= 2; "
+		"[x, y] : 3 <= x <= 5 and 0 <= y <= 2 }" },
+	{ 1, "{ [x, y] : 0 <= x <= 2 and 0 <= y <= 2; "
+		"[x, y] : 3 <= x <= 5 and 0 <= y <= 2 }" },
+	{ 0, "{ [x, y] : 0 <= x <= 2 and 0 <= y <= 2; "
+		"[x, y] : 0 <= x <= 2 and 4 <= y <= 6; "
+		"[x, y] : 4 <= x <= 6 and 0 <= y <= 6 }" },
 };
 
 /* A specialized coalescing test case that would result
@@ -2530,7 +3250,12 @@ struct {
 	{ "{ [a, b] : 0 <= a, b <= 100 and b mod 2 = 0}",
 	  "{ [a, b] -> [floor((b - 2*floor((-a)/4))/5)] }",
 	  &isl_set_max_val, "30" },
-
+	{ "{ [x, y] : 0 <= x <= 4294967296 and y >= 0 and "
+		"3037000499 y <= 4294967311 x + 2147483647 }",
+	  "{ [x, y] -> [y] }", &isl_set_max_val, "6074001023" },
+	{ "{ [x, y] : 0 <= x <= 4294967296 and y >= 0 and "
+		"3037000499 y <= 4294967311 x + 2147483647 }",
+	  "{ [x, y] -> [-y] }", &isl_set_min_val, "-6074001023" },
 };
 
 /* Perform basic isl_set_min_val and isl_set_max_val tests.
@@ -2570,6 +3295,25 @@ static int test_min(struct isl_ctx *ctx)
 	return 0;
 }
 
+/* Check that the lp_float_presolve option does not affect the results
+ * of linear optimization, by running some of the tests that
+ * perform many linear optimizations with the option set.
+ */
+static int test_lp_float_presolve(isl_ctx *ctx)
+{
+	int r;
+
+	isl_options_set_lp_float_presolve(ctx, 1);
+	r = test_min(ctx);
+	if (r >= 0)
+		r = test_convex_hull(ctx);
+	if (r >= 0)
+		r = test_coalesce(ctx);
+	isl_options_set_lp_float_presolve(ctx, 0);
+
+	return r;
+}
+
 struct must_may {
 	isl_map *must;
 	isl_map *may;
@@ -3102,6 +3846,296 @@ static int test_union(isl_ctx *ctx)
 	return 0;
 }
 
+/* Inputs and expected results of binary operations on union maps
+ * that only combine pairs of maps with matching tuples.
+ */
+struct {
+	__isl_give isl_union_map *(*fn)(__isl_take isl_union_map *umap1,
+		__isl_take isl_union_map *umap2);
+	const char *arg1;
+	const char *arg2;
+	const char *res;
+} union_map_match_tests[] = {
+	{ &isl_union_map_apply_range,
+	  "{ A[i] -> B[i]; A[i] -> C[i, i]; D[i] -> [[i] -> B[i]] }",
+	  "{ B[i] -> E[i + 1]; C[i, j] -> E[i + j]; C[i] -> F[i]; "
+	    "[[i] -> B[j]] -> G[i - j]; [i] -> H[i] }",
+	  "{ A[i] -> E[i + 1]; A[i] -> E[2i]; D[i] -> G[0] }" },
+	{ &isl_union_map_apply_domain,
+	  "{ A[i] -> B[i]; C[i] -> B[i + 1] }",
+	  "{ A[i] -> D[2i]; C[i] -> E[i]; B[i] -> F[i] }",
+	  "{ D[j] -> B[i] : j = 2i; E[i] -> B[i + 1] }" },
+	{ &isl_union_map_range_product,
+	  "{ A[i] -> B[i]; C[i] -> B[i] }",
+	  "{ A[i] -> D[i + 1]; A[i] -> E[i, i]; F[i] -> B[i] }",
+	  "{ A[i] -> [B[i] -> D[i + 1]]; A[i] -> [B[i] -> E[i, i]] }" },
+	{ &isl_union_map_lex_lt_union_map,
+	  "{ A[i] -> B[i]; C[i] -> D[i, i] }",
+	  "{ E[i] -> B[i]; F[i] -> D[i] }",
+	  "{ A[i] -> E[j] : i < j }" },
+};
+
+/* Check that binary operations on union maps that only combine
+ * pairs of maps with matching tuples produce the expected results.
+ */
+static int test_union_map_match(isl_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(union_map_match_tests); ++i) {
+		isl_union_map *umap1, *umap2, *res;
+		isl_bool equal;
+
+		umap1 = isl_union_map_read_from_str(ctx,
+						union_map_match_tests[i].arg1);
+		umap2 = isl_union_map_read_from_str(ctx,
+						union_map_match_tests[i].arg2);
+		res = isl_union_map_read_from_str(ctx,
+						union_map_match_tests[i].res);
+		umap1 = union_map_match_tests[i].fn(umap1, umap2);
+		equal = isl_union_map_is_equal(umap1, res);
+		isl_union_map_free(umap1);
+		isl_union_map_free(res);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected result", return -1);
+	}
+
+	return 0;
+}
+
+/* Construct a union map with "n" maps from statement spaces S<k>
+ * to array spaces A<k % 5> in the isl_ctx "ctx".
+ */
+static __isl_give isl_union_map *parallel_access_relation(isl_ctx *ctx, int n)
+{
+	int k;
+	isl_union_map *umap;
+
+	umap = isl_union_map_empty(isl_space_params_alloc(ctx, 0));
+	for (k = 0; k < n; ++k) {
+		char str[100];
+		isl_map *map;
+
+		snprintf(str, sizeof(str), "[N] -> { S%d[i, j] -> "
+			"A%d[i + %d j] : 0 <= i, j < N and i >= %d }",
+			k, k % 5, k % 3, k);
+		map = isl_map_read_from_str(ctx, str);
+		umap = isl_union_map_add_map(umap, map);
+	}
+
+	return umap;
+}
+
+/* Perform a sequence of binary operations on union maps in "ctx"
+ * and return a textual representation of the results.
+ */
+static char *parallel_union_map_ops(isl_ctx *ctx, void *user)
+{
+	isl_union_map *access, *res;
+	isl_union_set *dom;
+	isl_printer *p;
+	char *str;
+
+	access = parallel_access_relation(ctx, 40);
+	res = isl_union_map_apply_range(isl_union_map_copy(access),
+			isl_union_map_reverse(isl_union_map_copy(access)));
+	res = isl_union_map_subtract(res, isl_union_map_lex_ge_union_map(
+			isl_union_map_copy(access), isl_union_map_copy(access)));
+	dom = isl_union_set_read_from_str(ctx,
+		"[N] -> { S3[i, j] : i < j; S7[i, j] : j = 0; A1[x] : x > 10 }");
+	res = isl_union_map_union(res,
+		isl_union_map_intersect_domain(isl_union_map_copy(access),
+						isl_union_set_copy(dom)));
+	res = isl_union_map_union(res,
+		isl_union_map_intersect(isl_union_map_copy(access),
+			isl_union_map_from_domain_and_range(
+				isl_union_set_copy(dom),
+				isl_union_map_range(
+					isl_union_map_copy(access)))));
+	res = isl_union_map_union(res, isl_union_map_range_product(
+			isl_union_map_copy(access), isl_union_map_copy(access)));
+	isl_union_set_free(dom);
+	isl_union_map_free(access);
+
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_print_union_map(p, res);
+	str = isl_printer_get_str(p);
+	isl_printer_free(p);
+	isl_union_map_free(res);
+
+	return str;
+}
+
+/* Check that "gen" produces exactly the same result in "ctx"
+ * when the option set by "set_parallel" is set
+ * (with the n_threads option set to 4) as when it is not set.
+ * "get_parallel" retrieves the original value of the option.
+ * The options are reset to their original values afterwards.
+ */
+static int check_parallel_in(isl_ctx *ctx,
+	char *(*gen)(isl_ctx *ctx, void *user), void *user,
+	isl_stat (*set_parallel)(isl_ctx *ctx, int val),
+	int (*get_parallel)(isl_ctx *ctx))
+{
+	char *serial, *parallel = NULL;
+	int orig, n_threads;
+	int equal;
+
+	orig = get_parallel(ctx);
+	n_threads = isl_options_get_n_threads(ctx);
+	if (set_parallel(ctx, 0) < 0)
+		return -1;
+	serial = gen(ctx, user);
+	if (set_parallel(ctx, 1) >= 0 &&
+	    isl_options_set_n_threads(ctx, 4) >= 0)
+		parallel = gen(ctx, user);
+	equal = serial && parallel && !strcmp(serial, parallel);
+	free(serial);
+	free(parallel);
+	if (set_parallel(ctx, orig) < 0 ||
+	    isl_options_set_n_threads(ctx, n_threads) < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel result differs from serial result",
+			return -1);
+
+	return 0;
+}
+
+/* Perform check_parallel_in on "ctx" and, in builds with thread support,
+ * on a separate concurrent isl_ctx.
+ * The computation is only performed in parallel in a concurrent isl_ctx,
+ * but enabling concurrency on "ctx" would affect all subsequent tests.
+ */
+static int check_parallel(isl_ctx *ctx,
+	char *(*gen)(isl_ctx *ctx, void *user), void *user,
+	isl_stat (*set_parallel)(isl_ctx *ctx, int val),
+	int (*get_parallel)(isl_ctx *ctx))
+{
+	int r;
+
+	r = check_parallel_in(ctx, gen, user, set_parallel, get_parallel);
+#ifdef USE_THREADS
+	if (r >= 0) {
+		isl_ctx *cctx = isl_ctx_alloc();
+
+		if (isl_ctx_enable_concurrency(cctx) < 0)
+			r = -1;
+		else
+			r = check_parallel_in(cctx, gen, user,
+						set_parallel, get_parallel);
+		isl_ctx_free(cctx);
+	}
+#endif
+
+	return r;
+}
+
+/* Check that performing binary operations on union maps in parallel
+ * produces exactly the same results as performing them serially.
+ * In builds without thread support, the operations are always
+ * performed serially, even if the union_map_parallel option is set.
+ */
+static int test_union_map_parallel(isl_ctx *ctx)
+{
+	return check_parallel(ctx, &parallel_union_map_ops, NULL,
+				&isl_options_set_union_map_parallel,
+				&isl_options_get_union_map_parallel);
+}
+
+/* Compute the dataflow dependences in a stencil-like program
+ * with "n" statements accessing five arrays in "ctx" and
+ * return a textual representation of the result.
+ * If "tree" is set, then the schedule is represented
+ * by a schedule tree.  Otherwise, it is represented by a schedule map.
+ */
+static char *parallel_flow(isl_ctx *ctx, int n, int tree)
+{
+	int k;
+	isl_union_map *sink, *source, *schedule;
+	isl_union_access_info *access;
+	isl_union_flow *flow;
+	char *str;
+
+	sink = isl_union_map_empty(isl_space_params_alloc(ctx, 0));
+	source = isl_union_map_copy(sink);
+	schedule = isl_union_map_copy(sink);
+	for (k = 0; k < n; ++k) {
+		char buf[100];
+
+		snprintf(buf, sizeof(buf), "[N] -> { S%d[i] -> A%d[i - 1] : "
+			"0 < i < N; S%d[i] -> A%d[i + 1] : 0 <= i < N - 1 }",
+			k, (k + 1) % 5, k, (k + 1) % 5);
+		sink = isl_union_map_union(sink,
+					isl_union_map_read_from_str(ctx, buf));
+		snprintf(buf, sizeof(buf),
+			"[N] -> { S%d[i] -> A%d[i] : 0 <= i < N }", k, k % 5);
+		source = isl_union_map_union(source,
+					isl_union_map_read_from_str(ctx, buf));
+		snprintf(buf, sizeof(buf), "{ S%d[i] -> [i, %d] }", k, k);
+		schedule = isl_union_map_union(schedule,
+					isl_union_map_read_from_str(ctx, buf));
+	}
+
+	access = isl_union_access_info_from_sink(sink);
+	access = isl_union_access_info_set_must_source(access, source);
+	if (tree) {
+		isl_union_set *domain;
+		isl_multi_union_pw_aff *mupa;
+		isl_schedule *sched;
+
+		domain = isl_union_map_domain(isl_union_map_copy(schedule));
+		mupa = isl_multi_union_pw_aff_from_union_map(schedule);
+		sched = isl_schedule_from_domain(domain);
+		sched = isl_schedule_insert_partial_schedule(sched, mupa);
+		access = isl_union_access_info_set_schedule(access, sched);
+	} else {
+		access = isl_union_access_info_set_schedule_map(access,
+								schedule);
+	}
+	flow = isl_union_access_info_compute_flow(access);
+	str = isl_union_flow_to_str(flow);
+	isl_union_flow_free(flow);
+
+	return str;
+}
+
+/* Compute the dataflow dependences in the stencil-like program
+ * constructed by parallel_flow with 12 statements and
+ * return a textual representation of the result.
+ * "user" points to a flag indicating whether the schedule
+ * should be represented by a schedule tree.
+ */
+static char *parallel_flow_str(isl_ctx *ctx, void *user)
+{
+	int *tree = user;
+
+	return parallel_flow(ctx, 12, *tree);
+}
+
+/* Check that computing dataflow dependences for different sinks
+ * in parallel produces exactly the same results as computing them serially,
+ * both with a schedule map and with a schedule tree.
+ * In builds without thread support, the dependences are always
+ * computed serially, even if the flow_parallel option is set.
+ */
+static int test_flow_parallel(isl_ctx *ctx)
+{
+	int tree;
+
+	for (tree = 0; tree <= 1; ++tree)
+		if (check_parallel(ctx, &parallel_flow_str, &tree,
+				    &isl_options_set_flow_parallel,
+				    &isl_options_get_flow_parallel) < 0)
+			return -1;
+
+	return 0;
+}
+
 /* Check that computing a bound of a non-zero polynomial over an unbounded
  * domain does not produce a rational value.
  * In particular, check that the upper bound is infinity.
@@ -3215,6 +4249,13 @@ struct {
 			"4e0 >= -61 + i0 + i1)) or "
 		"(i1 <= 66 - i0 and i0 >= 2 and i1 >= 59 + i0) }", 1 },
 	{ "[a, b] -> { : a = 0 and b = -1 }", "[b, a] -> { : b >= -10 }", 1 },
+	{ "{ [i, j] : 0 <= j <= i <= 10; [i, 0] : 20 <= i <= 30 }",
+	  "{ [i, j] : 0 <= j <= i <= 30 }", 1 },
+	{ "{ [i, j] : 0 <= j <= i <= 10; [i, 0] : 20 <= i <= 30 }",
+	  "{ [i, j] : 0 <= j <= i <= 25 }", 0 },
+	{ "{ [i] : exists (a : i = 2a and 0 <= i <= 10) }",
+	  "{ [i] : exists (a : i = 4a) }", 0 },
+	{ "{ rat: [i] : 0 <= 2i <= 1 and i >= 1 }", "{ [7] }", 1 },
 };
 
 static int test_subset(isl_ctx *ctx)
@@ -4443,6 +5484,189 @@ static int test_schedule_incremental(isl_ctx *ctx)
 	return r;
 }
 
+/* Compute a schedule for the domain "domain" with validity and
+ * proximity constraints "validity" and return it as a string.
+ * If "coincidence" is not NULL, then it is used as coincidence constraints.
+ * If "condition" and "conditional_validity" are not NULL,
+ * then they are used as conditional validity constraints.
+ */
+static char *schedule_str(isl_ctx *ctx, const char *domain,
+	const char *validity, const char *coincidence, const char *condition,
+	const char *conditional_validity)
+{
+	isl_union_set *D;
+	isl_union_map *V, *C, *CV;
+	isl_schedule_constraints *sc;
+	isl_schedule *schedule;
+	char *str;
+
+	D = isl_union_set_read_from_str(ctx, domain);
+	V = isl_union_map_read_from_str(ctx, validity);
+	sc = isl_schedule_constraints_on_domain(D);
+	sc = isl_schedule_constraints_set_validity(sc, isl_union_map_copy(V));
+	sc = isl_schedule_constraints_set_proximity(sc, V);
+	if (coincidence) {
+		C = isl_union_map_read_from_str(ctx, coincidence);
+		sc = isl_schedule_constraints_set_coincidence(sc, C);
+	}
+	if (condition && conditional_validity) {
+		C = isl_union_map_read_from_str(ctx, condition);
+		CV = isl_union_map_read_from_str(ctx, conditional_validity);
+		sc = isl_schedule_constraints_set_conditional_validity(sc,
+								C, CV);
+	}
+	schedule = isl_schedule_constraints_compute_schedule(sc);
+	str = isl_schedule_to_str(schedule);
+	isl_schedule_free(schedule);
+
+	return str;
+}
+
+/* Compute a schedule for the instances in the domain user[0]
+ * that respects the dependences in user[1] and
+ * return a textual representation of the result.
+ */
+static char *schedule_components_str(isl_ctx *ctx, void *user)
+{
+	const char **str = user;
+
+	return schedule_str(ctx, str[0], str[1], NULL, NULL, NULL);
+}
+
+/* Check that scheduling the components of a dependence graph
+ * in parallel produces exactly the same schedule tree
+ * as scheduling them serially and, in builds with thread support,
+ * perform the scheduling tests with components scheduled in parallel
+ * in a separate concurrent isl_ctx.
+ * The dependence graph below has several weakly connected components,
+ * one of which is further split into strongly connected components
+ * that are scheduled separately.
+ * In builds without thread support, the components are always
+ * scheduled serially, even if the schedule_parallel_components option is set.
+ */
+static int test_schedule_parallel(isl_ctx *ctx)
+{
+	const char *str[2];
+	int r;
+
+	str[0] = "[n] -> { A[i] : 0 <= i < n; B[i] : 0 <= i < n; "
+		"C[i, j] : 0 <= i, j < n; D[i] : 0 <= i < n; "
+		"E[i, j] : 0 <= i, j < n; F[i, j] : 0 <= i, j < n }";
+	str[1] = "[n] -> { A[i] -> B[i]; C[i, j] -> C[i, j + 1]; "
+		"D[i] -> D[i + 1]; E[i, j] -> F[j, i]; "
+		"F[i, j] -> F[i + 1, j]; F[i, j] -> E[i, j + 1] }";
+
+	r = check_parallel(ctx, &schedule_components_str, str,
+			    &isl_options_set_schedule_parallel_components,
+			    &isl_options_get_schedule_parallel_components);
+#ifdef USE_THREADS
+	if (r >= 0) {
+		isl_ctx *cctx = isl_ctx_alloc();
+
+		if (isl_ctx_enable_concurrency(cctx) < 0 ||
+		    isl_options_set_schedule_parallel_components(cctx, 1) < 0 ||
+		    isl_options_set_n_threads(cctx, 4) < 0)
+			r = -1;
+		else
+			r = test_schedule(cctx);
+		isl_ctx_free(cctx);
+	}
+#endif
+
+	return r;
+}
+
+/* Inputs for test_schedule_reuse_lp.
+ * "domain", "validity", "coincidence", "condition" and
+ * "conditional_validity" are passed to schedule_str, where
+ * "coincidence", "condition" and "conditional_validity" may be NULL.
+ * "expected" is a substring of the textual representation
+ * of the expected schedule.
+ *
+ * The schedule of the first dependence graph consists
+ * of a single band with three rows, only the first of which
+ * is coincident.  The tableau is therefore reused
+ * both while coincidence constraints are enforced and afterwards.
+ *
+ * In the second dependence graph, the condition dependence
+ * is adjacent to the conditional validity dependence.
+ * Since the conditional validity dependence is violated by the first row,
+ * the condition dependence needs to remain local in the second row,
+ * resulting in two separate bands.
+ */
+static struct {
+	const char *domain;
+	const char *validity;
+	const char *coincidence;
+	const char *condition;
+	const char *conditional_validity;
+	const char *expected;
+} reuse_lp_tests[] = {
+	{ "[n] -> { S[i, j, k] : 0 <= i, j, k < n; T[i, j] : 0 <= i, j < n }",
+	  "[n] -> { S[i, j, k] -> S[i + 1, j, k]; "
+		"S[i, j, k] -> S[i, j + 1, k - 1]; "
+		"S[i, j, k] -> S[i, j, k + 1]; "
+		"S[i, j, k] -> T[i, j] : k = n - 1; "
+		"T[i, j] -> T[i + 1, j + 1] }",
+	  "{ S[i, j, k] -> S[i + 1, j, k]; S[i, j, k] -> S[i, j + 1, k - 1] }",
+	  NULL, NULL,
+	  "coincident: [ 1, 0, 0 ]" },
+	{ "[n] -> { S[i, j] : 0 <= i, j < n }",
+	  "{ S[i, j] -> S[i, j + 1] }",
+	  NULL,
+	  "{ [S[i, j] -> t[]] -> [S[i, j + 1] -> t[]] }",
+	  "{ [S[i, j] -> t[]] -> [S[i - 1, j'] -> t[]] }",
+	  "coincident: [ 1 ], child" },
+};
+
+/* Check that reusing the ILP tableau across the rows of a band
+ * produces exactly the same schedule as constructing it for each row
+ * and that this schedule is the expected one
+ * for each of the inputs in reuse_lp_tests.
+ */
+static int test_schedule_reuse_lp(isl_ctx *ctx)
+{
+	int i;
+	int orig;
+
+	orig = isl_options_get_schedule_reuse_lp(ctx);
+	for (i = 0; i < ARRAY_SIZE(reuse_lp_tests); ++i) {
+		char *fresh, *reused;
+		int equal, expected;
+
+		if (isl_options_set_schedule_reuse_lp(ctx, 0) < 0)
+			return -1;
+		fresh = schedule_str(ctx, reuse_lp_tests[i].domain,
+			reuse_lp_tests[i].validity,
+			reuse_lp_tests[i].coincidence,
+			reuse_lp_tests[i].condition,
+			reuse_lp_tests[i].conditional_validity);
+		reused = NULL;
+		if (isl_options_set_schedule_reuse_lp(ctx, 1) >= 0)
+			reused = schedule_str(ctx, reuse_lp_tests[i].domain,
+				reuse_lp_tests[i].validity,
+				reuse_lp_tests[i].coincidence,
+				reuse_lp_tests[i].condition,
+				reuse_lp_tests[i].conditional_validity);
+		equal = fresh && reused && !strcmp(fresh, reused);
+		expected = reused &&
+			    strstr(reused, reuse_lp_tests[i].expected);
+		free(fresh);
+		free(reused);
+		if (isl_options_set_schedule_reuse_lp(ctx, orig) < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"schedule depends on reuse of ILP tableau",
+				return -1);
+		if (!expected)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected schedule", return -1);
+	}
+
+	return 0;
+}
+
 int test_plain_injective(isl_ctx *ctx, const char *str, int injective)
 {
 	isl_union_map *umap;
@@ -6642,6 +7866,435 @@ static int test_ast_gen(isl_ctx *ctx)
 	return 0;
 }
 
+/* A schedule tree with a wide sequence node,
+ * one of the children of which contains a set node.
+ */
+static const char *parallel_ast_schedule_str =
+	"domain: \"[n] -> { A[i] : 0 <= i < n; B[i, j] : 0 <= i, j < n; "
+		"C[i] : 0 <= i < 2n; D[i] : 0 <= i <= n; E[i] : 0 <= i < 10; "
+		"F[i] : 0 <= i < n; G[i] : 0 <= i < n }\"\n"
+	"child:\n"
+	"  sequence:\n"
+	"  - filter: \"{ A[i] }\"\n"
+	"    child:\n"
+	"      schedule: \"[{ A[i] -> [i] }]\"\n"
+	"  - filter: \"{ B[i, j] }\"\n"
+	"    child:\n"
+	"      schedule: \"[{ B[i, j] -> [i] }, { B[i, j] -> [j] }]\"\n"
+	"  - filter: \"{ C[i] }\"\n"
+	"    child:\n"
+	"      schedule: \"[{ C[i] -> [floor(i/2)] }]\"\n"
+	"  - filter: \"{ D[i]; E[i] }\"\n"
+	"    child:\n"
+	"      schedule: \"[{ D[i] -> [i]; E[i] -> [i] }]\"\n"
+	"      child:\n"
+	"        set:\n"
+	"        - filter: \"{ D[i] }\"\n"
+	"        - filter: \"{ E[i] }\"\n"
+	"  - filter: \"{ F[i] }\"\n"
+	"    child:\n"
+	"      schedule: \"[n] -> [{ F[i] -> [n - i] }]\"\n"
+	"  - filter: \"{ G[i] }\"\n";
+
+/* Generate an AST from "schedule" and return its textual representation.
+ */
+static char *ast_gen_to_str(isl_ctx *ctx, __isl_take isl_schedule *schedule)
+{
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	char *str;
+
+	build = isl_ast_build_alloc(ctx);
+	tree = isl_ast_build_node_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	str = isl_ast_node_to_C_str(tree);
+	isl_ast_node_free(tree);
+
+	return str;
+}
+
+/* Generate an AST from parallel_ast_schedule_str in "ctx" and
+ * return its textual representation.
+ */
+static char *parallel_ast_gen(isl_ctx *ctx, void *user)
+{
+	isl_schedule *schedule;
+
+	schedule = isl_schedule_read_from_str(ctx, parallel_ast_schedule_str);
+	return ast_gen_to_str(ctx, schedule);
+}
+
+/* Generate an AST from "schedule" with and without the AST cache and
+ * check that the results are the same and that
+ * the cache was hit at least "min_hits" times.
+ */
+static int check_ast_gen_cache(isl_ctx *ctx, __isl_take isl_schedule *schedule,
+	unsigned long min_hits)
+{
+	char *uncached, *cached;
+	unsigned long hits;
+	int equal;
+
+	if (isl_options_set_ast_build_cache_size(ctx, 0) < 0)
+		schedule = isl_schedule_free(schedule);
+	uncached = ast_gen_to_str(ctx, isl_schedule_copy(schedule));
+	if (isl_options_set_ast_build_cache_size(ctx, 100) < 0)
+		schedule = isl_schedule_free(schedule);
+	hits = isl_ctx_get_ast_cache_hits(ctx);
+	cached = ast_gen_to_str(ctx, schedule);
+	hits = isl_ctx_get_ast_cache_hits(ctx) - hits;
+	equal = uncached && cached && !strcmp(uncached, cached);
+	free(uncached);
+	free(cached);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"cached result differs from uncached result",
+			return -1);
+	if (hits < min_hits)
+		isl_die(ctx, isl_error_unknown, "unexpected number of hits",
+			return -1);
+
+	return 0;
+}
+
+/* Check that the AST cache produces the same results as
+ * regular AST generation and that the ASTs of the children
+ * of a sequence node that have not been modified are reused.
+ * The schedule is first generated once to fill the cache,
+ * after which all six children should be taken from the cache.
+ * After changing the AST generation type of the band
+ * in the third child, only the other five are taken from the cache.
+ */
+static int test_ast_gen_cache(isl_ctx *ctx)
+{
+	int r;
+	isl_schedule *schedule;
+	isl_schedule_node *node;
+
+	schedule = isl_schedule_read_from_str(ctx, parallel_ast_schedule_str);
+	r = check_ast_gen_cache(ctx, isl_schedule_copy(schedule), 0);
+	if (r >= 0)
+		r = check_ast_gen_cache(ctx, isl_schedule_copy(schedule), 6);
+
+	node = isl_schedule_get_root(schedule);
+	isl_schedule_free(schedule);
+	node = isl_schedule_node_child(node, 0);
+	node = isl_schedule_node_child(node, 2);
+	node = isl_schedule_node_child(node, 0);
+	node = isl_schedule_node_band_member_set_ast_loop_type(node, 0,
+							isl_ast_loop_separate);
+	schedule = isl_schedule_node_get_schedule(node);
+	isl_schedule_node_free(node);
+	if (r >= 0)
+		r = check_ast_gen_cache(ctx, schedule, 5);
+	else
+		isl_schedule_free(schedule);
+
+	isl_ctx_reset_ast_cache(ctx);
+	if (isl_options_set_ast_build_cache_size(ctx, 0) < 0)
+		return -1;
+
+	return r;
+}
+
+/* A schedule tree with a band over three statements with
+ * overlapping domains, with the AST generation option of the band
+ * left to be filled in.
+ */
+static const char *separation_schedule_str =
+	"domain: \"[n] -> { A[i] : 0 <= i < n; B[i] : 2 <= i < n + 3; "
+		"C[i] : 5 <= i < 2n }\"\n"
+	"child:\n"
+	"  schedule: \"[{ A[i] -> [i]; B[i] -> [i]; C[i] -> [i] }]\"\n"
+	"  options: \"{ %s[x] }\"\n"
+	"  child:\n"
+	"    sequence:\n"
+	"    - filter: \"{ A[i] }\"\n"
+	"    - filter: \"{ B[i] }\"\n"
+	"    - filter: \"{ C[i] }\"\n";
+
+/* Generate an AST from separation_schedule_str with
+ * AST generation option "option" and return its textual representation.
+ */
+static char *separation_ast_gen(isl_ctx *ctx, const char *option)
+{
+	char str[1000];
+	isl_schedule *schedule;
+
+	snprintf(str, sizeof(str), separation_schedule_str, option);
+	schedule = isl_schedule_read_from_str(ctx, str);
+	return ast_gen_to_str(ctx, schedule);
+}
+
+/* Check that separation is abandoned in favor of atomic code generation
+ * if it would produce more pieces than allowed by
+ * the ast_build_separation_max_pieces option and
+ * that it is performed as usual if the limit is not exceeded.
+ */
+static int test_ast_gen_separation_max_pieces(isl_ctx *ctx)
+{
+	char *separate, *atomic, *limited;
+	int ok;
+
+	separate = separation_ast_gen(ctx, "separate");
+	atomic = separation_ast_gen(ctx, "atomic");
+	if (isl_options_set_ast_build_separation_max_pieces(ctx, 2) < 0)
+		limited = NULL;
+	else
+		limited = separation_ast_gen(ctx, "separate");
+	ok = separate && atomic && limited &&
+		strcmp(separate, atomic) != 0 && !strcmp(limited, atomic);
+	free(limited);
+	limited = NULL;
+	if (ok &&
+	    isl_options_set_ast_build_separation_max_pieces(ctx, 100) >= 0)
+		limited = separation_ast_gen(ctx, "separate");
+	ok = ok && limited && !strcmp(limited, separate);
+	free(separate);
+	free(atomic);
+	free(limited);
+	if (isl_options_set_ast_build_separation_max_pieces(ctx, 0) < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result of limited separation", return -1);
+
+	return 0;
+}
+
+/* Generate an AST from "schedule" with an AST expression cache
+ * of size "size" and check that the result is equal to "expected".
+ */
+static int check_ast_gen_expr_cache(isl_ctx *ctx,
+	__isl_take isl_schedule *schedule, int size, const char *expected)
+{
+	char *str;
+	int equal;
+
+	if (isl_options_set_ast_build_expr_cache_size(ctx, size) < 0)
+		schedule = isl_schedule_free(schedule);
+	str = ast_gen_to_str(ctx, schedule);
+	equal = str && expected && !strcmp(str, expected);
+	free(str);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"cached result differs from uncached result",
+			return -1);
+
+	return 0;
+}
+
+/* A schedule tree with a band over statements that share a guard
+ * and with loop bounds that are repeated in the children
+ * of a sequence node.
+ */
+static const char *expr_cache_schedule_str =
+	"domain: \"[n, m] -> { A[i, j] : 0 <= i < n and 0 <= j < m and "
+		"m >= 3; B[i, j] : 0 <= i < n and 0 <= j < m and m >= 3; "
+		"C[i, j] : 0 <= i < n and 0 <= j <= i and n <= m }\"\n"
+	"child:\n"
+	"  schedule: \"[{ A[i, j] -> [i]; B[i, j] -> [i]; C[i, j] -> [i] }]\"\n"
+	"  child:\n"
+	"    sequence:\n"
+	"    - filter: \"{ A[i, j] }\"\n"
+	"      child:\n"
+	"        schedule: \"[{ A[i, j] -> [j] }]\"\n"
+	"    - filter: \"{ B[i, j] }\"\n"
+	"      child:\n"
+	"        schedule: \"[{ B[i, j] -> [j] }]\"\n"
+	"    - filter: \"{ C[i, j] }\"\n"
+	"      child:\n"
+	"        schedule: \"[{ C[i, j] -> [j] }]\"\n";
+
+/* Check that generating an AST with an AST expression cache
+ * produces exactly the same result as generating it without,
+ * both for a cache that is large enough to hold all expressions and
+ * for a cache that can only hold a single expression.
+ */
+static int test_ast_gen_expr_cache(isl_ctx *ctx)
+{
+	int i, r = 0;
+	const char *str[] = { parallel_ast_schedule_str,
+				expr_cache_schedule_str };
+
+	for (i = 0; r >= 0 && i < ARRAY_SIZE(str); ++i) {
+		isl_schedule *schedule;
+		char *uncached;
+
+		schedule = isl_schedule_read_from_str(ctx, str[i]);
+		if (isl_options_set_ast_build_expr_cache_size(ctx, 0) < 0)
+			schedule = isl_schedule_free(schedule);
+		uncached = ast_gen_to_str(ctx, isl_schedule_copy(schedule));
+		r = check_ast_gen_expr_cache(ctx, isl_schedule_copy(schedule),
+						100, uncached);
+		if (r >= 0)
+			r = check_ast_gen_expr_cache(ctx,
+				    isl_schedule_copy(schedule), 1, uncached);
+		isl_schedule_free(schedule);
+		free(uncached);
+	}
+
+	if (isl_options_set_ast_build_expr_cache_size(ctx, 0) < 0)
+		return -1;
+
+	return r;
+}
+
+/* Output collected by collect_output.
+ */
+struct isl_test_output {
+	char *str;
+	size_t len;
+};
+
+/* Append the "len" bytes in "buf" to the output collected in "user".
+ */
+static isl_stat collect_output(const char *buf, size_t len, void *user)
+{
+	struct isl_test_output *output = user;
+	char *str;
+
+	str = realloc(output->str, output->len + len + 1);
+	if (!str)
+		return isl_stat_error;
+	memcpy(str + output->len, buf, len);
+	output->len += len;
+	str[output->len] = '\0';
+	output->str = str;
+
+	return isl_stat_ok;
+}
+
+/* Print the AST generated from "schedule" while it is being generated
+ * through a printer that passes its output to collect_output and
+ * return the result.
+ */
+static char *ast_print_stream_to_str(isl_ctx *ctx,
+	__isl_take isl_schedule *schedule)
+{
+	struct isl_test_output output = { NULL, 0 };
+	isl_ast_build *build;
+	isl_ast_print_options *options;
+	isl_printer *p;
+
+	p = isl_printer_to_callback(ctx, &collect_output, &output);
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	build = isl_ast_build_alloc(ctx);
+	options = isl_ast_print_options_alloc(ctx);
+	p = isl_ast_build_print_from_schedule(build, schedule, p, options);
+	isl_ast_build_free(build);
+	if (!p) {
+		free(output.str);
+		return NULL;
+	}
+	isl_printer_free(p);
+
+	return output.str;
+}
+
+/* Check that printing an AST while it is being generated
+ * produces exactly the same result as first generating
+ * the complete AST and then printing it.
+ */
+static int test_ast_print_stream(isl_ctx *ctx)
+{
+	int i;
+	const char *str[] = { parallel_ast_schedule_str,
+				expr_cache_schedule_str,
+				"domain: \"[n] -> { S[i] : 0 <= i < n }\"" };
+
+	for (i = 0; i < ARRAY_SIZE(str); ++i) {
+		isl_schedule *schedule;
+		char *full, *stream;
+		int equal;
+
+		schedule = isl_schedule_read_from_str(ctx, str[i]);
+		full = ast_gen_to_str(ctx, isl_schedule_copy(schedule));
+		stream = ast_print_stream_to_str(ctx, schedule);
+		equal = full && stream && !strcmp(full, stream);
+		free(full);
+		free(stream);
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"streamed AST differs from complete AST",
+				return -1);
+	}
+
+	return 0;
+}
+
+/* Print a sequence of integers that does not fit in a single
+ * output buffer of a printer to a file descriptor and
+ * check that the result is the same as printing them to a string.
+ */
+static int test_printer_fd(isl_ctx *ctx)
+{
+	FILE *file;
+	isl_printer *p, *p_str;
+	char *expected = NULL, *buf = NULL;
+	long len;
+	int i, equal;
+
+	file = tmpfile();
+	if (!file)
+		isl_die(ctx, isl_error_unknown, "unable to open temporary file",
+			return -1);
+	p = isl_printer_to_fd(ctx, fileno(file));
+	p_str = isl_printer_to_str(ctx);
+	for (i = 0; i < 20000; ++i) {
+		p = isl_printer_print_int(p, i);
+		p = isl_printer_print_str(p, " ");
+		p_str = isl_printer_print_int(p_str, i);
+		p_str = isl_printer_print_str(p_str, " ");
+	}
+	p = isl_printer_flush(p);
+	expected = isl_printer_get_str(p_str);
+	isl_printer_free(p_str);
+	if (!p || !expected)
+		goto error;
+	isl_printer_free(p);
+	p = NULL;
+
+	if (fseek(file, 0, SEEK_END) != 0)
+		goto error;
+	len = ftell(file);
+	if (len < 0 || fseek(file, 0, SEEK_SET) != 0)
+		goto error;
+	buf = isl_alloc_array(ctx, char, len + 1);
+	if (!buf || fread(buf, 1, len, file) != (size_t) len)
+		goto error;
+	buf[len] = '\0';
+	equal = !strcmp(buf, expected);
+	free(buf);
+	free(expected);
+	fclose(file);
+
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected output of file descriptor printer",
+			return -1);
+
+	return 0;
+error:
+	isl_printer_free(p);
+	free(buf);
+	free(expected);
+	fclose(file);
+	return -1;
+}
+
+/* Check that generating an AST with the ast_build_parallel option set
+ * produces exactly the same result as generating it without.
+ * In builds without thread support, the AST is always
+ * generated serially, even if the ast_build_parallel option is set.
+ */
+static int test_ast_gen_parallel(isl_ctx *ctx)
+{
+	return check_parallel(ctx, &parallel_ast_gen, NULL,
+				&isl_options_set_ast_build_parallel,
+				&isl_options_get_ast_build_parallel);
+}
+
 /* Check if dropping output dimensions from an isl_pw_multi_aff
  * works properly.
  */
@@ -7340,10 +8993,156 @@ static int test_chambers(isl_ctx *ctx)
 	return 0;
 }
 
+/* Maps that are shared between the threads in test_concurrent.
+ */
+const char *concurrent_tests[] = {
+	"{ A[i] -> B[i + 1] : 0 <= i < 100; A[i] -> B[i - 1] : 50 <= i < 200 }",
+	"{ B[i] -> C[i, j] : 0 <= j <= i < 100 and exists a : i = 2a }",
+	"[n] -> { B[i] -> C[j, i] : 0 <= i, j < n; B[i] -> C[i, i] : i > n }",
+	"{ A[i] -> C[i, i] : 0 <= i < 10; A[i] -> C[i, -i] : 0 <= i < 10 }",
+	"{ A[i] -> A[j] : 0 <= i, j < 10 and i + j >= 3; "
+	  "A[i] -> A[j] : 10 <= i <= 20 and 0 <= j < 10; "
+	  "A[i] -> A[j] : exists a : i = 3a and 2i = 3j + 1 }",
+};
+
+#ifdef USE_THREADS
+#define N_CONCURRENT_THREADS	4
+
+/* Data shared with or produced by a thread in test_concurrent.
+ * "map" contains the shared input maps, while "res" is set
+ * to the result computed by the thread.
+ */
+struct isl_concurrent_data {
+	isl_map **map;
+	isl_map *res;
+};
+
+/* Combine the shared maps in "data" in some arbitrary way,
+ * exercising operations that may update information cached
+ * inside the shared maps.
+ * In particular, the emptiness of the basic maps of each shared map
+ * is checked while other threads may be coalescing the same map
+ * and vice versa.
+ */
+static __isl_give isl_map *combine_concurrent(isl_map **map)
+{
+	int i, j;
+	isl_map *res;
+	isl_id *id;
+
+	for (j = 0; j < 10; ++j) {
+		for (i = 0; i < ARRAY_SIZE(concurrent_tests); ++i) {
+			isl_map *coalesced;
+
+			coalesced = isl_map_coalesce(isl_map_copy(map[i]));
+			if (!coalesced || isl_map_is_empty(map[i]) < 0)
+				return isl_map_free(coalesced);
+			isl_map_free(coalesced);
+		}
+	}
+
+	res = isl_map_apply_range(isl_map_copy(map[0]), isl_map_copy(map[1]));
+	res = isl_map_union(res, isl_map_apply_range(isl_map_copy(map[0]),
+						isl_map_copy(map[2])));
+	res = isl_map_union(res, isl_map_copy(map[3]));
+	for (i = 0; i < ARRAY_SIZE(concurrent_tests); ++i) {
+		isl_basic_map *hull;
+
+		hull = isl_map_simple_hull(isl_map_copy(map[i]));
+		if (isl_basic_map_is_empty(hull) < 0 ||
+		    isl_map_is_empty(map[i]) < 0)
+			res = isl_map_free(res);
+		isl_basic_map_free(hull);
+	}
+	id = isl_id_alloc(isl_map_get_ctx(map[0]), "S", NULL);
+	res = isl_map_set_tuple_id(res, isl_dim_in, id);
+	return isl_map_coalesce(res);
+}
+
+/* Thread entry point of test_concurrent.
+ */
+static void *concurrent_thread(void *user)
+{
+	struct isl_concurrent_data *data = user;
+
+	data->res = combine_concurrent(data->map);
+
+	return NULL;
+}
+
+/* Check that a concurrent isl_ctx can be used by several threads
+ * operating on shared objects at the same time.
+ * The results computed by the threads are compared
+ * to the result computed by the main thread.
+ * The test is performed on a separate isl_ctx "cctx"
+ * since making an isl_ctx concurrent cannot be undone.
+ */
+static int test_concurrent(isl_ctx *ctx)
+{
+	int i, n = ARRAY_SIZE(concurrent_tests);
+	isl_ctx *cctx;
+	isl_map *map[ARRAY_SIZE(concurrent_tests)];
+	isl_map *expected;
+	pthread_t thread[N_CONCURRENT_THREADS];
+	struct isl_concurrent_data data[N_CONCURRENT_THREADS];
+	int ok = 1;
+
+	cctx = isl_ctx_alloc();
+	if (isl_ctx_enable_concurrency(cctx) < 0)
+		goto error;
+	if (isl_ctx_is_concurrent(cctx) != isl_bool_true)
+		goto error;
+
+	for (i = 0; i < n; ++i)
+		map[i] = isl_map_read_from_str(cctx, concurrent_tests[i]);
+
+	for (i = 0; i < N_CONCURRENT_THREADS; ++i) {
+		data[i].map = map;
+		data[i].res = NULL;
+		if (pthread_create(&thread[i], NULL, &concurrent_thread,
+				    &data[i]) != 0)
+			break;
+	}
+	expected = combine_concurrent(map);
+	n = i;
+	for (i = 0; i < n; ++i) {
+		isl_bool equal;
+
+		pthread_join(thread[i], NULL);
+		equal = isl_map_is_equal(data[i].res, expected);
+		if (equal < 0 || !equal)
+			ok = 0;
+		isl_map_free(data[i].res);
+	}
+	isl_map_free(expected);
+	for (i = 0; i < ARRAY_SIZE(concurrent_tests); ++i)
+		isl_map_free(map[i]);
+
+	if (n != N_CONCURRENT_THREADS || !ok)
+		goto error;
+	isl_ctx_free(cctx);
+	return 0;
+error:
+	isl_ctx_free(cctx);
+	return -1;
+}
+#else
+/* Check that an isl_ctx cannot be made concurrent
+ * in a build without thread support.
+ */
+static int test_concurrent(isl_ctx *ctx)
+{
+	if (isl_ctx_is_concurrent(ctx) != isl_bool_false)
+		return -1;
+	return 0;
+}
+#endif
+
 struct {
 	const char *name;
 	int (*fn)(isl_ctx *ctx);
 } tests [] = {
+	{ "concurrency", &test_concurrent },
 	{ "universe", &test_universe },
 	{ "domain hash", &test_domain_hash },
 	{ "dual", &test_dual },
@@ -7363,6 +9162,12 @@ struct {
 	{ "AST", &test_ast },
 	{ "AST build", &test_ast_build },
 	{ "AST generation", &test_ast_gen },
+	{ "parallel AST generation", &test_ast_gen_parallel },
+	{ "AST generation cache", &test_ast_gen_cache },
+	{ "AST separation limit", &test_ast_gen_separation_max_pieces },
+	{ "AST expression cache", &test_ast_gen_expr_cache },
+	{ "streaming AST printing", &test_ast_print_stream },
+	{ "file descriptor printer", &test_printer_fd },
 	{ "eliminate", &test_eliminate },
 	{ "residue class", &test_residue_class },
 	{ "div", &test_div },
@@ -7381,12 +9186,15 @@ struct {
 	{ "injective", &test_injective },
 	{ "schedule (whole component)", &test_schedule_whole },
 	{ "schedule (incremental)", &test_schedule_incremental },
+	{ "schedule (parallel components)", &test_schedule_parallel },
+	{ "schedule (reuse ILP tableau)", &test_schedule_reuse_lp },
 	{ "schedule tree", &test_schedule_tree },
 	{ "schedule tree grouping", &test_schedule_tree_group },
 	{ "tile", &test_tile },
 	{ "union_pw", &test_union_pw },
 	{ "eval", &test_eval },
 	{ "parse", &test_parse },
+	{ "binary format", &test_binary },
 	{ "single-valued", &test_sv },
 	{ "affine hull", &test_affine_hull },
 	{ "simple_hull", &test_simple_hull },
@@ -7397,11 +9205,20 @@ struct {
 	{ "intersect", &test_intersect },
 	{ "lexmin", &test_lexmin },
 	{ "min", &test_min },
+	{ "floating point LP presolve", &test_lp_float_presolve },
 	{ "gist", &test_gist },
+	{ "memo table", &test_memo },
+	{ "profile", &test_profile },
+	{ "budget", &test_budget },
+	{ "arena", &test_arena },
+	{ "blk cache", &test_blk_cache },
 	{ "piecewise quasi-polynomials", &test_pwqp },
 	{ "lift", &test_lift },
 	{ "bound", &test_bound },
 	{ "union", &test_union },
+	{ "union map matching", &test_union_map_match },
+	{ "parallel union map operations", &test_union_map_parallel },
+	{ "parallel dependence analysis", &test_flow_parallel },
 	{ "split periods", &test_split_periods },
 	{ "lexicographic order", &test_lex },
 	{ "bijectivity", &test_bijective },
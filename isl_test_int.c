@@ -11,10 +11,19 @@
 #include <assert.h>
 #include <stdio.h>
 #include <isl_int.h>
+#include <isl_seq.h>
 
 #define ARRAY_SIZE(array) (sizeof(array)/sizeof(*array))
 
 #ifdef USE_SMALL_INT_OPT
+#ifdef USE_GMP_FOR_MP
+#define int_promote(i)		isl_siogmp_promote(i)
+#define int_try_demote(i)	isl_siogmp_try_demote(i)
+#else
+#define int_promote(i)		isl_sioimath_promote(i)
+#define int_try_demote(i)	isl_sioimath_try_demote(i)
+#endif
+
 /* Test whether small and big representation of the same number have the same
  * hash.
  */
@@ -29,8 +38,8 @@ static void int_test_hash(isl_int val)
 	isl_int_init(promoted);
 	isl_int_set(promoted, val);
 
-	isl_sioimath_try_demote(demoted);
-	isl_sioimath_promote(promoted);
+	int_try_demote(demoted);
+	int_promote(promoted);
 
 	assert(isl_int_eq(demoted, promoted));
 
@@ -57,6 +66,10 @@ struct {
 	{ &int_test_hash, "-2147483647" },
 	{ &int_test_hash, "2147483648" },
 	{ &int_test_hash, "-2147483648" },
+	{ &int_test_hash, "4611686018427387903" },
+	{ &int_test_hash, "-4611686018427387903" },
+	{ &int_test_hash, "4611686018427387904" },
+	{ &int_test_hash, "-4611686018427387904" },
 };
 
 static void int_test_single_value()
@@ -89,14 +102,14 @@ static void invoke_alternate_representations_2args(char *arg1, char *arg2,
 		isl_int_read(int2, arg2);
 
 		if (j & 1)
-			isl_sioimath_promote(int1);
+			int_promote(int1);
 		else
-			isl_sioimath_try_demote(int1);
+			int_try_demote(int1);
 
 		if (j & 2)
-			isl_sioimath_promote(int2);
+			int_promote(int2);
 		else
-			isl_sioimath_try_demote(int2);
+			int_try_demote(int2);
 
 		(*fn)(int1, int2);
 	}
@@ -121,19 +134,19 @@ static void invoke_alternate_representations_3args(char *arg1, char *arg2,
 		isl_int_read(int3, arg3);
 
 		if (j & 1)
-			isl_sioimath_promote(int1);
+			int_promote(int1);
 		else
-			isl_sioimath_try_demote(int1);
+			int_try_demote(int1);
 
 		if (j & 2)
-			isl_sioimath_promote(int2);
+			int_promote(int2);
 		else
-			isl_sioimath_try_demote(int2);
+			int_try_demote(int2);
 
 		if (j & 4)
-			isl_sioimath_promote(int3);
+			int_promote(int3);
 		else
-			isl_sioimath_try_demote(int3);
+			int_try_demote(int3);
 
 		(*fn)(int1, int2, int3);
 	}
@@ -294,8 +307,41 @@ static void int_test_mul(isl_int expected, isl_int lhs, isl_int rhs)
 	isl_int_clear(result);
 }
 
+/* Check that adding "lhs * rhs" to "expected" and subtracting it again
+ * results in the original value and that subtracting it from "expected"
+ * results in zero.
+ */
+static void int_test_addmul(isl_int expected, isl_int lhs, isl_int rhs)
+{
+	isl_int result;
+	isl_int_init(result);
+
+	isl_int_set(result, expected);
+	isl_int_addmul(result, lhs, rhs);
+	isl_int_submul(result, lhs, rhs);
+	assert(isl_int_eq(expected, result));
+
+	isl_int_submul(result, lhs, rhs);
+	assert(isl_int_is_zero(result));
+
+	isl_int_addmul(result, lhs, rhs);
+	assert(isl_int_eq(expected, result));
+
+	if (isl_int_fits_ulong(rhs)) {
+		unsigned long rhsulong = isl_int_get_ui(rhs);
+
+		isl_int_submul_ui(result, lhs, rhsulong);
+		assert(isl_int_is_zero(result));
+
+		isl_int_addmul_ui(result, lhs, rhsulong);
+		assert(isl_int_eq(expected, result));
+	}
+
+	isl_int_clear(result);
+}
+
 /* Use a triple that satisfies 'product = factor1 * factor2' to check the
- * operations mul, divexact, tdiv, fdiv and cdiv.
+ * operations mul, addmul, submul, divexact, tdiv, fdiv and cdiv.
  */
 static void int_test_product(isl_int product, isl_int factor1, isl_int factor2)
 {
@@ -304,6 +350,9 @@ static void int_test_product(isl_int product, isl_int factor1, isl_int factor2)
 
 	int_test_mul(product, factor1, factor2);
 	int_test_mul(product, factor2, factor1);
+
+	int_test_addmul(product, factor1, factor2);
+	int_test_addmul(product, factor2, factor1);
 }
 
 static void int_test_add(isl_int expected, isl_int lhs, isl_int rhs)
@@ -504,6 +553,13 @@ struct {
 	{ &int_test_sum, "2147483648", "2147483647", "1" },
 	{ &int_test_sum, "-2147483648", "-2147483647", "-1" },
 
+	{ &int_test_sum, "4611686018427387903",
+	  "2305843009213693951", "2305843009213693952" },
+	{ &int_test_sum, "4611686018427387904", "4611686018427387903", "1" },
+	{ &int_test_sum, "-4611686018427387904", "-4611686018427387903", "-1" },
+	{ &int_test_sum, "9223372036854775806",
+	  "4611686018427387903", "4611686018427387903" },
+
 	{ &int_test_product, "0", "0", "0" },
 	{ &int_test_product, "0", "0", "1" },
 	{ &int_test_product, "1", "1", "1" },
@@ -530,6 +586,17 @@ struct {
 	{ &int_test_product,
 	  "4611686016279904256", "-2147483647", "-2147483648" },
 
+	{ &int_test_product,
+	  "4611686018427387904", "2147483648", "2147483648" },
+	{ &int_test_product,
+	  "-4611686018427387904", "-2147483648", "2147483648" },
+	{ &int_test_product,
+	  "4611686014132420609", "-2147483647", "-2147483647" },
+	{ &int_test_product,
+	  "-4611686018427387903", "-4611686018427387903", "1" },
+	{ &int_test_product,
+	  "9223372036854775806", "4611686018427387903", "2" },
+
 	{ &int_test_product, "85070591730234615847396907784232501249",
 	  "9223372036854775807", "9223372036854775807" },
 	{ &int_test_product, "-85070591730234615847396907784232501249",
@@ -602,6 +669,12 @@ struct {
 	{ &int_test_lcm, "55340232221128654842", "6", "9223372036854775807" },
 	{ &int_test_gcd, "2", "6", "-9223372036854775808" },
 	{ &int_test_lcm, "27670116110564327424", "6", "-9223372036854775808" },
+	{ &int_test_gcd, "4611686018427387903",
+	  "4611686018427387903", "-4611686018427387903" },
+	{ &int_test_lcm, "4611686018427387903",
+	  "4611686018427387903", "-4611686018427387903" },
+	{ &int_test_lcm, "4611686011984936962", "2147483647", "2147483646" },
+	{ &int_test_lcm, "9223372036854775806", "4611686018427387903", "2" },
 	{ &int_test_gcd, "1", "18446744073709551616", "18446744073709551615" },
 	{ &int_test_lcm, "340282366920938463444927863358058659840",
 	  "18446744073709551616", "18446744073709551615" },
@@ -647,11 +720,88 @@ struct {
  * If small integer optimization is enabled, we also test whether the results
  * are the same in small and big representation.
  */
+/* Values used to fill up the sequences in int_test_seq.
+ * They include the boundaries of the ranges that are handled
+ * by the specialized kernels in isl_seq.c.
+ */
+static char *int_seq_values[] = {
+	"0", "1", "-1", "0", "7", "-9", "0", "0",
+	"2147483647", "-2147483647", "2147483648", "-2147483648",
+	"0", "3", "4611686018427387903", "-4611686018427387903",
+	"1073741824", "-1073741824", "0", "12",
+};
+
+/* Check isl_seq_combine, isl_seq_inner_product and isl_seq_first_non_zero
+ * against an element-wise computation on sequences of all lengths
+ * up to ARRAY_SIZE(int_seq_values) starting at various offsets in
+ * int_seq_values.  The multipliers are taken from the same list.
+ */
+static void int_test_seq(void)
+{
+	int i, j, len, off1, off2;
+	int n = ARRAY_SIZE(int_seq_values);
+	isl_int v[2 * ARRAY_SIZE(int_seq_values)];
+	isl_int res[ARRAY_SIZE(int_seq_values)];
+	isl_int prod, expected;
+
+	for (i = 0; i < 2 * n; ++i) {
+		isl_int_init(v[i]);
+		isl_int_read(v[i], int_seq_values[i % n]);
+	}
+	for (i = 0; i < n; ++i)
+		isl_int_init(res[i]);
+	isl_int_init(prod);
+	isl_int_init(expected);
+
+	for (len = 0; len <= n; ++len)
+	for (off1 = 0; off1 < n; ++off1)
+	for (off2 = 0; off2 < n; off2 += 3) {
+		isl_int *src1 = v + off1;
+		isl_int *src2 = v + off2;
+		isl_int *m1 = &v[(off1 + off2) % n];
+		isl_int *m2 = &v[(off1 + 5) % n];
+
+		isl_seq_combine(res, *m1, src1, *m2, src2, len);
+		for (i = 0; i < len; ++i) {
+			isl_int_mul(expected, *m1, src1[i]);
+			isl_int_addmul(expected, *m2, src2[i]);
+			assert(isl_int_eq(expected, res[i]));
+		}
+
+		isl_seq_inner_product(src1, src2, len, &prod);
+		isl_int_set_si(expected, 0);
+		for (i = 0; i < len; ++i)
+			isl_int_addmul(expected, src1[i], src2[i]);
+		assert(isl_int_eq(expected, prod));
+
+		j = isl_seq_first_non_zero(src1, len);
+		for (i = 0; i < len; ++i)
+			if (!isl_int_is_zero(src1[i]))
+				break;
+		assert(j == (i < len ? i : -1));
+	}
+
+	isl_seq_clr(res, n);
+#ifdef USE_SMALL_INT_OPT
+	int_promote(res[6]);
+#endif
+	isl_int_set_si(res[9], 5);
+	assert(isl_seq_first_non_zero(res, n) == 9);
+
+	for (i = 0; i < 2 * n; ++i)
+		isl_int_clear(v[i]);
+	for (i = 0; i < n; ++i)
+		isl_int_clear(res[i]);
+	isl_int_clear(prod);
+	isl_int_clear(expected);
+}
+
 int main()
 {
 	int i;
 
 	int_test_single_value();
+	int_test_seq();
 
 	for (i = 0; i < ARRAY_SIZE(int_unary_tests); i += 1) {
 		invoke_alternate_representations_2args(
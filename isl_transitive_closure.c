@@ -19,6 +19,7 @@
 #include <isl_vec_private.h>
 #include <isl_options_private.h>
 #include <isl_tarjan.h>
+#include <isl_profile_private.h>
 
 int isl_map_is_transitively_closed(__isl_keep isl_map *map)
 {
@@ -2532,7 +2533,7 @@ error:
  * it to project out the lengths of the paths instead of equating
  * the length to a parameter.
  */
-__isl_give isl_map *isl_map_transitive_closure(__isl_take isl_map *map,
+static __isl_give isl_map *map_transitive_closure(__isl_take isl_map *map,
 	int *exact)
 {
 	isl_space *target_dim;
@@ -2565,6 +2566,26 @@ error:
 	return NULL;
 }
 
+/* Compute the transitive closure of "map", or an overapproximation,
+ * profiling the operation if requested.
+ */
+__isl_give isl_map *isl_map_transitive_closure(__isl_take isl_map *map,
+	int *exact)
+{
+	isl_ctx *ctx;
+	struct isl_profile_scope scope;
+
+	if (!map)
+		return NULL;
+
+	ctx = isl_map_get_ctx(map);
+	isl_profile_enter(ctx, "isl_map_transitive_closure", &scope);
+	map = map_transitive_closure(map, exact);
+	isl_profile_leave(ctx, &scope);
+
+	return map;
+}
+
 static isl_stat inc_count(__isl_take isl_map *map, void *user)
 {
 	int *n = user;
@@ -14,6 +14,8 @@
  */
 
 #define ISL_DIM_H
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
 #include <isl_map_private.h>
 #include <isl_union_map_private.h>
 #include <isl/ctx.h>
@@ -24,6 +26,7 @@
 #include <isl_space_private.h>
 #include <isl/union_set.h>
 #include <isl_maybe_map.h>
+#include <isl_parallel.h>
 
 #include <bset_from_bmap.c>
 #include <set_to_map.c>
@@ -194,13 +197,16 @@ error:
 
 __isl_give isl_union_map *isl_union_map_cow(__isl_take isl_union_map *umap)
 {
+	isl_union_map *dup;
+
 	if (!umap)
 		return NULL;
 
-	if (umap->ref == 1)
+	if (isl_atomic_get(&umap->ref) == 1)
 		return umap;
-	umap->ref--;
-	return isl_union_map_dup(umap);
+	dup = isl_union_map_dup(umap);
+	isl_union_map_free(umap);
+	return dup;
 }
 
 struct isl_union_align {
@@ -308,7 +314,7 @@ __isl_give isl_union_map *isl_union_map_copy(__isl_keep isl_union_map *umap)
 	if (!umap)
 		return NULL;
 
-	umap->ref++;
+	isl_atomic_inc(&umap->ref);
 	return umap;
 }
 
@@ -322,7 +328,7 @@ __isl_null isl_union_map *isl_union_map_free(__isl_take isl_union_map *umap)
 	if (!umap)
 		return NULL;
 
-	if (--umap->ref > 0)
+	if (isl_atomic_dec(&umap->ref) > 0)
 		return NULL;
 
 	isl_hash_table_foreach(umap->dim->ctx, &umap->table,
@@ -667,6 +673,161 @@ isl_stat isl_union_set_foreach_point(__isl_keep isl_union_set *uset,
 	return isl_union_set_foreach_set(uset, &foreach_point, &data);
 }
 
+/* Collector of the maps produced by a binary operation on union maps.
+ * If "collect" is not set, then the maps are added to "umap" directly.
+ * Otherwise, they are appended to "list" such that they can be
+ * added to the final result later on, in the same order.
+ */
+struct isl_union_map_bin_res {
+	int collect;
+	isl_union_map *umap;
+	isl_map_list *list;
+};
+
+/* Add "map" to the maps collected in "res".
+ */
+static isl_stat bin_res_add(struct isl_union_map_bin_res *res,
+	__isl_take isl_map *map)
+{
+	if (res->collect) {
+		res->list = isl_map_list_add(res->list, map);
+		return res->list ? isl_stat_ok : isl_stat_error;
+	}
+	res->umap = isl_union_map_add_map(res->umap, map);
+	return res->umap ? isl_stat_ok : isl_stat_error;
+}
+
+/* Internal data structure for bin_foreach.
+ * "fn" is called on each map in the first argument of a binary operation,
+ * with extra argument "user", and adds the maps it produces to "res".
+ * If the maps in the first argument are handled in parallel,
+ * then "maps" contains those "n" maps in the order in which
+ * they are visited by isl_hash_table_foreach and
+ * "lists" collects the maps produced for each of them.
+ */
+struct isl_union_map_bin_foreach_data {
+	isl_stat (*fn)(__isl_keep isl_map *map,
+		struct isl_union_map_bin_res *res, void *user);
+	void *user;
+	struct isl_union_map_bin_res *res;
+
+	int n;
+	isl_map **maps;
+	isl_map_list **lists;
+};
+
+/* isl_hash_table_foreach callback for bin_foreach in the serial case.
+ */
+static isl_stat bin_foreach_entry(void **entry, void *user)
+{
+	struct isl_union_map_bin_foreach_data *data = user;
+
+	return data->fn(*entry, data->res, data->user);
+}
+
+/* isl_hash_table_foreach callback for bin_foreach_parallel
+ * that appends the map that "entry" points to to data->maps.
+ */
+static isl_stat bin_foreach_collect(void **entry, void *user)
+{
+	struct isl_union_map_bin_foreach_data *data = user;
+
+	data->maps[data->n++] = *entry;
+
+	return isl_stat_ok;
+}
+
+/* isl_parallel_for callback for bin_foreach_parallel.
+ * Call data->fn on the map at position "i" in data->maps and
+ * keep track of the maps it produces in data->lists[i].
+ */
+static isl_stat bin_foreach_task(int i, void *user)
+{
+	struct isl_union_map_bin_foreach_data *data = user;
+	struct isl_union_map_bin_res res = { 1, NULL, NULL };
+	isl_stat r;
+
+	res.list = isl_map_list_alloc(isl_map_get_ctx(data->maps[i]), 0);
+	if (!res.list)
+		return isl_stat_error;
+	r = data->fn(data->maps[i], &res, data->user);
+	data->lists[i] = res.list;
+
+	return r;
+}
+
+/* Call data->fn on each map in "umap" in parallel and
+ * add the results to data->res.
+ *
+ * The maps produced for each map in "umap" are collected separately and
+ * only added to data->res once all of them have been computed,
+ * in the order in which isl_hash_table_foreach visits the maps in "umap".
+ * This ensures that data->res ends up being exactly the same
+ * as when data->fn is called on the maps in "umap" one by one.
+ */
+static isl_stat bin_foreach_parallel(__isl_keep isl_union_map *umap,
+	struct isl_union_map_bin_foreach_data *data)
+{
+	isl_ctx *ctx = isl_union_map_get_ctx(umap);
+	int i, j, n = umap->table.n;
+	isl_stat r = isl_stat_ok;
+
+	data->n = 0;
+	data->maps = isl_alloc_array(ctx, isl_map *, n);
+	data->lists = isl_calloc_array(ctx, isl_map_list *, n);
+	if (!data->maps || !data->lists)
+		r = isl_stat_error;
+	if (r >= 0)
+		r = isl_hash_table_foreach(ctx, &umap->table,
+					    &bin_foreach_collect, data);
+	if (r >= 0)
+		r = isl_parallel_for(ctx, n, &bin_foreach_task, data);
+	for (i = 0; r >= 0 && i < n; ++i) {
+		int n_map = isl_map_list_n_map(data->lists[i]);
+
+		for (j = 0; r >= 0 && j < n_map; ++j) {
+			isl_map *map;
+
+			map = isl_map_list_get_map(data->lists[i], j);
+			r = bin_res_add(data->res, map);
+		}
+	}
+
+	for (i = 0; data->lists && i < n; ++i)
+		isl_map_list_free(data->lists[i]);
+	free(data->lists);
+	free(data->maps);
+
+	return r;
+}
+
+/* Call "fn" on each map in "umap", the first argument
+ * of a binary operation, with extra argument "user" and
+ * add the maps it produces to "res".
+ *
+ * If the union_map_parallel option is set and if
+ * the maps in "umap" can be handled by several threads,
+ * then do so in bin_foreach_parallel.
+ * "fn" may then be called concurrently on different maps in "umap",
+ * but each call adds its results to a separate collector.
+ */
+static isl_stat bin_foreach(__isl_keep isl_union_map *umap,
+	isl_stat (*fn)(__isl_keep isl_map *map,
+		struct isl_union_map_bin_res *res, void *user),
+	void *user, struct isl_union_map_bin_res *res)
+{
+	isl_ctx *ctx;
+	struct isl_union_map_bin_foreach_data data = { fn, user, res };
+
+	ctx = isl_union_map_get_ctx(umap);
+	if (ctx->opt->union_map_parallel &&
+	    isl_parallel_n_threads(ctx, umap->table.n) > 1)
+		return bin_foreach_parallel(umap, &data);
+
+	return isl_hash_table_foreach(ctx, &umap->table,
+				      &bin_foreach_entry, &data);
+}
+
 /* Data structure that specifies how gen_bin_op should
  * construct results from the inputs.
  *
@@ -695,26 +856,24 @@ struct isl_bin_op_control {
 /* Internal data structure for gen_bin_op.
  * "control" specifies how the maps in the result should be constructed.
  * "umap2" is a pointer to the second argument.
- * "res" collects the results.
  */
 struct isl_union_map_gen_bin_data {
 	struct isl_bin_op_control *control;
 	isl_union_map *umap2;
-	isl_union_map *res;
 };
 
-/* Add a copy of "map" to "res" and return the result.
+/* Add a copy of "map" to "res".
  */
-static __isl_give isl_union_map *bin_add_map(__isl_take isl_union_map *res,
+static isl_stat bin_add_map(struct isl_union_map_bin_res *res,
 	__isl_keep isl_map *map)
 {
-	return isl_union_map_add_map(res, isl_map_copy(map));
+	return bin_res_add(res, isl_map_copy(map));
 }
 
-/* Combine "map1" and "map2", add the result to "res" and return the result.
+/* Combine "map1" and "map2" and add the result to "res".
  * Check whether the result is empty before adding it to "res".
  */
-static __isl_give isl_union_map *bin_add_pair(__isl_take isl_union_map *res,
+static isl_stat bin_add_pair(struct isl_union_map_bin_res *res,
 	__isl_keep isl_map *map1, __isl_keep isl_map *map2,
 	struct isl_union_map_gen_bin_data *data)
 {
@@ -726,10 +885,10 @@ static __isl_give isl_union_map *bin_add_pair(__isl_take isl_union_map *res,
 	if (empty < 0 || empty) {
 		isl_map_free(map);
 		if (empty < 0)
-			return isl_union_map_free(res);
-		return res;
+			return isl_stat_error;
+		return isl_stat_ok;
 	}
-	return isl_union_map_add_map(res, map);
+	return bin_res_add(res, map);
 }
 
 /* Dummy match_space function that simply returns the input space.
@@ -781,19 +940,18 @@ static __isl_keep isl_maybe_isl_map bin_try_get_match(
 	return res;
 }
 
-/* isl_hash_table_foreach callback for gen_bin_op.
- * Look for the map in data->umap2 that corresponds
- * to the map that "entry" points to, apply the binary operation and
- * add the result to data->res.
+/* bin_foreach callback for gen_bin_op.
+ * Look for the map in data->umap2 that corresponds to "map",
+ * apply the binary operation and add the result to "res".
  *
  * If no corresponding map can be found, then the effect depends
  * on data->control->subtract.  If it is set, then the current map
  * is added directly to the result.  Otherwise, it is ignored.
  */
-static isl_stat gen_bin_entry(void **entry, void *user)
+static isl_stat gen_bin_entry(__isl_keep isl_map *map,
+	struct isl_union_map_bin_res *res, void *user)
 {
 	struct isl_union_map_gen_bin_data *data = user;
-	isl_map *map = *entry;
 	isl_maybe_isl_map m;
 
 	m = bin_try_get_match(data, map);
@@ -803,13 +961,9 @@ static isl_stat gen_bin_entry(void **entry, void *user)
 		return isl_stat_ok;
 
 	if (!m.valid)
-		data->res = bin_add_map(data->res, map);
+		return bin_add_map(res, map);
 	else
-		data->res = bin_add_pair(data->res, map, m.value, data);
-	if (!data->res)
-		return isl_stat_error;
-
-	return isl_stat_ok;
+		return bin_add_pair(res, map, m.value, data);
 }
 
 /* Apply a binary operation to "umap1" and "umap2" based on "control".
@@ -819,7 +973,8 @@ static isl_stat gen_bin_entry(void **entry, void *user)
 static __isl_give isl_union_map *gen_bin_op(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2, struct isl_bin_op_control *control)
 {
-	struct isl_union_map_gen_bin_data data = { control, NULL, NULL };
+	struct isl_union_map_gen_bin_data data = { control, NULL };
+	struct isl_union_map_bin_res res = { 0, NULL, NULL };
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -828,19 +983,18 @@ static __isl_give isl_union_map *gen_bin_op(__isl_take isl_union_map *umap1,
 		goto error;
 
 	data.umap2 = umap2;
-	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
+	res.umap = isl_union_map_alloc(isl_space_copy(umap1->dim),
 				       umap1->table.n);
-	if (isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
-				   &gen_bin_entry, &data) < 0)
+	if (bin_foreach(umap1, &gen_bin_entry, &data, &res) < 0)
 		goto error;
 
 	isl_union_map_free(umap1);
 	isl_union_map_free(umap2);
-	return data.res;
+	return res.umap;
 error:
 	isl_union_map_free(umap1);
 	isl_union_map_free(umap2);
-	isl_union_map_free(data.res);
+	isl_union_map_free(res.umap);
 	return NULL;
 }
 
@@ -960,16 +1114,15 @@ static __isl_give isl_union_map *union_map_gist_params(
 
 struct isl_union_map_match_bin_data {
 	isl_union_map *umap2;
-	isl_union_map *res;
 	__isl_give isl_map *(*fn)(__isl_take isl_map*, __isl_take isl_map*);
 };
 
-static isl_stat match_bin_entry(void **entry, void *user)
+static isl_stat match_bin_entry(__isl_keep isl_map *map,
+	struct isl_union_map_bin_res *res, void *user)
 {
 	struct isl_union_map_match_bin_data *data = user;
 	uint32_t hash;
 	struct isl_hash_table_entry *entry2;
-	isl_map *map = *entry;
 	int empty;
 
 	hash = isl_space_get_hash(map->dim);
@@ -991,16 +1144,15 @@ static isl_stat match_bin_entry(void **entry, void *user)
 		return isl_stat_ok;
 	}
 
-	data->res = isl_union_map_add_map(data->res, map);
-
-	return isl_stat_ok;
+	return bin_res_add(res, map);
 }
 
 static __isl_give isl_union_map *match_bin_op(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2,
 	__isl_give isl_map *(*fn)(__isl_take isl_map*, __isl_take isl_map*))
 {
-	struct isl_union_map_match_bin_data data = { NULL, NULL, fn };
+	struct isl_union_map_match_bin_data data = { NULL, fn };
+	struct isl_union_map_bin_res res = { 0, NULL, NULL };
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -1009,19 +1161,18 @@ static __isl_give isl_union_map *match_bin_op(__isl_take isl_union_map *umap1,
 		goto error;
 
 	data.umap2 = umap2;
-	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
+	res.umap = isl_union_map_alloc(isl_space_copy(umap1->dim),
 				       umap1->table.n);
-	if (isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
-				   &match_bin_entry, &data) < 0)
+	if (bin_foreach(umap1, &match_bin_entry, &data, &res) < 0)
 		goto error;
 
 	isl_union_map_free(umap1);
 	isl_union_map_free(umap2);
-	return data.res;
+	return res.umap;
 error:
 	isl_union_map_free(umap1);
 	isl_union_map_free(umap2);
-	isl_union_map_free(data.res);
+	isl_union_map_free(res.umap);
 	return NULL;
 }
 
@@ -1292,9 +1443,184 @@ __isl_give isl_union_map *isl_union_map_intersect_range_factor_range(
 	return gen_bin_op(umap, factor, &control);
 }
 
+/* A group of maps in a union map that all have the same tuple
+ * of the type on which the union map is indexed.
+ * "map" contains the "n" maps in the group, in the order in which
+ * they are visited by isl_hash_table_foreach, and has room for "size" maps.
+ * The maps are not referenced by the group.
+ */
+struct isl_union_map_tuple_group {
+	int n;
+	int size;
+	isl_map **map;
+};
+
+/* An index on the maps in a union map, grouping them
+ * by their "type" tuple, with "type" equal to isl_dim_in or isl_dim_out.
+ * "table" maps a hash of a tuple to the corresponding group.
+ */
+struct isl_union_map_tuple_index {
+	isl_ctx *ctx;
+	enum isl_dim_type type;
+	struct isl_hash_table table;
+};
+
+/* Return the hash value of the "type" tuple of "map",
+ * with "type" equal to isl_dim_in or isl_dim_out.
+ */
+static uint32_t tuple_hash(__isl_keep isl_map *map, enum isl_dim_type type)
+{
+	if (type == isl_dim_in)
+		return isl_space_get_domain_hash(map->dim);
+	return isl_space_get_range_hash(map->dim);
+}
+
+/* A tuple that is being looked up in an isl_union_map_tuple_index.
+ * "map" is a map that has the tuple as its "type" tuple.
+ * "index_type" is the type of the tuples on which the index is built.
+ */
+struct isl_union_map_tuple_key {
+	isl_map *map;
+	enum isl_dim_type type;
+	enum isl_dim_type index_type;
+};
+
+/* Is the tuple shared by the maps in the group "entry"
+ * equal to the tuple described by the isl_union_map_tuple_key "val"?
+ */
+static int has_tuple(const void *entry, const void *val)
+{
+	const struct isl_union_map_tuple_group *group = entry;
+	const struct isl_union_map_tuple_key *key = val;
+
+	return isl_space_tuple_is_equal(group->map[0]->dim, key->index_type,
+					key->map->dim, key->type) == isl_bool_true;
+}
+
+/* Look for the group in "index" of maps with a tuple that is equal
+ * to the "type" tuple of "map".
+ * If "reserve" is set, then create an empty entry for the group
+ * if it does not exist yet.
+ */
+static struct isl_hash_table_entry *tuple_index_find(
+	struct isl_union_map_tuple_index *index, __isl_keep isl_map *map,
+	enum isl_dim_type type, int reserve)
+{
+	struct isl_union_map_tuple_key key = { map, type, index->type };
+
+	return isl_hash_table_find(index->ctx, &index->table, tuple_hash(map, type),
+				   &has_tuple, &key, reserve);
+}
+
+/* isl_hash_table_foreach callback for tuple_index_build.
+ * Add the map that "entry" points to to the group of maps
+ * with the same tuple in the isl_union_map_tuple_index "user",
+ * creating the group if needed.
+ */
+static isl_stat tuple_index_add(void **entry, void *user)
+{
+	struct isl_union_map_tuple_index *index = user;
+	isl_map *map = *entry;
+	isl_ctx *ctx = isl_map_get_ctx(map);
+	struct isl_hash_table_entry *group_entry;
+	struct isl_union_map_tuple_group *group;
+
+	group_entry = tuple_index_find(index, map, index->type, 1);
+	if (!group_entry)
+		return isl_stat_error;
+	if (!group_entry->data) {
+		group = isl_calloc_type(ctx, struct isl_union_map_tuple_group);
+		if (!group)
+			return isl_stat_error;
+		group_entry->data = group;
+	}
+	group = group_entry->data;
+	if (group->n >= group->size) {
+		int size = 2 * group->size + 1;
+		isl_map **list;
+
+		list = isl_realloc_array(ctx, group->map, isl_map *, size);
+		if (!list)
+			return isl_stat_error;
+		group->map = list;
+		group->size = size;
+	}
+	group->map[group->n++] = map;
+
+	return isl_stat_ok;
+}
+
+/* isl_hash_table_foreach callback for tuple_index_free.
+ */
+static isl_stat free_tuple_group(void **entry, void *user)
+{
+	struct isl_union_map_tuple_group *group = *entry;
+
+	if (!group)
+		return isl_stat_ok;
+	free(group->map);
+	free(group);
+	return isl_stat_ok;
+}
+
+/* Free "index" along with the groups it contains.
+ */
+static struct isl_union_map_tuple_index *tuple_index_free(
+	struct isl_union_map_tuple_index *index)
+{
+	if (!index)
+		return NULL;
+	isl_hash_table_foreach(index->ctx, &index->table,
+				&free_tuple_group, NULL);
+	isl_hash_table_clear(&index->table);
+	free(index);
+	return NULL;
+}
+
+/* Construct an index on the maps in "umap" that groups them
+ * by their "type" tuple, with "type" equal to isl_dim_in or isl_dim_out.
+ * Within each group, the maps appear in the same order
+ * as in a traversal of "umap" using isl_hash_table_foreach.
+ */
+static struct isl_union_map_tuple_index *tuple_index_build(
+	__isl_keep isl_union_map *umap, enum isl_dim_type type)
+{
+	isl_ctx *ctx;
+	struct isl_union_map_tuple_index *index;
+
+	if (!umap)
+		return NULL;
+	ctx = isl_union_map_get_ctx(umap);
+	index = isl_calloc_type(ctx, struct isl_union_map_tuple_index);
+	if (!index)
+		return NULL;
+	index->ctx = ctx;
+	index->type = type;
+	if (isl_hash_table_init(ctx, &index->table, umap->table.n) < 0) {
+		free(index);
+		return NULL;
+	}
+	if (isl_hash_table_foreach(ctx, &umap->table,
+				   &tuple_index_add, index) < 0)
+		return tuple_index_free(index);
+
+	return index;
+}
+
+/* Internal data structure for bin_op.
+ * "umap2" is a pointer to the second argument.
+ * "fn" is called on each map in "umap2" for the current map "map"
+ * in the first argument and adds its results to "res".
+ * If "index" is not NULL, then "fn" only needs to be called
+ * on the maps in "umap2" that have a tuple (as specified by "index")
+ * that is equal to the "type" tuple of "map".
+ * "index" then contains the maps in "umap2" grouped by that tuple.
+ */
 struct isl_union_map_bin_data {
 	isl_union_map *umap2;
-	isl_union_map *res;
+	struct isl_union_map_tuple_index *index;
+	enum isl_dim_type type;
+	struct isl_union_map_bin_res *res;
 	isl_map *map;
 	isl_stat (*fn)(void **entry, void *user);
 };
@@ -1321,29 +1647,79 @@ static isl_stat apply_range_entry(void **entry, void *user)
 		return isl_stat_ok;
 	}
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
-static isl_stat bin_entry(void **entry, void *user)
+/* Call data->fn on each map in the group of data->index
+ * with a tuple equal to the data->type tuple of data->map, if any.
+ */
+static isl_stat bin_entry_indexed(struct isl_union_map_bin_data *data)
 {
-	struct isl_union_map_bin_data *data = user;
-	isl_map *map = *entry;
+	int i;
+	struct isl_hash_table_entry *entry;
+	struct isl_union_map_tuple_group *group;
+
+	entry = tuple_index_find(data->index, data->map, data->type, 0);
+	if (!entry)
+		return isl_stat_ok;
+	group = entry->data;
+	for (i = 0; i < group->n; ++i) {
+		void *map2 = group->map[i];
+
+		if (data->fn(&map2, data) < 0)
+			return isl_stat_error;
+	}
 
-	data->map = map;
-	if (isl_hash_table_foreach(data->umap2->dim->ctx, &data->umap2->table,
-				   data->fn, data) < 0)
+	return isl_stat_ok;
+}
+
+/* bin_foreach callback for bin_op.
+ * Call data->fn on each map in data->umap2 for the current map "map"
+ * of the first argument, adding the results to "res".
+ * If data->index is set, then only the maps in data->umap2
+ * that can be combined with "map" need to be considered.
+ * They are considered in the same order.
+ * Since this function may be called concurrently on several maps
+ * of the first argument, the per-map information is kept
+ * in a local copy of "data".
+ */
+static isl_stat bin_entry(__isl_keep isl_map *map,
+	struct isl_union_map_bin_res *res, void *user)
+{
+	struct isl_union_map_bin_data *shared = user;
+	struct isl_union_map_bin_data data = *shared;
+
+	data.map = map;
+	data.res = res;
+	if (data.index)
+		return bin_entry_indexed(&data);
+	if (isl_hash_table_foreach(data.umap2->dim->ctx, &data.umap2->table,
+				   data.fn, &data) < 0)
 		return isl_stat_error;
 
 	return isl_stat_ok;
 }
 
-static __isl_give isl_union_map *bin_op(__isl_take isl_union_map *umap1,
+/* Apply "fn" to each pair of maps in "umap1" and "umap2" and
+ * collect the results.
+ *
+ * If "type1" is not isl_dim_all, then only pairs of maps
+ * where the "type1" tuple of the map in "umap1" is equal to
+ * the "type2" tuple of the map in "umap2" can produce any results.
+ * In this case, the maps in "umap2" are first grouped by their "type2" tuple
+ * such that each map in "umap1" only needs to be combined
+ * with the group of maps that have a matching tuple.
+ * Apart from the omitted calls on incompatible pairs,
+ * "fn" is called in the same order.
+ */
+static __isl_give isl_union_map *bin_op_match(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2,
+	enum isl_dim_type type1, enum isl_dim_type type2,
 	isl_stat (*fn)(void **entry, void *user))
 {
-	struct isl_union_map_bin_data data = { NULL, NULL, NULL, fn };
+	struct isl_union_map_bin_data data = { NULL, NULL, type1, NULL, NULL,
+						fn };
+	struct isl_union_map_bin_res res = { 0, NULL, NULL };
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -1352,26 +1728,46 @@ static __isl_give isl_union_map *bin_op(__isl_take isl_union_map *umap1,
 		goto error;
 
 	data.umap2 = umap2;
-	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
+	if (type1 != isl_dim_all) {
+		data.index = tuple_index_build(umap2, type2);
+		if (!data.index)
+			goto error;
+	}
+	res.umap = isl_union_map_alloc(isl_space_copy(umap1->dim),
 				       umap1->table.n);
-	if (isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
-				   &bin_entry, &data) < 0)
+	if (bin_foreach(umap1, &bin_entry, &data, &res) < 0)
 		goto error;
 
+	tuple_index_free(data.index);
 	isl_union_map_free(umap1);
 	isl_union_map_free(umap2);
-	return data.res;
+	return res.umap;
 error:
+	tuple_index_free(data.index);
 	isl_union_map_free(umap1);
 	isl_union_map_free(umap2);
-	isl_union_map_free(data.res);
+	isl_union_map_free(res.umap);
 	return NULL;
 }
 
+/* Apply "fn" to each pair of maps in "umap1" and "umap2" and
+ * collect the results.
+ */
+static __isl_give isl_union_map *bin_op(__isl_take isl_union_map *umap1,
+	__isl_take isl_union_map *umap2,
+	isl_stat (*fn)(void **entry, void *user))
+{
+	return bin_op_match(umap1, umap2, isl_dim_all, isl_dim_all, fn);
+}
+
+/* Compose each map in "umap1" with the maps in "umap2"
+ * that have a domain equal to its range.
+ */
 __isl_give isl_union_map *isl_union_map_apply_range(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &apply_range_entry);
+	return bin_op_match(umap1, umap2, isl_dim_out, isl_dim_in,
+			    &apply_range_entry);
 }
 
 __isl_give isl_union_map *isl_union_map_apply_domain(
@@ -1399,15 +1795,14 @@ static isl_stat map_lex_lt_entry(void **entry, void *user)
 
 	map2 = isl_map_lex_lt_map(isl_map_copy(data->map), isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 __isl_give isl_union_map *isl_union_map_lex_lt_union_map(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &map_lex_lt_entry);
+	return bin_op_match(umap1, umap2, isl_dim_out, isl_dim_out,
+			    &map_lex_lt_entry);
 }
 
 static isl_stat map_lex_le_entry(void **entry, void *user)
@@ -1421,15 +1816,14 @@ static isl_stat map_lex_le_entry(void **entry, void *user)
 
 	map2 = isl_map_lex_le_map(isl_map_copy(data->map), isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 __isl_give isl_union_map *isl_union_map_lex_le_union_map(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &map_lex_le_entry);
+	return bin_op_match(umap1, umap2, isl_dim_out, isl_dim_out,
+			    &map_lex_le_entry);
 }
 
 static isl_stat product_entry(void **entry, void *user)
@@ -1439,9 +1833,7 @@ static isl_stat product_entry(void **entry, void *user)
 
 	map2 = isl_map_product(isl_map_copy(data->map), isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 __isl_give isl_union_map *isl_union_map_product(__isl_take isl_union_map *umap1,
@@ -1457,9 +1849,7 @@ static isl_stat set_product_entry(void **entry, void *user)
 
 	set2 = isl_set_product(isl_set_copy(data->map), isl_set_copy(set2));
 
-	data->res = isl_union_set_add_set(data->res, set2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, set_to_map(set2));
 }
 
 __isl_give isl_union_set *isl_union_set_product(__isl_take isl_union_set *uset1,
@@ -1480,9 +1870,7 @@ static isl_stat domain_product_entry(void **entry, void *user)
 	map2 = isl_map_domain_product(isl_map_copy(data->map),
 				     isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 /* Given two maps A -> B and C -> D, construct a map [A -> C] -> (B * D)
@@ -1490,7 +1878,8 @@ static isl_stat domain_product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_domain_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &domain_product_entry);
+	return bin_op_match(umap1, umap2, isl_dim_out, isl_dim_out,
+			    &domain_product_entry);
 }
 
 static isl_stat range_product_entry(void **entry, void *user)
@@ -1505,15 +1894,14 @@ static isl_stat range_product_entry(void **entry, void *user)
 	map2 = isl_map_range_product(isl_map_copy(data->map),
 				     isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 __isl_give isl_union_map *isl_union_map_range_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &range_product_entry);
+	return bin_op_match(umap1, umap2, isl_dim_in, isl_dim_in,
+			    &range_product_entry);
 }
 
 /* If data->map A -> B and "map2" C -> D have the same range space,
@@ -1531,9 +1919,7 @@ static isl_stat flat_domain_product_entry(void **entry, void *user)
 	map2 = isl_map_flat_domain_product(isl_map_copy(data->map),
 					  isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 /* Given two maps A -> B and C -> D, construct a map (A, C) -> (B * D).
@@ -1541,7 +1927,8 @@ static isl_stat flat_domain_product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_flat_domain_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &flat_domain_product_entry);
+	return bin_op_match(umap1, umap2, isl_dim_out, isl_dim_out,
+			    &flat_domain_product_entry);
 }
 
 static isl_stat flat_range_product_entry(void **entry, void *user)
@@ -1556,15 +1943,14 @@ static isl_stat flat_range_product_entry(void **entry, void *user)
 	map2 = isl_map_flat_range_product(isl_map_copy(data->map),
 					  isl_map_copy(map2));
 
-	data->res = isl_union_map_add_map(data->res, map2);
-
-	return isl_stat_ok;
+	return bin_res_add(data->res, map2);
 }
 
 __isl_give isl_union_map *isl_union_map_flat_range_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &flat_range_product_entry);
+	return bin_op_match(umap1, umap2, isl_dim_in, isl_dim_in,
+			    &flat_range_product_entry);
 }
 
 /* Data structure that specifies how un_op should modify
@@ -1675,7 +2061,7 @@ static __isl_give isl_union_map *un_op(__isl_take isl_union_map *umap,
 			"inplace/total modification cannot be filtered",
 			return isl_union_map_free(umap));
 
-	if (control->total && umap->ref == 1)
+	if (control->total && isl_atomic_get(&umap->ref) == 1)
 		control->inplace = 1;
 	if (control->inplace) {
 		data.res = umap;
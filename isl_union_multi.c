@@ -452,7 +452,7 @@ static isl_bool FN(UNION,has_single_reference)(__isl_keep UNION *u)
 {
 	if (!u)
 		return isl_bool_error;
-	return u->ref == 1;
+	return isl_atomic_get(&u->ref) == 1;
 }
 
 static isl_stat FN(UNION,free_u_entry)(void **entry, void *user)
@@ -99,7 +99,7 @@ __isl_give UNION *FN(UNION,copy)(__isl_keep UNION *u)
 	if (!u)
 		return NULL;
 
-	u->ref++;
+	isl_atomic_inc(&u->ref);
 	return u;
 }
 
@@ -358,13 +358,16 @@ __isl_give UNION *FN(UNION,dup)(__isl_keep UNION *u)
 
 __isl_give UNION *FN(UNION,cow)(__isl_take UNION *u)
 {
+	UNION *dup;
+
 	if (!u)
 		return NULL;
 
-	if (u->ref == 1)
+	if (isl_atomic_get(&u->ref) == 1)
 		return u;
-	u->ref--;
-	return FN(UNION,dup)(u);
+	dup = FN(UNION,dup)(u);
+	FN(UNION,free)(u);
+	return dup;
 }
 
 __isl_null UNION *FN(UNION,free)(__isl_take UNION *u)
@@ -372,7 +375,7 @@ __isl_null UNION *FN(UNION,free)(__isl_take UNION *u)
 	if (!u)
 		return NULL;
 
-	if (--u->ref > 0)
+	if (isl_atomic_dec(&u->ref) > 0)
 		return NULL;
 
 	isl_hash_table_foreach(u->space->ctx, &u->table,
@@ -220,7 +220,7 @@ __isl_give isl_val *isl_val_copy(__isl_keep isl_val *v)
 	if (!v)
 		return NULL;
 
-	v->ref++;
+	isl_atomic_inc(&v->ref);
 	return v;
 }
 
@@ -248,13 +248,16 @@ __isl_give isl_val *isl_val_dup(__isl_keep isl_val *val)
  */
 __isl_give isl_val *isl_val_cow(__isl_take isl_val *val)
 {
+	isl_val *dup;
+
 	if (!val)
 		return NULL;
 
-	if (val->ref == 1)
+	if (isl_atomic_get(&val->ref) == 1)
 		return val;
-	val->ref--;
-	return isl_val_dup(val);
+	dup = isl_val_dup(val);
+	isl_val_free(val);
+	return dup;
 }
 
 /* Free "v" and return NULL.
@@ -264,7 +267,7 @@ __isl_null isl_val *isl_val_free(__isl_take isl_val *v)
 	if (!v)
 		return NULL;
 
-	if (--v->ref > 0)
+	if (isl_atomic_dec(&v->ref) > 0)
 		return NULL;
 
 	isl_ctx_deref(v->ctx);
@@ -383,7 +386,7 @@ uint32_t isl_val_get_hash(__isl_keep isl_val *val)
  */
 __isl_give isl_val *isl_val_normalize(__isl_take isl_val *v)
 {
-	isl_ctx *ctx;
+	struct isl_ctx_local *local;
 
 	if (!v)
 		return NULL;
@@ -395,12 +398,14 @@ __isl_give isl_val *isl_val_normalize(__isl_take isl_val *v)
 		isl_int_neg(v->d, v->d);
 		isl_int_neg(v->n, v->n);
 	}
-	ctx = isl_val_get_ctx(v);
-	isl_int_gcd(ctx->normalize_gcd, v->n, v->d);
-	if (isl_int_is_one(ctx->normalize_gcd))
+	local = isl_ctx_local(isl_val_get_ctx(v));
+	if (!local)
+		return isl_val_free(v);
+	isl_int_gcd(local->normalize_gcd, v->n, v->d);
+	if (isl_int_is_one(local->normalize_gcd))
 		return v;
-	isl_int_divexact(v->n, v->n, ctx->normalize_gcd);
-	isl_int_divexact(v->d, v->d, ctx->normalize_gcd);
+	isl_int_divexact(v->n, v->n, local->normalize_gcd);
+	isl_int_divexact(v->d, v->d, local->normalize_gcd);
 	return v;
 }
 
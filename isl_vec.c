@@ -10,6 +10,7 @@
  */
 
 #include <isl_ctx_private.h>
+#include <isl_arena_private.h>
 #include <isl_seq.h>
 #include <isl_val_private.h>
 #include <isl_vec_private.h>
@@ -33,7 +34,7 @@ __isl_give isl_vec *isl_vec_alloc(struct isl_ctx *ctx, unsigned size)
 {
 	struct isl_vec *vec;
 
-	vec = isl_alloc_type(ctx, struct isl_vec);
+	vec = isl_arena_alloc_type(ctx, struct isl_vec);
 	if (!vec)
 		return NULL;
 
@@ -50,7 +51,7 @@ __isl_give isl_vec *isl_vec_alloc(struct isl_ctx *ctx, unsigned size)
 	return vec;
 error:
 	isl_blk_free(ctx, vec->block);
-	free(vec);
+	isl_arena_free(ctx, vec);
 	return NULL;
 }
 
@@ -199,7 +200,7 @@ struct isl_vec *isl_vec_copy(struct isl_vec *vec)
 	if (!vec)
 		return NULL;
 
-	vec->ref++;
+	isl_atomic_inc(&vec->ref);
 	return vec;
 }
 
@@ -222,7 +223,7 @@ struct isl_vec *isl_vec_cow(struct isl_vec *vec)
 	if (!vec)
 		return NULL;
 
-	if (vec->ref == 1)
+	if (isl_atomic_get(&vec->ref) == 1)
 		return vec;
 
 	vec2 = isl_vec_dup(vec);
@@ -235,12 +236,12 @@ __isl_null isl_vec *isl_vec_free(__isl_take isl_vec *vec)
 	if (!vec)
 		return NULL;
 
-	if (--vec->ref > 0)
+	if (isl_atomic_dec(&vec->ref) > 0)
 		return NULL;
 
 	isl_ctx_deref(vec->ctx);
 	isl_blk_free(vec->ctx, vec->block);
-	free(vec);
+	isl_arena_free(vec->ctx, vec);
 
 	return NULL;
 }
@@ -6,12 +6,19 @@ const char *isl_version(void)
 	return GIT_HEAD_ID
 #ifdef USE_GMP_FOR_MP
 	"-GMP"
+#ifdef USE_SMALL_INT_OPT
+	"-64"
+#endif
 #endif
 #ifdef USE_IMATH_FOR_MP
 	"-IMath"
 #ifdef USE_SMALL_INT_OPT
+#ifdef USE_SMALL_INT_64
+	"-64"
+#else
 	"-32"
 #endif
+#endif
 #endif
 	"\n";
 }
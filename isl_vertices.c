@@ -8,6 +8,7 @@
  * 91893 Orsay, France 
  */
 
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_aff_private.h>
 #include <isl/set.h>
@@ -31,7 +32,7 @@ __isl_give isl_vertices *isl_vertices_copy(__isl_keep isl_vertices *vertices)
 	if (!vertices)
 		return NULL;
 
-	vertices->ref++;
+	isl_atomic_inc(&vertices->ref);
 	return vertices;
 }
 
@@ -42,7 +43,7 @@ __isl_null isl_vertices *isl_vertices_free(__isl_take isl_vertices *vertices)
 	if (!vertices)
 		return NULL;
 
-	if (--vertices->ref > 0)
+	if (isl_atomic_dec(&vertices->ref) > 0)
 		return NULL;
 
 	for (i = 0; i < vertices->n_vertices; ++i) {